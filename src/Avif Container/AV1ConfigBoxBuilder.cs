@@ -29,10 +29,22 @@ namespace AvifFileType.AvifContainer
                 ExceptionUtil.ThrowArgumentNullException(nameof(image));
             }
 
+            return Build(image.Width, image.Height, image.Format);
+        }
+
+        /// <summary>
+        /// Builds the <see cref="AV1ConfigBox"/> for an image with the specified size and format.
+        /// </summary>
+        /// <param name="width">The image width.</param>
+        /// <param name="height">The image height.</param>
+        /// <param name="format">The image format.</param>
+        /// <returns></returns>
+        public static AV1ConfigBox Build(int width, int height, YUVChromaSubsampling format)
+        {
             bool chromaSubsamplingX;
             bool chromaSubsamplingY;
 
-            switch (image.Format)
+            switch (format)
             {
                 case YUVChromaSubsampling.Subsampling400:
                 case YUVChromaSubsampling.Subsampling420:
@@ -51,17 +63,17 @@ namespace AvifFileType.AvifContainer
                     chromaSubsamplingY = false;
                     break;
                 default:
-                    throw new InvalidOperationException($"Unknown { nameof(YUVChromaSubsampling) } value: { image.Format }");
+                    throw new InvalidOperationException($"Unknown { nameof(YUVChromaSubsampling) } value: { format }");
             }
 
             return new AV1ConfigBox()
             {
-                SeqProfile = GetSeqProfile(image.Format),
-                SeqLevelIdx0 = GetSeqLevelIdx0(image),
+                SeqProfile = GetSeqProfile(format),
+                SeqLevelIdx0 = GetSeqLevelIdx0(width, height),
                 SeqTier0 = false,
                 HighBitDepth = false,
                 TwelveBit = false,
-                Monochrome = image.Format == YUVChromaSubsampling.Subsampling400,
+                Monochrome = format == YUVChromaSubsampling.Subsampling400,
                 ChromaSubsamplingX = chromaSubsamplingX,
                 ChromaSubsamplingY = chromaSubsamplingY,
                 ChromaSamplePosition = ChromaSamplePosition.Unknown
@@ -85,10 +97,8 @@ namespace AvifFileType.AvifContainer
             }
         }
 
-        private static SequenceLevel GetSeqLevelIdx0(CompressedAV1Image image)
+        private static SequenceLevel GetSeqLevelIdx0(int width, int height)
         {
-            int width = image.Width;
-            int height = image.Height;
             long imageSize = (long)width * height;
 
             // These values are from the Annex A.3 table: https://aomediacodec.github.io/av1-spec/av1-spec.pdf
@@ -12,6 +12,7 @@
 
 using System;
 using System.Globalization;
+using System.IO;
 
 namespace AvifFileType.AvifContainer
 {
@@ -19,6 +20,7 @@ namespace AvifFileType.AvifContainer
     {
         private long offsetWritePosition;
         private byte offsetSize;
+        private byte lengthSize;
 
         public ItemLocationExtent(in EndianBinaryReaderSegment reader, ItemLocationBox parent, ushort extentCount)
         {
@@ -129,12 +131,47 @@ namespace AvifFileType.AvifContainer
             }
         }
 
+        public void WriteFinalLength(BigEndianBinaryWriter writer, ulong finalLength)
+        {
+            if (this.offsetWritePosition == -1)
+            {
+                ExceptionUtil.ThrowInvalidOperationException("The item locations must have been written before calling this method.");
+            }
+
+            if (this.lengthSize != 0)
+            {
+                long oldPosition = writer.Position;
+                // The length is written after the offset.
+                writer.Position = this.offsetWritePosition + this.offsetSize;
+
+                switch (this.lengthSize)
+                {
+                    case 4:
+                        if (finalLength > uint.MaxValue)
+                        {
+                            throw new IOException($"The item length exceeds { uint.MaxValue } bytes.");
+                        }
+
+                        writer.Write((uint)finalLength);
+                        break;
+                    case 8:
+                        writer.Write(finalLength);
+                        break;
+                    default:
+                        throw new InvalidOperationException($"{ nameof(this.lengthSize) } must be 4 or 8, actual value: { this.lengthSize.ToString(CultureInfo.InvariantCulture) }");
+                }
+
+                writer.Position = oldPosition;
+            }
+        }
+
         public void Write(BigEndianBinaryWriter writer, ItemLocationBox parent)
         {
             if (this.offsetWritePosition == -1)
             {
                 this.offsetWritePosition = writer.Position;
                 this.offsetSize = parent.OffsetSize;
+                this.lengthSize = parent.LengthSize;
             }
 
             if (parent.Version == 1 || parent.Version == 2)
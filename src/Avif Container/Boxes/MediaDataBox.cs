@@ -10,17 +10,70 @@
 //
 ////////////////////////////////////////////////////////////////////////
 
+using System.IO;
+
 namespace AvifFileType.AvifContainer
 {
     internal sealed class MediaDataBox
         : Box
     {
         private readonly ulong dataLength;
+        private long headerWritePosition;
+        private bool isLargeBox;
 
         public MediaDataBox(ulong length)
             : base(BoxTypes.MediaData)
         {
             this.dataLength = length;
+            this.headerWritePosition = -1;
+        }
+
+        public override void Write(BigEndianBinaryWriter writer)
+        {
+            this.headerWritePosition = writer.Position;
+            this.isLargeBox = GetTotalBoxSize() > uint.MaxValue;
+
+            base.Write(writer);
+        }
+
+        /// <summary>
+        /// Updates the box size after the data has been written.
+        /// </summary>
+        /// <remarks>
+        /// This allows the box to be written before the final data length is known, the length
+        /// that was passed to the constructor must be large enough to select the correct size field.
+        /// </remarks>
+        /// <param name="writer">The writer.</param>
+        /// <param name="finalLength">The final data length.</param>
+        public void WriteFinalLength(BigEndianBinaryWriter writer, ulong finalLength)
+        {
+            if (this.headerWritePosition == -1)
+            {
+                ExceptionUtil.ThrowInvalidOperationException("The box must have been written before calling this method.");
+            }
+
+            long oldPosition = writer.Position;
+
+            if (this.isLargeBox)
+            {
+                // The 64-bit size is written after the size and type fields.
+                writer.Position = this.headerWritePosition + sizeof(uint) + FourCC.SizeOf;
+                writer.Write(base.GetTotalBoxSize() + sizeof(ulong) + finalLength);
+            }
+            else
+            {
+                ulong totalBoxSize = base.GetTotalBoxSize() + finalLength;
+
+                if (totalBoxSize > uint.MaxValue)
+                {
+                    throw new IOException($"The media data box size exceeds { uint.MaxValue } bytes.");
+                }
+
+                writer.Position = this.headerWritePosition;
+                writer.Write((uint)totalBoxSize);
+            }
+
+            writer.Position = oldPosition;
         }
 
         protected override ulong GetTotalBoxSize()
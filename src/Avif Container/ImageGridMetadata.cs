@@ -79,10 +79,16 @@ namespace AvifFileType.AvifContainer
 
         public bool IsValidForImage(uint documentWidth, uint documentHeight, YUVChromaSubsampling yuvFormat)
         {
+            // The grid must cover the image, the tiles in the last column and row can extend past its right and bottom edges.
+            ulong gridWidth = (ulong)this.TileColumnCount * this.TileImageWidth;
+            ulong gridHeight = (ulong)this.TileRowCount * this.TileImageHeight;
+
             return this.OutputWidth == documentWidth
                    && this.OutputHeight == documentHeight
-                   && (this.TileColumnCount * this.TileImageWidth) == documentWidth
-                   && (this.TileRowCount * this.TileImageHeight) == documentHeight
+                   && gridWidth >= documentWidth
+                   && gridHeight >= documentHeight
+                   && (gridWidth - this.TileImageWidth) < documentWidth
+                   && (gridHeight - this.TileImageHeight) < documentHeight
                    && IsValidForYUVFormat(yuvFormat);
         }
 
@@ -0,0 +1,454 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using AvifFileType.AvifContainer;
+
+namespace AvifFileType
+{
+    /// <summary>
+    /// Reads the image properties from an AV1 sequence header OBU without decoding the image.
+    /// </summary>
+    /// <remarks>
+    /// See the AV1 Bitstream and Decoding Process Specification, sections 5.3 and 5.5.
+    /// </remarks>
+    internal sealed class AV1SequenceHeader
+    {
+        private const int ObuTypeSequenceHeader = 1;
+
+        private AV1SequenceHeader()
+        {
+        }
+
+        public int SeqProfile { get; private set; }
+
+        public bool StillPicture { get; private set; }
+
+        public uint MaxFrameWidth { get; private set; }
+
+        public uint MaxFrameHeight { get; private set; }
+
+        public int BitDepth { get; private set; }
+
+        public bool Monochrome { get; private set; }
+
+        public bool ChromaSubsamplingX { get; private set; }
+
+        public bool ChromaSubsamplingY { get; private set; }
+
+        public CICPColorPrimaries ColorPrimaries { get; private set; }
+
+        public CICPTransferCharacteristics TransferCharacteristics { get; private set; }
+
+        public CICPMatrixCoefficients MatrixCoefficients { get; private set; }
+
+        public bool FullRange { get; private set; }
+
+        /// <summary>
+        /// Searches the specified OBU data for a sequence header.
+        /// </summary>
+        /// <param name="data">The OBU data.</param>
+        /// <returns>The sequence header, or <see langword="null"/> if the data does not contain a valid sequence header.</returns>
+        public static AV1SequenceHeader TryParse(byte[] data)
+        {
+            if (data is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(data));
+            }
+
+            int offset = 0;
+
+            while (offset < data.Length)
+            {
+                // obu_header(), see section 5.3.2.
+                byte obuHeader = data[offset++];
+
+                if ((obuHeader & 0x80) != 0)
+                {
+                    // The forbidden bit must be zero.
+                    return null;
+                }
+
+                int obuType = (obuHeader >> 3) & 0x0f;
+                bool obuExtensionFlag = (obuHeader & 0x04) != 0;
+                bool obuHasSizeField = (obuHeader & 0x02) != 0;
+
+                if (obuExtensionFlag)
+                {
+                    offset++;
+                }
+
+                if (offset > data.Length)
+                {
+                    return null;
+                }
+
+                ulong obuSize;
+
+                if (obuHasSizeField)
+                {
+                    if (!TryReadLeb128(data, ref offset, out obuSize))
+                    {
+                        return null;
+                    }
+                }
+                else
+                {
+                    obuSize = (ulong)(data.Length - offset);
+                }
+
+                ulong remainingBytes = (ulong)(data.Length - offset);
+
+                if (obuType == ObuTypeSequenceHeader)
+                {
+                    // The sequence header may extend past the end of the data if the caller only read
+                    // the start of the item, the bit reader reports an error if it runs out of data.
+                    int length = obuSize < remainingBytes ? (int)obuSize : (int)remainingBytes;
+
+                    return ParseSequenceHeaderObu(new BitReader(data, offset, length));
+                }
+
+                if (obuSize > remainingBytes)
+                {
+                    return null;
+                }
+
+                offset += (int)obuSize;
+            }
+
+            return null;
+        }
+
+        private static AV1SequenceHeader ParseSequenceHeaderObu(BitReader reader)
+        {
+            // sequence_header_obu(), see section 5.5.1.
+            AV1SequenceHeader header = new AV1SequenceHeader
+            {
+                SeqProfile = (int)reader.ReadBits(3),
+                StillPicture = reader.ReadBit() != 0
+            };
+
+            if (header.SeqProfile > 2)
+            {
+                return null;
+            }
+
+            bool reducedStillPictureHeader = reader.ReadBit() != 0;
+
+            if (reducedStillPictureHeader)
+            {
+                reader.ReadBits(5); // seq_level_idx[0]
+            }
+            else
+            {
+                bool decoderModelInfoPresent = false;
+                int bufferDelayLength = 0;
+
+                bool timingInfoPresent = reader.ReadBit() != 0;
+
+                if (timingInfoPresent)
+                {
+                    // timing_info()
+                    reader.ReadBits(32); // num_units_in_display_tick
+                    reader.ReadBits(32); // time_scale
+
+                    bool equalPictureInterval = reader.ReadBit() != 0;
+                    if (equalPictureInterval)
+                    {
+                        reader.SkipUvlc(); // num_ticks_per_picture_minus_1
+                    }
+
+                    decoderModelInfoPresent = reader.ReadBit() != 0;
+
+                    if (decoderModelInfoPresent)
+                    {
+                        // decoder_model_info()
+                        bufferDelayLength = (int)reader.ReadBits(5) + 1;
+                        reader.ReadBits(32); // num_units_in_decoding_tick
+                        reader.ReadBits(5); // buffer_removal_time_length_minus_1
+                        reader.ReadBits(5); // frame_presentation_time_length_minus_1
+                    }
+                }
+
+                bool initialDisplayDelayPresent = reader.ReadBit() != 0;
+                int operatingPointCount = (int)reader.ReadBits(5) + 1;
+
+                for (int i = 0; i < operatingPointCount; i++)
+                {
+                    reader.ReadBits(12); // operating_point_idc[i]
+
+                    uint seqLevelIdx = reader.ReadBits(5);
+                    if (seqLevelIdx > 7)
+                    {
+                        reader.ReadBit(); // seq_tier[i]
+                    }
+
+                    if (decoderModelInfoPresent)
+                    {
+                        bool decoderModelPresentForThisOp = reader.ReadBit() != 0;
+                        if (decoderModelPresentForThisOp)
+                        {
+                            // operating_parameters_info(i)
+                            reader.ReadBits(bufferDelayLength); // decoder_buffer_delay[i]
+                            reader.ReadBits(bufferDelayLength); // encoder_buffer_delay[i]
+                            reader.ReadBit(); // low_delay_mode_flag[i]
+                        }
+                    }
+
+                    if (initialDisplayDelayPresent)
+                    {
+                        bool initialDisplayDelayPresentForThisOp = reader.ReadBit() != 0;
+                        if (initialDisplayDelayPresentForThisOp)
+                        {
+                            reader.ReadBits(4); // initial_display_delay_minus_1[i]
+                        }
+                    }
+                }
+            }
+
+            int frameWidthBits = (int)reader.ReadBits(4) + 1;
+            int frameHeightBits = (int)reader.ReadBits(4) + 1;
+
+            header.MaxFrameWidth = reader.ReadBits(frameWidthBits) + 1;
+            header.MaxFrameHeight = reader.ReadBits(frameHeightBits) + 1;
+
+            if (!reducedStillPictureHeader)
+            {
+                bool frameIdNumbersPresent = reader.ReadBit() != 0;
+                if (frameIdNumbersPresent)
+                {
+                    reader.ReadBits(4); // delta_frame_id_length_minus_2
+                    reader.ReadBits(3); // additional_frame_id_length_minus_1
+                }
+            }
+
+            reader.ReadBit(); // use_128x128_superblock
+            reader.ReadBit(); // enable_filter_intra
+            reader.ReadBit(); // enable_intra_edge_filter
+
+            if (!reducedStillPictureHeader)
+            {
+                reader.ReadBit(); // enable_interintra_compound
+                reader.ReadBit(); // enable_masked_compound
+                reader.ReadBit(); // enable_warped_motion
+                reader.ReadBit(); // enable_dual_filter
+
+                bool enableOrderHint = reader.ReadBit() != 0;
+                if (enableOrderHint)
+                {
+                    reader.ReadBit(); // enable_jnt_comp
+                    reader.ReadBit(); // enable_ref_frame_mvs
+                }
+
+                bool seqChooseScreenContentTools = reader.ReadBit() != 0;
+                bool seqForceScreenContentTools = seqChooseScreenContentTools || reader.ReadBit() != 0;
+
+                if (seqForceScreenContentTools)
+                {
+                    bool seqChooseIntegerMv = reader.ReadBit() != 0;
+                    if (!seqChooseIntegerMv)
+                    {
+                        reader.ReadBit(); // seq_force_integer_mv
+                    }
+                }
+
+                if (enableOrderHint)
+                {
+                    reader.ReadBits(3); // order_hint_bits_minus_1
+                }
+            }
+
+            reader.ReadBit(); // enable_superres
+            reader.ReadBit(); // enable_cdef
+            reader.ReadBit(); // enable_restoration
+
+            ParseColorConfig(ref reader, header);
+
+            if (reader.EndOfData)
+            {
+                return null;
+            }
+
+            return header;
+        }
+
+        private static void ParseColorConfig(ref BitReader reader, AV1SequenceHeader header)
+        {
+            // color_config(), see section 5.5.2.
+            bool highBitDepth = reader.ReadBit() != 0;
+
+            if (header.SeqProfile == 2 && highBitDepth)
+            {
+                bool twelveBit = reader.ReadBit() != 0;
+                header.BitDepth = twelveBit ? 12 : 10;
+            }
+            else
+            {
+                header.BitDepth = highBitDepth ? 10 : 8;
+            }
+
+            header.Monochrome = header.SeqProfile != 1 && reader.ReadBit() != 0;
+
+            bool colorDescriptionPresent = reader.ReadBit() != 0;
+
+            if (colorDescriptionPresent)
+            {
+                header.ColorPrimaries = (CICPColorPrimaries)reader.ReadBits(8);
+                header.TransferCharacteristics = (CICPTransferCharacteristics)reader.ReadBits(8);
+                header.MatrixCoefficients = (CICPMatrixCoefficients)reader.ReadBits(8);
+            }
+            else
+            {
+                header.ColorPrimaries = CICPColorPrimaries.Unspecified;
+                header.TransferCharacteristics = CICPTransferCharacteristics.Unspecified;
+                header.MatrixCoefficients = CICPMatrixCoefficients.Unspecified;
+            }
+
+            if (header.Monochrome)
+            {
+                header.FullRange = reader.ReadBit() != 0;
+                header.ChromaSubsamplingX = true;
+                header.ChromaSubsamplingY = true;
+            }
+            else if (header.ColorPrimaries == CICPColorPrimaries.BT709
+                     && header.TransferCharacteristics == CICPTransferCharacteristics.Srgb
+                     && header.MatrixCoefficients == CICPMatrixCoefficients.Identity)
+            {
+                header.FullRange = true;
+                header.ChromaSubsamplingX = false;
+                header.ChromaSubsamplingY = false;
+            }
+            else
+            {
+                header.FullRange = reader.ReadBit() != 0;
+
+                if (header.SeqProfile == 0)
+                {
+                    header.ChromaSubsamplingX = true;
+                    header.ChromaSubsamplingY = true;
+                }
+                else if (header.SeqProfile == 1)
+                {
+                    header.ChromaSubsamplingX = false;
+                    header.ChromaSubsamplingY = false;
+                }
+                else if (header.BitDepth == 12)
+                {
+                    header.ChromaSubsamplingX = reader.ReadBit() != 0;
+                    header.ChromaSubsamplingY = header.ChromaSubsamplingX && reader.ReadBit() != 0;
+                }
+                else
+                {
+                    header.ChromaSubsamplingX = true;
+                    header.ChromaSubsamplingY = false;
+                }
+            }
+
+            // The remaining color_config() fields are not needed.
+        }
+
+        private static bool TryReadLeb128(byte[] data, ref int offset, out ulong value)
+        {
+            // leb128(), see section 4.10.5.
+            value = 0;
+
+            for (int i = 0; i < 8; i++)
+            {
+                if (offset >= data.Length)
+                {
+                    return false;
+                }
+
+                byte leb128Byte = data[offset++];
+
+                value |= (ulong)(leb128Byte & 0x7f) << (i * 7);
+
+                if ((leb128Byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        private struct BitReader
+        {
+            private readonly byte[] data;
+            private readonly int endOffset;
+            private int offset;
+            private int bitIndex;
+
+            public BitReader(byte[] data, int offset, int length)
+            {
+                this.data = data;
+                this.offset = offset;
+                this.endOffset = offset + length;
+                this.bitIndex = 0;
+                this.EndOfData = false;
+            }
+
+            /// <summary>
+            /// Gets a value indicating whether a read went past the end of the data.
+            /// </summary>
+            public bool EndOfData { get; private set; }
+
+            public uint ReadBit()
+            {
+                if (this.offset >= this.endOffset)
+                {
+                    this.EndOfData = true;
+                    return 0;
+                }
+
+                uint bit = (uint)(this.data[this.offset] >> (7 - this.bitIndex)) & 1;
+
+                this.bitIndex++;
+                if (this.bitIndex == 8)
+                {
+                    this.bitIndex = 0;
+                    this.offset++;
+                }
+
+                return bit;
+            }
+
+            public uint ReadBits(int count)
+            {
+                uint value = 0;
+
+                for (int i = 0; i < count; i++)
+                {
+                    value = (value << 1) | ReadBit();
+                }
+
+                return value;
+            }
+
+            public void SkipUvlc()
+            {
+                // uvlc(), see section 4.10.3.
+                int leadingZeros = 0;
+
+                while (ReadBit() == 0 && !this.EndOfData)
+                {
+                    leadingZeros++;
+                }
+
+                if (leadingZeros < 32)
+                {
+                    ReadBits(leadingZeros);
+                }
+            }
+        }
+    }
+}
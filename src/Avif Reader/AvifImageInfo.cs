@@ -0,0 +1,77 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using AvifFileType.AvifContainer;
+using AvifFileType.Interop;
+
+namespace AvifFileType
+{
+    /// <summary>
+    /// The properties of an AVIF image that can be read without decoding it.
+    /// </summary>
+    internal sealed class AvifImageInfo
+    {
+        public AvifImageInfo(int width,
+                             int height,
+                             int bitDepth,
+                             YUVChromaSubsampling chromaSubsampling,
+                             bool hasTransparency,
+                             CICPColorData? colorData,
+                             byte[] iccProfile,
+                             ImageGridMetadata imageGridMetadata)
+        {
+            this.Width = width;
+            this.Height = height;
+            this.BitDepth = bitDepth;
+            this.ChromaSubsampling = chromaSubsampling;
+            this.HasTransparency = hasTransparency;
+            this.ColorData = colorData;
+            this.IccProfile = iccProfile;
+            this.ImageGridMetadata = imageGridMetadata;
+        }
+
+        /// <summary>
+        /// Gets the width of the image after the crop and rotation transforms have been applied.
+        /// </summary>
+        public int Width { get; }
+
+        /// <summary>
+        /// Gets the height of the image after the crop and rotation transforms have been applied.
+        /// </summary>
+        public int Height { get; }
+
+        public int BitDepth { get; }
+
+        public YUVChromaSubsampling ChromaSubsampling { get; }
+
+        public bool HasTransparency { get; }
+
+        /// <summary>
+        /// Gets the CICP color data from the container or the AV1 sequence header.
+        /// </summary>
+        /// <value>
+        /// The CICP color data, or <see langword="null"/> if the image does not have any.
+        /// </value>
+        public CICPColorData? ColorData { get; }
+
+        public byte[] IccProfile { get; }
+
+        /// <summary>
+        /// Gets the image grid layout.
+        /// </summary>
+        /// <value>
+        /// The image grid layout, or <see langword="null"/> if the image is not an image grid.
+        /// </value>
+        public ImageGridMetadata ImageGridMetadata { get; }
+    }
+}
@@ -15,6 +15,7 @@ using PaintDotNet;
 using PaintDotNet.AppModel;
 using System;
 using System.IO;
+using System.IO.MemoryMappedFiles;
 using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 
@@ -227,4 +228,81 @@ namespace AvifFileType
             }
         }
     }
+
+    internal sealed class MemoryMappedAvifItemData
+        : AvifItemData
+    {
+        private MemoryMappedViewAccessor view;
+
+        public MemoryMappedAvifItemData(MemoryMappedFile file, long offset, ulong length)
+            : base()
+        {
+            this.view = file.CreateViewAccessor(offset, checked((long)length), MemoryMappedFileAccess.Read);
+            this.Length = length;
+        }
+
+        protected override void Dispose(bool disposing)
+        {
+            if (disposing)
+            {
+                if (this.view != null)
+                {
+                    this.view.Dispose();
+                    this.view = null;
+                }
+            }
+
+            base.Dispose(disposing);
+        }
+
+        protected override Stream GetStreamImpl()
+        {
+            // The UnmanagedMemoryStream class does not take ownership of the SafeBuffer.
+            return new UnmanagedMemoryStream(this.view.SafeMemoryMappedViewHandle,
+                                             this.view.PointerOffset,
+                                             checked((long)this.Length),
+                                             FileAccess.Read);
+        }
+
+        protected override unsafe byte[] ToArrayImpl()
+        {
+            ulong length = this.Length;
+
+            byte[] array = new byte[length];
+
+            UseBufferPointerImpl((readPtr, readLength) =>
+            {
+                fixed (byte* writePtr = array)
+                {
+                    Buffer.MemoryCopy(readPtr, writePtr, length, length);
+                }
+            });
+
+            return array;
+        }
+
+        protected override unsafe void UseBufferPointerImpl(UseBufferPointerDelegate action)
+        {
+            SafeBuffer handle = this.view.SafeMemoryMappedViewHandle;
+
+            byte* ptr = null;
+            RuntimeHelpers.PrepareDelegate(action);
+            RuntimeHelpers.PrepareConstrainedRegions();
+            try
+            {
+                handle.AcquirePointer(ref ptr);
+
+                // The start of the view is aligned to the system allocation granularity,
+                // the PointerOffset property is the distance from the start of the view to the item data.
+                action(ptr + this.view.PointerOffset, this.Length);
+            }
+            finally
+            {
+                if (ptr != null)
+                {
+                    handle.ReleasePointer();
+                }
+            }
+        }
+    }
 }
@@ -16,6 +16,7 @@ using System;
 using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
+using System.IO.MemoryMappedFiles;
 using System.Linq;
 
 namespace AvifFileType
@@ -35,6 +36,9 @@ namespace AvifFileType
         private FileTypeBox fileTypeBox;
         private MetaBox metaBox;
         private EndianBinaryReader reader;
+        private MemoryMappedFile memoryMappedFile;
+        private bool memoryMappedFileCreated;
+        private readonly Stream stream;
         private readonly ulong fileLength;
         private readonly IArrayPoolService arrayPool;
 
@@ -46,13 +50,24 @@ namespace AvifFileType
             }
 
             this.arrayPool = arrayPool;
+            this.stream = stream;
             this.reader = new EndianBinaryReader(stream, Endianess.Big, leaveOpen, arrayPool);
             Parse();
             this.fileLength = (ulong)stream.Length;
+            // The memory mapped file is created when the first item is read, this avoids
+            // the cost of creating it when only the image properties are needed.
+            this.memoryMappedFile = null;
+            this.memoryMappedFileCreated = false;
         }
 
         public void Dispose()
         {
+            if (this.memoryMappedFile != null)
+            {
+                this.memoryMappedFile.Dispose();
+                this.memoryMappedFile = null;
+            }
+
             if (this.reader != null)
             {
                 this.reader.Dispose();
@@ -178,7 +193,19 @@ namespace AvifFileType
 
                 ulong totalItemSize = entry.TotalItemSize;
 
-                if (totalItemSize <= ManagedAvifItemDataMaxSize)
+                if (!this.memoryMappedFileCreated)
+                {
+                    this.memoryMappedFile = TryCreateMemoryMappedFile(this.stream);
+                    this.memoryMappedFileCreated = true;
+                }
+
+                if (this.memoryMappedFile != null && totalItemSize > 0)
+                {
+                    // The item data is read directly from the memory mapped file, this avoids
+                    // making a copy of the compressed data.
+                    data = new MemoryMappedAvifItemData(this.memoryMappedFile, offset, totalItemSize);
+                }
+                else if (totalItemSize <= ManagedAvifItemDataMaxSize)
                 {
                     ManagedAvifItemData managedItemData = new ManagedAvifItemData((int)totalItemSize, this.arrayPool);
 
@@ -211,6 +238,41 @@ namespace AvifFileType
             return data;
         }
 
+        /// <summary>
+        /// Reads the start of the item data.
+        /// </summary>
+        /// <remarks>
+        /// Only the first extent is read, this is used to read the headers at the start of
+        /// an item without reading the whole item into memory.
+        /// </remarks>
+        /// <param name="entry">The item location entry.</param>
+        /// <param name="maxLength">The maximum number of bytes to read.</param>
+        /// <returns>The bytes at the start of the item.</returns>
+        public byte[] ReadItemDataPrefix(ItemLocationEntry entry, int maxLength)
+        {
+            if (entry is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(entry));
+            }
+
+            if (entry.Extents.Count == 0)
+            {
+                ExceptionUtil.ThrowFormatException("The item does not have any extents.");
+            }
+
+            ItemLocationExtent extent = entry.Extents[0];
+
+            long offset = CalculateExtentOffset(entry.BaseOffset, entry.ConstructionMethod, extent);
+            ulong extentLength = entry.Extents.Count == 1 ? entry.TotalItemSize : extent.Length;
+
+            byte[] bytes = new byte[(int)Math.Min(extentLength, (ulong)maxLength)];
+
+            this.reader.Position = offset;
+            this.reader.ProperRead(bytes, 0, bytes.Length);
+
+            return bytes;
+        }
+
         public TProperty TryGetAssociatedItemProperty<TProperty>(uint itemId) where TProperty : class, IItemProperty
         {
             if (typeof(TProperty).IsAbstract)
@@ -404,6 +466,32 @@ namespace AvifFileType
             }
         }
 
+        private static MemoryMappedFile TryCreateMemoryMappedFile(Stream stream)
+        {
+            // Only streams that read from a file on disk can be memory mapped, the other
+            // stream types will copy the item data into a managed or unmanaged buffer.
+            if (stream is FileStream fileStream && fileStream.Length > 0)
+            {
+                try
+                {
+                    return MemoryMappedFile.CreateFromFile(fileStream,
+                                                           null,
+                                                           0,
+                                                           MemoryMappedFileAccess.Read,
+                                                           HandleInheritability.None,
+                                                           leaveOpen: true);
+                }
+                catch (IOException)
+                {
+                }
+                catch (UnauthorizedAccessException)
+                {
+                }
+            }
+
+            return null;
+        }
+
         private bool IsAlphaChannelItem(uint itemId)
         {
             AuxiliaryTypePropertyBox auxiliaryTypeBox = TryGetAssociatedItemProperty<AuxiliaryTypePropertyBox>(itemId);
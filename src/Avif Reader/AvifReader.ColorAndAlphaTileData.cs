@@ -0,0 +1,42 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using System;
+
+namespace AvifFileType
+{
+    internal sealed partial class AvifReader
+    {
+        /// <summary>
+        /// The compressed color and alpha images of an image grid tile.
+        /// </summary>
+        private sealed class ColorAndAlphaTileData : IDisposable
+        {
+            public ColorAndAlphaTileData(AvifItemData color, AvifItemData alpha)
+            {
+                this.Color = color;
+                this.Alpha = alpha;
+            }
+
+            public AvifItemData Color { get; }
+
+            public AvifItemData Alpha { get; }
+
+            public void Dispose()
+            {
+                this.Color?.Dispose();
+                this.Alpha?.Dispose();
+            }
+        }
+    }
+}
@@ -18,12 +18,20 @@ using System;
 using System.Collections.Generic;
 using System.Drawing;
 using System.IO;
+using System.Runtime.ExceptionServices;
+using System.Threading.Tasks;
 
 namespace AvifFileType
 {
-    internal sealed class AvifReader
+    internal sealed partial class AvifReader
         : IDisposable
     {
+        // The sequence header OBU is normally a few dozen bytes, this leaves room for
+        // the timing and operating point information that precedes the color configuration.
+        private const int SequenceHeaderMaxReadLength = 1024;
+        // This must be kept in sync with MaxDownsampleShift in ImageDownsampler.h.
+        private const int MaxDownsampleShift = 8;
+
         private bool disposed;
         private readonly AvifParser parser;
         private readonly uint primaryItemId;
@@ -35,6 +43,7 @@ namespace AvifFileType
         private readonly ImageGridInfo alphaGridInfo;
         private readonly IccProfileColorInformation iccProfileColorInformation;
         private readonly NclxColorInformation nclxColorInformation;
+        private readonly DecoderOptions decoderOptions;
 
         /// <summary>
         /// Initializes a new instance of the <see cref="AvifReader"/> class.
@@ -66,6 +75,11 @@ namespace AvifFileType
                                                     out this.cleanApertureBox,
                                                     out this.imageRotateBox,
                                                     out this.imageMirrorBox);
+            this.decoderOptions = new DecoderOptions
+            {
+                maxThreads = Environment.ProcessorCount,
+                rowMultithreading = true
+            };
             this.colorGridInfo = this.parser.TryGetImageGridInfo(this.primaryItemId);
             if (this.alphaItemId != 0)
             {
@@ -114,36 +128,68 @@ namespace AvifFileType
 
             Size colorSize = GetImageSize(this.primaryItemId, this.colorGridInfo, "color");
 
-            Surface surface = new Surface(colorSize);
-            bool disposeSurface = true;
+            return DecodeImage(colorSize, GetCropRectangle(colorSize), 0);
+        }
 
-            try
-            {
-                ProcessColorImage(surface);
-                if (this.alphaItemId != 0)
-                {
-                    ProcessAlphaImage(surface);
-                }
-                else
-                {
-                    // The AVIF file does not have an alpha channel.
-                    new UnaryPixelOps.SetAlphaChannelTo255().Apply(surface, surface.Bounds);
-                }
-                ApplyImageTransforms(ref surface);
+        /// <summary>
+        /// Decodes a region of the image.
+        /// </summary>
+        /// <remarks>
+        /// The region is specified in the coordinates of the output image, after the crop, rotation
+        /// and mirror transforms have been applied. When the image is an image grid only the tiles
+        /// that overlap the region are decoded.
+        /// </remarks>
+        /// <param name="region">The region of the output image to decode.</param>
+        /// <returns>The decoded region.</returns>
+        /// <exception cref="ArgumentOutOfRangeException">
+        /// <paramref name="region"/> is empty or is not within the bounds of the output image.
+        /// </exception>
+        public Surface Decode(Rectangle region)
+        {
+            VerifyNotDisposed();
+            EnsureCompressedImagesAreAV1();
+            EnsurePrimaryItemIsNotHidden();
+            EnsureRequiredImagePropertiesAreSupported();
 
-                disposeSurface = false;
+            Size colorSize = GetImageSize(this.primaryItemId, this.colorGridInfo, "color");
+            Size outputSize = GetTransformedImageSize(colorSize);
+
+            if (region.Width <= 0 || region.Height <= 0 || !new Rectangle(Point.Empty, outputSize).Contains(region))
+            {
+                ExceptionUtil.ThrowArgumentOutOfRangeException(nameof(region), "The region must not be empty and must be within the image bounds.");
             }
-            finally
+
+            return DecodeImage(colorSize, GetSourceRegion(region, colorSize), 0);
+        }
+
+        /// <summary>
+        /// Decodes a reduced size copy of the image.
+        /// </summary>
+        /// <remarks>
+        /// The image is downsampled by a power of two in the YUV domain as each image or tile is decoded,
+        /// so the memory usage scales with the thumbnail size instead of the full image size.
+        /// The longest side of the output will be at least <paramref name="targetSize"/> pixels,
+        /// unless the image is smaller than that.
+        /// </remarks>
+        /// <param name="targetSize">The target size of the longest side of the image.</param>
+        /// <returns>The decoded image.</returns>
+        /// <exception cref="ArgumentOutOfRangeException"><paramref name="targetSize"/> is less than 1.</exception>
+        public Surface DecodeThumbnail(int targetSize)
+        {
+            if (targetSize < 1)
             {
-                // Free the surface if an exception was thrown when populating it.
-                if (disposeSurface)
-                {
-                    surface.Dispose();
-                    surface = null;
-                }
+                ExceptionUtil.ThrowArgumentOutOfRangeException(nameof(targetSize), "Must be greater than zero.");
             }
 
-            return surface;
+            VerifyNotDisposed();
+            EnsureCompressedImagesAreAV1();
+            EnsurePrimaryItemIsNotHidden();
+            EnsureRequiredImagePropertiesAreSupported();
+
+            Size colorSize = GetImageSize(this.primaryItemId, this.colorGridInfo, "color");
+            Rectangle cropRect = GetCropRectangle(colorSize);
+
+            return DecodeImage(colorSize, cropRect, GetThumbnailDownsampleShift(cropRect.Size, targetSize));
         }
 
         public void Dispose()
@@ -203,6 +249,112 @@ namespace AvifFileType
             return null;
         }
 
+        /// <summary>
+        /// Gets the image properties without decoding the image.
+        /// </summary>
+        /// <remarks>
+        /// The properties are read from the item property boxes, the AV1 sequence header
+        /// is only read when the container does not have the required information.
+        /// </remarks>
+        /// <returns>The image properties.</returns>
+        public AvifImageInfo GetImageInfo()
+        {
+            VerifyNotDisposed();
+            EnsureCompressedImagesAreAV1();
+            EnsurePrimaryItemIsNotHidden();
+
+            Size imageSize = GetImageSize(this.primaryItemId, this.colorGridInfo, "color");
+
+            uint firstImageId = this.primaryItemId;
+            ImageGridMetadata imageGridMetadata = null;
+
+            if (this.colorGridInfo != null)
+            {
+                this.colorGridInfo.CheckAvailableTileCount();
+
+                firstImageId = this.colorGridInfo.ChildImageIds[0];
+
+                Size tileSize = GetImageSize(firstImageId, null, "color");
+
+                imageGridMetadata = new ImageGridMetadata(this.colorGridInfo, (uint)tileSize.Height, (uint)tileSize.Width);
+            }
+
+            CICPColorData? colorData = GetContainerColorData();
+            AV1ConfigBox configBox = this.parser.TryGetAssociatedItemProperty<AV1ConfigBox>(firstImageId);
+            AV1SequenceHeader sequenceHeader = null;
+
+            if (configBox is null || !colorData.HasValue)
+            {
+                sequenceHeader = ReadSequenceHeader(firstImageId);
+            }
+
+            int bitDepth;
+            bool monochrome;
+            bool chromaSubsamplingX;
+            bool chromaSubsamplingY;
+
+            if (configBox != null)
+            {
+                bitDepth = configBox.HighBitDepth ? (configBox.TwelveBit ? 12 : 10) : 8;
+                monochrome = configBox.Monochrome;
+                chromaSubsamplingX = configBox.ChromaSubsamplingX;
+                chromaSubsamplingY = configBox.ChromaSubsamplingY;
+            }
+            else if (sequenceHeader != null)
+            {
+                bitDepth = sequenceHeader.BitDepth;
+                monochrome = sequenceHeader.Monochrome;
+                chromaSubsamplingX = sequenceHeader.ChromaSubsamplingX;
+                chromaSubsamplingY = sequenceHeader.ChromaSubsamplingY;
+            }
+            else
+            {
+                throw new FormatException("The color image does not have an AV1 configuration property.");
+            }
+
+            if (!colorData.HasValue && sequenceHeader != null)
+            {
+                colorData = new CICPColorData
+                {
+                    colorPrimaries = sequenceHeader.ColorPrimaries,
+                    transferCharacteristics = sequenceHeader.TransferCharacteristics,
+                    matrixCoefficients = sequenceHeader.MatrixCoefficients,
+                    fullRange = sequenceHeader.FullRange
+                };
+            }
+
+            YUVChromaSubsampling chromaSubsampling;
+
+            // This matches the chroma subsampling that the decoder reports for the image.
+            if (monochrome)
+            {
+                chromaSubsampling = YUVChromaSubsampling.Subsampling400;
+            }
+            else if (colorData.HasValue && colorData.Value.matrixCoefficients == CICPMatrixCoefficients.Identity)
+            {
+                chromaSubsampling = YUVChromaSubsampling.IdentityMatrix;
+            }
+            else if (chromaSubsamplingX)
+            {
+                chromaSubsampling = chromaSubsamplingY ? YUVChromaSubsampling.Subsampling420 : YUVChromaSubsampling.Subsampling422;
+            }
+            else
+            {
+                chromaSubsampling = YUVChromaSubsampling.Subsampling444;
+            }
+
+            Size outputSize = GetTransformedImageSize(imageSize);
+
+            return new AvifImageInfo(outputSize.Width,
+                                     outputSize.Height,
+                                     bitDepth,
+                                     chromaSubsampling,
+                                     this.alphaItemId != 0,
+                                     colorData,
+                                     GetICCProfile(),
+                                     imageGridMetadata);
+        }
+
         public byte[] GetICCProfile()
         {
             return this.iccProfileColorInformation?.GetProfileBytes();
@@ -263,51 +415,63 @@ namespace AvifFileType
             }
         }
 
-        private void ApplyImageTransforms(ref Surface surface)
+        private static uint GetDownsampledDimension(uint value, uint downsampleShift)
         {
-            // The image transforms must be applied in the following order:
-            // Crop
-            // Rotate
-            // Flip horizontal or vertical
+            return (value + ((1U << (int)downsampleShift) - 1)) >> (int)downsampleShift;
+        }
 
-            if (this.cleanApertureBox != null)
+        private static Rectangle GetDownsampledRegion(Rectangle region, uint downsampleShift)
+        {
+            if (downsampleShift == 0)
             {
-                ImageTransform.Crop(this.cleanApertureBox, ref surface);
+                return region;
             }
 
-            if (this.imageRotateBox != null)
+            int shift = (int)downsampleShift;
+
+            return Rectangle.FromLTRB(region.Left >> shift,
+                                      region.Top >> shift,
+                                      (int)GetDownsampledDimension((uint)region.Right, downsampleShift),
+                                      (int)GetDownsampledDimension((uint)region.Bottom, downsampleShift));
+        }
+
+        private OutputMirror GetOutputMirror()
+        {
+            if (this.imageMirrorBox is null)
             {
-                switch (this.imageRotateBox.Rotation)
-                {
-                    case ImageRotation.RotateNone:
-                        break;
-                    case ImageRotation.Rotate90CCW:
-                        ImageTransform.Rotate90CCW(ref surface);
-                        break;
-                    case ImageRotation.Rotate180:
-                        ImageTransform.Rotate180(surface);
-                        break;
-                    case ImageRotation.Rotate270CCW:
-                        ImageTransform.Rotate270CCW(ref surface);
-                        break;
-                    default:
-                        throw new InvalidOperationException("Unknown ImageRotation value.");
-                }
+                return OutputMirror.None;
             }
 
-            if (this.imageMirrorBox != null)
+            switch (this.imageMirrorBox.MirrorDirection)
             {
-                switch (this.imageMirrorBox.MirrorDirection)
-                {
-                    case ImageMirrorDirection.Vertical:
-                        ImageTransform.FlipVertical(surface);
-                        break;
-                    case ImageMirrorDirection.Horizontal:
-                        ImageTransform.FlipHorizontal(surface);
-                        break;
-                    default:
-                        throw new InvalidOperationException("Unknown ImageMirrorDirection value.");
-                }
+                case ImageMirrorDirection.Vertical:
+                    return OutputMirror.Vertical;
+                case ImageMirrorDirection.Horizontal:
+                    return OutputMirror.Horizontal;
+                default:
+                    throw new InvalidOperationException("Unknown ImageMirrorDirection value.");
+            }
+        }
+
+        private OutputRotation GetOutputRotation()
+        {
+            if (this.imageRotateBox is null)
+            {
+                return OutputRotation.None;
+            }
+
+            switch (this.imageRotateBox.Rotation)
+            {
+                case ImageRotation.RotateNone:
+                    return OutputRotation.None;
+                case ImageRotation.Rotate90CCW:
+                    return OutputRotation.Rotate90CCW;
+                case ImageRotation.Rotate180:
+                    return OutputRotation.Rotate180;
+                case ImageRotation.Rotate270CCW:
+                    return OutputRotation.Rotate270CCW;
+                default:
+                    throw new InvalidOperationException("Unknown ImageRotation value.");
             }
         }
 
@@ -390,20 +554,144 @@ namespace AvifFileType
             }
         }
 
-        private void DecodeColorImage(uint itemId, DecodeInfo decodeInfo, CICPColorData? colorConversionInfo, Surface fullSurface)
+        /// <summary>
+        /// Decodes a region of the image.
+        /// </summary>
+        /// <param name="colorSize">The size of the color image.</param>
+        /// <param name="sourceRegion">The region of the color image to decode, before the rotation and mirror transforms are applied.</param>
+        /// <param name="downsampleShift">The power of two that the image is downsampled by.</param>
+        /// <returns>The decoded image.</returns>
+        private Surface DecodeImage(Size colorSize, Rectangle sourceRegion, uint downsampleShift)
+        {
+            // The image transforms must be applied in the following order:
+            // Crop
+            // Rotate
+            // Flip horizontal or vertical
+            //
+            // The native code applies the transforms as the decoded pixels are written to the surface,
+            // the crop is the decoded region and the rotation and mirror are part of the DecodeInfo.
+            Size outputSize = GetDownsampledRegion(sourceRegion, downsampleShift).Size;
+
+            OutputRotation rotation = GetOutputRotation();
+
+            if (rotation == OutputRotation.Rotate90CCW || rotation == OutputRotation.Rotate270CCW)
+            {
+                outputSize = new Size(outputSize.Height, outputSize.Width);
+            }
+
+            // The color image conversion sets the alpha channel to opaque, so an image without
+            // an alpha channel does not need a separate pass over the surface.
+            bool decodeAlphaSeparately = this.alphaItemId != 0 && !CanDecodeColorAndAlphaTogether();
+            AvifLoadReport report = new AvifLoadReport(outputSize.Width,
+                                                       outputSize.Height,
+                                                       downsampleShift,
+                                                       GetTileCount(this.colorGridInfo),
+                                                       decodeAlphaSeparately ? GetTileCount(this.alphaGridInfo) : 0);
+
+            Surface surface = new Surface(outputSize);
+            bool disposeSurface = true;
+
+            try
+            {
+                if (this.alphaItemId == 0)
+                {
+                    ProcessColorImage(surface, colorSize, sourceRegion, downsampleShift, report);
+                }
+                else if (!decodeAlphaSeparately)
+                {
+                    ProcessColorAndAlphaImage(surface, colorSize, sourceRegion, downsampleShift, report);
+                }
+                else
+                {
+                    ProcessColorImage(surface, colorSize, sourceRegion, downsampleShift, report);
+                    ProcessAlphaImage(surface, colorSize, sourceRegion, downsampleShift, report);
+                }
+
+                disposeSurface = false;
+            }
+            finally
+            {
+                // Free the surface if an exception was thrown when populating it.
+                if (disposeSurface)
+                {
+                    surface.Dispose();
+                    surface = null;
+                }
+            }
+
+            report.DecodeCompleted();
+
+            return surface;
+        }
+
+        private void DecodeColorImage(uint itemId,
+                                      DecodeInfo decodeInfo,
+                                      CICPColorData? colorConversionInfo,
+                                      Surface fullSurface,
+                                      out DecodeStats stats)
         {
             using (AvifItemData color = ReadColorImage(itemId))
             {
-                AvifNative.DecompressColor(color, colorConversionInfo, decodeInfo, fullSurface);
+                AvifNative.DecompressColor(color, this.decoderOptions, colorConversionInfo, decodeInfo, fullSurface, out stats);
             }
         }
 
-        private void DecodeAlphaImage(uint itemId, DecodeInfo decodeInfo, Surface fullSurface)
+        private void DecodeAlphaImage(uint itemId, DecodeInfo decodeInfo, Surface fullSurface, out DecodeStats stats)
         {
             using (AvifItemData alpha = ReadAlphaImage(itemId))
             {
-                AvifNative.DecompressAlpha(alpha, decodeInfo, fullSurface);
+                AvifNative.DecompressAlpha(alpha, this.decoderOptions, decodeInfo, fullSurface, out stats);
+            }
+        }
+
+        private void DecodeColorAndAlphaImage(uint colorItemId,
+                                              uint alphaItemId,
+                                              DecodeInfo colorDecodeInfo,
+                                              DecodeInfo alphaDecodeInfo,
+                                              CICPColorData? colorConversionInfo,
+                                              Surface fullSurface,
+                                              out DecodeStats stats)
+        {
+            using (AvifItemData color = ReadColorImage(colorItemId))
+            using (AvifItemData alpha = ReadAlphaImage(alphaItemId))
+            {
+                AvifNative.DecompressColorAndAlpha(color,
+                                                   alpha,
+                                                   this.decoderOptions,
+                                                   colorConversionInfo,
+                                                   colorDecodeInfo,
+                                                   alphaDecodeInfo,
+                                                   fullSurface,
+                                                   out stats);
+            }
+        }
+
+        private bool CanDecodeColorAndAlphaTogether()
+        {
+            // The color and alpha images are decoded together when each color image or tile
+            // has an alpha image or tile that covers the same area.
+            if (this.colorGridInfo is null || this.alphaGridInfo is null)
+            {
+                return this.colorGridInfo is null && this.alphaGridInfo is null;
+            }
+
+            if (this.colorGridInfo.TileColumnCount != this.alphaGridInfo.TileColumnCount
+                || this.colorGridInfo.TileRowCount != this.alphaGridInfo.TileRowCount
+                || this.colorGridInfo.OutputWidth != this.alphaGridInfo.OutputWidth
+                || this.colorGridInfo.OutputHeight != this.alphaGridInfo.OutputHeight
+                || this.colorGridInfo.ChildImageIds.Count == 0
+                || this.alphaGridInfo.ChildImageIds.Count == 0)
+            {
+                return false;
             }
+
+            ImageSpatialExtentsBox colorTileExtents = this.parser.TryGetAssociatedItemProperty<ImageSpatialExtentsBox>(this.colorGridInfo.ChildImageIds[0]);
+            ImageSpatialExtentsBox alphaTileExtents = this.parser.TryGetAssociatedItemProperty<ImageSpatialExtentsBox>(this.alphaGridInfo.ChildImageIds[0]);
+
+            return colorTileExtents != null
+                && alphaTileExtents != null
+                && colorTileExtents.ImageWidth == alphaTileExtents.ImageWidth
+                && colorTileExtents.ImageHeight == alphaTileExtents.ImageHeight;
         }
 
         private void EnsureCompressedImagesAreAV1()
@@ -440,81 +728,228 @@ namespace AvifFileType
             }
         }
 
-        private void FillAlphaImageGrid(Surface fullSurface)
+        private void FillAlphaImageGrid(Surface fullSurface,
+                                        Size imageSize,
+                                        Rectangle sourceRegion,
+                                        uint downsampleShift,
+                                        AvifLoadReport report)
         {
             this.alphaGridInfo.CheckAvailableTileCount();
-            DecodeInfo decodeInfo = new DecodeInfo
-            {
-                expectedWidth = 0,
-                expectedHeight = 0
-            };
+            IReadOnlyList<int> tileIndices = GetGridTileIndices(this.alphaGridInfo, imageSize, sourceRegion, "alpha");
+            DecodeInfo decodeInfo = CreateGridTileDecodeInfo(this.alphaGridInfo, tileIndices[0], sourceRegion, downsampleShift);
 
             IReadOnlyList<uint> childImageIds = this.alphaGridInfo.ChildImageIds;
-            bool firstTile = true;
 
-            // The tiles are encoded from top to bottom then left to right.
+            // The first tile is decoded before the others because it sets the tile size and format
+            // that the remaining tiles are validated against.
+            DecodeAlphaImage(childImageIds[tileIndices[0]], decodeInfo, fullSurface, out report.AlphaTileStats[tileIndices[0]]);
+            CheckImageGridAndTileBounds(decodeInfo.expectedWidth,
+                                        decodeInfo.expectedHeight,
+                                        decodeInfo.chromaSubsampling,
+                                        this.alphaGridInfo);
+
+            DecodeRemainingGridTiles(tileIndices,
+                                     (index) => ReadAlphaImage(childImageIds[index]),
+                                     (alpha, options, index) =>
+                                     {
+                                         DecodeInfo tileDecodeInfo = CreateRemainingTileDecodeInfo(decodeInfo, index, this.alphaGridInfo);
+
+                                         AvifNative.DecompressAlpha(alpha, options, tileDecodeInfo, fullSurface, out report.AlphaTileStats[index]);
+                                     });
+        }
+
+        private void FillColorAndAlphaImageGrid(CICPColorData? colorInfo,
+                                                Surface fullSurface,
+                                                Size imageSize,
+                                                Rectangle sourceRegion,
+                                                uint downsampleShift,
+                                                AvifLoadReport report)
+        {
+            this.colorGridInfo.CheckAvailableTileCount();
+            this.alphaGridInfo.CheckAvailableTileCount();
+
+            // The color and alpha grids have the same layout, so the tiles that overlap
+            // the region are the same for both images.
+            IReadOnlyList<int> tileIndices = GetGridTileIndices(this.colorGridInfo, imageSize, sourceRegion, "color");
+            DecodeInfo colorDecodeInfo = CreateGridTileDecodeInfo(this.colorGridInfo, tileIndices[0], sourceRegion, downsampleShift);
+            DecodeInfo alphaDecodeInfo = CreateGridTileDecodeInfo(this.alphaGridInfo, tileIndices[0], sourceRegion, downsampleShift);
+
+            IReadOnlyList<uint> colorChildImageIds = this.colorGridInfo.ChildImageIds;
+            IReadOnlyList<uint> alphaChildImageIds = this.alphaGridInfo.ChildImageIds;
+
+            // The first tile is decoded before the others because it sets the tile size, format
+            // and NCLX color data that the remaining tiles are validated against.
+            DecodeColorAndAlphaImage(colorChildImageIds[tileIndices[0]],
+                                     alphaChildImageIds[tileIndices[0]],
+                                     colorDecodeInfo,
+                                     alphaDecodeInfo,
+                                     colorInfo,
+                                     fullSurface,
+                                     out report.ColorTileStats[tileIndices[0]]);
+            CheckImageGridAndTileBounds(colorDecodeInfo.expectedWidth,
+                                        colorDecodeInfo.expectedHeight,
+                                        colorDecodeInfo.chromaSubsampling,
+                                        this.colorGridInfo);
+            CheckImageGridAndTileBounds(alphaDecodeInfo.expectedWidth,
+                                        alphaDecodeInfo.expectedHeight,
+                                        alphaDecodeInfo.chromaSubsampling,
+                                        this.alphaGridInfo);
+
+            DecodeRemainingGridTiles(tileIndices,
+                                     (index) => new ColorAndAlphaTileData(ReadColorImage(colorChildImageIds[index]),
+                                                                          ReadAlphaImage(alphaChildImageIds[index])),
+                                     (tile, options, index) =>
+                                     {
+                                         DecodeInfo tileColorDecodeInfo = CreateRemainingTileDecodeInfo(colorDecodeInfo, index, this.colorGridInfo);
+                                         DecodeInfo tileAlphaDecodeInfo = CreateRemainingTileDecodeInfo(alphaDecodeInfo, index, this.alphaGridInfo);
+
+                                         AvifNative.DecompressColorAndAlpha(tile.Color,
+                                                                            tile.Alpha,
+                                                                            options,
+                                                                            colorInfo,
+                                                                            tileColorDecodeInfo,
+                                                                            tileAlphaDecodeInfo,
+                                                                            fullSurface,
+                                                                            out report.ColorTileStats[index]);
+                                     });
+
+            this.ImageGridMetadata = new ImageGridMetadata(this.colorGridInfo, colorDecodeInfo.expectedHeight, colorDecodeInfo.expectedWidth);
+            SetImageColorData(colorInfo, colorDecodeInfo);
+        }
+
+        private void FillColorImageGrid(CICPColorData? colorInfo,
+                                        Surface fullSurface,
+                                        Size imageSize,
+                                        Rectangle sourceRegion,
+                                        uint downsampleShift,
+                                        AvifLoadReport report)
+        {
+            this.colorGridInfo.CheckAvailableTileCount();
+            IReadOnlyList<int> tileIndices = GetGridTileIndices(this.colorGridInfo, imageSize, sourceRegion, "color");
+            DecodeInfo decodeInfo = CreateGridTileDecodeInfo(this.colorGridInfo, tileIndices[0], sourceRegion, downsampleShift);
 
-            for (int row = 0; row < this.alphaGridInfo.TileRowCount; row++)
+            IReadOnlyList<uint> childImageIds = this.colorGridInfo.ChildImageIds;
+
+            // The first tile is decoded before the others because it sets the tile size, format
+            // and NCLX color data that the remaining tiles are validated against.
+            DecodeColorImage(childImageIds[tileIndices[0]], decodeInfo, colorInfo, fullSurface, out report.ColorTileStats[tileIndices[0]]);
+            CheckImageGridAndTileBounds(decodeInfo.expectedWidth,
+                                        decodeInfo.expectedHeight,
+                                        decodeInfo.chromaSubsampling,
+                                        this.colorGridInfo);
+
+            DecodeRemainingGridTiles(tileIndices,
+                                     (index) => ReadColorImage(childImageIds[index]),
+                                     (color, options, index) =>
+                                     {
+                                         DecodeInfo tileDecodeInfo = CreateRemainingTileDecodeInfo(decodeInfo, index, this.colorGridInfo);
+
+                                         AvifNative.DecompressColor(color, options, colorInfo, tileDecodeInfo, fullSurface, out report.ColorTileStats[index]);
+                                     });
+
+            this.ImageGridMetadata = new ImageGridMetadata(this.colorGridInfo, decodeInfo.expectedHeight, decodeInfo.expectedWidth);
+            SetImageColorData(colorInfo, decodeInfo);
+        }
+
+        /// <summary>
+        /// Decodes the image grid tiles that follow the first tile.
+        /// </summary>
+        /// <remarks>
+        /// Each tile is written to a separate region of the output surface, so the tiles can be decoded concurrently.
+        /// The tile data is read from the file one tile at a time because the parser is not thread-safe.
+        /// </remarks>
+        /// <typeparam name="TTileData">The type of the compressed tile data.</typeparam>
+        /// <param name="tileIndices">The indices of the tiles to decode, the first tile has already been decoded.</param>
+        /// <param name="readTile">The function that reads the data of the tile at the specified index.</param>
+        /// <param name="decodeTile">The action that decodes the tile at the specified index.</param>
+        private void DecodeRemainingGridTiles<TTileData>(IReadOnlyList<int> tileIndices,
+                                                         Func<int, TTileData> readTile,
+                                                         Action<TTileData, DecoderOptions, int> decodeTile) where TTileData : IDisposable
+        {
+            int tileCount = tileIndices.Count;
+
+            if (tileCount <= 1)
+            {
+                return;
+            }
+
+            int maxDegreeOfParallelism = Math.Min(Environment.ProcessorCount, tileCount - 1);
+
+            // The threads that are not used for decoding the tiles are split between the tile decoders.
+            DecoderOptions tileDecoderOptions = new DecoderOptions
+            {
+                maxThreads = Math.Max(this.decoderOptions.maxThreads / maxDegreeOfParallelism, 1),
+                rowMultithreading = this.decoderOptions.rowMultithreading
+            };
+            ParallelOptions parallelOptions = new ParallelOptions
             {
-                decodeInfo.tileRowIndex = (uint)row;
-                int startIndex = row * this.alphaGridInfo.TileColumnCount;
+                MaxDegreeOfParallelism = maxDegreeOfParallelism
+            };
+            object readLock = new object();
 
-                for (int col = 0; col < this.alphaGridInfo.TileColumnCount; col++)
+            try
+            {
+                Parallel.For(1, tileCount, parallelOptions, (i) =>
                 {
-                    decodeInfo.tileColumnIndex = (uint)col;
+                    int index = tileIndices[i];
 
-                    DecodeAlphaImage(childImageIds[startIndex + col], decodeInfo, fullSurface);
+                    TTileData tileData;
 
-                    if (firstTile)
+                    lock (readLock)
                     {
-                        firstTile = false;
-                        CheckImageGridAndTileBounds(decodeInfo.expectedWidth,
-                                                    decodeInfo.expectedHeight,
-                                                    decodeInfo.chromaSubsampling,
-                                                    this.alphaGridInfo);
+                        tileData = readTile(index);
                     }
-                }
+
+                    using (tileData)
+                    {
+                        decodeTile(tileData, tileDecoderOptions, index);
+                    }
+                });
+            }
+            catch (AggregateException ex)
+            {
+                // Rethrow the original exception so that the caller sees the same
+                // exception types as the sequential decoding path.
+                ExceptionDispatchInfo.Capture(ex.InnerExceptions[0]).Throw();
             }
         }
 
-        private void FillColorImageGrid(CICPColorData? colorInfo, Surface fullSurface)
+        private static DecodeInfo CreateRemainingTileDecodeInfo(DecodeInfo firstTileDecodeInfo, int tileIndex, ImageGridInfo gridInfo)
         {
-            this.colorGridInfo.CheckAvailableTileCount();
-            DecodeInfo decodeInfo = new DecodeInfo
+            // The tiles are stored from top to bottom then left to right.
+            return new DecodeInfo
             {
-                expectedWidth = 0,
-                expectedHeight = 0
+                expectedWidth = firstTileDecodeInfo.expectedWidth,
+                expectedHeight = firstTileDecodeInfo.expectedHeight,
+                tileColumnIndex = (uint)(tileIndex % gridInfo.TileColumnCount),
+                tileRowIndex = (uint)(tileIndex / gridInfo.TileColumnCount),
+                downsampleShift = firstTileDecodeInfo.downsampleShift,
+                outputX = firstTileDecodeInfo.outputX,
+                outputY = firstTileDecodeInfo.outputY,
+                outputRotation = firstTileDecodeInfo.outputRotation,
+                outputMirror = firstTileDecodeInfo.outputMirror,
+                chromaSubsampling = firstTileDecodeInfo.chromaSubsampling,
+                bitDepth = firstTileDecodeInfo.bitDepth,
+                firstTileColorData = firstTileDecodeInfo.firstTileColorData
             };
+        }
 
-            IReadOnlyList<uint> childImageIds = this.colorGridInfo.ChildImageIds;
-            bool firstTile = true;
-
-            // The tiles are encoded from top to bottom then left to right.
+        private CICPColorData? GetContainerColorData()
+        {
+            CICPColorData? colorData = null;
 
-            for (int row = 0; row < this.colorGridInfo.TileRowCount; row++)
+            if (this.nclxColorInformation != null)
             {
-                decodeInfo.tileRowIndex = (uint)row;
-                int startIndex = row * this.colorGridInfo.TileColumnCount;
-
-                for (int col = 0; col < this.colorGridInfo.TileColumnCount; col++)
+                colorData = new CICPColorData
                 {
-                    decodeInfo.tileColumnIndex = (uint)col;
-
-                    DecodeColorImage(childImageIds[startIndex + col], decodeInfo, colorInfo, fullSurface);
-
-                    if (firstTile)
-                    {
-                        firstTile = false;
-                        CheckImageGridAndTileBounds(decodeInfo.expectedWidth,
-                                                    decodeInfo.expectedHeight,
-                                                    decodeInfo.chromaSubsampling,
-                                                    this.colorGridInfo);
-                    }
-                }
+                    colorPrimaries = this.nclxColorInformation.ColorPrimaries,
+                    transferCharacteristics = this.nclxColorInformation.TransferCharacteristics,
+                    matrixCoefficients = this.nclxColorInformation.MatrixCoefficients,
+                    fullRange = this.nclxColorInformation.FullRange
+                };
             }
 
-            this.ImageGridMetadata = new ImageGridMetadata(this.colorGridInfo, decodeInfo.expectedHeight, decodeInfo.expectedWidth);
-            SetImageColorData(colorInfo, decodeInfo);
+            return colorData;
         }
 
         private Size GetImageSize(uint itemId, ImageGridInfo gridInfo, string imageName)
@@ -559,55 +994,281 @@ namespace AvifFileType
             return new Size((int)width, (int)height);
         }
 
-        private void ProcessAlphaImage(Surface fullSurface)
+        private uint GetThumbnailDownsampleShift(Size imageSize, int targetSize)
         {
+            int longestSide = Math.Max(imageSize.Width, imageSize.Height);
+            uint maxShift = MaxDownsampleShift;
+
+            // The image grid tiles are placed at multiples of the downsampled tile size, so the tile
+            // size must be evenly divisible by the downsample factor to keep the tiles aligned.
+            if (this.colorGridInfo != null)
+            {
+                maxShift = Math.Min(maxShift, GetGridTileMaxDownsampleShift(this.colorGridInfo, "color"));
+            }
+
             if (this.alphaGridInfo != null)
             {
-                FillAlphaImageGrid(fullSurface);
+                maxShift = Math.Min(maxShift, GetGridTileMaxDownsampleShift(this.alphaGridInfo, "alpha"));
             }
-            else
+
+            // Use the largest power of two that keeps the image at least as large as the target size,
+            // the caller can then resize it to the exact size with a higher quality filter.
+            uint shift = 0;
+
+            while (shift < maxShift && (longestSide >> (int)(shift + 1)) >= targetSize)
             {
-                DecodeInfo decodeInfo = new DecodeInfo
+                shift++;
+            }
+
+            return shift;
+        }
+
+        private uint GetGridTileMaxDownsampleShift(ImageGridInfo gridInfo, string imageName)
+        {
+            gridInfo.CheckAvailableTileCount();
+
+            Size tileSize = GetImageSize(gridInfo.ChildImageIds[0], null, imageName);
+
+            uint value = (uint)(tileSize.Width | tileSize.Height);
+            uint shift = 0;
+
+            while (shift < MaxDownsampleShift && (value & 1) == 0)
+            {
+                value >>= 1;
+                shift++;
+            }
+
+            return shift;
+        }
+
+        private Rectangle GetCropRectangle(Size imageSize)
+        {
+            Rectangle imageBounds = new Rectangle(Point.Empty, imageSize);
+
+            if (this.cleanApertureBox != null && ImageTransform.TryGetCropRectangle(this.cleanApertureBox, imageSize, out Rectangle cropRect))
+            {
+                cropRect.Intersect(imageBounds);
+
+                if (!cropRect.IsEmpty)
                 {
-                    tileColumnIndex = 0,
-                    tileRowIndex = 0,
-                    expectedWidth = (uint)fullSurface.Width,
-                    expectedHeight = (uint)fullSurface.Height
-                };
+                    return cropRect;
+                }
+            }
+
+            return imageBounds;
+        }
+
+        private DecodeInfo CreateGridTileDecodeInfo(ImageGridInfo gridInfo, int tileIndex, Rectangle sourceRegion, uint downsampleShift)
+        {
+            Rectangle outputRegion = GetDownsampledRegion(sourceRegion, downsampleShift);
 
-                DecodeAlphaImage(this.alphaItemId, decodeInfo, fullSurface);
+            return new DecodeInfo
+            {
+                expectedWidth = 0,
+                expectedHeight = 0,
+                tileColumnIndex = (uint)(tileIndex % gridInfo.TileColumnCount),
+                tileRowIndex = (uint)(tileIndex / gridInfo.TileColumnCount),
+                downsampleShift = downsampleShift,
+                outputX = (uint)outputRegion.X,
+                outputY = (uint)outputRegion.Y,
+                outputRotation = GetOutputRotation(),
+                outputMirror = GetOutputMirror()
+            };
+        }
+
+        private DecodeInfo CreateImageDecodeInfo(Size imageSize, Rectangle sourceRegion, uint downsampleShift)
+        {
+            Rectangle outputRegion = GetDownsampledRegion(sourceRegion, downsampleShift);
+
+            return new DecodeInfo
+            {
+                expectedWidth = (uint)imageSize.Width,
+                expectedHeight = (uint)imageSize.Height,
+                tileColumnIndex = 0,
+                tileRowIndex = 0,
+                downsampleShift = downsampleShift,
+                outputX = (uint)outputRegion.X,
+                outputY = (uint)outputRegion.Y,
+                outputRotation = GetOutputRotation(),
+                outputMirror = GetOutputMirror()
+            };
+        }
+
+        private IReadOnlyList<int> GetGridTileIndices(ImageGridInfo gridInfo, Size imageSize, Rectangle sourceRegion, string imageName)
+        {
+            int tileColumnCount = gridInfo.TileColumnCount;
+            int tileRowCount = gridInfo.TileRowCount;
+
+            int firstColumn = 0;
+            int lastColumn = tileColumnCount - 1;
+            int firstRow = 0;
+            int lastRow = tileRowCount - 1;
+
+            if (sourceRegion != new Rectangle(Point.Empty, imageSize))
+            {
+                // Only the tiles that overlap the region are decoded.
+                Size tileSize = GetImageSize(gridInfo.ChildImageIds[0], null, imageName);
+
+                firstColumn = Math.Min(sourceRegion.Left / tileSize.Width, lastColumn);
+                lastColumn = Math.Min((sourceRegion.Right - 1) / tileSize.Width, lastColumn);
+                firstRow = Math.Min(sourceRegion.Top / tileSize.Height, lastRow);
+                lastRow = Math.Min((sourceRegion.Bottom - 1) / tileSize.Height, lastRow);
             }
+
+            List<int> tileIndices = new List<int>((lastColumn - firstColumn + 1) * (lastRow - firstRow + 1));
+
+            // The tiles are stored from top to bottom then left to right.
+            for (int row = firstRow; row <= lastRow; row++)
+            {
+                for (int column = firstColumn; column <= lastColumn; column++)
+                {
+                    tileIndices.Add((row * tileColumnCount) + column);
+                }
+            }
+
+            return tileIndices;
         }
 
-        private void ProcessColorImage(Surface fullSurface)
+        /// <summary>
+        /// Maps a region of the output image to the region of the color image that it was produced from.
+        /// </summary>
+        /// <param name="outputRegion">The region of the output image.</param>
+        /// <param name="imageSize">The size of the color image.</param>
+        /// <returns>The region of the color image.</returns>
+        private Rectangle GetSourceRegion(Rectangle outputRegion, Size imageSize)
         {
-            CICPColorData? colorConversionInfo = null;
-            if (this.nclxColorInformation != null)
+            // The transforms are undone in the reverse of the order that they are applied.
+            Rectangle cropRect = GetCropRectangle(imageSize);
+            Size rotatedSize = GetTransformedImageSize(imageSize);
+            Rectangle region = outputRegion;
+
+            if (this.imageMirrorBox != null)
             {
-                colorConversionInfo = new CICPColorData
+                switch (this.imageMirrorBox.MirrorDirection)
                 {
-                    colorPrimaries = this.nclxColorInformation.ColorPrimaries,
-                    transferCharacteristics = this.nclxColorInformation.TransferCharacteristics,
-                    matrixCoefficients = this.nclxColorInformation.MatrixCoefficients,
-                    fullRange = this.nclxColorInformation.FullRange
-                };
+                    case ImageMirrorDirection.Vertical:
+                        region.Y = rotatedSize.Height - region.Bottom;
+                        break;
+                    case ImageMirrorDirection.Horizontal:
+                        region.X = rotatedSize.Width - region.Right;
+                        break;
+                    default:
+                        throw new InvalidOperationException("Unknown ImageMirrorDirection value.");
+                }
+            }
+
+            if (this.imageRotateBox != null)
+            {
+                int width = cropRect.Width;
+                int height = cropRect.Height;
+
+                switch (this.imageRotateBox.Rotation)
+                {
+                    case ImageRotation.RotateNone:
+                        break;
+                    case ImageRotation.Rotate90CCW:
+                        region = Rectangle.FromLTRB(width - region.Bottom, region.Left, width - region.Top, region.Right);
+                        break;
+                    case ImageRotation.Rotate180:
+                        region = Rectangle.FromLTRB(width - region.Right, height - region.Bottom, width - region.Left, height - region.Top);
+                        break;
+                    case ImageRotation.Rotate270CCW:
+                        region = Rectangle.FromLTRB(region.Top, height - region.Right, region.Bottom, height - region.Left);
+                        break;
+                    default:
+                        throw new InvalidOperationException("Unknown ImageRotation value.");
+                }
+            }
+
+            region.Offset(cropRect.Location);
+
+            return region;
+        }
+
+        private static int GetTileCount(ImageGridInfo gridInfo)
+        {
+            return gridInfo != null ? gridInfo.TileColumnCount * gridInfo.TileRowCount : 1;
+        }
+
+        private Size GetTransformedImageSize(Size imageSize)
+        {
+            // This must match the image size that DecodeImage produces.
+            Size size = GetCropRectangle(imageSize).Size;
+
+            if (this.imageRotateBox != null)
+            {
+                if (this.imageRotateBox.Rotation == ImageRotation.Rotate90CCW || this.imageRotateBox.Rotation == ImageRotation.Rotate270CCW)
+                {
+                    size = new Size(size.Height, size.Width);
+                }
             }
 
+            return size;
+        }
+
+        private void ProcessAlphaImage(Surface fullSurface,
+                                       Size imageSize,
+                                       Rectangle sourceRegion,
+                                       uint downsampleShift,
+                                       AvifLoadReport report)
+        {
+            if (this.alphaGridInfo != null)
+            {
+                FillAlphaImageGrid(fullSurface, imageSize, sourceRegion, downsampleShift, report);
+            }
+            else
+            {
+                DecodeInfo decodeInfo = CreateImageDecodeInfo(imageSize, sourceRegion, downsampleShift);
+
+                DecodeAlphaImage(this.alphaItemId, decodeInfo, fullSurface, out report.AlphaTileStats[0]);
+            }
+        }
+
+        private void ProcessColorAndAlphaImage(Surface fullSurface,
+                                               Size imageSize,
+                                               Rectangle sourceRegion,
+                                               uint downsampleShift,
+                                               AvifLoadReport report)
+        {
+            CICPColorData? colorConversionInfo = GetContainerColorData();
+
             if (this.colorGridInfo != null)
             {
-                FillColorImageGrid(colorConversionInfo, fullSurface);
+                FillColorAndAlphaImageGrid(colorConversionInfo, fullSurface, imageSize, sourceRegion, downsampleShift, report);
             }
             else
             {
-                DecodeInfo decodeInfo = new DecodeInfo
-                {
-                    tileColumnIndex = 0,
-                    tileRowIndex = 0,
-                    expectedWidth = (uint)fullSurface.Width,
-                    expectedHeight = (uint)fullSurface.Height
-                };
+                DecodeInfo colorDecodeInfo = CreateImageDecodeInfo(imageSize, sourceRegion, downsampleShift);
+                DecodeInfo alphaDecodeInfo = CreateImageDecodeInfo(imageSize, sourceRegion, downsampleShift);
+
+                DecodeColorAndAlphaImage(this.primaryItemId,
+                                         this.alphaItemId,
+                                         colorDecodeInfo,
+                                         alphaDecodeInfo,
+                                         colorConversionInfo,
+                                         fullSurface,
+                                         out report.ColorTileStats[0]);
+                SetImageColorData(colorConversionInfo, colorDecodeInfo);
+            }
+        }
+
+        private void ProcessColorImage(Surface fullSurface,
+                                       Size imageSize,
+                                       Rectangle sourceRegion,
+                                       uint downsampleShift,
+                                       AvifLoadReport report)
+        {
+            CICPColorData? colorConversionInfo = GetContainerColorData();
+
+            if (this.colorGridInfo != null)
+            {
+                FillColorImageGrid(colorConversionInfo, fullSurface, imageSize, sourceRegion, downsampleShift, report);
+            }
+            else
+            {
+                DecodeInfo decodeInfo = CreateImageDecodeInfo(imageSize, sourceRegion, downsampleShift);
 
-                DecodeColorImage(this.primaryItemId, decodeInfo, colorConversionInfo, fullSurface);
+                DecodeColorImage(this.primaryItemId, decodeInfo, colorConversionInfo, fullSurface, out report.ColorTileStats[0]);
                 SetImageColorData(colorConversionInfo, decodeInfo);
             }
         }
@@ -636,6 +1297,22 @@ namespace AvifFileType
             return this.parser.ReadItemData(entry);
         }
 
+        private AV1SequenceHeader ReadSequenceHeader(uint itemId)
+        {
+            ItemLocationEntry entry = this.parser.TryGetItemLocation(itemId);
+
+            if (entry is null)
+            {
+                ExceptionUtil.ThrowFormatException("The color image item location was not found.");
+            }
+
+            // The AV1 image item data starts with the sequence header OBU, so only the
+            // start of the item needs to be read.
+            byte[] obuData = this.parser.ReadItemDataPrefix(entry, SequenceHeaderMaxReadLength);
+
+            return AV1SequenceHeader.TryParse(obuData);
+        }
+
         private void SetImageColorData(CICPColorData? containerColorData, DecodeInfo decodeInfo)
         {
             if (containerColorData.HasValue)
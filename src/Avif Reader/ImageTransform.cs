@@ -11,7 +11,6 @@
 ////////////////////////////////////////////////////////////////////////
 
 using AvifFileType.AvifContainer;
-using PaintDotNet;
 using System;
 using System.Drawing;
 
@@ -19,7 +18,14 @@ namespace AvifFileType
 {
     internal static class ImageTransform
     {
-        internal static void Crop(CleanApertureBox cleanApertureBox, ref Surface surface)
+        /// <summary>
+        /// Gets the crop rectangle of the clean aperture box.
+        /// </summary>
+        /// <param name="cleanApertureBox">The clean aperture box.</param>
+        /// <param name="imageSize">The size of the image.</param>
+        /// <param name="cropRect">The crop rectangle.</param>
+        /// <returns><see langword="true"/> if the image should be cropped; otherwise, <see langword="false"/>.</returns>
+        internal static bool TryGetCropRectangle(CleanApertureBox cleanApertureBox, Size imageSize, out Rectangle cropRect)
         {
             if (cleanApertureBox is null)
             {
@@ -31,7 +37,8 @@ namespace AvifFileType
                 cleanApertureBox.HorizontalOffset.Denominator == 0 ||
                 cleanApertureBox.VerticalOffset.Denominator == 0)
             {
-                return;
+                cropRect = Rectangle.Empty;
+                return false;
             }
 
             int cropWidth = cleanApertureBox.Width.ToInt32();
@@ -40,145 +47,16 @@ namespace AvifFileType
             double offsetX = cleanApertureBox.HorizontalOffset.ToDouble();
             double offsetY = cleanApertureBox.VerticalOffset.ToDouble();
 
-            double pictureCenterX = offsetX + ((surface.Width - 1) / 2.0);
-            double pictureCenterY = offsetY + ((surface.Height - 1) / 2.0);
+            double pictureCenterX = offsetX + ((imageSize.Width - 1) / 2.0);
+            double pictureCenterY = offsetY + ((imageSize.Height - 1) / 2.0);
 
             int cropRectX = (int)Math.Round(pictureCenterX - ((cropWidth - 1) / 2.0));
             int cropRectY = (int)Math.Round(pictureCenterY - ((cropHeight - 1) / 2.0));
 
-            Rectangle cropRect = new Rectangle(cropRectX, cropRectY, cropWidth, cropHeight);
+            cropRect = new Rectangle(cropRectX, cropRectY, cropWidth, cropHeight);
 
-            // Check that the crop rectangle is within the surface bounds.
-            if (cropRect.IntersectsWith(surface.Bounds))
-            {
-                Surface temp = new Surface(cropWidth, cropHeight);
-                try
-                {
-                    temp.CopySurface(surface, cropRect);
-
-                    surface.Dispose();
-                    surface = temp;
-                    temp = null;
-                }
-                finally
-                {
-                    temp?.Dispose();
-                }
-            }
-        }
-
-        internal static unsafe void FlipHorizontal(Surface surface)
-        {
-            int lastColumn = surface.Width - 1;
-            int flipWidth = surface.Width / 2;
-
-            for (int y = 0; y < surface.Height; y++)
-            {
-                for (int x = 0; x < flipWidth; x++)
-                {
-                    int sampleColumn = lastColumn - x;
-
-                    ColorBgra temp = surface[x, y];
-                    surface[x, y] = surface[sampleColumn, y];
-                    surface[sampleColumn, y] = temp;
-                }
-            }
-        }
-
-        internal static unsafe void FlipVertical(Surface surface)
-        {
-            int lastRow = surface.Height - 1;
-            int flipHeight = surface.Height / 2;
-
-            for (int x = 0; x < surface.Width; x++)
-            {
-                for (int y = 0; y < flipHeight; y++)
-                {
-                    int sampleRow = lastRow - y;
-
-                    ColorBgra temp = surface[x, y];
-                    surface[x, y] = surface[x, sampleRow];
-                    surface[x, sampleRow] = temp;
-                }
-            }
-        }
-
-        internal static unsafe void Rotate90CCW(ref Surface surface)
-        {
-            Surface temp = null;
-            try
-            {
-                temp = new Surface(surface.Height, surface.Width);
-
-                int lastColumn = surface.Width - 1;
-
-                for (int y = 0; y < temp.Height; y++)
-                {
-                    ColorBgra* dstPtr = temp.GetRowAddressUnchecked(y);
-
-                    for (int x = 0; x < temp.Width; x++)
-                    {
-                        ColorBgra pixel = surface[lastColumn - y, x];
-
-                        dstPtr->Bgra = pixel.Bgra;
-                        dstPtr++;
-                    }
-                }
-
-                surface.Dispose();
-                surface = temp;
-                temp = null;
-            }
-            finally
-            {
-                temp?.Dispose();
-            }
-        }
-
-        internal static unsafe void Rotate180(Surface surface)
-        {
-            int lastColumn = surface.Width - 1;
-            int lastRow = surface.Height - 1;
-
-            for (int y = 0; y < surface.Height; y++)
-            {
-                for (int x = 0; x < surface.Width; x++)
-                {
-                    surface[x, y] = surface[lastColumn - x, lastRow - y];
-                }
-            }
-        }
-
-        internal static unsafe void Rotate270CCW(ref Surface surface)
-        {
-            Surface temp = null;
-            try
-            {
-                temp = new Surface(surface.Height, surface.Width);
-
-                int lastRow = surface.Height - 1;
-
-                for (int y = 0; y < temp.Height; y++)
-                {
-                    ColorBgra* dstPtr = temp.GetRowAddressUnchecked(y);
-
-                    for (int x = 0; x < temp.Width; x++)
-                    {
-                        ColorBgra pixel = surface[y, lastRow - x];
-
-                        dstPtr->Bgra = pixel.Bgra;
-                        dstPtr++;
-                    }
-                }
-
-                surface.Dispose();
-                surface = temp;
-                temp = null;
-            }
-            finally
-            {
-                temp?.Dispose();
-            }
+            // Check that the crop rectangle is within the image bounds.
+            return cropRect.IntersectsWith(new Rectangle(Point.Empty, imageSize));
         }
     }
 }
@@ -32,11 +32,35 @@ namespace AvifFileType
                 this.Id = id;
                 this.Name = name;
                 this.Image = image;
+                this.IsAV1Image = true;
+                this.ImageWidth = image.Width;
+                this.ImageHeight = image.Height;
+                this.ImageFormat = image.Format;
                 this.IsAlphaImage = isAlphaImage;
                 this.ContentBytes = null;
                 this.ItemInfoEntry = new AV01ItemInfoEntryBox(id, name);
                 this.ItemLocation = new ItemLocationEntry(id, image.Data.ByteLength);
                 this.ItemReferences = new List<ItemReferenceEntryBox>();
+                this.DuplicateItems = new List<AvifWriterItem>();
+            }
+
+            private AvifWriterItem(uint id, string name, int imageWidth, int imageHeight, YUVChromaSubsampling imageFormat, bool isAlphaImage)
+            {
+                this.Id = id;
+                this.Name = name;
+                this.Image = null;
+                this.IsAV1Image = true;
+                this.ImageWidth = imageWidth;
+                this.ImageHeight = imageHeight;
+                this.ImageFormat = imageFormat;
+                this.IsAlphaImage = isAlphaImage;
+                this.ContentBytes = null;
+                this.ItemInfoEntry = new AV01ItemInfoEntryBox(id, name);
+                // The item length is written as a placeholder, the real value will be updated
+                // when the image data is written.
+                this.ItemLocation = new ItemLocationEntry(id, 0);
+                this.ItemReferences = new List<ItemReferenceEntryBox>();
+                this.DuplicateItems = new List<AvifWriterItem>();
             }
 
             private AvifWriterItem(uint id, string name, byte[] contentBytes, ItemInfoEntryBox itemInfo)
@@ -60,6 +84,7 @@ namespace AvifFileType
                 this.ItemInfoEntry = itemInfo;
                 this.ItemLocation = new ItemLocationEntry(id, (ulong)contentBytes.Length);
                 this.ItemReferences = new List<ItemReferenceEntryBox>();
+                this.DuplicateItems = new List<AvifWriterItem>();
             }
 
             private AvifWriterItem(uint id, string name, ulong dataBoxOffset, ulong length)
@@ -77,6 +102,7 @@ namespace AvifFileType
                 this.ItemInfoEntry = new ImageGridItemInfoEntryBox(id, name);
                 this.ItemLocation = new ItemLocationEntry(id, dataBoxOffset, length);
                 this.ItemReferences = new List<ItemReferenceEntryBox>();
+                this.DuplicateItems = new List<AvifWriterItem>();
             }
 
             public uint Id { get; }
@@ -85,6 +111,14 @@ namespace AvifFileType
 
             public CompressedAV1Image Image { get; }
 
+            public bool IsAV1Image { get; }
+
+            public int ImageWidth { get; }
+
+            public int ImageHeight { get; }
+
+            public YUVChromaSubsampling ImageFormat { get; }
+
             public bool IsAlphaImage { get; }
 
             public byte[] ContentBytes { get; }
@@ -95,6 +129,17 @@ namespace AvifFileType
 
             public List<ItemReferenceEntryBox> ItemReferences { get; }
 
+            /// <summary>
+            /// Gets the items that have the same image data as this item.
+            /// </summary>
+            /// <remarks>
+            /// The duplicate items do not have any data of their own in the media data box,
+            /// their item locations point to the data of this item.
+            /// </remarks>
+            public List<AvifWriterItem> DuplicateItems { get; }
+
+            public bool IsDuplicate { get; private set; }
+
             [DebuggerBrowsable(DebuggerBrowsableState.Never)]
             private string DebuggerDisplay
             {
@@ -111,11 +156,37 @@ namespace AvifFileType
                 }
             }
 
+            public void AddDuplicateItem(AvifWriterItem item)
+            {
+                if (item is null)
+                {
+                    ExceptionUtil.ThrowArgumentNullException(nameof(item));
+                }
+
+                if (this.IsDuplicate)
+                {
+                    ExceptionUtil.ThrowInvalidOperationException("A duplicate item cannot be the source of another duplicate.");
+                }
+
+                item.IsDuplicate = true;
+                this.DuplicateItems.Add(item);
+            }
+
             public static AvifWriterItem CreateFromImage(uint itemId, string name, CompressedAV1Image image, bool isAlphaImage)
             {
                 return new AvifWriterItem(itemId, name, image, isAlphaImage);
             }
 
+            public static AvifWriterItem CreateFromStreamedImage(uint itemId,
+                                                                 string name,
+                                                                 int imageWidth,
+                                                                 int imageHeight,
+                                                                 YUVChromaSubsampling imageFormat,
+                                                                 bool isAlphaImage)
+            {
+                return new AvifWriterItem(itemId, name, imageWidth, imageHeight, imageFormat, isAlphaImage);
+            }
+
             public static AvifWriterItem CreateFromImageGrid(uint itemId, string name, ulong dataBoxOffset, ulong length)
             {
                 return new AvifWriterItem(itemId, name, dataBoxOffset, length);
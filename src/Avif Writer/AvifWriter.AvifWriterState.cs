@@ -12,6 +12,7 @@
 
 using AvifFileType.AvifContainer;
 using PaintDotNet.AppModel;
+using System;
 using System.Collections.Generic;
 using System.IO;
 
@@ -48,10 +49,68 @@ namespace AvifFileType
                 }
 
                 this.ImageGrid = imageGridMetadata;
-                this.items = new List<AvifWriterItem>(GetItemCount(colorImages, alphaImages, metadata));
+                this.items = new List<AvifWriterItem>(GetItemCount(colorImages.Count, alphaImages != null, metadata));
                 Initialize(colorImages, alphaImages, imageGridMetadata, metadata, arrayPool);
             }
 
+            /// <summary>
+            /// Initializes a new instance of the <see cref="AvifWriterState"/> class for an image grid
+            /// with tiles that are written as they are compressed.
+            /// </summary>
+            /// <param name="duplicateTileIndexes">
+            /// The index of the first tile with identical pixels for each tile, or <see langword="null"/> if
+            /// every tile is compressed. The duplicate tiles are not compressed, their items use the data of
+            /// the tile that they are identical to.
+            /// </param>
+            /// <param name="duplicateAlphaTileIndexes">
+            /// The index of the first tile with identical alpha values for each tile, or <see langword="null"/> if
+            /// the alpha images are only shared by the duplicate tiles.
+            /// </param>
+            public AvifWriterState(ImageGridMetadata imageGridMetadata,
+                                   IReadOnlyList<uint> duplicateTileIndexes,
+                                   IReadOnlyList<uint> duplicateAlphaTileIndexes,
+                                   YUVChromaSubsampling colorFormat,
+                                   bool hasAlphaImages,
+                                   AvifMetadata metadata,
+                                   IArrayPoolService arrayPool)
+            {
+                if (imageGridMetadata is null)
+                {
+                    ExceptionUtil.ThrowArgumentNullException(nameof(imageGridMetadata));
+                }
+
+                if (metadata is null)
+                {
+                    ExceptionUtil.ThrowArgumentNullException(nameof(metadata));
+                }
+
+                if (arrayPool is null)
+                {
+                    ExceptionUtil.ThrowArgumentNullException(nameof(arrayPool));
+                }
+
+                this.ImageGrid = imageGridMetadata;
+                this.items = new List<AvifWriterItem>(GetItemCount(imageGridMetadata.TileCount, hasAlphaImages, metadata));
+
+                int tileWidth = (int)imageGridMetadata.TileImageWidth;
+                int tileHeight = (int)imageGridMetadata.TileImageHeight;
+
+                ImageStateInfo result = InitializeFromImageGrid(imageGridMetadata.TileCount,
+                                                                duplicateTileIndexes,
+                                                                duplicateAlphaTileIndexes,
+                                                                hasAlphaImages,
+                                                                (itemId, tileIndex, isAlphaImage) => AvifWriterItem.CreateFromStreamedImage(itemId,
+                                                                                                                                            null,
+                                                                                                                                            tileWidth,
+                                                                                                                                            tileHeight,
+                                                                                                                                            isAlphaImage ? YUVChromaSubsampling.Subsampling400 : colorFormat,
+                                                                                                                                            isAlphaImage),
+                                                                imageGridMetadata);
+                this.ItemDataBox = CreateItemDataBox(imageGridMetadata, arrayPool);
+
+                InitializeMetadata(result, metadata);
+            }
+
             public uint AlphaItemId { get; private set; }
 
             public ImageGridMetadata ImageGrid { get; }
@@ -107,7 +166,15 @@ namespace AvifFileType
 
                 if (imageGridMetadata != null)
                 {
-                    result = InitializeFromImageGrid(colorImages, alphaImages, imageGridMetadata);
+                    result = InitializeFromImageGrid(colorImages.Count,
+                                                     null,
+                                                     null,
+                                                     alphaImages != null,
+                                                     (itemId, tileIndex, isAlphaImage) => AvifWriterItem.CreateFromImage(itemId,
+                                                                                                                         null,
+                                                                                                                         isAlphaImage ? alphaImages[tileIndex] : colorImages[tileIndex],
+                                                                                                                         isAlphaImage),
+                                                     imageGridMetadata);
                     this.ItemDataBox = CreateItemDataBox(imageGridMetadata, arrayPool);
                 }
                 else
@@ -116,6 +183,11 @@ namespace AvifFileType
                     this.ItemDataBox = null;
                 }
 
+                InitializeMetadata(result, metadata);
+            }
+
+            private void InitializeMetadata(ImageStateInfo result, AvifMetadata metadata)
+            {
                 uint itemId = result.NextId;
                 ulong mediaDataBoxContentSize = result.MediaDataBoxContentSize;
 
@@ -148,39 +220,56 @@ namespace AvifFileType
                 this.MediaDataBoxMetadataItemIndexes = mediaDataBoxMetadataItemIndexes;
             }
 
-            private ImageStateInfo InitializeFromImageGrid(IReadOnlyList<CompressedAV1Image> colorImages,
-                                                           IReadOnlyList<CompressedAV1Image> alphaImages,
+            private ImageStateInfo InitializeFromImageGrid(int tileCount,
+                                                           IReadOnlyList<uint> duplicateTileIndexes,
+                                                           IReadOnlyList<uint> duplicateAlphaTileIndexes,
+                                                           bool hasAlphaImages,
+                                                           Func<uint, int, bool, AvifWriterItem> createTileItem,
                                                            ImageGridMetadata imageGridMetadata)
             {
                 ulong mediaDataBoxContentSize = 0;
                 uint itemId = FirstItemId;
 
-                List<uint> colorImageIds = new List<uint>(colorImages.Count);
-                List<uint> alphaImageIds = alphaImages != null ? new List<uint>(alphaImages.Count) : null;
+                List<uint> colorImageIds = new List<uint>(tileCount);
+                List<uint> alphaImageIds = hasAlphaImages ? new List<uint>(tileCount) : null;
 
-                List<int> mediaDataBoxColorItemIndexes = new List<int>(colorImages.Count);
-                List<int> mediaBoxAlphaItemIndexes = new List<int>(alphaImages != null ? alphaImages.Count : 0);
+                List<int> mediaDataBoxColorItemIndexes = new List<int>(tileCount);
+                List<int> mediaBoxAlphaItemIndexes = new List<int>(hasAlphaImages ? tileCount : 0);
 
-                for (int i = 0; i < colorImages.Count; i++)
+                for (int i = 0; i < tileCount; i++)
                 {
-                    CompressedAV1Image color = colorImages[i];
-                    AvifWriterItem colorItem = AvifWriterItem.CreateFromImage(itemId, null, color, false);
+                    int sourceTileIndex = duplicateTileIndexes != null ? (int)duplicateTileIndexes[i] : i;
+                    int alphaSourceTileIndex = duplicateAlphaTileIndexes != null ? (int)duplicateAlphaTileIndexes[i] : sourceTileIndex;
+
+                    if (sourceTileIndex > i || alphaSourceTileIndex > i)
+                    {
+                        ExceptionUtil.ThrowInvalidOperationException($"Tile { i } cannot be a duplicate of a later tile.");
+                    }
+
+                    AvifWriterItem colorItem = createTileItem(itemId, i, false);
                     itemId++;
                     colorImageIds.Add(colorItem.Id);
+                    if (sourceTileIndex != i)
+                    {
+                        this.items[mediaDataBoxColorItemIndexes[sourceTileIndex]].AddDuplicateItem(colorItem);
+                    }
                     mediaDataBoxColorItemIndexes.Add(this.items.Count);
                     this.items.Add(colorItem);
-                    mediaDataBoxContentSize += color.Data.ByteLength;
+                    mediaDataBoxContentSize += colorItem.ItemLocation.TotalItemSize;
 
-                    if (alphaImages != null)
+                    if (hasAlphaImages)
                     {
-                        CompressedAV1Image alpha = alphaImages[i];
-                        AvifWriterItem alphaItem = AvifWriterItem.CreateFromImage(itemId, null, alpha, true);
+                        AvifWriterItem alphaItem = createTileItem(itemId, i, true);
                         itemId++;
                         alphaItem.ItemReferences.Add(new ItemReferenceEntryBox(alphaItem.Id, ReferenceTypes.AuxiliaryImage, colorItem.Id));
                         alphaImageIds.Add(alphaItem.Id);
+                        if (alphaSourceTileIndex != i)
+                        {
+                            this.items[mediaBoxAlphaItemIndexes[alphaSourceTileIndex]].AddDuplicateItem(alphaItem);
+                        }
                         mediaBoxAlphaItemIndexes.Add(this.items.Count);
                         this.items.Add(alphaItem);
-                        mediaDataBoxContentSize += alpha.Data.ByteLength;
+                        mediaDataBoxContentSize += alphaItem.ItemLocation.TotalItemSize;
                     }
                 }
 
@@ -203,7 +292,7 @@ namespace AvifFileType
                 this.PrimaryItemId = colorGridItem.Id;
                 this.items.Add(colorGridItem);
 
-                if (alphaImages != null)
+                if (hasAlphaImages)
                 {
                     // The ImageGridDescriptor is shared between the color and alpha image.
                     AvifWriterItem alphaGridItem = AvifWriterItem.CreateFromImageGrid(itemId, "Alpha", 0, gridDescriptorLength);
@@ -253,21 +342,21 @@ namespace AvifFileType
                 return new ImageStateInfo(mediaDataBoxContentSize, itemId);
             }
 
-            private static int GetItemCount(IReadOnlyList<CompressedAV1Image> colorImages, IReadOnlyList<CompressedAV1Image> alphaImages, AvifMetadata metadata)
+            private static int GetItemCount(int colorImageCount, bool hasAlphaImages, AvifMetadata metadata)
             {
                 int count;
 
-                if (colorImages.Count == 1)
+                if (colorImageCount == 1)
                 {
                     count = 1;
                 }
                 else
                 {
                     // Add one item for the grid image.
-                    count = 1 + colorImages.Count;
+                    count = 1 + colorImageCount;
                 }
 
-                if (alphaImages != null)
+                if (hasAlphaImages)
                 {
                     // The color and alpha lists will always have the same number of images.
                     count *= 2;
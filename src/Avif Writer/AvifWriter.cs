@@ -13,6 +13,7 @@
 using AvifFileType.AvifContainer;
 using PaintDotNet;
 using PaintDotNet.AppModel;
+using System;
 using System.Collections.Generic;
 using System.IO;
 
@@ -31,6 +32,9 @@ namespace AvifFileType
         private uint progressDone;
         private readonly uint progressTotal;
 
+        private readonly bool use64BitFileOffsets;
+        private readonly ulong maxMediaDataBoxContentSize;
+
         public AvifWriter(IReadOnlyList<CompressedAV1Image> colorImages,
                           IReadOnlyList<CompressedAV1Image> alphaImages,
                           AvifMetadata metadata,
@@ -49,10 +53,58 @@ namespace AvifFileType
             this.progressCallback = progressEventHandler;
             this.progressDone = progressDone;
             this.progressTotal = progressTotal;
+            this.use64BitFileOffsets = this.state.MediaDataBoxContentSize > uint.MaxValue;
+            this.maxMediaDataBoxContentSize = this.state.MediaDataBoxContentSize;
+            this.fileTypeBox = new FileTypeBox(chromaSubsampling);
+            this.metaBox = new MetaBox(this.state.PrimaryItemId,
+                                       this.state.Items.Count,
+                                       this.use64BitFileOffsets,
+                                       this.state.ItemDataBox);
+            PopulateMetaBox();
+        }
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="AvifWriter"/> class for an image grid that
+        /// is written with <see cref="WriteStreamingTo(Stream, Action{CompressedImageGridTileHandler})"/>.
+        /// </summary>
+        /// <remarks>
+        /// The tile data sizes are not known until the tiles have been compressed, so the item locations
+        /// and media data box size are written as placeholders and updated as each tile is written.
+        /// The tiles in <paramref name="duplicateTileIndexes"/> that refer to an earlier tile are not passed
+        /// to the tile handler, their item locations point to the data of the earlier tile.
+        /// The tiles in <paramref name="duplicateAlphaTileIndexes"/> that refer to an earlier tile are passed
+        /// to the tile handler without an alpha image, their alpha item locations point to the alpha data of
+        /// the earlier tile.
+        /// </remarks>
+        public AvifWriter(ImageGridMetadata imageGridMetadata,
+                          IReadOnlyList<uint> duplicateTileIndexes,
+                          IReadOnlyList<uint> duplicateAlphaTileIndexes,
+                          YUVChromaSubsampling chromaSubsampling,
+                          bool hasTransparency,
+                          AvifMetadata metadata,
+                          IReadOnlyList<ColorInformationBox> colorInformationBoxes,
+                          IArrayPoolService arrayPool)
+        {
+            this.state = new AvifWriterState(imageGridMetadata,
+                                             duplicateTileIndexes,
+                                             duplicateAlphaTileIndexes,
+                                             chromaSubsampling,
+                                             hasTransparency,
+                                             metadata,
+                                             arrayPool);
+            this.arrayPool = arrayPool;
+            this.colorImageIsGrayscale = chromaSubsampling == YUVChromaSubsampling.Subsampling400;
+            this.colorInformationBoxes = colorInformationBoxes ?? System.Array.Empty<ColorInformationBox>();
+            // The encoder reports the progress for the streamed tiles.
+            this.progressCallback = null;
+            this.progressDone = 0;
+            this.progressTotal = 0;
+            this.maxMediaDataBoxContentSize = this.state.MediaDataBoxContentSize + GetMaxCompressedTileDataSize(imageGridMetadata, hasTransparency);
+            this.use64BitFileOffsets = this.maxMediaDataBoxContentSize > uint.MaxValue;
             this.fileTypeBox = new FileTypeBox(chromaSubsampling);
             this.metaBox = new MetaBox(this.state.PrimaryItemId,
                                        this.state.Items.Count,
-                                       this.state.MediaDataBoxContentSize > uint.MaxValue,
+                                       this.use64BitFileOffsets,
                                        this.state.ItemDataBox);
             PopulateMetaBox();
         }
@@ -88,6 +140,124 @@ namespace AvifFileType
             }
         }
 
+        /// <summary>
+        /// Writes the image grid to the stream as the tiles are compressed.
+        /// </summary>
+        /// <remarks>
+        /// The file header, meta box and media data box header are written first, then each tile is appended
+        /// to the media data box when <paramref name="compressTiles"/> passes it to the tile handler.
+        /// This allows the compressed data for a tile to be released as soon as it has been written.
+        /// </remarks>
+        /// <param name="stream">The output stream, it must support seeking.</param>
+        /// <param name="compressTiles">The action that compresses the tiles and passes them to the tile handler.</param>
+        public void WriteStreamingTo(Stream stream, Action<CompressedImageGridTileHandler> compressTiles)
+        {
+            if (compressTiles is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(compressTiles));
+            }
+
+            if (this.state.ImageGrid is null)
+            {
+                ExceptionUtil.ThrowInvalidOperationException("Only image grids can be written as a stream.");
+            }
+
+            using (BigEndianBinaryWriter writer = new BigEndianBinaryWriter(stream, true, this.arrayPool))
+            {
+                this.fileTypeBox.Write(writer);
+                this.metaBox.Write(writer);
+
+                MediaDataBox mediaDataBox = new MediaDataBox(this.maxMediaDataBoxContentSize);
+                mediaDataBox.Write(writer);
+                long mediaDataBoxContentStart = writer.Position;
+
+                WriteMediaDataBoxItems(writer, this.state.MediaDataBoxMetadataItemIndexes);
+
+                IReadOnlyList<AvifWriterItem> items = this.state.Items;
+                IReadOnlyList<int> colorItemIndexes = this.state.MediaDataBoxColorItemIndexes;
+                IReadOnlyList<int> alphaItemIndexes = this.state.MediaDataBoxAlphaItemIndexes;
+                bool[] tilesWritten = new bool[colorItemIndexes.Count];
+
+                for (int i = 0; i < tilesWritten.Length; i++)
+                {
+                    // The duplicate tiles are written with the tile that they are identical to.
+                    tilesWritten[i] = items[colorItemIndexes[i]].IsDuplicate;
+                }
+
+                compressTiles((tileIndex, color, alpha) =>
+                {
+                    using (color)
+                    using (alpha)
+                    {
+                        if (tilesWritten[tileIndex])
+                        {
+                            ExceptionUtil.ThrowInvalidOperationException($"Tile { tileIndex } has already been written.");
+                        }
+
+                        // The alpha image data is written before the color image data, see WriteTo for the reasons.
+                        // A tile that shares the alpha image of an earlier tile does not have any alpha data to write.
+                        if (this.state.AlphaItemId != 0 && !items[alphaItemIndexes[tileIndex]].IsDuplicate)
+                        {
+                            if (alpha is null)
+                            {
+                                ExceptionUtil.ThrowArgumentNullException(nameof(alpha));
+                            }
+
+                            WriteStreamedImage(writer, items[alphaItemIndexes[tileIndex]], alpha);
+                        }
+                        WriteStreamedImage(writer, items[colorItemIndexes[tileIndex]], color);
+
+                        tilesWritten[tileIndex] = true;
+                    }
+                });
+
+                for (int i = 0; i < tilesWritten.Length; i++)
+                {
+                    if (!tilesWritten[i])
+                    {
+                        ExceptionUtil.ThrowInvalidOperationException($"Tile { i } was not written.");
+                    }
+                }
+
+                mediaDataBox.WriteFinalLength(writer, (ulong)(writer.Position - mediaDataBoxContentStart));
+            }
+        }
+
+        private static ulong GetMaxCompressedTileDataSize(ImageGridMetadata imageGridMetadata, bool hasTransparency)
+        {
+            // The compressed size is not known before the tiles are encoded, so the uncompressed
+            // size is used as an upper bound when selecting the size of the file offset fields.
+            ulong tilePixelCount = (ulong)imageGridMetadata.TileImageWidth * imageGridMetadata.TileImageHeight;
+            ulong bytesPerPixel = hasTransparency ? 5UL : 4UL;
+
+            return tilePixelCount * bytesPerPixel * (ulong)imageGridMetadata.TileCount;
+        }
+
+        private void WriteStreamedImage(BigEndianBinaryWriter writer, AvifWriterItem item, CompressedAV1Image image)
+        {
+            ulong offset = (ulong)writer.Position;
+            ulong length = image.Data.ByteLength;
+
+            if (!this.use64BitFileOffsets && (offset + length) > uint.MaxValue)
+            {
+                throw new IOException($"The compressed image data exceeds { uint.MaxValue } bytes.");
+            }
+
+            // We only ever write items with a single extent.
+            ItemLocationExtent extent = item.ItemLocation.Extents[0];
+            extent.WriteFinalOffset(writer, offset);
+            extent.WriteFinalLength(writer, length);
+
+            for (int i = 0; i < item.DuplicateItems.Count; i++)
+            {
+                ItemLocationExtent duplicateExtent = item.DuplicateItems[i].ItemLocation.Extents[0];
+                duplicateExtent.WriteFinalOffset(writer, offset);
+                duplicateExtent.WriteFinalLength(writer, length);
+            }
+
+            image.Data.Write(writer);
+        }
+
         private void PopulateItemInfos()
         {
             IReadOnlyList<AvifWriterItem> items = this.state.Items;
@@ -145,11 +315,11 @@ namespace AvifFileType
             for (int i = 0; i < items.Count; i++)
             {
                 AvifWriterItem item = items[i];
-                if (item.Image != null)
+                if (item.IsAV1Image)
                 {
                     if (imageSpatialExtentsAssociationIndex == 0)
                     {
-                        itemPropertiesBox.AddProperty(new ImageSpatialExtentsBox((uint)item.Image.Width, (uint)item.Image.Height));
+                        itemPropertiesBox.AddProperty(new ImageSpatialExtentsBox((uint)item.ImageWidth, (uint)item.ImageHeight));
                         imageSpatialExtentsAssociationIndex = propertyAssociationIndex;
                         propertyAssociationIndex++;
                     }
@@ -167,7 +337,7 @@ namespace AvifFileType
 
                     if (colorAv1ConfigAssociationIndex == 0 || item.IsAlphaImage && alphaAv1ConfigAssociationIndex == 0)
                     {
-                        itemPropertiesBox.AddProperty(AV1ConfigBoxBuilder.Build(item.Image));
+                        itemPropertiesBox.AddProperty(AV1ConfigBoxBuilder.Build(item.ImageWidth, item.ImageHeight, item.ImageFormat));
                         if (this.colorImageIsGrayscale)
                         {
                             colorAv1ConfigAssociationIndex = alphaAv1ConfigAssociationIndex = propertyAssociationIndex;
@@ -189,7 +359,7 @@ namespace AvifFileType
 
                     if (colorPixelInformationAssociationIndex == 0 || item.IsAlphaImage && alphaPixelInformationAssociationIndex == 0)
                     {
-                        itemPropertiesBox.AddProperty(new PixelInformationBox(item.Image.Format));
+                        itemPropertiesBox.AddProperty(new PixelInformationBox(item.ImageFormat));
                         if (this.colorImageIsGrayscale)
                         {
                             colorPixelInformationAssociationIndex = alphaPixelInformationAssociationIndex = propertyAssociationIndex;
@@ -18,8 +18,6 @@ using PaintDotNet.AppModel;
 using PaintDotNet.Imaging;
 using System;
 using System.Collections.Generic;
-using System.ComponentModel;
-using System.Drawing;
 using System.IO;
 
 namespace AvifFileType
@@ -69,9 +67,29 @@ namespace AvifFileType
             return doc;
         }
 
+        /// <summary>
+        /// Reads the image properties without decoding the image.
+        /// </summary>
+        /// <param name="input">The input stream.</param>
+        /// <param name="arrayPool">The array pool.</param>
+        /// <returns>The image properties.</returns>
+        public static AvifImageInfo Probe(Stream input, IArrayPoolService arrayPool)
+        {
+            if (arrayPool is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(arrayPool));
+            }
+
+            using (AvifReader reader = new AvifReader(input, leaveOpen: true, arrayPool))
+            {
+                return reader.GetImageInfo();
+            }
+        }
+
         public static void Save(Document document,
                          Stream output,
                          int quality,
+                         int targetFileSize,
                          CompressionSpeed compressionSpeed,
                          YUVChromaSubsampling chromaSubsampling,
                          bool preserveExistingTileSize,
@@ -89,7 +107,26 @@ namespace AvifFileType
                 document.Render(args, true);
             }
 
-            bool grayscale = IsGrayscaleImage(scratchSurface);
+            AvifSaveReport report = new AvifSaveReport(scratchSurface.Width, scratchSurface.Height);
+
+            // The target file size is in kilobytes, the quality is selected by the encoder when it is set.
+            // Lossless encoding is not used in that mode as its file size cannot be controlled.
+            bool useTargetFileSize = targetFileSize > 0;
+            bool lossless = quality == 100 && !useTargetFileSize;
+
+            // The image grid is selected before the image is analyzed, so that the properties of the
+            // individual tiles can be computed in the same pass as the properties of the whole image.
+            // A grid that is valid for the requested YUV format is also valid for the YUV 4:0:0 format
+            // that is used for gray-scale images.
+            ImageGridMetadata imageGridMetadata = TryGetImageGridMetadata(document,
+                                                                          compressionSpeed,
+                                                                          lossless ? YUVChromaSubsampling.IdentityMatrix : chromaSubsampling,
+                                                                          preserveExistingTileSize);
+
+            ImageAnalysis analysis = AvifNative.AnalyzeImage(scratchSurface, imageGridMetadata, Environment.ProcessorCount);
+            uint[] duplicateTileIndexes = imageGridMetadata != null ? analysis.GetDuplicateTileIndexes() : null;
+            report.AnalysisCompleted(imageGridMetadata, duplicateTileIndexes);
+            bool grayscale = analysis.IsGrayscale;
 
             AvifMetadata metadata = CreateAvifMetadata(document);
             EncoderOptions options = new EncoderOptions
@@ -111,7 +148,7 @@ namespace AvifFileType
                 fullRange = true
             };
 
-            if (quality == 100 && !grayscale)
+            if (lossless && !grayscale)
             {
                 // The Identity matrix coefficient places the RGB values into the YUV planes without any conversion.
                 // This reduces the compression efficiency, but allows for fully lossless encoding.
@@ -147,68 +184,141 @@ namespace AvifFileType
                 }
             }
 
-            ImageGridMetadata imageGridMetadata = TryGetImageGridMetadata(document,
-                                                                          options.compressionSpeed,
-                                                                          options.yuvFormat,
-                                                                          preserveExistingTileSize);
+            bool hasTransparency = analysis.HasTransparency;
+
+            List<ColorInformationBox> colorInformationBoxes = new List<ColorInformationBox>(2);
 
-            bool hasTransparency = HasTransparency(scratchSurface);
+            byte[] iccProfileBytes = metadata.GetICCProfileBytesReadOnly();
+            if (iccProfileBytes != null && iccProfileBytes.Length > 0)
+            {
+                colorInformationBoxes.Add(new IccProfileColorInformation(iccProfileBytes));
+            }
 
-            CompressedAV1ImageCollection colorImages = new CompressedAV1ImageCollection(imageGridMetadata?.TileCount ?? 1);
-            CompressedAV1ImageCollection alphaImages = hasTransparency ? new CompressedAV1ImageCollection(colorImages.Capacity) : null;
+            colorInformationBoxes.Add(new NclxColorInformation(colorConversionInfo.colorPrimaries,
+                                                               colorConversionInfo.transferCharacteristics,
+                                                               colorConversionInfo.matrixCoefficients,
+                                                               colorConversionInfo.fullRange));
 
             // Progress is reported at the following stages:
-            // 1. Before converting the image to the YUV color space
-            // 2. Before compressing the color image
-            // 3. After compressing the color image
-            // 4. After compressing the alpha image (if present)
-            // 5. After writing the color image to the file
-            // 6. After writing the alpha image to the file (if present)
+            // 1. The steps of the target file size search (if enabled)
+            // 2. Before converting the image to the YUV color space
+            // 3. Before compressing the color image
+            // 4. After compressing the color image
+            // 5. After compressing the alpha image (if present)
+            // 6. After writing the color image to the file
+            // 7. After writing the alpha image to the file (if present)
+            //
+            // The image grid tiles are written to the file as they are compressed, so
+            // the write stages are not reported for image grids.
+            // The image grid tiles that are identical to an earlier tile are not compressed, and
+            // the opaque tiles share a single alpha image.
 
             uint progressDone = 0;
-            uint progressTotal = hasTransparency ? 6U : 4U;
-            if (colorImages.Capacity > 1)
+            uint progressTotal;
+            uint[] duplicateAlphaTileIndexes = null;
+
+            if (imageGridMetadata != null)
+            {
+                progressTotal = 3U * (uint)analysis.UniqueTileCount;
+
+                if (hasTransparency)
+                {
+                    progressTotal += (uint)analysis.EncodedAlphaTileCount;
+                    duplicateAlphaTileIndexes = analysis.GetDuplicateAlphaTileIndexes();
+                }
+            }
+            else
+            {
+                progressTotal = hasTransparency ? 6U : 4U;
+            }
+
+            if (useTargetFileSize)
             {
-                progressTotal *= (uint)colorImages.Capacity;
+                progressTotal += AvifNative.TargetSizeSearchProgressSteps;
+
+                ulong targetSize = GetTargetCompressedSize(targetFileSize, metadata, imageGridMetadata);
+
+                TargetSizeResult result = AvifNative.FindTargetSizeQuality(scratchSurface,
+                                                                           imageGridMetadata,
+                                                                           duplicateTileIndexes,
+                                                                           duplicateAlphaTileIndexes,
+                                                                           options,
+                                                                           ReportCompressionProgress,
+                                                                           ref progressDone,
+                                                                           progressTotal,
+                                                                           colorConversionInfo,
+                                                                           hasTransparency,
+                                                                           targetSize);
+                report.TargetSizeSearchCompleted(targetSize, result);
+
+                options.quality = result.quality;
             }
 
-            try
+            if (imageGridMetadata != null)
+            {
+                AvifWriter writer = new AvifWriter(imageGridMetadata,
+                                                   duplicateTileIndexes,
+                                                   duplicateAlphaTileIndexes,
+                                                   options.yuvFormat,
+                                                   hasTransparency,
+                                                   metadata,
+                                                   colorInformationBoxes,
+                                                   arrayPool);
+                writer.WriteStreamingTo(output, (tileHandler) =>
+                {
+                    AvifNative.CompressImageGrid(scratchSurface,
+                                                 imageGridMetadata,
+                                                 duplicateTileIndexes,
+                                                 duplicateAlphaTileIndexes,
+                                                 options,
+                                                 ReportCompressionProgress,
+                                                 ref progressDone,
+                                                 progressTotal,
+                                                 colorConversionInfo,
+                                                 hasTransparency,
+                                                 tileHandler,
+                                                 report.TileStats);
+                    report.CompressionCompleted();
+                });
+            }
+            else
             {
-                Rectangle[] windowRectangles = GetTileWindowRectangles(imageGridMetadata, document);
+                CompressedAV1ImageCollection colorImages = new CompressedAV1ImageCollection(1);
+                CompressedAV1ImageCollection alphaImages = hasTransparency ? new CompressedAV1ImageCollection(1) : null;
 
-                for (int i = 0; i < colorImages.Capacity; i++)
+                try
                 {
                     CompressedAV1Image color = null;
                     CompressedAV1Image alpha = null;
 
                     try
                     {
-                        Rectangle windowRect = windowRectangles[i];
-                        using (Surface window = scratchSurface.CreateWindow(windowRect))
+                        if (hasTransparency)
                         {
-                            if (hasTransparency)
-                            {
-                                AvifNative.CompressWithTransparency(window,
-                                                                    options,
-                                                                    ReportCompressionProgress,
-                                                                    ref progressDone,
-                                                                    progressTotal,
-                                                                    colorConversionInfo,
-                                                                    out color,
-                                                                    out alpha);
-                            }
-                            else
-                            {
-                                AvifNative.CompressWithoutTransparency(window,
-                                                                       options,
-                                                                       ReportCompressionProgress,
-                                                                       ref progressDone,
-                                                                       progressTotal,
-                                                                       colorConversionInfo,
-                                                                       out color);
-                            }
+                            AvifNative.CompressWithTransparency(scratchSurface,
+                                                                options,
+                                                                ReportCompressionProgress,
+                                                                ref progressDone,
+                                                                progressTotal,
+                                                                colorConversionInfo,
+                                                                out color,
+                                                                out alpha,
+                                                                out report.TileStats[0]);
+                        }
+                        else
+                        {
+                            AvifNative.CompressWithoutTransparency(scratchSurface,
+                                                                   options,
+                                                                   ReportCompressionProgress,
+                                                                   ref progressDone,
+                                                                   progressTotal,
+                                                                   colorConversionInfo,
+                                                                   out color,
+                                                                   out report.TileStats[0]);
                         }
 
+                        report.CompressionCompleted();
+
                         colorImages.Add(color);
                         color = null;
                         if (hasTransparency)
@@ -222,40 +332,28 @@ namespace AvifFileType
                         color?.Dispose();
                         alpha?.Dispose();
                     }
-                }
 
-
-                List<ColorInformationBox> colorInformationBoxes = new List<ColorInformationBox>(2);
-
-                byte[] iccProfileBytes = metadata.GetICCProfileBytesReadOnly();
-                if (iccProfileBytes != null && iccProfileBytes.Length > 0)
+                    AvifWriter writer = new AvifWriter(colorImages,
+                                                       alphaImages,
+                                                       metadata,
+                                                       imageGridMetadata,
+                                                       options.yuvFormat,
+                                                       colorInformationBoxes,
+                                                       progressCallback,
+                                                       progressDone,
+                                                       progressTotal,
+                                                       arrayPool);
+                    writer.WriteTo(output);
+                }
+                finally
                 {
-                    colorInformationBoxes.Add(new IccProfileColorInformation(iccProfileBytes));
+                    colorImages?.Dispose();
+                    alphaImages?.Dispose();
                 }
-
-                colorInformationBoxes.Add(new NclxColorInformation(colorConversionInfo.colorPrimaries,
-                                                                   colorConversionInfo.transferCharacteristics,
-                                                                   colorConversionInfo.matrixCoefficients,
-                                                                   colorConversionInfo.fullRange));
-
-                AvifWriter writer = new AvifWriter(colorImages,
-                                                   alphaImages,
-                                                   metadata,
-                                                   imageGridMetadata,
-                                                   options.yuvFormat,
-                                                   colorInformationBoxes,
-                                                   progressCallback,
-                                                   progressDone,
-                                                   progressTotal,
-                                                   arrayPool);
-                writer.WriteTo(output);
-            }
-            finally
-            {
-                colorImages?.Dispose();
-                alphaImages?.Dispose();
             }
 
+            report.SaveCompleted(options);
+
             bool ReportCompressionProgress(uint done, uint total)
             {
                 try
@@ -270,6 +368,32 @@ namespace AvifFileType
             }
         }
 
+        private static ulong GetTargetCompressedSize(int targetFileSize, AvifMetadata metadata, ImageGridMetadata imageGridMetadata)
+        {
+            // The meta-data and the container boxes are not part of the compressed images, so their
+            // size is subtracted from the target file size.
+            // The allowance for the container boxes is a rough estimate, it includes the image item
+            // properties and the location and reference boxes of every image grid tile.
+            const long ContainerSize = 1024;
+            const long GridTileContainerSize = 64;
+
+            long overhead = ContainerSize;
+
+            if (imageGridMetadata != null)
+            {
+                overhead += GridTileContainerSize * imageGridMetadata.TileCount;
+            }
+
+            overhead += metadata.GetExifBytesReadOnly()?.Length ?? 0;
+            overhead += metadata.GetICCProfileBytesReadOnly()?.Length ?? 0;
+            overhead += metadata.GetXmpBytesReadOnly()?.Length ?? 0;
+
+            long targetSize = (targetFileSize * 1024L) - overhead;
+
+            // Use the lowest quality if the meta-data is larger than the target file size.
+            return (ulong)Math.Max(targetSize, 1);
+        }
+
         private static void AddAvifMetadataToDocument(Document doc, AvifReader reader, IArrayPoolService arrayPool)
         {
             byte[] exifBytes = reader.GetExifData();
@@ -424,194 +548,19 @@ namespace AvifFileType
             return items;
         }
 
-        private static Rectangle[] GetTileWindowRectangles(ImageGridMetadata imageGridMetadata, Document document)
-        {
-            Rectangle[] rects;
-
-            if (imageGridMetadata is null)
-            {
-                rects = new Rectangle[] { document.Bounds };
-            }
-            else
-            {
-                rects = new Rectangle[imageGridMetadata.TileCount];
-
-                // The tiles are encoded from top to bottom then left to right.
-
-                int tileWidth = checked((int)imageGridMetadata.TileImageWidth);
-                int tileHeight = checked((int)imageGridMetadata.TileImageHeight);
-
-                for (int row = 0; row < imageGridMetadata.TileRowCount; row++)
-                {
-                    int startIndex = row * imageGridMetadata.TileColumnCount;
-                    int y = row * tileHeight;
-
-                    for (int col = 0; col < imageGridMetadata.TileColumnCount; col++)
-                    {
-                        int index = startIndex + col;
-                        int x = col * tileWidth;
-
-                        rects[index] = new Rectangle(x, y, tileWidth, tileHeight);
-                    }
-                }
-            }
-
-            return rects;
-        }
-
-        private static unsafe bool IsGrayscaleImage(Surface surface)
-        {
-            for (int y = 0; y < surface.Height; y++)
-            {
-                ColorBgra* ptr = surface.GetRowAddressUnchecked(y);
-                ColorBgra* ptrEnd = ptr + surface.Width;
-
-                while (ptr < ptrEnd)
-                {
-                    if (!(ptr->R == ptr->G && ptr->G == ptr->B))
-                    {
-                        return false;
-                    }
-                    ptr++;
-                }
-            }
-
-            return true;
-        }
-
-        private static unsafe bool HasTransparency(Surface surface)
-        {
-            for (int y = 0; y < surface.Height; y++)
-            {
-                ColorBgra* ptr = surface.GetRowAddressUnchecked(y);
-                ColorBgra* ptrEnd = ptr + surface.Width;
-
-                while (ptr < ptrEnd)
-                {
-                    if (ptr->A < 255)
-                    {
-                        return true;
-                    }
-
-                    ptr++;
-                }
-            }
-
-            return false;
-        }
-
         private static ImageGridMetadata TryCalculateBestTileSize(
             Document document,
             CompressionSpeed compressionSpeed)
         {
-            // Although the HEIF specification (ISO/IEC 23008-12:2017) allows an image grid to have up to 256 tiles
-            // in each direction (65536 total), the ISO base media file format (ISO/IEC 14496-12:2015) limits
-            // an item reference box to 65535 items.
-            // Because of this we limit the maximum number of tiles to 250.
-            //
-            // While this would result in the image using 62500 tiles in the worst case, it allows
-            // memory usage to be minimized when encoding extremely wide and/or tall images.
-            //
-            // For example, a 65536x65536 pixel image would use a 128x128 grid of 512x512 pixel tiles.
-            const int MaxTileCount = 250;
-            // The MIAF specification (ISO/IEC 23000-22:2019) requires that the tile size be at least 64x64 pixels.
-            const int MinTileSize = 64;
-
-            int maxTileSize;
-
-            switch (compressionSpeed)
+            if (compressionSpeed == CompressionSpeed.VerySlow)
             {
-                case CompressionSpeed.Fast:
-                    maxTileSize = 512;
-                    break;
-                case CompressionSpeed.Medium:
-                    maxTileSize = 1280;
-                    break;
-                case CompressionSpeed.Slow:
-                    maxTileSize = 1920;
-                    break;
-                case CompressionSpeed.VerySlow:
-                    // Tiles are not used for the very slow compression speed.
-                    return null;
-                default:
-                    throw new InvalidEnumArgumentException(nameof(compressionSpeed), (int)compressionSpeed, typeof(CompressionSpeed));
+                // Tiles are not used for the very slow compression speed.
+                return null;
             }
 
-            int bestTileColumnCount = 1;
-            int bestTileWidth = document.Width;
-            int bestTileRowCount = 1;
-            int bestTileHeight = document.Height;
-
-            if (document.Width > maxTileSize)
-            {
-                for (int tileColumnCount = 2; tileColumnCount <= MaxTileCount; tileColumnCount++)
-                {
-                    int tileWidth = document.Width / tileColumnCount;
-
-                    if (tileWidth < MinTileSize)
-                    {
-                        break;
-                    }
-
-                    if ((tileWidth & 1) == 0 && (tileWidth * tileColumnCount) == document.Width)
-                    {
-                        bestTileWidth = tileWidth;
-                        bestTileColumnCount = tileColumnCount;
-
-                        if (tileWidth <= maxTileSize)
-                        {
-                            break;
-                        }
-                    }
-                }
-            }
-
-            if (document.Height > maxTileSize)
-            {
-                if (document.Width == document.Height)
-                {
-                    // Square images use the same number of horizontal and vertical tiles.
-                    bestTileHeight = bestTileWidth;
-                    bestTileRowCount = bestTileColumnCount;
-                }
-                else
-                {
-                    for (int tileRowCount = 2; tileRowCount <= MaxTileCount; tileRowCount++)
-                    {
-                        int tileHeight = document.Height / tileRowCount;
-
-                        if (tileHeight < MinTileSize)
-                        {
-                            break;
-                        }
-
-                        if ((tileHeight & 1) == 0 && (tileHeight * tileRowCount) == document.Height)
-                        {
-                            bestTileHeight = tileHeight;
-                            bestTileRowCount = tileRowCount;
-
-                            if (tileHeight <= maxTileSize)
-                            {
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-
-            ImageGridMetadata metadata = null;
-
-            if (bestTileColumnCount > 1 || bestTileRowCount > 1)
-            {
-                metadata = new ImageGridMetadata(bestTileColumnCount,
-                                                 bestTileRowCount,
-                                                 (uint)document.Height,
-                                                 (uint)document.Width,
-                                                 (uint)bestTileHeight,
-                                                 (uint)bestTileWidth);
-            }
-
-            return metadata;
+            // The native encoder predicts the encode time of each tile layout from the number of threads,
+            // the image size and the compression speed, the tile limits are described in GridLayoutModel.cpp.
+            return AvifNative.SelectImageGridLayout(document.Width, document.Height, compressionSpeed, Environment.ProcessorCount);
         }
 
         private static ImageGridMetadata TryGetImageGridMetadata(
@@ -30,6 +30,7 @@ namespace AvifFileType
         private enum PropertyNames
         {
             Quality,
+            TargetFileSize,
             CompressionSpeed,
             YUVChromaSubsampling,
             ForumLink,
@@ -77,8 +78,9 @@ namespace AvifFileType
         protected override bool IsReflexive(PropertyBasedSaveConfigToken token)
         {
             int quality = token.GetProperty<Int32Property>(PropertyNames.Quality).Value;
+            int targetFileSize = token.GetProperty<Int32Property>(PropertyNames.TargetFileSize).Value;
 
-            return quality == 100;
+            return quality == 100 && targetFileSize == 0;
         }
 
         /// <summary>
@@ -89,6 +91,7 @@ namespace AvifFileType
             Property[] props = new Property[]
             {
                 new Int32Property(PropertyNames.Quality, 85, 0, 100, false),
+                new Int32Property(PropertyNames.TargetFileSize, 0, 0, 1048576, false),
                 StaticListChoiceProperty.CreateForEnum(PropertyNames.CompressionSpeed, CompressionSpeed.Fast),
                 CreateChromaSubsampling(),
                 new BooleanProperty(PropertyNames.PreserveExistingTileSize, true),
@@ -96,7 +99,13 @@ namespace AvifFileType
                 new UriProperty(PropertyNames.GitHubLink, new Uri("https://github.com/0xC0000054/pdn-avif"))
             };
 
-            return new PropertyCollection(props);
+            PropertyCollectionRule[] rules = new PropertyCollectionRule[]
+            {
+                // The quality is selected by the encoder when a target file size is set.
+                new ReadOnlyBoundToValueRule<int, Int32Property>(PropertyNames.Quality, PropertyNames.TargetFileSize, 0, true)
+            };
+
+            return new PropertyCollection(props, rules);
 
             StaticListChoiceProperty CreateChromaSubsampling()
             {
@@ -127,6 +136,10 @@ namespace AvifFileType
             qualityPCI.ControlProperties[ControlInfoPropertyNames.DisplayName].Value = this.strings.GetString("Quality_DisplayName");
             qualityPCI.ControlProperties[ControlInfoPropertyNames.Description].Value = string.Empty;
 
+            PropertyControlInfo targetFileSizePCI = configUI.FindControlForPropertyName(PropertyNames.TargetFileSize);
+            targetFileSizePCI.ControlProperties[ControlInfoPropertyNames.DisplayName].Value = this.strings.GetString("TargetFileSize_DisplayName");
+            targetFileSizePCI.ControlProperties[ControlInfoPropertyNames.Description].Value = this.strings.GetString("TargetFileSize_Description");
+
             PropertyControlInfo compressionSpeedPCI = configUI.FindControlForPropertyName(PropertyNames.CompressionSpeed);
             compressionSpeedPCI.ControlProperties[ControlInfoPropertyNames.DisplayName].Value = this.strings.GetString("CompressionSpeed_DisplayName");
             compressionSpeedPCI.SetValueDisplayName(CompressionSpeed.Fast, this.strings.GetString("CompressionSpeed_Fast_DisplayName"));
@@ -161,19 +174,28 @@ namespace AvifFileType
         protected override void OnSaveT(Document input, Stream output, PropertyBasedSaveConfigToken token, Surface scratchSurface, ProgressEventHandler progressCallback)
         {
             int quality = token.GetProperty<Int32Property>(PropertyNames.Quality).Value;
+            int targetFileSize = token.GetProperty<Int32Property>(PropertyNames.TargetFileSize).Value;
             CompressionSpeed compressionSpeed = (CompressionSpeed)token.GetProperty(PropertyNames.CompressionSpeed).Value;
             YUVChromaSubsampling chromaSubsampling = (YUVChromaSubsampling)token.GetProperty(PropertyNames.YUVChromaSubsampling).Value;
             bool preserveExistingTileSize = token.GetProperty<BooleanProperty>(PropertyNames.PreserveExistingTileSize).Value;
 
-            AvifFile.Save(input,
-                          output,
-                          quality,
-                          compressionSpeed,
-                          chromaSubsampling,
-                          preserveExistingTileSize,
-                          scratchSurface,
-                          progressCallback,
-                          this.arrayPoolService);
+            try
+            {
+                AvifFile.Save(input,
+                              output,
+                              quality,
+                              targetFileSize,
+                              compressionSpeed,
+                              chromaSubsampling,
+                              preserveExistingTileSize,
+                              scratchSurface,
+                              progressCallback,
+                              this.arrayPoolService);
+            }
+            finally
+            {
+                EncoderSessionReference.TrimCachedSession();
+            }
         }
 
         /// <summary>
@@ -0,0 +1,153 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+using AvifFileType.Interop;
+using System;
+using System.Diagnostics;
+using System.Globalization;
+using System.Text;
+
+namespace AvifFileType
+{
+    /// <summary>
+    /// Collects the per-stage timing and memory statistics of a decode operation.
+    /// </summary>
+    /// <remarks>
+    /// The report is written to the <c>AvifFileType.Load</c> trace source, which is disabled by default.
+    /// It can be enabled with a <c>system.diagnostics</c> section in the application configuration file.
+    /// </remarks>
+    internal sealed class AvifLoadReport
+    {
+        private static readonly TraceSource LoadTraceSource = new TraceSource("AvifFileType.Load", SourceLevels.Off);
+
+        private readonly int width;
+        private readonly int height;
+        private readonly uint downsampleShift;
+        private readonly Stopwatch stopwatch;
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="AvifLoadReport"/> class, and starts timing the decode.
+        /// </summary>
+        /// <param name="width">The width of the decoded image.</param>
+        /// <param name="height">The height of the decoded image.</param>
+        /// <param name="downsampleShift">The power of two that the image is downsampled by.</param>
+        /// <param name="colorTileCount">The number of color image grid tiles, or 1 if the color image is not an image grid.</param>
+        /// <param name="alphaTileCount">
+        /// The number of alpha image grid tiles that are decoded separately from the color image, or 1 if the alpha image
+        /// is not an image grid. This is 0 if the image does not have an alpha image or if it is decoded with the color image.
+        /// </param>
+        public AvifLoadReport(int width, int height, uint downsampleShift, int colorTileCount, int alphaTileCount)
+        {
+            this.width = width;
+            this.height = height;
+            this.downsampleShift = downsampleShift;
+            this.stopwatch = Stopwatch.StartNew();
+            this.ColorTileStats = new DecodeStats[colorTileCount];
+            this.AlphaTileStats = new DecodeStats[alphaTileCount];
+        }
+
+        /// <summary>
+        /// Gets the decoder statistics of each color image grid tile, or of the whole color image if it is not an image grid.
+        /// </summary>
+        /// <remarks>
+        /// The statistics include the alpha image when the color and alpha images are decoded together.
+        /// The tiles that are outside of the decoded region are not decoded, and their statistics are zero.
+        /// </remarks>
+        public DecodeStats[] ColorTileStats { get; }
+
+        /// <summary>
+        /// Gets the decoder statistics of each alpha image grid tile that is decoded separately from the color image.
+        /// </summary>
+        public DecodeStats[] AlphaTileStats { get; }
+
+        /// <summary>
+        /// Records the end of the decode, and writes the report to the trace source if it is enabled.
+        /// </summary>
+        public void DecodeCompleted()
+        {
+            this.stopwatch.Stop();
+
+            if (LoadTraceSource.Switch.ShouldTrace(TraceEventType.Information))
+            {
+                LoadTraceSource.TraceEvent(TraceEventType.Information, 0, Format());
+            }
+        }
+
+        private string Format()
+        {
+            StringBuilder builder = new StringBuilder();
+
+            builder.AppendFormat(CultureInfo.InvariantCulture,
+                                 "AVIF load: {0}x{1}, downsample shift {2}, {3} color tiles, {4} alpha tiles",
+                                 this.width,
+                                 this.height,
+                                 this.downsampleShift,
+                                 this.ColorTileStats.Length,
+                                 this.AlphaTileStats.Length);
+            builder.AppendLine();
+            builder.AppendFormat(CultureInfo.InvariantCulture, "Total {0:F2} ms", this.stopwatch.Elapsed.TotalMilliseconds);
+            builder.AppendLine();
+
+            ulong compressedSize = 0;
+            ulong largestFrameBufferSize = 0;
+
+            AppendTileStats(builder, "Tile", this.ColorTileStats, ref compressedSize, ref largestFrameBufferSize);
+            AppendTileStats(builder, "Alpha tile", this.AlphaTileStats, ref compressedSize, ref largestFrameBufferSize);
+
+            builder.AppendFormat(CultureInfo.InvariantCulture,
+                                 "Compressed size {0} bytes, largest tile frame buffers {1} bytes",
+                                 compressedSize,
+                                 largestFrameBufferSize);
+
+            return builder.ToString();
+        }
+
+        private static void AppendTileStats(StringBuilder builder,
+                                            string name,
+                                            DecodeStats[] tileStats,
+                                            ref ulong compressedSize,
+                                            ref ulong largestFrameBufferSize)
+        {
+            for (int i = 0; i < tileStats.Length; i++)
+            {
+                DecodeStats stats = tileStats[i];
+
+                if (stats.threadCount == 0)
+                {
+                    // The tile was not decoded.
+                    continue;
+                }
+
+                builder.AppendFormat(CultureInfo.InvariantCulture,
+                                     "{0} {1}: {2:F2} ms, {3} bytes, {4} threads, color decode {5:F2} ms, alpha decode {6:F2} ms, " +
+                                     "conversion {7:F2} ms, frame buffers {8} bytes",
+                                     name,
+                                     i,
+                                     ToMilliseconds(stats.totalTime),
+                                     stats.compressedSize,
+                                     stats.threadCount,
+                                     ToMilliseconds(stats.colorDecodeTime),
+                                     ToMilliseconds(stats.alphaDecodeTime),
+                                     ToMilliseconds(stats.conversionTime),
+                                     stats.frameBufferSize);
+                builder.AppendLine();
+
+                compressedSize += stats.compressedSize;
+                largestFrameBufferSize = Math.Max(largestFrameBufferSize, stats.frameBufferSize);
+            }
+        }
+
+        private static double ToMilliseconds(ulong nanoseconds)
+        {
+            return nanoseconds / 1000000.0;
+        }
+    }
+}
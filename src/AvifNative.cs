@@ -10,6 +10,7 @@
 //
 ////////////////////////////////////////////////////////////////////////
 
+using AvifFileType.AvifContainer;
 using AvifFileType.Interop;
 using PaintDotNet;
 using System;
@@ -19,6 +20,113 @@ namespace AvifFileType
 {
     internal static class AvifNative
     {
+        /// <summary>
+        /// The number of times that <see cref="FindTargetSizeQuality"/> reports progress.
+        /// </summary>
+        /// <remarks>
+        /// This must be kept in sync with AvifNative.h
+        /// </remarks>
+        public const uint TargetSizeSearchProgressSteps = 6;
+
+        /// <summary>
+        /// Computes the properties of the image and each of its grid tiles in a single pass over the image.
+        /// </summary>
+        /// <param name="surface">The image.</param>
+        /// <param name="imageGridMetadata">The image grid, or <see langword="null"/> to analyze the image as a single tile.</param>
+        /// <param name="maxThreads">The maximum number of threads to use.</param>
+        /// <returns>The image analysis.</returns>
+        public static ImageAnalysis AnalyzeImage(Surface surface, ImageGridMetadata imageGridMetadata, int maxThreads)
+        {
+            BitmapData bitmapData = new BitmapData
+            {
+                scan0 = surface.Scan0.Pointer,
+                width = (uint)surface.Width,
+                height = (uint)surface.Height,
+                stride = (uint)surface.Stride
+            };
+
+            TileAnalysis[] tiles = new TileAnalysis[imageGridMetadata?.TileCount ?? 1];
+            EncoderStatus status;
+
+            if (imageGridMetadata != null)
+            {
+                ImageGridLayout gridLayout = new ImageGridLayout
+                {
+                    tileColumnCount = (uint)imageGridMetadata.TileColumnCount,
+                    tileRowCount = (uint)imageGridMetadata.TileRowCount,
+                    tileWidth = imageGridMetadata.TileImageWidth,
+                    tileHeight = imageGridMetadata.TileImageHeight
+                };
+
+                if (IntPtr.Size == 8)
+                {
+                    status = AvifNative_64.AnalyzeImage(ref bitmapData, ref gridLayout, maxThreads, tiles);
+                }
+                else
+                {
+                    status = AvifNative_86.AnalyzeImage(ref bitmapData, ref gridLayout, maxThreads, tiles);
+                }
+            }
+            else
+            {
+                if (IntPtr.Size == 8)
+                {
+                    status = AvifNative_64.AnalyzeImage(ref bitmapData, IntPtr.Zero, maxThreads, tiles);
+                }
+                else
+                {
+                    status = AvifNative_86.AnalyzeImage(ref bitmapData, IntPtr.Zero, maxThreads, tiles);
+                }
+            }
+
+            if (status != EncoderStatus.Ok)
+            {
+                HandleError(status, null);
+            }
+
+            return new ImageAnalysis(tiles, imageGridMetadata);
+        }
+
+        /// <summary>
+        /// Selects the image grid layout with the lowest predicted encode time.
+        /// </summary>
+        /// <param name="width">The image width.</param>
+        /// <param name="height">The image height.</param>
+        /// <param name="compressionSpeed">The compression speed.</param>
+        /// <param name="maxThreads">The maximum number of threads to use.</param>
+        /// <returns>The image grid, or <see langword="null"/> if the image should be encoded as a single tile.</returns>
+        public static ImageGridMetadata SelectImageGridLayout(int width, int height, CompressionSpeed compressionSpeed, int maxThreads)
+        {
+            ImageGridLayout gridLayout;
+            EncoderStatus status;
+
+            if (IntPtr.Size == 8)
+            {
+                status = AvifNative_64.SelectImageGridLayout((uint)width, (uint)height, compressionSpeed, maxThreads, out gridLayout);
+            }
+            else
+            {
+                status = AvifNative_86.SelectImageGridLayout((uint)width, (uint)height, compressionSpeed, maxThreads, out gridLayout);
+            }
+
+            if (status != EncoderStatus.Ok)
+            {
+                HandleError(status, null);
+            }
+
+            if (gridLayout.tileColumnCount == 1 && gridLayout.tileRowCount == 1)
+            {
+                return null;
+            }
+
+            return new ImageGridMetadata((int)gridLayout.tileColumnCount,
+                                         (int)gridLayout.tileRowCount,
+                                         (uint)height,
+                                         (uint)width,
+                                         gridLayout.tileHeight,
+                                         gridLayout.tileWidth);
+        }
+
         public static void CompressWithTransparency(Surface surface,
                                                     EncoderOptions options,
                                                     AvifProgressCallback avifProgress,
@@ -26,7 +134,8 @@ namespace AvifFileType
                                                     uint progressTotal,
                                                     CICPColorData colorInfo,
                                                     out CompressedAV1Image color,
-                                                    out CompressedAV1Image alpha)
+                                                    out CompressedAV1Image alpha,
+                                                    out EncodeStats stats)
         {
             BitmapData bitmapData = new BitmapData
             {
@@ -46,25 +155,30 @@ namespace AvifFileType
                 CompressedAV1OutputAlloc outputAllocDelegate = new CompressedAV1OutputAlloc(allocator.Allocate);
                 EncoderStatus status = EncoderStatus.Ok;
 
-                if (IntPtr.Size == 8)
-                {
-                    status = AvifNative_64.CompressImage(ref bitmapData,
-                                                         options,
-                                                         progressContext,
-                                                         ref colorInfo,
-                                                         outputAllocDelegate,
-                                                         out colorImage,
-                                                         out alphaImage);
-                }
-                else
+                using (EncoderSessionReference session = EncoderSessionReference.Acquire(options))
                 {
-                    status = AvifNative_86.CompressImage(ref bitmapData,
-                                                         options,
-                                                         progressContext,
-                                                         ref colorInfo,
-                                                         outputAllocDelegate,
-                                                         out colorImage,
-                                                         out alphaImage);
+                    if (IntPtr.Size == 8)
+                    {
+                        status = AvifNative_64.CompressImage(session.Handle,
+                                                             ref bitmapData,
+                                                             progressContext,
+                                                             ref colorInfo,
+                                                             outputAllocDelegate,
+                                                             out colorImage,
+                                                             out alphaImage,
+                                                             out stats);
+                    }
+                    else
+                    {
+                        status = AvifNative_86.CompressImage(session.Handle,
+                                                             ref bitmapData,
+                                                             progressContext,
+                                                             ref colorInfo,
+                                                             outputAllocDelegate,
+                                                             out colorImage,
+                                                             out alphaImage,
+                                                             out stats);
+                    }
                 }
 
                 GC.KeepAlive(outputAllocDelegate);
@@ -88,7 +202,8 @@ namespace AvifFileType
                                                        ref uint progressDone,
                                                        uint progressTotal,
                                                        CICPColorData colorInfo,
-                                                       out CompressedAV1Image color)
+                                                       out CompressedAV1Image color,
+                                                       out EncodeStats stats)
         {
             BitmapData bitmapData = new BitmapData
             {
@@ -107,25 +222,30 @@ namespace AvifFileType
                 CompressedAV1OutputAlloc outputAllocDelegate = new CompressedAV1OutputAlloc(allocator.Allocate);
                 EncoderStatus status = EncoderStatus.Ok;
 
-                if (IntPtr.Size == 8)
+                using (EncoderSessionReference session = EncoderSessionReference.Acquire(options))
                 {
-                    status = AvifNative_64.CompressImage(ref bitmapData,
-                                                         options,
-                                                         progressContext,
-                                                         ref colorInfo,
-                                                         outputAllocDelegate,
-                                                         out colorImage,
-                                                         IntPtr.Zero);
-                }
-                else
-                {
-                    status = AvifNative_86.CompressImage(ref bitmapData,
-                                                         options,
-                                                         progressContext,
-                                                         ref colorInfo,
-                                                         outputAllocDelegate,
-                                                         out colorImage,
-                                                         IntPtr.Zero);
+                    if (IntPtr.Size == 8)
+                    {
+                        status = AvifNative_64.CompressImage(session.Handle,
+                                                             ref bitmapData,
+                                                             progressContext,
+                                                             ref colorInfo,
+                                                             outputAllocDelegate,
+                                                             out colorImage,
+                                                             IntPtr.Zero,
+                                                             out stats);
+                    }
+                    else
+                    {
+                        status = AvifNative_86.CompressImage(session.Handle,
+                                                             ref bitmapData,
+                                                             progressContext,
+                                                             ref colorInfo,
+                                                             outputAllocDelegate,
+                                                             out colorImage,
+                                                             IntPtr.Zero,
+                                                             out stats);
+                    }
                 }
 
                 GC.KeepAlive(outputAllocDelegate);
@@ -142,16 +262,333 @@ namespace AvifFileType
             GC.KeepAlive(avifProgress);
         }
 
+        /// <summary>
+        /// Compresses the tiles of an image grid, the tiles are passed to <paramref name="tileHandler"/> as they finish encoding.
+        /// </summary>
+        /// <remarks>
+        /// The tile handler takes ownership of the compressed images, and it is called once for each tile in
+        /// the order that the tiles are completed.
+        /// The calls are serialized, but they may be made from a thread pool thread.
+        /// The encoder statistics of each tile are written to <paramref name="tileStats"/>, which must
+        /// have one entry for each tile.
+        /// </remarks>
+        public static void CompressImageGrid(Surface surface,
+                                             ImageGridMetadata imageGridMetadata,
+                                             uint[] duplicateTileIndexes,
+                                             uint[] duplicateAlphaTileIndexes,
+                                             EncoderOptions options,
+                                             AvifProgressCallback avifProgress,
+                                             ref uint progressDone,
+                                             uint progressTotal,
+                                             CICPColorData colorInfo,
+                                             bool hasTransparency,
+                                             CompressedImageGridTileHandler tileHandler,
+                                             EncodeStats[] tileStats)
+        {
+            if (imageGridMetadata is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(imageGridMetadata));
+            }
+
+            if (tileHandler is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(tileHandler));
+            }
+
+            if (tileStats is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(tileStats));
+            }
+
+            if (tileStats.Length < imageGridMetadata.TileCount)
+            {
+                ExceptionUtil.ThrowArgumentOutOfRangeException(nameof(tileStats), "The array must have one entry for each tile.");
+            }
+
+            if (duplicateTileIndexes != null && duplicateTileIndexes.Length < imageGridMetadata.TileCount)
+            {
+                ExceptionUtil.ThrowArgumentOutOfRangeException(nameof(duplicateTileIndexes), "The array must have one entry for each tile.");
+            }
+
+            if (duplicateAlphaTileIndexes != null && duplicateAlphaTileIndexes.Length < imageGridMetadata.TileCount)
+            {
+                ExceptionUtil.ThrowArgumentOutOfRangeException(nameof(duplicateAlphaTileIndexes), "The array must have one entry for each tile.");
+            }
+
+            BitmapData bitmapData = new BitmapData
+            {
+                scan0 = surface.Scan0.Pointer,
+                width = (uint)surface.Width,
+                height = (uint)surface.Height,
+                stride = (uint)surface.Stride
+            };
+
+            ImageGridLayout gridLayout = new ImageGridLayout
+            {
+                tileColumnCount = (uint)imageGridMetadata.TileColumnCount,
+                tileRowCount = (uint)imageGridMetadata.TileRowCount,
+                tileWidth = imageGridMetadata.TileImageWidth,
+                tileHeight = imageGridMetadata.TileImageHeight
+            };
+
+            int tileCount = imageGridMetadata.TileCount;
+            int tileWidth = (int)imageGridMetadata.TileImageWidth;
+            int tileHeight = (int)imageGridMetadata.TileImageHeight;
+            int encodedTileCount = tileCount;
+
+            if (duplicateTileIndexes != null)
+            {
+                encodedTileCount = 0;
+
+                for (int i = 0; i < tileCount; i++)
+                {
+                    if (duplicateTileIndexes[i] == (uint)i)
+                    {
+                        encodedTileCount++;
+                    }
+                }
+            }
+
+            ProgressContext progressContext = new ProgressContext(avifProgress, progressDone, progressTotal);
+
+            using (CompressedAV1DataAllocator allocator = new CompressedAV1DataAllocator(hasTransparency ? encodedTileCount * 2 : encodedTileCount))
+            {
+                IntPtr[] colorTiles = new IntPtr[tileCount];
+                IntPtr[] alphaTiles = hasTransparency ? new IntPtr[tileCount] : null;
+                ExceptionDispatchInfo tileExceptionInfo = null;
+
+                CompressedAV1OutputAlloc outputAllocDelegate = new CompressedAV1OutputAlloc(allocator.Allocate);
+                CompressedTileReady tileReadyDelegate = new CompressedTileReady((tileIndex, colorImage, alphaImage) =>
+                {
+                    CompressedAV1Image color = null;
+                    CompressedAV1Image alpha = null;
+
+                    try
+                    {
+                        color = new CompressedAV1Image(allocator.GetCompressedAV1Data(colorImage), tileWidth, tileHeight, options.yuvFormat);
+
+                        if (alphaImage != IntPtr.Zero)
+                        {
+                            alpha = new CompressedAV1Image(allocator.GetCompressedAV1Data(alphaImage), tileWidth, tileHeight, YUVChromaSubsampling.Subsampling400);
+                        }
+
+                        CompressedAV1Image ownedColor = color;
+                        CompressedAV1Image ownedAlpha = alpha;
+                        color = null;
+                        alpha = null;
+
+                        tileHandler((int)tileIndex, ownedColor, ownedAlpha);
+                    }
+                    catch (Exception ex)
+                    {
+                        tileExceptionInfo = ExceptionDispatchInfo.Capture(ex);
+                        return false;
+                    }
+                    finally
+                    {
+                        color?.Dispose();
+                        alpha?.Dispose();
+                    }
+
+                    return true;
+                });
+                EncoderStatus status = EncoderStatus.Ok;
+
+                using (EncoderSessionReference session = EncoderSessionReference.Acquire(options))
+                {
+                    if (IntPtr.Size == 8)
+                    {
+                        status = AvifNative_64.CompressImageGrid(session.Handle,
+                                                                 ref bitmapData,
+                                                                 ref gridLayout,
+                                                                 duplicateTileIndexes,
+                                                                 duplicateAlphaTileIndexes,
+                                                                 progressContext,
+                                                                 ref colorInfo,
+                                                                 outputAllocDelegate,
+                                                                 colorTiles,
+                                                                 alphaTiles,
+                                                                 tileReadyDelegate,
+                                                                 tileStats);
+                    }
+                    else
+                    {
+                        status = AvifNative_86.CompressImageGrid(session.Handle,
+                                                                 ref bitmapData,
+                                                                 ref gridLayout,
+                                                                 duplicateTileIndexes,
+                                                                 duplicateAlphaTileIndexes,
+                                                                 progressContext,
+                                                                 ref colorInfo,
+                                                                 outputAllocDelegate,
+                                                                 colorTiles,
+                                                                 alphaTiles,
+                                                                 tileReadyDelegate,
+                                                                 tileStats);
+                    }
+                }
+
+                GC.KeepAlive(outputAllocDelegate);
+                GC.KeepAlive(tileReadyDelegate);
+
+                if (status != EncoderStatus.Ok)
+                {
+                    HandleError(status, allocator.ExceptionInfo ?? tileExceptionInfo);
+                }
+            }
+
+            progressDone = progressContext.progressDone;
+            GC.KeepAlive(avifProgress);
+        }
+
+        /// <summary>
+        /// Searches for the highest quality that compresses the color and alpha images to at most the target size.
+        /// </summary>
+        /// <param name="surface">The image.</param>
+        /// <param name="imageGridMetadata">The image grid, or <see langword="null"/> to compress the image as a single tile.</param>
+        /// <param name="duplicateTileIndexes">The duplicate color tile indexes, or <see langword="null"/>.</param>
+        /// <param name="duplicateAlphaTileIndexes">The duplicate alpha tile indexes, or <see langword="null"/>.</param>
+        /// <param name="options">The encoder options, the quality is ignored.</param>
+        /// <param name="avifProgress">The progress callback.</param>
+        /// <param name="progressDone">The progress done.</param>
+        /// <param name="progressTotal">The progress total.</param>
+        /// <param name="colorInfo">The color information.</param>
+        /// <param name="hasTransparency"><see langword="true"/> if the image has an alpha image; otherwise, <see langword="false"/>.</param>
+        /// <param name="targetSize">The target size of the compressed images in bytes.</param>
+        /// <returns>The search result.</returns>
+        public static TargetSizeResult FindTargetSizeQuality(Surface surface,
+                                                             ImageGridMetadata imageGridMetadata,
+                                                             uint[] duplicateTileIndexes,
+                                                             uint[] duplicateAlphaTileIndexes,
+                                                             EncoderOptions options,
+                                                             AvifProgressCallback avifProgress,
+                                                             ref uint progressDone,
+                                                             uint progressTotal,
+                                                             CICPColorData colorInfo,
+                                                             bool hasTransparency,
+                                                             ulong targetSize)
+        {
+            if (imageGridMetadata != null)
+            {
+                if (duplicateTileIndexes != null && duplicateTileIndexes.Length < imageGridMetadata.TileCount)
+                {
+                    ExceptionUtil.ThrowArgumentOutOfRangeException(nameof(duplicateTileIndexes), "The array must have one entry for each tile.");
+                }
+
+                if (duplicateAlphaTileIndexes != null && duplicateAlphaTileIndexes.Length < imageGridMetadata.TileCount)
+                {
+                    ExceptionUtil.ThrowArgumentOutOfRangeException(nameof(duplicateAlphaTileIndexes), "The array must have one entry for each tile.");
+                }
+            }
+
+            BitmapData bitmapData = new BitmapData
+            {
+                scan0 = surface.Scan0.Pointer,
+                width = (uint)surface.Width,
+                height = (uint)surface.Height,
+                stride = (uint)surface.Stride
+            };
+
+            ProgressContext progressContext = new ProgressContext(avifProgress, progressDone, progressTotal);
+
+            TargetSizeResult result;
+            EncoderStatus status;
+
+            if (imageGridMetadata != null)
+            {
+                ImageGridLayout gridLayout = new ImageGridLayout
+                {
+                    tileColumnCount = (uint)imageGridMetadata.TileColumnCount,
+                    tileRowCount = (uint)imageGridMetadata.TileRowCount,
+                    tileWidth = imageGridMetadata.TileImageWidth,
+                    tileHeight = imageGridMetadata.TileImageHeight
+                };
+
+                if (IntPtr.Size == 8)
+                {
+                    status = AvifNative_64.FindTargetSizeQuality(ref bitmapData,
+                                                                 ref gridLayout,
+                                                                 duplicateTileIndexes,
+                                                                 duplicateAlphaTileIndexes,
+                                                                 options,
+                                                                 ref colorInfo,
+                                                                 hasTransparency,
+                                                                 targetSize,
+                                                                 progressContext,
+                                                                 out result);
+                }
+                else
+                {
+                    status = AvifNative_86.FindTargetSizeQuality(ref bitmapData,
+                                                                 ref gridLayout,
+                                                                 duplicateTileIndexes,
+                                                                 duplicateAlphaTileIndexes,
+                                                                 options,
+                                                                 ref colorInfo,
+                                                                 hasTransparency,
+                                                                 targetSize,
+                                                                 progressContext,
+                                                                 out result);
+                }
+            }
+            else
+            {
+                if (IntPtr.Size == 8)
+                {
+                    status = AvifNative_64.FindTargetSizeQuality(ref bitmapData,
+                                                                 IntPtr.Zero,
+                                                                 IntPtr.Zero,
+                                                                 IntPtr.Zero,
+                                                                 options,
+                                                                 ref colorInfo,
+                                                                 hasTransparency,
+                                                                 targetSize,
+                                                                 progressContext,
+                                                                 out result);
+                }
+                else
+                {
+                    status = AvifNative_86.FindTargetSizeQuality(ref bitmapData,
+                                                                 IntPtr.Zero,
+                                                                 IntPtr.Zero,
+                                                                 IntPtr.Zero,
+                                                                 options,
+                                                                 ref colorInfo,
+                                                                 hasTransparency,
+                                                                 targetSize,
+                                                                 progressContext,
+                                                                 out result);
+                }
+            }
+
+            if (status != EncoderStatus.Ok)
+            {
+                HandleError(status, null);
+            }
+
+            progressDone = progressContext.progressDone;
+            GC.KeepAlive(avifProgress);
+
+            return result;
+        }
+
         public static void DecompressColor(AvifItemData colorImage,
+                                           DecoderOptions decoderOptions,
                                            CICPColorData? colorConversionInfo,
                                            DecodeInfo decodeInfo,
-                                           Surface fullSurface)
+                                           Surface fullSurface,
+                                           out DecodeStats stats)
         {
             if (colorImage is null)
             {
                 ExceptionUtil.ThrowArgumentNullException(nameof(colorImage));
             }
 
+            if (decoderOptions is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(decoderOptions));
+            }
+
             if (decodeInfo is null)
             {
                 ExceptionUtil.ThrowArgumentNullException(nameof(decodeInfo));
@@ -164,6 +601,7 @@ namespace AvifFileType
 
 
             DecoderStatus status = DecoderStatus.Ok;
+            DecodeStats decodeStats = default;
 
             unsafe
             {
@@ -186,17 +624,21 @@ namespace AvifFileType
                         {
                             status = AvifNative_64.DecompressColorImage(ptr,
                                                                         colorImageSize,
+                                                                        decoderOptions,
                                                                         ref colorData,
                                                                         decodeInfo,
-                                                                        ref bitmapData);
+                                                                        ref bitmapData,
+                                                                        out decodeStats);
                         }
                         else
                         {
                             status = AvifNative_86.DecompressColorImage(ptr,
                                                                         colorImageSize,
+                                                                        decoderOptions,
                                                                         ref colorData,
                                                                         decodeInfo,
-                                                                        ref bitmapData);
+                                                                        ref bitmapData,
+                                                                        out decodeStats);
                         }
                     }
                     else
@@ -205,22 +647,28 @@ namespace AvifFileType
                         {
                             status = AvifNative_64.DecompressColorImage(ptr,
                                                                         colorImageSize,
+                                                                        decoderOptions,
                                                                         IntPtr.Zero,
                                                                         decodeInfo,
-                                                                        ref bitmapData);
+                                                                        ref bitmapData,
+                                                                        out decodeStats);
                         }
                         else
                         {
                             status = AvifNative_86.DecompressColorImage(ptr,
                                                                         colorImageSize,
+                                                                        decoderOptions,
                                                                         IntPtr.Zero,
                                                                         decodeInfo,
-                                                                        ref bitmapData);
+                                                                        ref bitmapData,
+                                                                        out decodeStats);
                         }
                     }
                 });
             }
 
+            stats = decodeStats;
+
             if (status != DecoderStatus.Ok)
             {
                 HandleError(status);
@@ -228,14 +676,21 @@ namespace AvifFileType
         }
 
         public static void DecompressAlpha(AvifItemData alphaImage,
+                                           DecoderOptions decoderOptions,
                                            DecodeInfo decodeInfo,
-                                           Surface fullSurface)
+                                           Surface fullSurface,
+                                           out DecodeStats stats)
         {
             if (alphaImage is null)
             {
                 ExceptionUtil.ThrowArgumentNullException(nameof(alphaImage));
             }
 
+            if (decoderOptions is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(decoderOptions));
+            }
+
             if (decodeInfo is null)
             {
                 ExceptionUtil.ThrowArgumentNullException(nameof(decodeInfo));
@@ -247,6 +702,7 @@ namespace AvifFileType
             }
 
             DecoderStatus status = DecoderStatus.Ok;
+            DecodeStats decodeStats = default;
 
             unsafe
             {
@@ -266,19 +722,158 @@ namespace AvifFileType
                         {
                             status = AvifNative_64.DecompressAlphaImage(ptr,
                                                                         alphaImageSize,
+                                                                        decoderOptions,
                                                                         decodeInfo,
-                                                                        ref bitmapData);
+                                                                        ref bitmapData,
+                                                                        out decodeStats);
                         }
                         else
                         {
                             status = AvifNative_86.DecompressAlphaImage(ptr,
                                                                         alphaImageSize,
+                                                                        decoderOptions,
                                                                         decodeInfo,
-                                                                        ref bitmapData);
+                                                                        ref bitmapData,
+                                                                        out decodeStats);
                         }
                     });
             }
 
+            stats = decodeStats;
+
+            if (status != DecoderStatus.Ok)
+            {
+                HandleError(status);
+            }
+        }
+
+        /// <summary>
+        /// Decodes the color and alpha images, the output pixels are written in a single pass.
+        /// </summary>
+        public static void DecompressColorAndAlpha(AvifItemData colorImage,
+                                                   AvifItemData alphaImage,
+                                                   DecoderOptions decoderOptions,
+                                                   CICPColorData? colorConversionInfo,
+                                                   DecodeInfo colorDecodeInfo,
+                                                   DecodeInfo alphaDecodeInfo,
+                                                   Surface fullSurface,
+                                                   out DecodeStats stats)
+        {
+            if (colorImage is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(colorImage));
+            }
+
+            if (alphaImage is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(alphaImage));
+            }
+
+            if (decoderOptions is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(decoderOptions));
+            }
+
+            if (colorDecodeInfo is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(colorDecodeInfo));
+            }
+
+            if (alphaDecodeInfo is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(alphaDecodeInfo));
+            }
+
+            if (fullSurface is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(fullSurface));
+            }
+
+            DecoderStatus status = DecoderStatus.Ok;
+            DecodeStats decodeStats = default;
+
+            unsafe
+            {
+                colorImage.UseBufferPointer((colorPtr, colorLength) =>
+                {
+                    alphaImage.UseBufferPointer((alphaPtr, alphaLength) =>
+                    {
+                        BitmapData bitmapData = new BitmapData
+                        {
+                            scan0 = fullSurface.Scan0.Pointer,
+                            width = (uint)fullSurface.Width,
+                            height = (uint)fullSurface.Height,
+                            stride = (uint)fullSurface.Stride
+                        };
+                        UIntPtr colorImageSize = new UIntPtr(colorLength);
+                        UIntPtr alphaImageSize = new UIntPtr(alphaLength);
+
+                        if (colorConversionInfo.HasValue)
+                        {
+                            CICPColorData colorData = colorConversionInfo.Value;
+
+                            if (IntPtr.Size == 8)
+                            {
+                                status = AvifNative_64.DecompressImage(colorPtr,
+                                                                       colorImageSize,
+                                                                       alphaPtr,
+                                                                       alphaImageSize,
+                                                                       decoderOptions,
+                                                                       ref colorData,
+                                                                       colorDecodeInfo,
+                                                                       alphaDecodeInfo,
+                                                                       ref bitmapData,
+                                                                       out decodeStats);
+                            }
+                            else
+                            {
+                                status = AvifNative_86.DecompressImage(colorPtr,
+                                                                       colorImageSize,
+                                                                       alphaPtr,
+                                                                       alphaImageSize,
+                                                                       decoderOptions,
+                                                                       ref colorData,
+                                                                       colorDecodeInfo,
+                                                                       alphaDecodeInfo,
+                                                                       ref bitmapData,
+                                                                       out decodeStats);
+                            }
+                        }
+                        else
+                        {
+                            if (IntPtr.Size == 8)
+                            {
+                                status = AvifNative_64.DecompressImage(colorPtr,
+                                                                       colorImageSize,
+                                                                       alphaPtr,
+                                                                       alphaImageSize,
+                                                                       decoderOptions,
+                                                                       IntPtr.Zero,
+                                                                       colorDecodeInfo,
+                                                                       alphaDecodeInfo,
+                                                                       ref bitmapData,
+                                                                       out decodeStats);
+                            }
+                            else
+                            {
+                                status = AvifNative_86.DecompressImage(colorPtr,
+                                                                       colorImageSize,
+                                                                       alphaPtr,
+                                                                       alphaImageSize,
+                                                                       decoderOptions,
+                                                                       IntPtr.Zero,
+                                                                       colorDecodeInfo,
+                                                                       alphaDecodeInfo,
+                                                                       ref bitmapData,
+                                                                       out decodeStats);
+                            }
+                        }
+                    });
+                });
+            }
+
+            stats = decodeStats;
+
             if (status != DecoderStatus.Ok)
             {
                 HandleError(status);
@@ -309,6 +904,8 @@ namespace AvifFileType
                         throw new FormatException("The AV1 encode failed.");
                     case EncoderStatus.UserCancelled:
                         throw new OperationCanceledException();
+                    case EncoderStatus.InvalidParameter:
+                        throw new FormatException("An encoder parameter was not valid.");
                     default:
                         throw new FormatException("An unknown error occurred when encoding the image.");
                 }
@@ -341,6 +938,8 @@ namespace AvifFileType
                     throw new FormatException("The YUV format is not supported by the decoder.");
                 case DecoderStatus.TileFormatMismatch:
                     throw new FormatException("The color image tiles must use the same YUV format and bit depth.");
+                case DecoderStatus.InvalidParameter:
+                    throw new FormatException("A decoder parameter was not valid.");
                 default:
                     throw new FormatException("An unknown error occurred when decoding the image.");
             }
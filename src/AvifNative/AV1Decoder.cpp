@@ -13,6 +13,8 @@
 #include "AvifNative.h"
 #include "AV1Decoder.h"
 #include "DecodedImageConverter.h"
+#include "FrameBufferPool.h"
+#include "PerformanceStats.h"
 #include "ScopedAOMCodec.h"
 #include <aom/aom_decoder.h>
 #include <aom/aomdx.h>
@@ -54,14 +56,65 @@ namespace
         }
     }
 
+    // The color conversion of large images uses the same number of threads as the decoder.
+    int GetConversionThreadCount(const DecoderOptions* options)
+    {
+        return options && options->maxThreads > 1 ? options->maxThreads : 1;
+    }
+
+    // The maximum number of threads that libaom supports.
+    constexpr int32_t MaxDecoderThreads = 64;
+
+    unsigned int GetDecoderThreadCount(const DecoderOptions* options)
+    {
+        if (!options || options->maxThreads <= 1)
+        {
+            return 1;
+        }
+
+        return static_cast<unsigned int>(options->maxThreads < MaxDecoderThreads ? options->maxThreads : MaxDecoderThreads);
+    }
+
+    void InitializeDecodeStats(DecodeStats* stats, const DecoderOptions* options, size_t compressedSize)
+    {
+        if (stats)
+        {
+            *stats = {};
+            stats->compressedSize = compressedSize;
+            stats->threadCount = static_cast<int32_t>(GetDecoderThreadCount(options));
+        }
+    }
+
     class ScopedAOMDecoder : public ScopedAOMCodec
     {
     public:
-        ScopedAOMDecoder() : ScopedAOMCodec()
+        // The default libaom settings are used when options is null.
+        explicit ScopedAOMDecoder(const DecoderOptions* options) : ScopedAOMCodec()
         {
             aom_codec_iface_t* iface = aom_codec_av1_dx();
-            throw_on_error(aom_codec_dec_init(&codec, iface, nullptr, 0));
+
+            aom_codec_dec_cfg_t config = {};
+            config.threads = GetDecoderThreadCount(options);
+            // This matches the default configuration, the 8-bit images are decoded
+            // using the faster low bit depth code path.
+            config.allow_lowbitdepth = 1;
+
+            throw_on_error(aom_codec_dec_init(&codec, iface, &config, 0));
             initialized = true;
+
+            // The frame buffers are reused across decoder instances.
+            throw_on_error(aom_codec_set_frame_buffer_functions(
+                &codec,
+                FrameBufferPool::GetFrameBuffer,
+                FrameBufferPool::ReleaseFrameBuffer,
+                &FrameBufferPool::GetShared()));
+
+            if (options)
+            {
+                const unsigned int rowMultithreading = options->rowMultithreading ? 1 : 0;
+
+                throw_on_error(aom_codec_control(&codec, AV1D_SET_ROW_MT, rowMultithreading));
+            }
         }
     };
 }
@@ -69,41 +122,57 @@ namespace
 DecoderStatus DecodeColorImage(
     const uint8_t* compressedColorImage,
     size_t compressedColorImageSize,
+    const DecoderOptions* decoderOptions,
     const CICPColorData* colorInfo,
     DecodeInfo* decodeInfo,
-    BitmapData* decodedImage)
+    BitmapData* decodedImage,
+    DecodeStats* stats)
 {
     if (!compressedColorImage || !compressedColorImageSize || !decodedImage)
     {
         return DecoderStatus::NullParameter;
     }
 
+    InitializeDecodeStats(stats, decoderOptions, compressedColorImageSize);
+    ScopedStageTimer timer(stats ? &stats->totalTime : nullptr);
+
     DecoderStatus status = DecoderStatus::Ok;
 
     try
     {
-        ScopedAOMDecoder codec;
+        ScopedAOMDecoder codec(decoderOptions);
 
         // The image is owned by the decoder.
 
         aom_image_t* aomImage = nullptr;
 
-        status = DecodeAV1Image(codec.get(),
-                                compressedColorImage,
-                                compressedColorImageSize,
-                                &aomImage);
+        {
+            ScopedStageTimer decodeTimer(stats ? &stats->colorDecodeTime : nullptr);
+
+            status = DecodeAV1Image(codec.get(),
+                                    compressedColorImage,
+                                    compressedColorImageSize,
+                                    &aomImage);
+        }
 
         if (status == DecoderStatus::Ok)
         {
             // The expected width/height will be zero for the first tile in an image grid.
-            if (decodeInfo->expectedWidth != 0 && aomImage->d_w != decodeInfo->expectedWidth ||
-                decodeInfo->expectedHeight != 0 && aomImage->d_h != decodeInfo->expectedHeight)
+            if ((decodeInfo->expectedWidth != 0 && aomImage->d_w != decodeInfo->expectedWidth) ||
+                (decodeInfo->expectedHeight != 0 && aomImage->d_h != decodeInfo->expectedHeight))
             {
                 status = DecoderStatus::ColorSizeMismatch;
             }
             else
             {
-                status = ConvertColorImage(aomImage, colorInfo, decodeInfo, decodedImage);
+                if (stats)
+                {
+                    stats->frameBufferSize = GetAOMImageBufferSize(aomImage);
+                }
+
+                ScopedStageTimer conversionTimer(stats ? &stats->conversionTime : nullptr);
+
+                status = ConvertColorImage(aomImage, colorInfo, decodeInfo, decodedImage, GetConversionThreadCount(decoderOptions));
             }
         }
     }
@@ -122,40 +191,157 @@ DecoderStatus DecodeColorImage(
 DecoderStatus DecodeAlphaImage(
     const uint8_t* compressedAlphaImage,
     size_t compressedAlphaImageSize,
+    const DecoderOptions* decoderOptions,
     DecodeInfo* decodeInfo,
-    BitmapData* outputImage)
+    BitmapData* outputImage,
+    DecodeStats* stats)
 {
     if (!compressedAlphaImage || !compressedAlphaImageSize || !outputImage)
     {
         return DecoderStatus::NullParameter;
     }
 
+    InitializeDecodeStats(stats, decoderOptions, compressedAlphaImageSize);
+    ScopedStageTimer timer(stats ? &stats->totalTime : nullptr);
+
     DecoderStatus status = DecoderStatus::Ok;
 
     try
     {
-        ScopedAOMDecoder codec;
+        ScopedAOMDecoder codec(decoderOptions);
 
         // The image is owned by the decoder.
 
         aom_image_t* aomImage = nullptr;
 
-        status = DecodeAV1Image(codec.get(),
-                                compressedAlphaImage,
-                                compressedAlphaImageSize,
-                                &aomImage);
+        {
+            ScopedStageTimer decodeTimer(stats ? &stats->alphaDecodeTime : nullptr);
+
+            status = DecodeAV1Image(codec.get(),
+                                    compressedAlphaImage,
+                                    compressedAlphaImageSize,
+                                    &aomImage);
+        }
+
+        if (status == DecoderStatus::Ok)
+        {
+            // The expected width/height will be zero for the first tile in an image grid.
+            if ((decodeInfo->expectedWidth != 0 && aomImage->d_w != decodeInfo->expectedWidth) ||
+                (decodeInfo->expectedHeight != 0 && aomImage->d_h != decodeInfo->expectedHeight))
+            {
+                status = DecoderStatus::AlphaSizeMismatch;
+            }
+            else
+            {
+                if (stats)
+                {
+                    stats->frameBufferSize = GetAOMImageBufferSize(aomImage);
+                }
+
+                ScopedStageTimer conversionTimer(stats ? &stats->conversionTime : nullptr);
+
+                status = ConvertAlphaImage(aomImage, decodeInfo, outputImage, GetConversionThreadCount(decoderOptions));
+            }
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        status = DecoderStatus::OutOfMemory;
+    }
+    catch (const codec_error&)
+    {
+        status = DecoderStatus::CodecInitFailed;
+    }
+
+    return status;
+}
+
+DecoderStatus DecodeColorAndAlphaImage(
+    const uint8_t* compressedColorImage,
+    size_t compressedColorImageSize,
+    const uint8_t* compressedAlphaImage,
+    size_t compressedAlphaImageSize,
+    const DecoderOptions* decoderOptions,
+    const CICPColorData* colorInfo,
+    DecodeInfo* colorDecodeInfo,
+    DecodeInfo* alphaDecodeInfo,
+    BitmapData* outputImage,
+    DecodeStats* stats)
+{
+    if (!compressedColorImage || !compressedColorImageSize ||
+        !compressedAlphaImage || !compressedAlphaImageSize ||
+        !outputImage)
+    {
+        return DecoderStatus::NullParameter;
+    }
+
+    InitializeDecodeStats(stats, decoderOptions, compressedColorImageSize + compressedAlphaImageSize);
+    ScopedStageTimer timer(stats ? &stats->totalTime : nullptr);
+
+    DecoderStatus status = DecoderStatus::Ok;
+
+    try
+    {
+        // Each image is owned by its decoder, so both decoders must be kept
+        // alive until the images have been converted.
+        ScopedAOMDecoder colorCodec(decoderOptions);
+        ScopedAOMDecoder alphaCodec(decoderOptions);
+
+        aom_image_t* colorImage = nullptr;
+        aom_image_t* alphaImage = nullptr;
+
+        {
+            ScopedStageTimer decodeTimer(stats ? &stats->colorDecodeTime : nullptr);
+
+            status = DecodeAV1Image(colorCodec.get(),
+                                    compressedColorImage,
+                                    compressedColorImageSize,
+                                    &colorImage);
+        }
 
         if (status == DecoderStatus::Ok)
         {
             // The expected width/height will be zero for the first tile in an image grid.
-            if (decodeInfo->expectedWidth != 0 && aomImage->d_w != decodeInfo->expectedWidth ||
-                decodeInfo->expectedHeight != 0 && aomImage->d_h != decodeInfo->expectedHeight)
+            if ((colorDecodeInfo->expectedWidth != 0 && colorImage->d_w != colorDecodeInfo->expectedWidth) ||
+                (colorDecodeInfo->expectedHeight != 0 && colorImage->d_h != colorDecodeInfo->expectedHeight))
+            {
+                status = DecoderStatus::ColorSizeMismatch;
+            }
+        }
+
+        if (status == DecoderStatus::Ok)
+        {
+            ScopedStageTimer decodeTimer(stats ? &stats->alphaDecodeTime : nullptr);
+
+            status = DecodeAV1Image(alphaCodec.get(),
+                                    compressedAlphaImage,
+                                    compressedAlphaImageSize,
+                                    &alphaImage);
+        }
+
+        if (status == DecoderStatus::Ok)
+        {
+            if ((alphaDecodeInfo->expectedWidth != 0 && alphaImage->d_w != alphaDecodeInfo->expectedWidth) ||
+                (alphaDecodeInfo->expectedHeight != 0 && alphaImage->d_h != alphaDecodeInfo->expectedHeight))
             {
                 status = DecoderStatus::AlphaSizeMismatch;
             }
             else
             {
-                status = ConvertAlphaImage(aomImage, decodeInfo, outputImage);
+                if (stats)
+                {
+                    stats->frameBufferSize = GetAOMImageBufferSize(colorImage) + GetAOMImageBufferSize(alphaImage);
+                }
+
+                ScopedStageTimer conversionTimer(stats ? &stats->conversionTime : nullptr);
+
+                status = ConvertColorAndAlphaImage(colorImage,
+                                                   alphaImage,
+                                                   colorInfo,
+                                                   colorDecodeInfo,
+                                                   alphaDecodeInfo,
+                                                   outputImage,
+                                                   GetConversionThreadCount(decoderOptions));
             }
         }
     }
@@ -17,12 +17,28 @@
 DecoderStatus DecodeColorImage(
     const uint8_t* compressedColorImage,
     size_t compressedColorImageSize,
+    const DecoderOptions* decoderOptions,
     const CICPColorData* colorInfo,
     DecodeInfo* decodeInfo,
-    BitmapData* outputImage);
+    BitmapData* outputImage,
+    DecodeStats* stats);
 
 DecoderStatus DecodeAlphaImage(
     const uint8_t* compressedAlphaImage,
     size_t compressedAlphaImageSize,
+    const DecoderOptions* decoderOptions,
     DecodeInfo* decodeInfo,
-    BitmapData* outputImage);
+    BitmapData* outputImage,
+    DecodeStats* stats);
+
+DecoderStatus DecodeColorAndAlphaImage(
+    const uint8_t* compressedColorImage,
+    size_t compressedColorImageSize,
+    const uint8_t* compressedAlphaImage,
+    size_t compressedAlphaImageSize,
+    const DecoderOptions* decoderOptions,
+    const CICPColorData* colorInfo,
+    DecodeInfo* colorDecodeInfo,
+    DecodeInfo* alphaDecodeInfo,
+    BitmapData* outputImage,
+    DecodeStats* stats);
@@ -13,21 +13,86 @@
 #pragma once
 
 #include "AvifNative.h"
+#include "EncoderCallbacks.h"
 #include "aom/aom_image.h"
+#include <memory>
+#include <mutex>
+#include <vector>
 
-#ifdef __cplusplus
-extern "C" {
-#endif // __cplusplus
+// Keeps the initialized AV1 encoder contexts for a set of encoder options, the contexts are
+// reused for every image that has the same frame size, format and thread count.
+class EncoderSession
+{
+public:
+    explicit EncoderSession(const EncoderOptions& options);
+    ~EncoderSession();
+
+    EncoderSession(const EncoderSession&) = delete;
+    EncoderSession& operator=(const EncoderSession&) = delete;
+
+    const EncoderOptions& GetOptions() const noexcept
+    {
+        return options;
+    }
+
+    // Encodes the image using an idle encoder context, or a new one if there are no
+    // compatible encoders available.
+    // The stats parameter is optional.
+    // This method is thread-safe.
+    EncoderStatus EncodeImage(
+        const aom_image* frame,
+        int threadCount,
+        EncoderCallbacks& callbacks,
+        void** output,
+        EncodeImageStats* stats);
+
+    // Destroys the idle encoder contexts that have a different frame size, they cannot be
+    // reused by the image that is being encoded.
+    // This method is thread-safe.
+    void DiscardIdleEncoders(uint32_t frameWidth, uint32_t frameHeight);
+
+    // Destroys the least recently used idle encoder contexts until the memory that the remaining
+    // contexts are estimated to retain is at most maxIdleSize bytes.
+    // This method is thread-safe.
+    void TrimIdleEncoders(uint64_t maxIdleSize);
+
+    // The memory that the idle encoder contexts may retain between saves.
+    static constexpr uint64_t MaxIdleEncoderSizeBetweenSaves = 128 * 1024 * 1024;
+
+private:
+    class PooledEncoder;
+
+    // Limits the memory that is retained by encoder contexts that are waiting to be reused.
+    static constexpr uint64_t MaxIdleEncoderSize = 256 * 1024 * 1024;
+
+    EncoderStatus AcquireEncoder(const aom_image* frame, int threadCount, std::unique_ptr<PooledEncoder>& encoder);
+    void ReleaseEncoder(std::unique_ptr<PooledEncoder> encoder);
+    // The caller must hold the mutex.
+    void TrimIdleEncodersLocked(uint64_t maxIdleSize);
+    static EncoderStatus EncodeFrame(
+        PooledEncoder& encoder,
+        const aom_image* frame,
+        EncoderCallbacks& callbacks,
+        void** output,
+        EncodeImageStats* stats);
+
+    const EncoderOptions options;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<PooledEncoder>> idleEncoders;
+    uint64_t idleEncoderSize;
+    uint64_t useCount;
+};
+
+// Maps a quality value in the 0 to 100 range to the libaom quantizer range, where 0 is lossless
+// and 63 is the lowest quality.
+int ConvertQualityToQuantizer(int32_t quality);
 
 EncoderStatus CompressAOMImages(
+    EncoderSession& session,
     const aom_image* color,
     const aom_image* alpha,
-    const EncoderOptions* encodeOptions,
-    ProgressContext* progressContext,
-    CompressedAV1OutputAlloc outputAllocator,
+    int threadCount,
+    EncoderCallbacks& callbacks,
     void** compressedColorImage,
-    void** compressedAlphaImage);
-
-#ifdef __cplusplus
-}
-#endif // __cplusplus
+    void** compressedAlphaImage,
+    EncodeStats* stats);
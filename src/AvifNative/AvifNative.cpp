@@ -11,44 +11,36 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "AvifNative.h"
-#include "Memory.h"
+#include <string.h>
 #include "ChromaSubsampling.h"
 #include "AV1Decoder.h"
 #include "AV1Encoder.h"
+#include "EncoderCallbacks.h"
+#include "GridLayoutModel.h"
+#include "ImageAnalysis.h"
+#include "PerformanceStats.h"
+#include "ScopedAOMImage.h"
+#include "TargetSizeSearch.h"
+#include "ThreadPool.h"
 #include "aom/aom_image.h"
+#include <algorithm>
 #include <memory>
-
-namespace AvifNative
-{
-    namespace details
-    {
-        struct aom_image_deleter
-        {
-            void operator()(aom_image* img) noexcept
-            {
-                if (img)
-                {
-                    aom_img_free(img);
-                }
-            }
-        };
-    }
-
-    typedef std::unique_ptr<aom_image, details::aom_image_deleter> ScopedAOMImage;
-}
+#include <mutex>
+#include <vector>
 
 namespace
 {
     EncoderStatus CompressWithAOM(
+        EncoderSession& session,
         const BitmapData* image,
-        const EncoderOptions* encodeOptions,
-        ProgressContext* progressContext,
+        int threadCount,
+        EncoderCallbacks& callbacks,
         const CICPColorData& colorInfo,
-        CompressedAV1OutputAlloc outputAllocator,
         void** compressedColorImage,
-        void** compressedAlphaImage)
+        void** compressedAlphaImage,
+        EncodeStats* stats)
     {
-        const YUVChromaSubsampling yuvFormat = encodeOptions->yuvFormat;
+        const YUVChromaSubsampling yuvFormat = session.GetOptions().yuvFormat;
 
         aom_img_fmt aomFormat;
         switch (yuvFormat)
@@ -68,7 +60,12 @@ namespace
             return EncoderStatus::UnknownYUVFormat;
         }
 
-        AvifNative::ScopedAOMImage color(ConvertColorToAOMImage(image, colorInfo, yuvFormat, aomFormat));
+        AvifNative::ScopedAOMImage color;
+        {
+            ScopedStageTimer timer(stats ? &stats->color.conversionTime : nullptr);
+
+            color.reset(ConvertColorToAOMImage(image, colorInfo, yuvFormat, aomFormat));
+        }
         if (!color)
         {
             return EncoderStatus::OutOfMemory;
@@ -77,6 +74,8 @@ namespace
         AvifNative::ScopedAOMImage alpha;
         if (compressedAlphaImage)
         {
+            ScopedStageTimer timer(stats ? &stats->alpha.conversionTime : nullptr);
+
             alpha.reset(ConvertAlphaToAOMImage(image));
             if (!alpha)
             {
@@ -84,70 +83,574 @@ namespace
             }
         }
 
+        if (stats)
+        {
+            // The color and alpha images are kept until both of them have been encoded.
+            stats->frameBufferSize = GetAOMImageBufferSize(color.get()) + GetAOMImageBufferSize(alpha.get());
+        }
+
         return CompressAOMImages(
+            session,
             color.get(),
             alpha.get(),
-            encodeOptions,
-            progressContext,
-            outputAllocator,
+            threadCount,
+            callbacks,
             compressedColorImage,
-            compressedAlphaImage);
+            compressedAlphaImage,
+            stats);
+    }
+
+    bool IsValidGridLayout(const BitmapData* image, const ImageGridLayout* gridLayout)
+    {
+        if (gridLayout->tileColumnCount == 0 || gridLayout->tileRowCount == 0 ||
+            gridLayout->tileWidth == 0 || gridLayout->tileHeight == 0)
+        {
+            return false;
+        }
+
+        const uint64_t gridWidth = static_cast<uint64_t>(gridLayout->tileColumnCount) * gridLayout->tileWidth;
+        const uint64_t gridHeight = static_cast<uint64_t>(gridLayout->tileRowCount) * gridLayout->tileHeight;
+
+        // The grid must cover the image, and the tiles in the last column and row must start inside it.
+        return gridWidth >= image->width && gridHeight >= image->height &&
+               (gridWidth - gridLayout->tileWidth) < image->width &&
+               (gridHeight - gridLayout->tileHeight) < image->height;
+    }
+
+    // Copies a tile that extends past the right or bottom edge of the image, the pixels outside the image
+    // repeat the last column and row of the image.
+    // The image grid output size crops the padding when the image is decoded.
+    std::vector<ColorBgra> CreatePaddedTile(
+        const BitmapData* image,
+        uint32_t left,
+        uint32_t top,
+        uint32_t tileWidth,
+        uint32_t tileHeight,
+        BitmapData& tile)
+    {
+        const uint32_t copyWidth = std::min(tileWidth, image->width - left);
+        const uint32_t copyHeight = std::min(tileHeight, image->height - top);
+
+        std::vector<ColorBgra> pixels(static_cast<size_t>(tileWidth) * tileHeight);
+
+        for (uint32_t y = 0; y < tileHeight; y++)
+        {
+            const ColorBgra* src = reinterpret_cast<const ColorBgra*>(
+                image->scan0 + (static_cast<size_t>(top + std::min(y, copyHeight - 1)) * image->stride)) + left;
+            ColorBgra* dst = pixels.data() + (static_cast<size_t>(y) * tileWidth);
+
+            memcpy(dst, src, static_cast<size_t>(copyWidth) * sizeof(ColorBgra));
+            std::fill(dst + copyWidth, dst + tileWidth, src[copyWidth - 1]);
+        }
+
+        tile.scan0 = reinterpret_cast<uint8_t*>(pixels.data());
+        tile.width = tileWidth;
+        tile.height = tileHeight;
+        tile.stride = tileWidth * static_cast<uint32_t>(sizeof(ColorBgra));
+
+        return pixels;
+    }
+
+    // Each duplicate must refer to an earlier tile that is not itself a duplicate.
+    bool IsValidDuplicateTileIndexes(const uint32_t* duplicateTileIndexes, size_t tileCount)
+    {
+        for (size_t i = 0; i < tileCount; i++)
+        {
+            const uint32_t sourceTile = duplicateTileIndexes[i];
+
+            if (sourceTile > i || duplicateTileIndexes[sourceTile] != sourceTile)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // The alpha images can only be shared with a tile that is encoded.
+    bool IsValidDuplicateAlphaTileIndexes(
+        const uint32_t* duplicateAlphaTileIndexes,
+        const uint32_t* duplicateTileIndexes,
+        size_t tileCount)
+    {
+        if (!IsValidDuplicateTileIndexes(duplicateAlphaTileIndexes, tileCount))
+        {
+            return false;
+        }
+
+        if (duplicateTileIndexes)
+        {
+            for (size_t i = 0; i < tileCount; i++)
+            {
+                const uint32_t sourceTile = duplicateAlphaTileIndexes[i];
+
+                if (duplicateTileIndexes[sourceTile] != sourceTile)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
     }
 }
 
-DecoderStatus __stdcall DecompressColorImage(
+DecoderStatus AVIF_NATIVE_CALL DecompressColorImage(
     const uint8_t* compressedColorImage,
     size_t compressedColorImageSize,
+    const DecoderOptions* decoderOptions,
     const CICPColorData* colorInfo,
     DecodeInfo* decodeInfo,
-    BitmapData* outputImage)
+    BitmapData* outputImage,
+    DecodeStats* stats)
 {
     return DecodeColorImage(
         compressedColorImage,
         compressedColorImageSize,
+        decoderOptions,
         colorInfo,
         decodeInfo,
-        outputImage);
+        outputImage,
+        stats);
 }
 
-DecoderStatus __stdcall DecompressAlphaImage(
+DecoderStatus AVIF_NATIVE_CALL DecompressAlphaImage(
     const uint8_t* compressedAlphaImage,
     size_t compressedAlphaImageSize,
+    const DecoderOptions* decoderOptions,
     DecodeInfo* decodeInfo,
-    BitmapData* outputImage)
+    BitmapData* outputImage,
+    DecodeStats* stats)
 {
     return DecodeAlphaImage(
         compressedAlphaImage,
         compressedAlphaImageSize,
+        decoderOptions,
         decodeInfo,
-        outputImage);
+        outputImage,
+        stats);
+}
+
+DecoderStatus AVIF_NATIVE_CALL DecompressImage(
+    const uint8_t* compressedColorImage,
+    size_t compressedColorImageSize,
+    const uint8_t* compressedAlphaImage,
+    size_t compressedAlphaImageSize,
+    const DecoderOptions* decoderOptions,
+    const CICPColorData* colorInfo,
+    DecodeInfo* colorDecodeInfo,
+    DecodeInfo* alphaDecodeInfo,
+    BitmapData* outputImage,
+    DecodeStats* stats)
+{
+    return DecodeColorAndAlphaImage(
+        compressedColorImage,
+        compressedColorImageSize,
+        compressedAlphaImage,
+        compressedAlphaImageSize,
+        decoderOptions,
+        colorInfo,
+        colorDecodeInfo,
+        alphaDecodeInfo,
+        outputImage,
+        stats);
 }
 
-EncoderStatus __stdcall CompressImage(
+EncoderStatus AVIF_NATIVE_CALL AnalyzeImage(
     const BitmapData* image,
+    const ImageGridLayout* gridLayout,
+    int32_t maxThreads,
+    TileAnalysis* tiles)
+{
+    if (!image || !tiles)
+    {
+        return EncoderStatus::NullParameter;
+    }
+
+    if (image->width == 0 || image->height == 0 || (gridLayout && !IsValidGridLayout(image, gridLayout)))
+    {
+        return EncoderStatus::InvalidParameter;
+    }
+
+    try
+    {
+        AnalyzeImageTiles(image, gridLayout, maxThreads, tiles);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return EncoderStatus::OutOfMemory;
+    }
+    catch (const std::exception&)
+    {
+        return EncoderStatus::EncodeFailed;
+    }
+
+    return EncoderStatus::Ok;
+}
+
+EncoderStatus AVIF_NATIVE_CALL CreateEncoderSession(
     const EncoderOptions* encodeOptions,
+    EncoderSession** session)
+{
+    if (!encodeOptions || !session)
+    {
+        return EncoderStatus::NullParameter;
+    }
+
+    *session = nullptr;
+
+    try
+    {
+        *session = new EncoderSession(*encodeOptions);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return EncoderStatus::OutOfMemory;
+    }
+
+    return EncoderStatus::Ok;
+}
+
+void AVIF_NATIVE_CALL DestroyEncoderSession(EncoderSession* session)
+{
+    delete session;
+}
+
+void AVIF_NATIVE_CALL TrimEncoderSession(EncoderSession* session)
+{
+    if (session)
+    {
+        session->TrimIdleEncoders(EncoderSession::MaxIdleEncoderSizeBetweenSaves);
+    }
+}
+
+EncoderStatus AVIF_NATIVE_CALL CompressImage(
+    EncoderSession* session,
+    const BitmapData* image,
     ProgressContext* progressContext,
     const CICPColorData& colorInfo,
     CompressedAV1OutputAlloc outputAllocator,
     void** compressedColorImage,
-    void** compressedAlphaImage)
+    void** compressedAlphaImage,
+    EncodeStats* stats)
 {
-    if (!image || !encodeOptions || !progressContext || !outputAllocator || !compressedColorImage)
+    if (!session || !image || !progressContext || !outputAllocator || !compressedColorImage)
     {
         return EncoderStatus::NullParameter;
     }
 
-    if (!progressContext->progressCallback(++progressContext->progressDone, progressContext->progressTotal))
+    if (stats)
     {
-        return EncoderStatus::UserCancelled;
+        *stats = {};
     }
 
+    ScopedStageTimer timer(stats ? &stats->totalTime : nullptr);
+
+    EncoderCallbacks callbacks(progressContext, outputAllocator);
+
+    {
+        ScopedStageTimer callbackTimer(stats ? &stats->callbackTime : nullptr);
+
+        if (!callbacks.ReportProgress())
+        {
+            return EncoderStatus::UserCancelled;
+        }
+    }
+
+    session->DiscardIdleEncoders(image->width, image->height);
+
     return CompressWithAOM(
+        *session,
         image,
-        encodeOptions,
-        progressContext,
+        session->GetOptions().maxThreads,
+        callbacks,
         colorInfo,
-        outputAllocator,
         compressedColorImage,
-        compressedAlphaImage);
+        compressedAlphaImage,
+        stats);
+}
+
+EncoderStatus AVIF_NATIVE_CALL CompressImageGrid(
+    EncoderSession* session,
+    const BitmapData* image,
+    const ImageGridLayout* gridLayout,
+    const uint32_t* duplicateTileIndexes,
+    const uint32_t* duplicateAlphaTileIndexes,
+    ProgressContext* progressContext,
+    const CICPColorData& colorInfo,
+    CompressedAV1OutputAlloc outputAllocator,
+    void** compressedColorImages,
+    void** compressedAlphaImages,
+    CompressedTileReady tileReady,
+    EncodeStats* tileStats)
+{
+    if (!session || !image || !gridLayout || !progressContext || !outputAllocator || !compressedColorImages)
+    {
+        return EncoderStatus::NullParameter;
+    }
+
+    if (!IsValidGridLayout(image, gridLayout))
+    {
+        return EncoderStatus::InvalidParameter;
+    }
+
+    const size_t tileCount = static_cast<size_t>(gridLayout->tileColumnCount) * gridLayout->tileRowCount;
+
+    if (duplicateTileIndexes && !IsValidDuplicateTileIndexes(duplicateTileIndexes, tileCount))
+    {
+        return EncoderStatus::InvalidParameter;
+    }
+
+    if (duplicateAlphaTileIndexes &&
+        !IsValidDuplicateAlphaTileIndexes(duplicateAlphaTileIndexes, duplicateTileIndexes, tileCount))
+    {
+        return EncoderStatus::InvalidParameter;
+    }
+
+    for (size_t i = 0; i < tileCount; i++)
+    {
+        compressedColorImages[i] = nullptr;
+
+        if (compressedAlphaImages)
+        {
+            compressedAlphaImages[i] = nullptr;
+        }
+
+        if (tileStats)
+        {
+            tileStats[i] = {};
+        }
+    }
+
+    session->DiscardIdleEncoders(gridLayout->tileWidth, gridLayout->tileHeight);
+
+    EncoderStatus status = EncoderStatus::Ok;
+
+    try
+    {
+        // The duplicate tiles reuse the compressed data of the tile that they are identical to.
+        std::vector<uint32_t> encodedTiles;
+        encodedTiles.reserve(tileCount);
+
+        for (size_t i = 0; i < tileCount; i++)
+        {
+            if (!duplicateTileIndexes || duplicateTileIndexes[i] == i)
+            {
+                encodedTiles.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        ThreadPool& threadPool = ThreadPool::GetShared();
+
+        const GridThreadBudget budget = GetGridThreadBudget(
+            session->GetOptions().maxThreads,
+            session->GetOptions().compressionSpeed,
+            gridLayout,
+            encodedTiles.size(),
+            threadPool.GetConcurrencyLevel());
+
+        EncoderCallbacks callbacks(progressContext, outputAllocator, tileReady);
+        std::mutex statusMutex;
+
+        threadPool.ParallelFor(encodedTiles.size(), budget.tileConcurrency, [&](size_t encodedTileIndex)
+        {
+            const size_t index = encodedTiles[encodedTileIndex];
+
+            {
+                std::lock_guard<std::mutex> lock(statusMutex);
+
+                if (status != EncoderStatus::Ok)
+                {
+                    return;
+                }
+            }
+
+            EncodeStats* stats = tileStats ? &tileStats[index] : nullptr;
+            ScopedStageTimer timer(stats ? &stats->totalTime : nullptr);
+
+            void** compressedAlphaImage = nullptr;
+
+            if (compressedAlphaImages && (!duplicateAlphaTileIndexes || duplicateAlphaTileIndexes[index] == index))
+            {
+                compressedAlphaImage = &compressedAlphaImages[index];
+            }
+
+            const uint32_t row = static_cast<uint32_t>(index / gridLayout->tileColumnCount);
+            const uint32_t column = static_cast<uint32_t>(index % gridLayout->tileColumnCount);
+            const uint32_t left = column * gridLayout->tileWidth;
+            const uint32_t top = row * gridLayout->tileHeight;
+
+            BitmapData tile;
+            std::vector<ColorBgra> paddedTile;
+
+            if ((image->width - left) < gridLayout->tileWidth || (image->height - top) < gridLayout->tileHeight)
+            {
+                paddedTile = CreatePaddedTile(image, left, top, gridLayout->tileWidth, gridLayout->tileHeight, tile);
+            }
+            else
+            {
+                tile.scan0 = image->scan0 + (static_cast<size_t>(top) * image->stride) +
+                                            (static_cast<size_t>(left) * sizeof(ColorBgra));
+                tile.width = gridLayout->tileWidth;
+                tile.height = gridLayout->tileHeight;
+                tile.stride = image->stride;
+            }
+
+            EncoderStatus tileStatus;
+            bool cancelled;
+
+            {
+                ScopedStageTimer callbackTimer(stats ? &stats->callbackTime : nullptr);
+
+                cancelled = !callbacks.ReportProgress();
+            }
+
+            if (!cancelled)
+            {
+                tileStatus = CompressWithAOM(
+                    *session,
+                    &tile,
+                    budget.threadsPerTile,
+                    callbacks,
+                    colorInfo,
+                    &compressedColorImages[index],
+                    compressedAlphaImage,
+                    stats);
+            }
+            else
+            {
+                tileStatus = EncoderStatus::UserCancelled;
+            }
+
+            if (tileStatus == EncoderStatus::Ok)
+            {
+                ScopedStageTimer callbackTimer(stats ? &stats->callbackTime : nullptr);
+
+                if (!callbacks.ReportTileCompleted(
+                    static_cast<uint32_t>(index),
+                    compressedColorImages[index],
+                    compressedAlphaImage ? *compressedAlphaImage : nullptr))
+                {
+                    tileStatus = EncoderStatus::EncodeFailed;
+                }
+            }
+
+            if (tileStatus != EncoderStatus::Ok)
+            {
+                std::lock_guard<std::mutex> lock(statusMutex);
+
+                if (status == EncoderStatus::Ok)
+                {
+                    status = tileStatus;
+                }
+            }
+        });
+    }
+    catch (const std::bad_alloc&)
+    {
+        status = EncoderStatus::OutOfMemory;
+    }
+    catch (const std::exception&)
+    {
+        status = EncoderStatus::EncodeFailed;
+    }
+
+    return status;
+}
+
+EncoderStatus AVIF_NATIVE_CALL FindTargetSizeQuality(
+    const BitmapData* image,
+    const ImageGridLayout* gridLayout,
+    const uint32_t* duplicateTileIndexes,
+    const uint32_t* duplicateAlphaTileIndexes,
+    const EncoderOptions* encodeOptions,
+    const CICPColorData& colorInfo,
+    bool encodeAlpha,
+    uint64_t targetSize,
+    ProgressContext* progressContext,
+    TargetSizeResult* result)
+{
+    if (!image || !encodeOptions || !progressContext || !result)
+    {
+        return EncoderStatus::NullParameter;
+    }
+
+    if (image->width == 0 || image->height == 0 || targetSize == 0 || (gridLayout && !IsValidGridLayout(image, gridLayout)))
+    {
+        return EncoderStatus::InvalidParameter;
+    }
+
+    if (gridLayout)
+    {
+        const size_t tileCount = static_cast<size_t>(gridLayout->tileColumnCount) * gridLayout->tileRowCount;
+
+        if (duplicateTileIndexes && !IsValidDuplicateTileIndexes(duplicateTileIndexes, tileCount))
+        {
+            return EncoderStatus::InvalidParameter;
+        }
+
+        if (duplicateAlphaTileIndexes &&
+            !IsValidDuplicateAlphaTileIndexes(duplicateAlphaTileIndexes, duplicateTileIndexes, tileCount))
+        {
+            return EncoderStatus::InvalidParameter;
+        }
+    }
+
+    try
+    {
+        return SearchTargetSizeQuality(
+            image,
+            gridLayout,
+            duplicateTileIndexes,
+            duplicateAlphaTileIndexes,
+            *encodeOptions,
+            colorInfo,
+            encodeAlpha,
+            targetSize,
+            progressContext,
+            result);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return EncoderStatus::OutOfMemory;
+    }
+    catch (const std::exception&)
+    {
+        return EncoderStatus::EncodeFailed;
+    }
+}
+
+EncoderStatus AVIF_NATIVE_CALL SelectImageGridLayout(
+    uint32_t width,
+    uint32_t height,
+    CompressionSpeed compressionSpeed,
+    int32_t maxThreads,
+    ImageGridLayout* gridLayout)
+{
+    if (!gridLayout)
+    {
+        return EncoderStatus::NullParameter;
+    }
+
+    if (width == 0 || height == 0 ||
+        compressionSpeed < CompressionSpeed::Fast || compressionSpeed > CompressionSpeed::VerySlow)
+    {
+        return EncoderStatus::InvalidParameter;
+    }
+
+    try
+    {
+        *gridLayout = SelectGridLayout(
+            width,
+            height,
+            compressionSpeed,
+            maxThreads,
+            ThreadPool::GetShared().GetConcurrencyLevel());
+    }
+    catch (const std::bad_alloc&)
+    {
+        return EncoderStatus::OutOfMemory;
+    }
+
+    return EncoderStatus::Ok;
 }
@@ -12,10 +12,19 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include "TargetVer.h"
 #include "CICPEnums.h"
 
+#ifdef _WIN32
+#define AVIF_NATIVE_API __declspec(dllexport)
+#define AVIF_NATIVE_CALL __stdcall
+#else
+#define AVIF_NATIVE_API __attribute__((visibility("default")))
+#define AVIF_NATIVE_CALL
+#endif // _WIN32
+
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
@@ -39,6 +48,23 @@ extern "C" {
         IdentityMatrix
     };
 
+    // This must be kept in sync with OutputRotation.cs
+    enum class OutputRotation
+    {
+        None,
+        Rotate90CCW,
+        Rotate180,
+        Rotate270CCW
+    };
+
+    // This must be kept in sync with OutputMirror.cs
+    enum class OutputMirror
+    {
+        None,
+        Vertical,
+        Horizontal
+    };
+
     enum class EncoderStatus
     {
         Ok,
@@ -47,7 +73,8 @@ extern "C" {
         UnknownYUVFormat,
         CodecInitFailed,
         EncodeFailed,
-        UserCancelled
+        UserCancelled,
+        InvalidParameter
     };
 
     enum class DecoderStatus
@@ -62,7 +89,8 @@ extern "C" {
         TileNclxProfileMismatch,
         UnsupportedBitDepth,
         UnknownYUVFormat,
-        TileFormatMismatch
+        TileFormatMismatch,
+        InvalidParameter
     };
 
     // This must be kept in sync with EncoderOptions.cs
@@ -74,6 +102,23 @@ extern "C" {
         int32_t maxThreads;
     };
 
+    // This must be kept in sync with DecoderOptions.cs
+    struct DecoderOptions
+    {
+        int32_t maxThreads;
+        bool rowMultithreading;
+    };
+
+    // This must be kept in sync with ImageGridLayout.cs
+    // The grid covers the image, the tiles in the last column and row can extend past the right and bottom edges.
+    struct ImageGridLayout
+    {
+        uint32_t tileColumnCount;
+        uint32_t tileRowCount;
+        uint32_t tileWidth;
+        uint32_t tileHeight;
+    };
+
     struct CICPColorData
     {
         CICPColorPrimaries colorPrimaries;
@@ -82,12 +127,25 @@ extern "C" {
         bool fullRange;
     };
 
+    // This must be kept in sync with DecodeInfo.cs
     struct DecodeInfo
     {
         uint32_t expectedWidth;
         uint32_t expectedHeight;
         uint32_t tileColumnIndex;
         uint32_t tileRowIndex;
+        // The decoded image is downsampled by (1 << downsampleShift) before it is converted to BGRA,
+        // zero decodes the image at full size.
+        uint32_t downsampleShift;
+        // The position of the output image within the full image, this allows a region of the image to be decoded.
+        uint32_t outputX;
+        uint32_t outputY;
+        // The rotation and mirror transforms are applied as the pixels are written to the output image,
+        // the rotation is applied first. The output image dimensions are the transformed dimensions.
+        OutputRotation outputRotation;
+        OutputMirror outputMirror;
+        // The chromaSubsampling, bitDepth and firstTileColorData fields are set by the first image or tile
+        // that is decoded, bitDepth must be zero when the first tile is decoded.
         YUVChromaSubsampling chromaSubsampling;
         uint32_t bitDepth;
         CICPColorData firstTileColorData;
@@ -109,7 +167,93 @@ extern "C" {
         uint8_t a;
     };
 
-    typedef bool(__stdcall* ProgressProc)(uint32_t done, uint32_t total);
+    // This must be kept in sync with TileAnalysis.cs
+    struct TileAnalysis
+    {
+        bool grayscale;
+        // All of the alpha values are 255.
+        bool opaque;
+        // All of the pixels have the same value, which is stored in color.
+        bool solidColor;
+        ColorBgra color;
+        // The index of the first tile that has identical pixels, this is the index of the tile itself
+        // if there is no earlier tile with the same pixels.
+        uint32_t duplicateTileIndex;
+    };
+
+    // This must be kept in sync with EncodeImageStats.cs
+    // The times are in nanoseconds.
+    struct EncodeImageStats
+    {
+        // The BGRA to YUV conversion.
+        uint64_t conversionTime;
+        // The aom_codec_encode call that encodes the frame.
+        uint64_t encodeTime;
+        // Retrieving the compressed frame from libaom, including any encoder flush.
+        uint64_t flushTime;
+        // Copying the compressed frame to the output buffer.
+        uint64_t outputCopyTime;
+        // The progress and output allocation callbacks, including the time spent waiting for other threads.
+        uint64_t callbackTime;
+        uint64_t compressedSize;
+        // The size of the YUV frame that was passed to libaom.
+        uint64_t frameBufferSize;
+        // The base quantizer of the frame in the 0 to 63 range.
+        int32_t quantizer;
+        int32_t threadCount;
+    };
+
+    // This must be kept in sync with EncodeStats.cs
+    // The alpha stats are zero if the image does not have transparency.
+    struct EncodeStats
+    {
+        EncodeImageStats color;
+        EncodeImageStats alpha;
+        // The callbacks that are made before and after the color and alpha images are encoded.
+        uint64_t callbackTime;
+        uint64_t totalTime;
+        // The combined size of the color and alpha YUV frames that are passed to libaom, both frames
+        // are held until the image has been encoded.
+        // This does not include the memory that libaom allocates internally or the output buffers.
+        uint64_t frameBufferSize;
+    };
+
+    // This must be kept in sync with DecodeStats.cs
+    // The times are in nanoseconds.
+    struct DecodeStats
+    {
+        // The aom_codec_decode and aom_codec_get_frame calls for each image.
+        uint64_t colorDecodeTime;
+        uint64_t alphaDecodeTime;
+        // The YUV to BGRA conversion, which includes the rotation and mirror transforms.
+        uint64_t conversionTime;
+        uint64_t totalTime;
+        uint64_t compressedSize;
+        // The size of the decoded YUV frames that are converted to BGRA, this includes the alpha frame
+        // when the color and alpha images are decoded together.
+        // This does not include the memory that libaom allocates internally.
+        uint64_t frameBufferSize;
+        int32_t threadCount;
+    };
+
+    // This must be kept in sync with TargetSizeResult.cs
+    struct TargetSizeResult
+    {
+        // The highest quality that compresses the image to the target size.
+        int32_t quality;
+        // The base quantizer that the quality maps to, in the 0 to 63 range.
+        int32_t quantizer;
+        // The compressed size of the color and alpha images at the chosen quality.
+        // This is zero if no full size encode was made at the chosen quality.
+        uint64_t compressedSize;
+        // The encodes of the downsampled proxy image, and of the full image.
+        uint32_t probeEncodeCount;
+        uint32_t refineEncodeCount;
+        // False if the image is larger than the target size at the lowest quality.
+        bool targetSizeMet;
+    };
+
+    typedef bool(AVIF_NATIVE_CALL* ProgressProc)(uint32_t done, uint32_t total);
 
     struct ProgressContext
     {
@@ -118,29 +262,141 @@ extern "C" {
         uint32_t progressTotal;
     };
 
-    typedef void*(__stdcall* CompressedAV1OutputAlloc)(size_t sizeInBytes);
+    typedef void*(AVIF_NATIVE_CALL* CompressedAV1OutputAlloc)(size_t sizeInBytes);
+
+    // Called when an image grid tile has finished encoding, compressedAlphaImage is null if the image does not have transparency
+    // or if the tile shares the alpha image of an earlier tile.
+    // The callee takes ownership of the compressed data.
+    // Returns false if the tile could not be processed.
+    typedef bool(AVIF_NATIVE_CALL* CompressedTileReady)(uint32_t tileIndex, void* compressedColorImage, void* compressedAlphaImage);
+
+    // An opaque handle that keeps the initialized AV1 encoders for a set of encoder options.
+    // The encoders are reused for successive images with the same frame size and format.
+    class EncoderSession;
 
-    __declspec(dllexport) DecoderStatus __stdcall DecompressColorImage(
+    // The stats parameter of the decode functions is optional, it can be null if the caller does not need them.
+    AVIF_NATIVE_API DecoderStatus AVIF_NATIVE_CALL DecompressColorImage(
         const uint8_t* compressedColorImage,
         size_t compressedColorImageSize,
+        const DecoderOptions* decoderOptions,
         const CICPColorData* colorInfo,
         DecodeInfo* decodeInfo,
-        BitmapData* outputImage);
+        BitmapData* outputImage,
+        DecodeStats* stats);
 
-    __declspec(dllexport) DecoderStatus __stdcall DecompressAlphaImage(
+    AVIF_NATIVE_API DecoderStatus AVIF_NATIVE_CALL DecompressAlphaImage(
         const uint8_t* compressedAlphaImage,
         size_t compressedAlphaImageSize,
+        const DecoderOptions* decoderOptions,
         DecodeInfo* decodeInfo,
-        BitmapData* outputImage);
+        BitmapData* outputImage,
+        DecodeStats* stats);
 
-    __declspec(dllexport) EncoderStatus __stdcall CompressImage(
-        const BitmapData* bitmap,
+    // Decodes the color and alpha images of an image or image grid tile, and writes
+    // the BGRA pixels in a single pass over the output image.
+    AVIF_NATIVE_API DecoderStatus AVIF_NATIVE_CALL DecompressImage(
+        const uint8_t* compressedColorImage,
+        size_t compressedColorImageSize,
+        const uint8_t* compressedAlphaImage,
+        size_t compressedAlphaImageSize,
+        const DecoderOptions* decoderOptions,
+        const CICPColorData* colorInfo,
+        DecodeInfo* colorDecodeInfo,
+        DecodeInfo* alphaDecodeInfo,
+        BitmapData* outputImage,
+        DecodeStats* stats);
+
+    // Computes the properties of each image grid tile in a single pass over the image.
+    // The tiles array must have one entry for each tile in grid order, if gridLayout is null
+    // the whole image is analyzed as a single tile.
+    AVIF_NATIVE_API EncoderStatus AVIF_NATIVE_CALL AnalyzeImage(
+        const BitmapData* image,
+        const ImageGridLayout* gridLayout,
+        int32_t maxThreads,
+        TileAnalysis* tiles);
+
+    AVIF_NATIVE_API EncoderStatus AVIF_NATIVE_CALL CreateEncoderSession(
         const EncoderOptions* encodeOptions,
+        EncoderSession** session);
+
+    AVIF_NATIVE_API void AVIF_NATIVE_CALL DestroyEncoderSession(EncoderSession* session);
+
+    // Releases most of the memory that the idle encoders of the session retain, this is called
+    // after each save so that the session does not keep the encoders of a large image alive.
+    AVIF_NATIVE_API void AVIF_NATIVE_CALL TrimEncoderSession(EncoderSession* session);
+
+    // The stats parameter is optional, it can be null if the caller does not need them.
+    AVIF_NATIVE_API EncoderStatus AVIF_NATIVE_CALL CompressImage(
+        EncoderSession* session,
+        const BitmapData* bitmap,
         ProgressContext* progressContext,
         const CICPColorData& colorInfo,
         CompressedAV1OutputAlloc outputAllocator,
         void** compressedColorImage,
-        void** compressedAlphaImage);
+        void** compressedAlphaImage,
+        EncodeStats* stats);
+
+    // Encodes the tiles of an image grid concurrently.
+    // The compressed tiles are returned in grid order, top to bottom then left to right.
+    // The tiles that extend past the edges of the image are padded by repeating its last column and row.
+    // The compressedColorImages and compressedAlphaImages arrays must have one entry for each tile,
+    // compressedAlphaImages can be null if the image does not have transparency.
+    // If tileReady is not null it is called as each tile finishes encoding, which allows the caller
+    // to write the tiles before the rest of the grid has been compressed.
+    // The tileStats array is optional, if it is not null it must have one entry for each tile.
+    // The duplicateTileIndexes array is optional, it has the same meaning as TileAnalysis::duplicateTileIndex.
+    // The tiles that are duplicates of an earlier tile are not encoded, their entries in the compressed image
+    // and stats arrays are left empty and tileReady is not called for them.
+    // The duplicateAlphaTileIndexes array is optional, it maps each tile to the earlier tile that has the same
+    // alpha values, e.g. all of the opaque tiles can share the alpha image of the first opaque tile.
+    // The alpha image is only encoded for the tiles that map to themselves, the other tiles are passed to
+    // tileReady with a null compressedAlphaImage.
+    AVIF_NATIVE_API EncoderStatus AVIF_NATIVE_CALL CompressImageGrid(
+        EncoderSession* session,
+        const BitmapData* bitmap,
+        const ImageGridLayout* gridLayout,
+        const uint32_t* duplicateTileIndexes,
+        const uint32_t* duplicateAlphaTileIndexes,
+        ProgressContext* progressContext,
+        const CICPColorData& colorInfo,
+        CompressedAV1OutputAlloc outputAllocator,
+        void** compressedColorImages,
+        void** compressedAlphaImages,
+        CompressedTileReady tileReady,
+        EncodeStats* tileStats);
+
+    // The number of times that FindTargetSizeQuality reports progress.
+    // This must be kept in sync with AvifNative.cs
+    constexpr uint32_t TargetSizeSearchProgressSteps = 6;
+
+    // Searches for the highest quality below 100 that compresses the color and alpha images to at most
+    // targetSize bytes, the quality field of encodeOptions is ignored.
+    // The quantizers are probed with parallel encodes of a downsampled proxy image, and the quality that the
+    // proxy predicts is refined with encodes of the full image using the same grid layout and duplicate tile
+    // indexes as CompressImageGrid. The gridLayout and duplicate tile index arrays are optional.
+    AVIF_NATIVE_API EncoderStatus AVIF_NATIVE_CALL FindTargetSizeQuality(
+        const BitmapData* bitmap,
+        const ImageGridLayout* gridLayout,
+        const uint32_t* duplicateTileIndexes,
+        const uint32_t* duplicateAlphaTileIndexes,
+        const EncoderOptions* encodeOptions,
+        const CICPColorData& colorInfo,
+        bool encodeAlpha,
+        uint64_t targetSize,
+        ProgressContext* progressContext,
+        TargetSizeResult* result);
+
+    // Selects the image grid layout with the lowest predicted encode time for the available threads.
+    // The image is split into tiles that are a multiple of the superblock size with an aspect ratio of at most 4:1,
+    // and a layout is only used if its predicted size overhead is within a fixed limit.
+    // The tiles in the last column and row can extend past the right and bottom edges of the image.
+    // A layout with one tile column and row is returned when the image should be encoded as a single tile.
+    AVIF_NATIVE_API EncoderStatus AVIF_NATIVE_CALL SelectImageGridLayout(
+        uint32_t width,
+        uint32_t height,
+        CompressionSpeed compressionSpeed,
+        int32_t maxThreads,
+        ImageGridLayout* gridLayout);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,1506 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+// Measures the throughput of the native image conversion and codec paths.
+//
+// Each measurement is written to stdout as a single line JSON object, so that the results
+// of two builds can be compared with standard tools.
+
+#include "AvifNative.h"
+#include "ChromaSubsampling.h"
+#include "CpuFeatures.h"
+#include "DecodedImageConverter.h"
+#include "GridLayoutModel.h"
+#include "ScopedAOMImage.h"
+#include "ThreadPool.h"
+#include "aom/aom_image.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    const char* const UsageText =
+        "Usage: AvifNativeBenchmark [options] [image.pam|image.ppm ...]\n"
+        "\n"
+        "The synthetic image is always measured, the listed 8-bit PAM or PPM files are measured after it.\n"
+        "\n"
+        "Options:\n"
+        "  --size WIDTHxHEIGHT       The size of the synthetic image, the default is 1920x1080.\n"
+        "  --iterations N            The number of times each conversion is timed, the default is 5.\n"
+        "  --codec-iterations N      The number of times each encode and decode is timed, the default is 1.\n"
+        "  --threads N               The maximum number of threads, the default is the processor count.\n"
+        "  --no-codec                Only measure the image conversions.\n"
+        "  --grid                    Compare the predicted and measured encode times of the image grid layouts.\n"
+        "  --verify                  Check that the SIMD color conversions match the scalar reference on odd image\n"
+        "                            sizes and strides, and that the grid layout tiles are aligned to the superblock\n"
+        "                            size, the exit code is 2 if any check fails.\n"
+        "  --help                    Show this message.\n"
+        "\n"
+        "On Linux peakRssKiB is the peak memory use of each measurement, on other platforms it is the peak for the process.\n";
+
+    struct BenchmarkSettings
+    {
+        uint32_t syntheticWidth = 1920;
+        uint32_t syntheticHeight = 1080;
+        int iterations = 5;
+        int codecIterations = 1;
+        int maxThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+        bool measureCodec = true;
+        bool measureGridLayouts = false;
+        bool verifyConversions = false;
+        bool showUsage = false;
+        std::vector<std::string> corpusFiles;
+    };
+
+    struct BenchmarkImage
+    {
+        std::string name;
+        uint32_t width;
+        uint32_t height;
+        std::vector<ColorBgra> pixels;
+
+        BitmapData GetBitmapData()
+        {
+            BitmapData bitmap;
+            bitmap.scan0 = reinterpret_cast<uint8_t*>(pixels.data());
+            bitmap.width = width;
+            bitmap.height = height;
+            bitmap.stride = width * static_cast<uint32_t>(sizeof(ColorBgra));
+
+            return bitmap;
+        }
+    };
+
+    // The fields of a measurement, the empty string fields are not written.
+    struct BenchmarkResult
+    {
+        const char* benchmark;
+        const BenchmarkImage* image;
+        std::string format;
+        uint32_t bitDepth;
+        std::string simd;
+        std::string speed;
+        int threads;
+        int iterations;
+        double medianMilliseconds;
+        size_t bytes;
+        // The image grid layout fields, these are only written for the image grid layout measurements.
+        std::string layout;
+        bool selectedLayout;
+        double predictedEncodeTime;
+        double predictedSizeOverhead;
+        // The rotation and mirror transform of the decoded image writeout.
+        std::string transform;
+    };
+
+    [[noreturn]] void Fail(const std::string& message)
+    {
+        throw std::runtime_error(message);
+    }
+
+    // The fields that are not passed to this function are left empty, the measurements set the
+    // fields that only apply to them after the result is created.
+    BenchmarkResult CreateResult(
+        const char* benchmark,
+        const BenchmarkImage& image,
+        const std::string& format,
+        uint32_t bitDepth,
+        const std::string& simd,
+        const std::string& speed,
+        int threads,
+        int iterations,
+        double medianMilliseconds,
+        size_t bytes)
+    {
+        BenchmarkResult result{};
+        result.benchmark = benchmark;
+        result.image = &image;
+        result.format = format;
+        result.bitDepth = bitDepth;
+        result.simd = simd;
+        result.speed = speed;
+        result.threads = threads;
+        result.iterations = iterations;
+        result.medianMilliseconds = medianMilliseconds;
+        result.bytes = bytes;
+
+        return result;
+    }
+
+    // Resets the peak resident set size that is reported by GetPeakResidentSetKiB, this is only supported on Linux.
+    void ResetPeakResidentSet()
+    {
+#if defined(__linux__)
+        FILE* file = fopen("/proc/self/clear_refs", "w");
+        if (file)
+        {
+            fputs("5", file);
+            fclose(file);
+        }
+#endif
+    }
+
+    unsigned long long GetPeakResidentSetKiB()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return counters.PeakWorkingSetSize / 1024;
+        }
+        return 0;
+#else
+#if defined(__linux__)
+        FILE* file = fopen("/proc/self/status", "r");
+        if (file)
+        {
+            char line[256];
+            unsigned long long value = 0;
+            bool found = false;
+
+            while (!found && fgets(line, sizeof(line), file))
+            {
+                found = sscanf(line, "VmHWM: %llu kB", &value) == 1;
+            }
+            fclose(file);
+
+            if (found)
+            {
+                return value;
+            }
+        }
+#endif
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+        {
+#if defined(__APPLE__)
+            return static_cast<unsigned long long>(usage.ru_maxrss) / 1024;
+#else
+            return static_cast<unsigned long long>(usage.ru_maxrss);
+#endif
+        }
+        return 0;
+#endif
+    }
+
+    std::string EscapeJsonString(const std::string& value)
+    {
+        std::string escaped;
+
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                escaped += buffer;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+
+        return escaped;
+    }
+
+    void WriteResult(const BenchmarkResult& result)
+    {
+        const double megapixels = (static_cast<double>(result.image->width) * result.image->height) / 1000000.0;
+        const double megapixelsPerSecond = result.medianMilliseconds > 0 ? megapixels / (result.medianMilliseconds / 1000.0) : 0;
+
+        std::string line = "{\"benchmark\":\"" + std::string(result.benchmark) + "\"";
+        line += ",\"image\":\"" + EscapeJsonString(result.image->name) + "\"";
+        line += ",\"width\":" + std::to_string(result.image->width);
+        line += ",\"height\":" + std::to_string(result.image->height);
+
+        if (!result.format.empty())
+        {
+            line += ",\"format\":\"" + result.format + "\"";
+        }
+        if (result.bitDepth != 0)
+        {
+            line += ",\"bitDepth\":" + std::to_string(result.bitDepth);
+        }
+        if (!result.simd.empty())
+        {
+            line += ",\"simd\":\"" + result.simd + "\"";
+        }
+        if (!result.speed.empty())
+        {
+            line += ",\"speed\":\"" + result.speed + "\"";
+        }
+        if (!result.transform.empty())
+        {
+            line += ",\"transform\":\"" + result.transform + "\"";
+        }
+        if (!result.layout.empty())
+        {
+            char layoutNumbers[128];
+            snprintf(layoutNumbers,
+                     sizeof(layoutNumbers),
+                     ",\"selected\":%s,\"predictedEncodeTime\":%.4f,\"predictedSizeOverhead\":%.4f",
+                     result.selectedLayout ? "true" : "false",
+                     result.predictedEncodeTime,
+                     result.predictedSizeOverhead);
+
+            line += ",\"layout\":\"" + result.layout + "\"";
+            line += layoutNumbers;
+        }
+
+        char numbers[256];
+        snprintf(numbers,
+                 sizeof(numbers),
+                 ",\"threads\":%d,\"iterations\":%d,\"medianMs\":%.3f,\"megapixelsPerSecond\":%.2f,\"bytes\":%zu,\"peakRssKiB\":%llu}",
+                 result.threads,
+                 result.iterations,
+                 result.medianMilliseconds,
+                 megapixelsPerSecond,
+                 result.bytes,
+                 GetPeakResidentSetKiB());
+        line += numbers;
+
+        puts(line.c_str());
+        fflush(stdout);
+    }
+
+    // Returns the median time of the iterations, the optional warm-up call is not timed.
+    template <typename Func>
+    double MeasureMedianMilliseconds(int iterations, bool warmUp, Func&& func)
+    {
+        ResetPeakResidentSet();
+
+        if (warmUp)
+        {
+            func();
+        }
+
+        std::vector<double> times;
+        times.reserve(static_cast<size_t>(iterations));
+
+        for (int i = 0; i < iterations; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const auto end = std::chrono::steady_clock::now();
+
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        std::sort(times.begin(), times.end());
+
+        return times[times.size() / 2];
+    }
+
+    // A deterministic pseudo-random number generator, so that every run measures the same image.
+    uint32_t NextRandom(uint32_t& state)
+    {
+        state = state * 1664525U + 1013904223U;
+        return state >> 24;
+    }
+
+    uint8_t ClampToByte(int value)
+    {
+        return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+    }
+
+    // Creates an image with smooth gradients, noise and an alpha channel that fades out at the edges,
+    // which is closer to the content of a photograph than a single color.
+    BenchmarkImage CreateSyntheticImage(uint32_t width, uint32_t height)
+    {
+        BenchmarkImage image;
+        image.name = "synthetic";
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height);
+
+        uint32_t randomState = 1;
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const int noise = static_cast<int>(NextRandom(randomState) % 17) - 8;
+                const int edgeDistance = static_cast<int>(std::min(std::min(x, width - 1 - x), std::min(y, height - 1 - y)));
+
+                ColorBgra& pixel = image.pixels[(static_cast<size_t>(y) * width) + x];
+                pixel.r = ClampToByte(static_cast<int>((x * 255ULL) / width) + noise);
+                pixel.g = ClampToByte(static_cast<int>((y * 255ULL) / height) + noise);
+                pixel.b = ClampToByte(static_cast<int>(((x + y) * 255ULL) / (width + height)) - noise);
+                pixel.a = ClampToByte(edgeDistance * 4);
+            }
+        }
+
+        return image;
+    }
+
+    std::string ReadHeaderToken(std::istream& stream)
+    {
+        std::string token;
+
+        while (stream >> token)
+        {
+            if (token[0] != '#')
+            {
+                return token;
+            }
+
+            std::string comment;
+            std::getline(stream, comment);
+        }
+
+        return std::string();
+    }
+
+    // Reads an 8-bit binary PPM (P6) or PAM (P7) image with RGB or RGB_ALPHA tuples.
+    BenchmarkImage LoadCorpusImage(const std::string& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream)
+        {
+            Fail("Unable to open " + path);
+        }
+
+        const std::string magic = ReadHeaderToken(stream);
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t depth = 3;
+        uint32_t maxValue = 0;
+
+        if (magic == "P6")
+        {
+            width = static_cast<uint32_t>(std::stoul(ReadHeaderToken(stream)));
+            height = static_cast<uint32_t>(std::stoul(ReadHeaderToken(stream)));
+            maxValue = static_cast<uint32_t>(std::stoul(ReadHeaderToken(stream)));
+        }
+        else if (magic == "P7")
+        {
+            std::string token;
+
+            while ((token = ReadHeaderToken(stream)) != "ENDHDR")
+            {
+                if (token.empty())
+                {
+                    Fail(path + " has an invalid PAM header.");
+                }
+                else if (token == "WIDTH")
+                {
+                    width = static_cast<uint32_t>(std::stoul(ReadHeaderToken(stream)));
+                }
+                else if (token == "HEIGHT")
+                {
+                    height = static_cast<uint32_t>(std::stoul(ReadHeaderToken(stream)));
+                }
+                else if (token == "DEPTH")
+                {
+                    depth = static_cast<uint32_t>(std::stoul(ReadHeaderToken(stream)));
+                }
+                else if (token == "MAXVAL")
+                {
+                    maxValue = static_cast<uint32_t>(std::stoul(ReadHeaderToken(stream)));
+                }
+                else if (token == "TUPLTYPE")
+                {
+                    ReadHeaderToken(stream);
+                }
+            }
+        }
+        else
+        {
+            Fail(path + " is not a binary PPM or PAM image.");
+        }
+
+        if (width == 0 || height == 0 || maxValue != 255 || (depth != 3 && depth != 4))
+        {
+            Fail(path + " must be an 8-bit RGB or RGBA image.");
+        }
+
+        // A single white space character separates the header from the image data.
+        stream.get();
+
+        BenchmarkImage image;
+        image.name = path;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height);
+
+        std::vector<uint8_t> row(static_cast<size_t>(width) * depth);
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            if (!stream.read(reinterpret_cast<char*>(row.data()), static_cast<std::streamsize>(row.size())))
+            {
+                Fail(path + " is truncated.");
+            }
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const uint8_t* src = &row[static_cast<size_t>(x) * depth];
+                ColorBgra& pixel = image.pixels[(static_cast<size_t>(y) * width) + x];
+
+                pixel.r = src[0];
+                pixel.g = src[1];
+                pixel.b = src[2];
+                pixel.a = depth == 4 ? src[3] : 255;
+            }
+        }
+
+        return image;
+    }
+
+    const char* GetSimdLevelName(SimdLevel simdLevel)
+    {
+        switch (simdLevel)
+        {
+        case SimdLevel::SSE2:
+            return "SSE2";
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::None:
+        default:
+            return "None";
+        }
+    }
+
+    std::vector<SimdLevel> GetSupportedSimdLevels()
+    {
+        std::vector<SimdLevel> levels{ SimdLevel::None };
+        const SimdLevel supported = GetSupportedSimdLevel();
+
+        if (supported >= SimdLevel::SSE2)
+        {
+            levels.push_back(SimdLevel::SSE2);
+        }
+        if (supported >= SimdLevel::AVX2)
+        {
+            levels.push_back(SimdLevel::AVX2);
+        }
+
+        return levels;
+    }
+
+    struct EncodeFormat
+    {
+        const char* name;
+        YUVChromaSubsampling yuvFormat;
+        aom_img_fmt aomFormat;
+    };
+
+    // This matches the YUV formats that are used by the encoder.
+    const EncodeFormat EncodeFormats[] =
+    {
+        { "4:2:0", YUVChromaSubsampling::Subsampling420, AOM_IMG_FMT_I420 },
+        { "4:2:2", YUVChromaSubsampling::Subsampling422, AOM_IMG_FMT_I422 },
+        { "4:4:4", YUVChromaSubsampling::Subsampling444, AOM_IMG_FMT_I444 },
+        { "4:0:0", YUVChromaSubsampling::Subsampling400, AOM_IMG_FMT_I420 },
+        { "identity", YUVChromaSubsampling::IdentityMatrix, AOM_IMG_FMT_I444 }
+    };
+
+    CICPColorData GetColorInfo(YUVChromaSubsampling yuvFormat)
+    {
+        CICPColorData colorInfo;
+        colorInfo.colorPrimaries = CICPColorPrimaries::BT709;
+        colorInfo.transferCharacteristics = CICPTransferCharacteristics::Srgb;
+        colorInfo.matrixCoefficients = yuvFormat == YUVChromaSubsampling::IdentityMatrix ? CICPMatrixCoefficients::Identity : CICPMatrixCoefficients::BT709;
+        colorInfo.fullRange = true;
+
+        return colorInfo;
+    }
+
+    void MeasureEncodeConversions(BenchmarkImage& image, const BenchmarkSettings& settings)
+    {
+        const BitmapData bitmap = image.GetBitmapData();
+
+        for (SimdLevel simdLevel : GetSupportedSimdLevels())
+        {
+            for (const EncodeFormat& format : EncodeFormats)
+            {
+                const CICPColorData colorInfo = GetColorInfo(format.yuvFormat);
+
+                const double milliseconds = MeasureMedianMilliseconds(settings.iterations, true, [&]()
+                {
+                    AvifNative::ScopedAOMImage yuvImage(ConvertColorToAOMImage(&bitmap, colorInfo, format.yuvFormat, format.aomFormat, simdLevel));
+                    if (!yuvImage)
+                    {
+                        Fail("ConvertColorToAOMImage failed.");
+                    }
+                });
+
+                WriteResult(CreateResult("ConvertColorToAOMImage", image, format.name, 8, GetSimdLevelName(simdLevel), "", 1, settings.iterations, milliseconds, 0));
+            }
+
+            const double milliseconds = MeasureMedianMilliseconds(settings.iterations, true, [&]()
+            {
+                AvifNative::ScopedAOMImage alphaImage(ConvertAlphaToAOMImage(&bitmap, simdLevel));
+                if (!alphaImage)
+                {
+                    Fail("ConvertAlphaToAOMImage failed.");
+                }
+            });
+
+            WriteResult(CreateResult("ConvertAlphaToAOMImage", image, "4:0:0", 8, GetSimdLevelName(simdLevel), "", 1, settings.iterations, milliseconds, 0));
+        }
+    }
+
+    // Compares the visible area of the image planes, the row padding is not initialized.
+    bool IsSamePlaneData(const aom_image_t* expected, const aom_image_t* actual)
+    {
+        const int planeCount = expected->monochrome ? 1 : 3;
+
+        for (int plane = 0; plane < planeCount; plane++)
+        {
+            const uint32_t planeWidth = plane == AOM_PLANE_Y ? expected->d_w : (expected->d_w + expected->x_chroma_shift) >> expected->x_chroma_shift;
+            const uint32_t planeHeight = plane == AOM_PLANE_Y ? expected->d_h : (expected->d_h + expected->y_chroma_shift) >> expected->y_chroma_shift;
+
+            for (uint32_t y = 0; y < planeHeight; y++)
+            {
+                const uint8_t* expectedRow = expected->planes[plane] + (static_cast<size_t>(y) * expected->stride[plane]);
+                const uint8_t* actualRow = actual->planes[plane] + (static_cast<size_t>(y) * actual->stride[plane]);
+
+                if (memcmp(expectedRow, actualRow, planeWidth) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    struct VerifyMatrix
+    {
+        const char* name;
+        CICPMatrixCoefficients matrixCoefficients;
+    };
+
+    const VerifyMatrix VerifyMatrices[] =
+    {
+        { "BT.709", CICPMatrixCoefficients::BT709 },
+        { "BT.601", CICPMatrixCoefficients::BT601 },
+        { "BT.2020", CICPMatrixCoefficients::BT2020NCL }
+    };
+
+    // Converts random images with odd sizes and row strides using each supported instruction set,
+    // and compares the output with the scalar reference conversion.
+    // Returns the number of conversions that did not match.
+    int VerifyEncodeConversions()
+    {
+        struct ImageSize
+        {
+            uint32_t width;
+            uint32_t height;
+        };
+
+        // The sizes cover the SIMD block widths, the scalar remainder loops and the odd chroma rows and columns.
+        static const ImageSize Sizes[] =
+        {
+            { 1, 1 }, { 2, 3 }, { 3, 2 }, { 7, 5 }, { 15, 17 }, { 16, 16 },
+            { 31, 9 }, { 33, 31 }, { 63, 3 }, { 65, 65 }, { 129, 7 }
+        };
+        // The number of unused pixels at the end of each row, and at the start of the buffer.
+        // A single pixel offset moves the rows away from the 16 and 32 byte boundaries.
+        static const uint32_t RowPaddings[] = { 0, 1, 5 };
+        static const uint32_t StartOffsets[] = { 0, 1 };
+
+        const std::vector<SimdLevel> simdLevels = GetSupportedSimdLevels();
+
+        int conversionCount = 0;
+        int mismatchCount = 0;
+        uint32_t randomState = 1;
+
+        for (const ImageSize& size : Sizes)
+        {
+            for (uint32_t rowPadding : RowPaddings)
+            {
+                for (uint32_t startOffset : StartOffsets)
+                {
+                    const uint32_t rowPixels = size.width + rowPadding;
+                    std::vector<ColorBgra> pixels(startOffset + (static_cast<size_t>(rowPixels) * size.height));
+
+                    for (ColorBgra& pixel : pixels)
+                    {
+                        pixel.b = static_cast<uint8_t>(NextRandom(randomState));
+                        pixel.g = static_cast<uint8_t>(NextRandom(randomState));
+                        pixel.r = static_cast<uint8_t>(NextRandom(randomState));
+                        pixel.a = static_cast<uint8_t>(NextRandom(randomState));
+                    }
+
+                    BitmapData bitmap;
+                    bitmap.scan0 = reinterpret_cast<uint8_t*>(pixels.data() + startOffset);
+                    bitmap.width = size.width;
+                    bitmap.height = size.height;
+                    bitmap.stride = rowPixels * static_cast<uint32_t>(sizeof(ColorBgra));
+
+                    const std::string description = std::to_string(size.width) + "x" + std::to_string(size.height) +
+                        " stride " + std::to_string(bitmap.stride) + " offset " + std::to_string(startOffset * sizeof(ColorBgra));
+
+                    for (const EncodeFormat& format : EncodeFormats)
+                    {
+                        for (const VerifyMatrix& matrix : VerifyMatrices)
+                        {
+                            // The identity format does not use the matrix coefficients.
+                            if (format.yuvFormat == YUVChromaSubsampling::IdentityMatrix && &matrix != &VerifyMatrices[0])
+                            {
+                                continue;
+                            }
+
+                            CICPColorData colorInfo = GetColorInfo(format.yuvFormat);
+                            if (format.yuvFormat != YUVChromaSubsampling::IdentityMatrix)
+                            {
+                                colorInfo.matrixCoefficients = matrix.matrixCoefficients;
+                            }
+
+                            AvifNative::ScopedAOMImage reference(ConvertColorToAOMImage(&bitmap, colorInfo, format.yuvFormat, format.aomFormat, SimdLevel::None));
+                            if (!reference)
+                            {
+                                Fail("ConvertColorToAOMImage failed.");
+                            }
+
+                            for (SimdLevel simdLevel : simdLevels)
+                            {
+                                if (simdLevel == SimdLevel::None)
+                                {
+                                    continue;
+                                }
+
+                                AvifNative::ScopedAOMImage yuvImage(ConvertColorToAOMImage(&bitmap, colorInfo, format.yuvFormat, format.aomFormat, simdLevel));
+                                if (!yuvImage)
+                                {
+                                    Fail("ConvertColorToAOMImage failed.");
+                                }
+
+                                conversionCount++;
+
+                                if (!IsSamePlaneData(reference.get(), yuvImage.get()))
+                                {
+                                    mismatchCount++;
+                                    fprintf(stderr, "ConvertColorToAOMImage %s %s %s %s differs from the scalar conversion.\n",
+                                        GetSimdLevelName(simdLevel), format.name, matrix.name, description.c_str());
+                                }
+                            }
+                        }
+                    }
+
+                    AvifNative::ScopedAOMImage referenceAlpha(ConvertAlphaToAOMImage(&bitmap, SimdLevel::None));
+                    if (!referenceAlpha)
+                    {
+                        Fail("ConvertAlphaToAOMImage failed.");
+                    }
+
+                    for (SimdLevel simdLevel : simdLevels)
+                    {
+                        if (simdLevel == SimdLevel::None)
+                        {
+                            continue;
+                        }
+
+                        AvifNative::ScopedAOMImage alphaImage(ConvertAlphaToAOMImage(&bitmap, simdLevel));
+                        if (!alphaImage)
+                        {
+                            Fail("ConvertAlphaToAOMImage failed.");
+                        }
+
+                        conversionCount++;
+
+                        if (!IsSamePlaneData(referenceAlpha.get(), alphaImage.get()))
+                        {
+                            mismatchCount++;
+                            fprintf(stderr, "ConvertAlphaToAOMImage %s %s differs from the scalar conversion.\n",
+                                GetSimdLevelName(simdLevel), description.c_str());
+                        }
+                    }
+                }
+            }
+        }
+
+        printf("%d of %d SIMD conversions matched the scalar reference, the supported instruction set is %s.\n",
+            conversionCount - mismatchCount, conversionCount, GetSimdLevelName(simdLevels.back()));
+
+        return mismatchCount;
+    }
+
+    // Creates a decoder output image with the specified bit depth, the 8-bit planes from the
+    // encoder conversion are scaled to the new bit depth.
+    AvifNative::ScopedAOMImage CreateDecodedImage(const aom_image_t* source, uint32_t bitDepth)
+    {
+        const aom_img_fmt format = bitDepth > 8 ? static_cast<aom_img_fmt>(source->fmt | AOM_IMG_FMT_HIGHBITDEPTH) : source->fmt;
+
+        AvifNative::ScopedAOMImage image(aom_img_alloc(nullptr, format, source->d_w, source->d_h, 16));
+        if (!image)
+        {
+            Fail("aom_img_alloc failed.");
+        }
+
+        image->bit_depth = bitDepth;
+        image->range = source->range;
+        image->monochrome = source->monochrome;
+        image->cp = source->cp;
+        image->tc = source->tc;
+        image->mc = source->mc;
+
+        const int planeCount = source->monochrome ? 1 : 3;
+
+        for (int plane = 0; plane < planeCount; plane++)
+        {
+            const uint32_t planeWidth = plane == AOM_PLANE_Y ? source->d_w : (source->d_w + source->x_chroma_shift) >> source->x_chroma_shift;
+            const uint32_t planeHeight = plane == AOM_PLANE_Y ? source->d_h : (source->d_h + source->y_chroma_shift) >> source->y_chroma_shift;
+
+            for (uint32_t y = 0; y < planeHeight; y++)
+            {
+                const uint8_t* src = source->planes[plane] + (static_cast<size_t>(y) * source->stride[plane]);
+                uint8_t* dst = image->planes[plane] + (static_cast<size_t>(y) * image->stride[plane]);
+
+                if (bitDepth > 8)
+                {
+                    uint16_t* dst16 = reinterpret_cast<uint16_t*>(dst);
+
+                    for (uint32_t x = 0; x < planeWidth; x++)
+                    {
+                        dst16[x] = static_cast<uint16_t>(src[x] << (bitDepth - 8));
+                    }
+                }
+                else
+                {
+                    memcpy(dst, src, planeWidth);
+                }
+            }
+        }
+
+        return image;
+    }
+
+    DecodeInfo CreateDecodeInfo()
+    {
+        DecodeInfo decodeInfo;
+        memset(&decodeInfo, 0, sizeof(decodeInfo));
+
+        return decodeInfo;
+    }
+
+    void MeasureDecodeConversions(BenchmarkImage& image, const BenchmarkSettings& settings)
+    {
+        const BitmapData sourceBitmap = image.GetBitmapData();
+
+        std::vector<ColorBgra> outputPixels(image.pixels.size());
+        BitmapData outputBitmap = sourceBitmap;
+        outputBitmap.scan0 = reinterpret_cast<uint8_t*>(outputPixels.data());
+
+        static const uint32_t BitDepths[] = { 8, 10, 12 };
+
+        for (const EncodeFormat& format : EncodeFormats)
+        {
+            if (format.yuvFormat == YUVChromaSubsampling::IdentityMatrix)
+            {
+                continue;
+            }
+
+            AvifNative::ScopedAOMImage yuvImage(ConvertColorToAOMImage(&sourceBitmap, GetColorInfo(format.yuvFormat), format.yuvFormat, format.aomFormat));
+            if (!yuvImage)
+            {
+                Fail("ConvertColorToAOMImage failed.");
+            }
+
+            for (uint32_t bitDepth : BitDepths)
+            {
+                AvifNative::ScopedAOMImage decodedImage = CreateDecodedImage(yuvImage.get(), bitDepth);
+
+                const double milliseconds = MeasureMedianMilliseconds(settings.iterations, true, [&]()
+                {
+                    DecodeInfo decodeInfo = CreateDecodeInfo();
+
+                    if (ConvertColorImage(decodedImage.get(), nullptr, &decodeInfo, &outputBitmap, settings.maxThreads) != DecoderStatus::Ok)
+                    {
+                        Fail("ConvertColorImage failed.");
+                    }
+                });
+
+                WriteResult(CreateResult("ConvertColorImage", image, format.name, bitDepth, "", "", settings.maxThreads, settings.iterations, milliseconds, 0));
+            }
+        }
+
+        AvifNative::ScopedAOMImage alphaImage(ConvertAlphaToAOMImage(&sourceBitmap));
+        if (!alphaImage)
+        {
+            Fail("ConvertAlphaToAOMImage failed.");
+        }
+
+        for (uint32_t bitDepth : BitDepths)
+        {
+            AvifNative::ScopedAOMImage decodedImage = CreateDecodedImage(alphaImage.get(), bitDepth);
+
+            const double milliseconds = MeasureMedianMilliseconds(settings.iterations, true, [&]()
+            {
+                DecodeInfo decodeInfo = CreateDecodeInfo();
+
+                if (ConvertAlphaImage(decodedImage.get(), &decodeInfo, &outputBitmap, settings.maxThreads) != DecoderStatus::Ok)
+                {
+                    Fail("ConvertAlphaImage failed.");
+                }
+            });
+
+            WriteResult(CreateResult("ConvertAlphaImage", image, "4:0:0", bitDepth, "", "", settings.maxThreads, settings.iterations, milliseconds, 0));
+        }
+    }
+
+    struct OutputTransform
+    {
+        const char* name;
+        OutputRotation rotation;
+        OutputMirror mirror;
+    };
+
+    // The rotations and mirrors that the plugin applies for the EXIF orientations.
+    const OutputTransform OutputTransforms[] =
+    {
+        { "rotate90", OutputRotation::Rotate90CCW, OutputMirror::None },
+        { "rotate180", OutputRotation::Rotate180, OutputMirror::None },
+        { "rotate270", OutputRotation::Rotate270CCW, OutputMirror::None },
+        { "mirror-horizontal", OutputRotation::None, OutputMirror::Horizontal },
+        { "mirror-vertical", OutputRotation::None, OutputMirror::Vertical },
+        { "rotate90-mirror-horizontal", OutputRotation::Rotate90CCW, OutputMirror::Horizontal },
+        { "rotate90-mirror-vertical", OutputRotation::Rotate90CCW, OutputMirror::Vertical }
+    };
+
+    // Measures the decoded image writeout with the rotation and mirror transforms, the 90 and 270 degree
+    // rotations write the source rows to the output columns.
+    void MeasureTransformedDecodeConversions(BenchmarkImage& image, const BenchmarkSettings& settings)
+    {
+        const BitmapData sourceBitmap = image.GetBitmapData();
+
+        AvifNative::ScopedAOMImage yuvImage(ConvertColorToAOMImage(&sourceBitmap, GetColorInfo(YUVChromaSubsampling::Subsampling420), YUVChromaSubsampling::Subsampling420, AOM_IMG_FMT_I420));
+        if (!yuvImage)
+        {
+            Fail("ConvertColorToAOMImage failed.");
+        }
+
+        AvifNative::ScopedAOMImage alphaImage(ConvertAlphaToAOMImage(&sourceBitmap));
+        if (!alphaImage)
+        {
+            Fail("ConvertAlphaToAOMImage failed.");
+        }
+
+        AvifNative::ScopedAOMImage colorImages[] = { CreateDecodedImage(yuvImage.get(), 8), CreateDecodedImage(yuvImage.get(), 10) };
+        AvifNative::ScopedAOMImage decodedAlphaImage = CreateDecodedImage(alphaImage.get(), 8);
+
+        std::vector<ColorBgra> outputPixels(image.pixels.size());
+
+        for (const OutputTransform& transform : OutputTransforms)
+        {
+            const bool swapDimensions = transform.rotation == OutputRotation::Rotate90CCW || transform.rotation == OutputRotation::Rotate270CCW;
+
+            BitmapData outputBitmap;
+            outputBitmap.scan0 = reinterpret_cast<uint8_t*>(outputPixels.data());
+            outputBitmap.width = swapDimensions ? image.height : image.width;
+            outputBitmap.height = swapDimensions ? image.width : image.height;
+            outputBitmap.stride = outputBitmap.width * static_cast<uint32_t>(sizeof(ColorBgra));
+
+            for (const AvifNative::ScopedAOMImage& colorImage : colorImages)
+            {
+                const double milliseconds = MeasureMedianMilliseconds(settings.iterations, true, [&]()
+                {
+                    DecodeInfo decodeInfo = CreateDecodeInfo();
+                    decodeInfo.outputRotation = transform.rotation;
+                    decodeInfo.outputMirror = transform.mirror;
+
+                    if (ConvertColorImage(colorImage.get(), nullptr, &decodeInfo, &outputBitmap, settings.maxThreads) != DecoderStatus::Ok)
+                    {
+                        Fail("ConvertColorImage failed.");
+                    }
+                });
+
+                BenchmarkResult result = CreateResult("ConvertColorImage", image, "4:2:0", colorImage->bit_depth, "", "", settings.maxThreads, settings.iterations, milliseconds, 0);
+                result.transform = transform.name;
+                WriteResult(result);
+            }
+
+            const double milliseconds = MeasureMedianMilliseconds(settings.iterations, true, [&]()
+            {
+                DecodeInfo decodeInfo = CreateDecodeInfo();
+                decodeInfo.outputRotation = transform.rotation;
+                decodeInfo.outputMirror = transform.mirror;
+
+                if (ConvertAlphaImage(decodedAlphaImage.get(), &decodeInfo, &outputBitmap, settings.maxThreads) != DecoderStatus::Ok)
+                {
+                    Fail("ConvertAlphaImage failed.");
+                }
+            });
+
+            BenchmarkResult result = CreateResult("ConvertAlphaImage", image, "4:0:0", 8, "", "", settings.maxThreads, settings.iterations, milliseconds, 0);
+            result.transform = transform.name;
+            WriteResult(result);
+        }
+    }
+
+    // The compressed output buffers, the encoder callbacks are serialized but they
+    // can be called from the thread pool threads.
+    std::mutex outputMutex;
+    std::map<void*, std::unique_ptr<uint8_t[]>> outputBuffers;
+    std::map<void*, size_t> outputSizes;
+
+    void* AVIF_NATIVE_CALL AllocateOutput(size_t sizeInBytes)
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+
+        std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[sizeInBytes]);
+        void* pointer = buffer.get();
+
+        if (pointer)
+        {
+            outputSizes[pointer] = sizeInBytes;
+            outputBuffers[pointer] = std::move(buffer);
+        }
+
+        return pointer;
+    }
+
+    size_t GetOutputSize(void* pointer)
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+
+        return pointer ? outputSizes.at(pointer) : 0;
+    }
+
+    void FreeOutputBuffers()
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+
+        outputBuffers.clear();
+        outputSizes.clear();
+    }
+
+    bool AVIF_NATIVE_CALL ReportProgress(uint32_t, uint32_t)
+    {
+        return true;
+    }
+
+    const char* GetCompressionSpeedName(CompressionSpeed speed)
+    {
+        switch (speed)
+        {
+        case CompressionSpeed::Fast:
+            return "Fast";
+        case CompressionSpeed::Medium:
+            return "Medium";
+        case CompressionSpeed::Slow:
+            return "Slow";
+        case CompressionSpeed::VerySlow:
+        default:
+            return "VerySlow";
+        }
+    }
+
+    void MeasureCodec(BenchmarkImage& image, const BenchmarkSettings& settings)
+    {
+        const BitmapData bitmap = image.GetBitmapData();
+        const CICPColorData colorInfo = GetColorInfo(YUVChromaSubsampling::Subsampling420);
+
+        static const CompressionSpeed Speeds[] =
+        {
+            CompressionSpeed::Fast,
+            CompressionSpeed::Medium,
+            CompressionSpeed::Slow,
+            CompressionSpeed::VerySlow
+        };
+
+        std::vector<ColorBgra> outputPixels(image.pixels.size());
+        BitmapData outputBitmap = bitmap;
+        outputBitmap.scan0 = reinterpret_cast<uint8_t*>(outputPixels.data());
+
+        for (CompressionSpeed speed : Speeds)
+        {
+            EncoderOptions options;
+            options.quality = 85;
+            options.compressionSpeed = speed;
+            options.yuvFormat = YUVChromaSubsampling::Subsampling420;
+            options.maxThreads = settings.maxThreads;
+
+            EncoderSession* session;
+            EncoderStatus encoderStatus = CreateEncoderSession(&options, &session);
+            if (encoderStatus != EncoderStatus::Ok)
+            {
+                Fail("CreateEncoderSession failed with status " + std::to_string(static_cast<int>(encoderStatus)) + ".");
+            }
+
+            std::unique_ptr<EncoderSession, void(AVIF_NATIVE_CALL*)(EncoderSession*)> sessionOwner(session, DestroyEncoderSession);
+
+            void* colorImage = nullptr;
+            void* alphaImage = nullptr;
+
+            const double encodeMilliseconds = MeasureMedianMilliseconds(settings.codecIterations, false, [&]()
+            {
+                FreeOutputBuffers();
+
+                ProgressContext progressContext;
+                progressContext.progressCallback = ReportProgress;
+                progressContext.progressDone = 0;
+                progressContext.progressTotal = 6;
+
+                encoderStatus = CompressImage(session, &bitmap, &progressContext, colorInfo, AllocateOutput, &colorImage, &alphaImage, nullptr);
+                if (encoderStatus != EncoderStatus::Ok)
+                {
+                    Fail("CompressImage failed with status " + std::to_string(static_cast<int>(encoderStatus)) + ".");
+                }
+            });
+
+            const size_t colorImageSize = GetOutputSize(colorImage);
+
+            WriteResult(CreateResult("CompressImage", image, "4:2:0", 8, "", GetCompressionSpeedName(speed), settings.maxThreads,
+                                     settings.codecIterations, encodeMilliseconds, colorImageSize + GetOutputSize(alphaImage)));
+
+            DecoderOptions decoderOptions;
+            decoderOptions.maxThreads = settings.maxThreads;
+            decoderOptions.rowMultithreading = true;
+
+            const double decodeMilliseconds = MeasureMedianMilliseconds(settings.codecIterations, false, [&]()
+            {
+                DecodeInfo decodeInfo = CreateDecodeInfo();
+
+                const DecoderStatus decoderStatus = DecompressColorImage(
+                    static_cast<const uint8_t*>(colorImage),
+                    colorImageSize,
+                    &decoderOptions,
+                    nullptr,
+                    &decodeInfo,
+                    &outputBitmap,
+                    nullptr);
+                if (decoderStatus != DecoderStatus::Ok)
+                {
+                    Fail("DecompressColorImage failed with status " + std::to_string(static_cast<int>(decoderStatus)) + ".");
+                }
+            });
+
+            WriteResult(CreateResult("DecompressColorImage", image, "4:2:0", 8, "", GetCompressionSpeedName(speed), settings.maxThreads,
+                                     settings.codecIterations, decodeMilliseconds, colorImageSize));
+
+            FreeOutputBuffers();
+        }
+    }
+
+    bool AVIF_NATIVE_CALL IgnoreCompressedTile(uint32_t, void*, void*)
+    {
+        return true;
+    }
+
+    std::string FormatGridLayout(const ImageGridLayout& layout)
+    {
+        return std::to_string(layout.tileColumnCount) + "x" + std::to_string(layout.tileRowCount) + " of " +
+               std::to_string(layout.tileWidth) + "x" + std::to_string(layout.tileHeight);
+    }
+
+    bool IsSameGridLayout(const ImageGridLayout& first, const ImageGridLayout& second)
+    {
+        return first.tileColumnCount == second.tileColumnCount && first.tileRowCount == second.tileRowCount;
+    }
+
+    // Checks the superblock sizes that the grid layout model uses at the sizes where libaom switches from
+    // 64x64 to 128x128 superblocks, and checks that the tiles of every grid layout candidate are aligned
+    // to the superblock size of the tile.
+    // Returns the number of checks that failed.
+    int VerifyGridLayouts()
+    {
+        struct SuperblockCase
+        {
+            uint32_t width;
+            uint32_t height;
+            CompressionSpeed speed;
+            uint32_t superblockSize;
+        };
+
+        // The superblock sizes were read from the sequence headers that libaom 3.6 writes.
+        static const SuperblockCase SuperblockCases[] =
+        {
+            { 720, 720, CompressionSpeed::Fast, 64 },
+            { 722, 722, CompressionSpeed::Fast, 128 },
+            { 800, 721, CompressionSpeed::Fast, 128 },
+            { 1500, 700, CompressionSpeed::Fast, 64 },
+            { 480, 480, CompressionSpeed::Medium, 64 },
+            { 481, 481, CompressionSpeed::Medium, 128 },
+            { 1000, 200, CompressionSpeed::Medium, 64 },
+            { 64, 64, CompressionSpeed::Slow, 128 }
+        };
+
+        struct ImageSize
+        {
+            uint32_t width;
+            uint32_t height;
+        };
+
+        // The sizes have tiles just below and above the 480 and 720 pixel superblock size thresholds.
+        static const ImageSize GridSizes[] =
+        {
+            { 1440, 720 }, { 1442, 722 }, { 1450, 730 }, { 1536, 1448 }, { 960, 480 },
+            { 962, 482 }, { 1000, 700 }, { 1920, 1080 }, { 4000, 3000 }
+        };
+
+        static const CompressionSpeed Speeds[] =
+        {
+            CompressionSpeed::Fast,
+            CompressionSpeed::Medium,
+            CompressionSpeed::Slow
+        };
+
+        static const int ThreadCounts[] = { 1, 16 };
+
+        int checkCount = 0;
+        int failureCount = 0;
+
+        for (const SuperblockCase& superblockCase : SuperblockCases)
+        {
+            const uint32_t superblockSize = GetSuperblockSize(superblockCase.width, superblockCase.height, superblockCase.speed);
+
+            checkCount++;
+
+            if (superblockSize != superblockCase.superblockSize)
+            {
+                failureCount++;
+                fprintf(stderr, "GetSuperblockSize %ux%u %s returned %u, libaom uses %u.\n",
+                    superblockCase.width, superblockCase.height, GetCompressionSpeedName(superblockCase.speed),
+                    superblockSize, superblockCase.superblockSize);
+            }
+        }
+
+        for (const ImageSize& size : GridSizes)
+        {
+            for (CompressionSpeed speed : Speeds)
+            {
+                for (int threads : ThreadCounts)
+                {
+                    for (const GridLayoutCandidate& candidate : GetGridLayoutCandidates(size.width, size.height, speed, threads, threads))
+                    {
+                        const ImageGridLayout& layout = candidate.layout;
+                        const uint32_t superblockSize = GetSuperblockSize(layout.tileWidth, layout.tileHeight, speed);
+                        const uint64_t gridWidth = static_cast<uint64_t>(layout.tileColumnCount) * layout.tileWidth;
+                        const uint64_t gridHeight = static_cast<uint64_t>(layout.tileRowCount) * layout.tileHeight;
+
+                        checkCount++;
+
+                        // The tiles must be aligned on the sides that have a tile boundary, and the tiles
+                        // in the last column and row must start inside the image.
+                        if ((layout.tileColumnCount > 1 && (layout.tileWidth % superblockSize) != 0) ||
+                            (layout.tileRowCount > 1 && (layout.tileHeight % superblockSize) != 0) ||
+                            gridWidth < size.width || gridHeight < size.height ||
+                            (gridWidth - layout.tileWidth) >= size.width || (gridHeight - layout.tileHeight) >= size.height)
+                        {
+                            failureCount++;
+                            fprintf(stderr, "The %s grid layout of a %ux%u image at the %s speed is not aligned to %u pixel superblocks.\n",
+                                FormatGridLayout(layout).c_str(), size.width, size.height, GetCompressionSpeedName(speed), superblockSize);
+                        }
+                    }
+                }
+            }
+        }
+
+        printf("%d of %d grid layout checks passed.\n", checkCount - failureCount, checkCount);
+
+        return failureCount;
+    }
+
+    // Encodes the image with the layout that SelectImageGridLayout chooses, the single tile layout and
+    // the other layouts with the lowest predicted encode time.
+    // The predicted encode time is relative to the single tile layout, so that it can be compared with
+    // the ratio of the measured times.
+    void MeasureGridLayouts(BenchmarkImage& image, const BenchmarkSettings& settings)
+    {
+        constexpr size_t MaxAlternativeLayouts = 4;
+
+        const BitmapData bitmap = image.GetBitmapData();
+        const CICPColorData colorInfo = GetColorInfo(YUVChromaSubsampling::Subsampling420);
+        const int poolConcurrency = ThreadPool::GetShared().GetConcurrencyLevel();
+
+        static const CompressionSpeed Speeds[] =
+        {
+            CompressionSpeed::Fast,
+            CompressionSpeed::Medium,
+            CompressionSpeed::Slow
+        };
+
+        for (CompressionSpeed speed : Speeds)
+        {
+            ImageGridLayout selectedLayout;
+            EncoderStatus encoderStatus = SelectImageGridLayout(image.width, image.height, speed, settings.maxThreads, &selectedLayout);
+            if (encoderStatus != EncoderStatus::Ok)
+            {
+                Fail("SelectImageGridLayout failed with status " + std::to_string(static_cast<int>(encoderStatus)) + ".");
+            }
+
+            std::vector<GridLayoutCandidate> candidates = GetGridLayoutCandidates(
+                image.width,
+                image.height,
+                speed,
+                settings.maxThreads,
+                poolConcurrency);
+
+            // The single tile layout is always the first candidate.
+            const GridLayoutCost singleTileCost = candidates[0].cost;
+
+            std::vector<GridLayoutCandidate> measuredLayouts;
+            measuredLayouts.push_back(candidates[0]);
+
+            std::stable_sort(candidates.begin(), candidates.end(), [](const GridLayoutCandidate& first, const GridLayoutCandidate& second)
+            {
+                return first.cost.encodeTime < second.cost.encodeTime;
+            });
+
+            size_t alternativeLayouts = 0;
+
+            for (const GridLayoutCandidate& candidate : candidates)
+            {
+                const bool isSelected = IsSameGridLayout(candidate.layout, selectedLayout);
+
+                if (IsSameGridLayout(candidate.layout, measuredLayouts[0].layout) ||
+                    (!isSelected && (!candidate.feasible || alternativeLayouts == MaxAlternativeLayouts)))
+                {
+                    continue;
+                }
+
+                measuredLayouts.push_back(candidate);
+
+                if (!isSelected)
+                {
+                    alternativeLayouts++;
+                }
+            }
+
+            EncoderOptions options;
+            options.quality = 85;
+            options.compressionSpeed = speed;
+            options.yuvFormat = YUVChromaSubsampling::Subsampling420;
+            options.maxThreads = settings.maxThreads;
+
+            EncoderSession* session;
+            encoderStatus = CreateEncoderSession(&options, &session);
+            if (encoderStatus != EncoderStatus::Ok)
+            {
+                Fail("CreateEncoderSession failed with status " + std::to_string(static_cast<int>(encoderStatus)) + ".");
+            }
+
+            std::unique_ptr<EncoderSession, void(AVIF_NATIVE_CALL*)(EncoderSession*)> sessionOwner(session, DestroyEncoderSession);
+
+            for (const GridLayoutCandidate& candidate : measuredLayouts)
+            {
+                const ImageGridLayout& layout = candidate.layout;
+                const size_t tileCount = static_cast<size_t>(layout.tileColumnCount) * layout.tileRowCount;
+                std::vector<void*> colorImages(tileCount);
+
+                const double encodeMilliseconds = MeasureMedianMilliseconds(settings.codecIterations, false, [&]()
+                {
+                    FreeOutputBuffers();
+                    std::fill(colorImages.begin(), colorImages.end(), nullptr);
+
+                    ProgressContext progressContext;
+                    progressContext.progressCallback = ReportProgress;
+                    progressContext.progressDone = 0;
+                    progressContext.progressTotal = static_cast<uint32_t>(tileCount * 3);
+
+                    if (tileCount == 1)
+                    {
+                        encoderStatus = CompressImage(session, &bitmap, &progressContext, colorInfo, AllocateOutput, &colorImages[0], nullptr, nullptr);
+                    }
+                    else
+                    {
+                        encoderStatus = CompressImageGrid(
+                            session,
+                            &bitmap,
+                            &layout,
+                            nullptr,
+                            nullptr,
+                            &progressContext,
+                            colorInfo,
+                            AllocateOutput,
+                            colorImages.data(),
+                            nullptr,
+                            IgnoreCompressedTile,
+                            nullptr);
+                    }
+                    if (encoderStatus != EncoderStatus::Ok)
+                    {
+                        Fail("Compressing the " + FormatGridLayout(layout) + " grid failed with status " +
+                             std::to_string(static_cast<int>(encoderStatus)) + ".");
+                    }
+                });
+
+                size_t compressedSize = 0;
+
+                for (void* colorImage : colorImages)
+                {
+                    compressedSize += GetOutputSize(colorImage);
+                }
+
+                BenchmarkResult result = CreateResult("ImageGridLayout", image, "4:2:0", 8, "", GetCompressionSpeedName(speed), settings.maxThreads,
+                                                      settings.codecIterations, encodeMilliseconds, compressedSize);
+                result.layout = FormatGridLayout(layout);
+                result.selectedLayout = IsSameGridLayout(layout, selectedLayout);
+                result.predictedEncodeTime = candidate.cost.encodeTime / singleTileCost.encodeTime;
+                result.predictedSizeOverhead = candidate.cost.sizeOverhead;
+
+                WriteResult(result);
+            }
+
+            FreeOutputBuffers();
+        }
+    }
+
+    int ParsePositiveInteger(const char* value)
+    {
+        char* end;
+        const long result = strtol(value, &end, 10);
+
+        if (*end != '\0' || result <= 0 || result > 1000000)
+        {
+            Fail(std::string("Invalid number: ") + value);
+        }
+
+        return static_cast<int>(result);
+    }
+
+    BenchmarkSettings ParseArguments(int argc, char** argv)
+    {
+        BenchmarkSettings settings;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string argument = argv[i];
+            const bool hasValue = (i + 1) < argc;
+
+            if (argument == "--size" && hasValue)
+            {
+                unsigned int width;
+                unsigned int height;
+
+                if (sscanf(argv[++i], "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+                {
+                    Fail(std::string("Invalid size: ") + argv[i]);
+                }
+
+                settings.syntheticWidth = width;
+                settings.syntheticHeight = height;
+            }
+            else if (argument == "--iterations" && hasValue)
+            {
+                settings.iterations = ParsePositiveInteger(argv[++i]);
+            }
+            else if (argument == "--codec-iterations" && hasValue)
+            {
+                settings.codecIterations = ParsePositiveInteger(argv[++i]);
+            }
+            else if (argument == "--threads" && hasValue)
+            {
+                settings.maxThreads = ParsePositiveInteger(argv[++i]);
+            }
+            else if (argument == "--no-codec")
+            {
+                settings.measureCodec = false;
+            }
+            else if (argument == "--grid")
+            {
+                settings.measureGridLayouts = true;
+            }
+            else if (argument == "--verify")
+            {
+                settings.verifyConversions = true;
+            }
+            else if (argument == "--help")
+            {
+                settings.showUsage = true;
+            }
+            else if (argument.size() > 1 && argument[0] == '-')
+            {
+                Fail("Unknown option: " + argument + "\n\n" + UsageText);
+            }
+            else
+            {
+                settings.corpusFiles.push_back(argument);
+            }
+        }
+
+        return settings;
+    }
+
+    void MeasureImage(BenchmarkImage& image, const BenchmarkSettings& settings)
+    {
+        MeasureEncodeConversions(image, settings);
+        MeasureDecodeConversions(image, settings);
+        MeasureTransformedDecodeConversions(image, settings);
+
+        if (settings.measureCodec)
+        {
+            MeasureCodec(image, settings);
+        }
+
+        if (settings.measureGridLayouts)
+        {
+            MeasureGridLayouts(image, settings);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const BenchmarkSettings settings = ParseArguments(argc, argv);
+
+        if (settings.showUsage)
+        {
+            fputs(UsageText, stdout);
+            return 0;
+        }
+
+        if (settings.verifyConversions)
+        {
+            const int conversionMismatches = VerifyEncodeConversions();
+            const int gridLayoutFailures = VerifyGridLayouts();
+
+            return conversionMismatches == 0 && gridLayoutFailures == 0 ? 0 : 2;
+        }
+
+        BenchmarkImage syntheticImage = CreateSyntheticImage(settings.syntheticWidth, settings.syntheticHeight);
+        MeasureImage(syntheticImage, settings);
+
+        for (const std::string& path : settings.corpusFiles)
+        {
+            BenchmarkImage corpusImage = LoadCorpusImage(path);
+            MeasureImage(corpusImage, settings);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
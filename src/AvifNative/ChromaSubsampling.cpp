@@ -40,12 +40,15 @@
 #include <stdint.h>
 #include <math.h>
 #include "ChromaSubsampling.h"
-#include "Memory.h"
+#include "ChromaSubsamplingSIMD.h"
+#include <string.h>
 #include "YUVConversionHelpers.h"
 #include <array>
+#include <stdlib.h>
 
 namespace
 {
+#if !AVIF_FIXED_POINT_YUV_CONVERSION
     struct ColorRgb24Float
     {
         float r;
@@ -90,40 +93,7 @@ namespace
 
         return  static_cast<uint8_t>(avifRoundf(v * 255.0f));
     }
-
-    uint32_t GetUVHeight(uint32_t imageHeight, aom_img_fmt_t aomFormat)
-    {
-        switch (aomFormat)
-        {
-        case AOM_IMG_FMT_I420:
-        case AOM_IMG_FMT_AOMI420:
-        case AOM_IMG_FMT_I42016:
-        case AOM_IMG_FMT_YV12:
-        case AOM_IMG_FMT_AOMYV12:
-        case AOM_IMG_FMT_YV1216:
-            return imageHeight / 2;
-        case AOM_IMG_FMT_I422:
-        case AOM_IMG_FMT_I42216:
-        case AOM_IMG_FMT_I444:
-        case AOM_IMG_FMT_I44416:
-            return imageHeight;
-        case AOM_IMG_FMT_NONE:
-        default:
-            return 0;
-        }
-    }
-
-    constexpr std::array<float, 256> BuildUint8ToFloatLookupTable()
-    {
-        std::array<float, 256> table = {};
-
-        for (size_t i = 0; i < table.size(); ++i)
-        {
-            table[i] = static_cast<float>(i) / 255.0f;
-        }
-
-        return table;
-    }
+#endif // !AVIF_FIXED_POINT_YUV_CONVERSION
 
     void ColorToIdentity8(
         const BitmapData* bgraImage,
@@ -158,9 +128,22 @@ namespace
         }
     }
 
+#if !AVIF_FIXED_POINT_YUV_CONVERSION
+    constexpr std::array<float, 256> BuildUint8ToFloatLookupTable()
+    {
+        std::array<float, 256> table = {};
+
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            table[i] = static_cast<float>(i) / 255.0f;
+        }
+
+        return table;
+    }
+
     void ColorToYUV8(
         const BitmapData* bgraImage,
-        const CICPColorData& colorInfo,
+        const YUVCoefficiants& yuvCoefficiants,
         YUVChromaSubsampling yuvFormat,
         uint8_t* yPlane,
         size_t yPlaneStride,
@@ -169,9 +152,6 @@ namespace
         uint8_t* vPlane,
         size_t vPlaneStride)
     {
-        YUVCoefficiants yuvCoefficiants;
-        GetYUVCoefficiants(colorInfo, yuvCoefficiants);
-
         const float kr = yuvCoefficiants.kr;
         const float kg = yuvCoefficiants.kg;
         const float kb = yuvCoefficiants.kb;
@@ -275,6 +255,155 @@ namespace
         }
     }
 
+#endif // !AVIF_FIXED_POINT_YUV_CONVERSION
+
+    uint8_t ClampToUInt8(int32_t value)
+    {
+        if (value < 0)
+        {
+            return 0;
+        }
+        else if (value > 255)
+        {
+            return 255;
+        }
+
+        return static_cast<uint8_t>(value);
+    }
+
+    // Converts the sums of the RGB values in a block of 2^sampleCountShift pixels to a chroma value,
+    // see FixedPointYUVCoefficiants for the rounding model.
+    uint8_t FixedPointChromaToUNorm(
+        int32_t coefficiantR,
+        int32_t coefficiantG,
+        int32_t coefficiantB,
+        int32_t sumR,
+        int32_t sumG,
+        int32_t sumB,
+        int sampleCountShift)
+    {
+        const int32_t offset = (128 << FixedPointPrecision) << sampleCountShift;
+        const int32_t value = (coefficiantR * sumR) + (coefficiantG * sumG) + (coefficiantB * sumB) + offset;
+
+        return ClampToUInt8(value >> (FixedPointPrecision + sampleCountShift));
+    }
+
+    // Converts the pixels in the specified rectangle of the image, startX and startY must be even.
+    void ColorToYUV8FixedPoint(
+        const BitmapData* bgraImage,
+        const FixedPointYUVCoefficiants& coefficiants,
+        YUVChromaSubsampling yuvFormat,
+        uint32_t startX,
+        uint32_t startY,
+        uint32_t endX,
+        uint32_t endY,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride)
+    {
+        for (size_t imageY = startY; imageY < endY; imageY += 2)
+        {
+            const size_t blockHeight = (imageY + 1) < endY ? 2 : 1;
+
+            for (size_t imageX = startX; imageX < endX; imageX += 2)
+            {
+                const size_t blockWidth = (imageX + 1) < endX ? 2 : 1;
+
+                int32_t blockSumR = 0;
+                int32_t blockSumG = 0;
+                int32_t blockSumB = 0;
+
+                for (size_t blockY = 0; blockY < blockHeight; ++blockY)
+                {
+                    const size_t y = imageY + blockY;
+                    const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride) + (imageX * sizeof(ColorBgra)));
+
+                    int32_t rowSumR = 0;
+                    int32_t rowSumG = 0;
+                    int32_t rowSumB = 0;
+
+                    for (size_t blockX = 0; blockX < blockWidth; ++blockX)
+                    {
+                        const size_t x = imageX + blockX;
+                        const int32_t r = src[blockX].r;
+                        const int32_t g = src[blockX].g;
+                        const int32_t b = src[blockX].b;
+
+                        // The Y coefficients are positive and sum to one, so the result is always in range.
+                        const int32_t Y = ((coefficiants.yR * r) + (coefficiants.yG * g) + (coefficiants.yB * b) + FixedPointHalf) >> FixedPointPrecision;
+                        yPlane[x + (y * yPlaneStride)] = static_cast<uint8_t>(Y);
+
+                        if (yuvFormat == YUVChromaSubsampling::Subsampling444)
+                        {
+                            uPlane[x + (y * uPlaneStride)] = FixedPointChromaToUNorm(coefficiants.uR, coefficiants.uG, coefficiants.uB, r, g, b, 0);
+                            vPlane[x + (y * vPlaneStride)] = FixedPointChromaToUNorm(coefficiants.vR, coefficiants.vG, coefficiants.vB, r, g, b, 0);
+                        }
+
+                        rowSumR += r;
+                        rowSumG += g;
+                        rowSumB += b;
+                    }
+
+                    if (yuvFormat == YUVChromaSubsampling::Subsampling422)
+                    {
+                        // YUV422, average 2 samples (1x2), twice
+                        const int sampleCountShift = static_cast<int>(blockWidth - 1);
+                        const size_t uvX = imageX >> 1;
+
+                        uPlane[uvX + (y * uPlaneStride)] = FixedPointChromaToUNorm(
+                            coefficiants.uR,
+                            coefficiants.uG,
+                            coefficiants.uB,
+                            rowSumR,
+                            rowSumG,
+                            rowSumB,
+                            sampleCountShift);
+                        vPlane[uvX + (y * vPlaneStride)] = FixedPointChromaToUNorm(
+                            coefficiants.vR,
+                            coefficiants.vG,
+                            coefficiants.vB,
+                            rowSumR,
+                            rowSumG,
+                            rowSumB,
+                            sampleCountShift);
+                    }
+
+                    blockSumR += rowSumR;
+                    blockSumG += rowSumG;
+                    blockSumB += rowSumB;
+                }
+
+                if (yuvFormat == YUVChromaSubsampling::Subsampling420)
+                {
+                    // YUV420, average 4 samples (2x2)
+                    const int sampleCountShift = static_cast<int>((blockWidth - 1) + (blockHeight - 1));
+                    const size_t uvX = imageX >> 1;
+                    const size_t uvY = imageY >> 1;
+
+                    uPlane[uvX + (uvY * uPlaneStride)] = FixedPointChromaToUNorm(
+                        coefficiants.uR,
+                        coefficiants.uG,
+                        coefficiants.uB,
+                        blockSumR,
+                        blockSumG,
+                        blockSumB,
+                        sampleCountShift);
+                    vPlane[uvX + (uvY * vPlaneStride)] = FixedPointChromaToUNorm(
+                        coefficiants.vR,
+                        coefficiants.vG,
+                        coefficiants.vB,
+                        blockSumR,
+                        blockSumG,
+                        blockSumB,
+                        sampleCountShift);
+                }
+            }
+        }
+    }
+
     void MonoToY8(
         const BitmapData* bgraImage,
         uint8_t* yPlane,
@@ -315,22 +444,222 @@ namespace
         }
     }
 
-    void ZeroUVPlanes(
-        uint32_t uvHeight,
+    void ConvertColorToIdentity8(
+        const BitmapData* bgraImage,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
         uint8_t* uPlane,
         size_t uPlaneStride,
         uint8_t* vPlane,
-        size_t vPlaneStride)
+        size_t vPlaneStride,
+        SimdLevel simdLevel)
     {
-        for (uint32_t y = 0; y < uvHeight; ++y)
+        switch (simdLevel)
         {
-            // Zero out U and V
-            memset(&uPlane[y * uPlaneStride], 0, uPlaneStride);
-            memset(&vPlane[y * vPlaneStride], 0, vPlaneStride);
+#if AVIF_X86_SIMD_SUPPORTED
+        case SimdLevel::AVX2:
+            ColorToIdentity8AVX2(bgraImage, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+            break;
+        case SimdLevel::SSE2:
+            ColorToIdentity8SSE2(bgraImage, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+            break;
+#endif
+        default:
+            ColorToIdentity8(bgraImage, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+            break;
         }
     }
-}
 
+    void ConvertColorToYUV8(
+        const BitmapData* bgraImage,
+        const CICPColorData& colorInfo,
+        YUVChromaSubsampling yuvFormat,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride,
+        SimdLevel simdLevel)
+    {
+        YUVCoefficiants yuvCoefficiants;
+        GetYUVCoefficiants(colorInfo, yuvCoefficiants);
+
+#if AVIF_FIXED_POINT_YUV_CONVERSION
+        FixedPointYUVCoefficiants fixedPointCoefficiants;
+        GetFixedPointYUVCoefficiants(yuvCoefficiants, fixedPointCoefficiants);
+
+        uint32_t vectorWidth = 0;
+        uint32_t vectorHeight = 0;
+
+#if AVIF_X86_SIMD_SUPPORTED
+        if (simdLevel != SimdLevel::None)
+        {
+            const uint32_t blockWidth = simdLevel == SimdLevel::AVX2 ? ColorToYUV8AVX2BlockWidth : ColorToYUV8SSE2BlockWidth;
+
+            vectorWidth = bgraImage->width - (bgraImage->width % blockWidth);
+            // The 4:2:0 kernels convert two rows at a time.
+            vectorHeight = yuvFormat == YUVChromaSubsampling::Subsampling420 ? bgraImage->height & ~1U : bgraImage->height;
+
+            if (simdLevel == SimdLevel::AVX2)
+            {
+                ColorToYUV8AVX2(
+                    bgraImage,
+                    vectorWidth,
+                    vectorHeight,
+                    fixedPointCoefficiants,
+                    yuvFormat,
+                    yPlane,
+                    yPlaneStride,
+                    uPlane,
+                    uPlaneStride,
+                    vPlane,
+                    vPlaneStride);
+            }
+            else
+            {
+                ColorToYUV8SSE2(
+                    bgraImage,
+                    vectorWidth,
+                    vectorHeight,
+                    fixedPointCoefficiants,
+                    yuvFormat,
+                    yPlane,
+                    yPlaneStride,
+                    uPlane,
+                    uPlaneStride,
+                    vPlane,
+                    vPlaneStride);
+            }
+        }
+#endif
+
+        // The scalar code converts the columns to the right of the vectorized region, and the last row
+        // of an image with an odd height when using 4:2:0 chroma subsampling.
+        ColorToYUV8FixedPoint(
+            bgraImage,
+            fixedPointCoefficiants,
+            yuvFormat,
+            vectorWidth,
+            0,
+            bgraImage->width,
+            vectorHeight,
+            yPlane,
+            yPlaneStride,
+            uPlane,
+            uPlaneStride,
+            vPlane,
+            vPlaneStride);
+        ColorToYUV8FixedPoint(
+            bgraImage,
+            fixedPointCoefficiants,
+            yuvFormat,
+            0,
+            vectorHeight,
+            bgraImage->width,
+            bgraImage->height,
+            yPlane,
+            yPlaneStride,
+            uPlane,
+            uPlaneStride,
+            vPlane,
+            vPlaneStride);
+#else
+        // The floating point conversion does not have a vectorized implementation.
+        (void)simdLevel;
+
+        ColorToYUV8(
+            bgraImage,
+            yuvCoefficiants,
+            yuvFormat,
+            yPlane,
+            yPlaneStride,
+            uPlane,
+            uPlaneStride,
+            vPlane,
+            vPlaneStride);
+#endif
+    }
+
+    void ConvertChannelToY8(
+        const BitmapData* bgraImage,
+        BgraChannel channel,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        SimdLevel simdLevel)
+    {
+        switch (simdLevel)
+        {
+#if AVIF_X86_SIMD_SUPPORTED
+        case SimdLevel::AVX2:
+            ChannelToY8AVX2(bgraImage, channel, yPlane, yPlaneStride);
+            break;
+        case SimdLevel::SSE2:
+            ChannelToY8SSE2(bgraImage, channel, yPlane, yPlaneStride);
+            break;
+#endif
+        default:
+            if (channel == BgraChannel::Alpha)
+            {
+                AlphaToY8(bgraImage, yPlane, yPlaneStride);
+            }
+            else
+            {
+                // Gray scale images store the same value in all of the color channels.
+                MonoToY8(bgraImage, yPlane, yPlaneStride);
+            }
+            break;
+        }
+    }
+
+    // The largest chroma row of an AV1 frame, the maximum frame width is 65536.
+    constexpr uint32_t MaxChromaRowSize = 32768;
+
+    // The chroma planes of every monochrome image point to this row with a stride of zero.
+    uint8_t sharedMonochromeChromaRow[MaxChromaRowSize];
+
+    // libaom does not have a YUV 4:0:0 image format, monochrome images use the YUV 4:2:0 format
+    // with the monochrome flag set, and the encoder only reads the luma plane of those images.
+    // The luma plane is wrapped in an image that shares a single row of zeros for the chroma planes,
+    // so the chroma planes are neither allocated nor cleared.
+    aom_image_t* CreateMonochromeAOMImage(uint32_t width, uint32_t height)
+    {
+        constexpr unsigned int strideAlignment = 16;
+
+        if (((width + 1) / 2) > MaxChromaRowSize)
+        {
+            return nullptr;
+        }
+
+        const size_t yPlaneStride = (static_cast<size_t>(width) + (strideAlignment - 1)) & ~static_cast<size_t>(strideAlignment - 1);
+
+        uint8_t* yPlane = static_cast<uint8_t*>(malloc(yPlaneStride * height));
+        if (!yPlane)
+        {
+            return nullptr;
+        }
+
+        aom_image_t* aomImage = aom_img_wrap(nullptr, AOM_IMG_FMT_I420, width, height, strideAlignment, yPlane);
+        if (!aomImage)
+        {
+            free(yPlane);
+            return nullptr;
+        }
+
+        // The luma plane is released by the ScopedAOMImage deleter.
+        aomImage->user_priv = yPlane;
+        aomImage->monochrome = 1;
+
+        aomImage->planes[AOM_PLANE_Y] = yPlane;
+        aomImage->stride[AOM_PLANE_Y] = static_cast<int>(yPlaneStride);
+        aomImage->planes[AOM_PLANE_U] = sharedMonochromeChromaRow;
+        aomImage->planes[AOM_PLANE_V] = sharedMonochromeChromaRow;
+        aomImage->stride[AOM_PLANE_U] = 0;
+        aomImage->stride[AOM_PLANE_V] = 0;
+
+        return aomImage;
+    }
+}
 
 aom_image_t* ConvertColorToAOMImage(
     const BitmapData* bgraImage,
@@ -338,14 +667,34 @@ aom_image_t* ConvertColorToAOMImage(
     YUVChromaSubsampling yuvFormat,
     aom_img_fmt aomFormat)
 {
-    aom_image_t* aomImage = aom_img_alloc(nullptr, aomFormat, bgraImage->width, bgraImage->height, 16);
+    return ConvertColorToAOMImage(bgraImage, colorInfo, yuvFormat, aomFormat, GetSupportedSimdLevel());
+}
+
+
+aom_image_t* ConvertColorToAOMImage(
+    const BitmapData* bgraImage,
+    const CICPColorData& colorInfo,
+    YUVChromaSubsampling yuvFormat,
+    aom_img_fmt aomFormat,
+    SimdLevel simdLevel)
+{
+    aom_image_t* aomImage;
+
+    if (yuvFormat == YUVChromaSubsampling::Subsampling400)
+    {
+        aomImage = CreateMonochromeAOMImage(bgraImage->width, bgraImage->height);
+    }
+    else
+    {
+        aomImage = aom_img_alloc(nullptr, aomFormat, bgraImage->width, bgraImage->height, 16);
+    }
+
     if (!aomImage)
     {
         return nullptr;
     }
 
     aomImage->range = AOM_CR_FULL_RANGE;
-    aomImage->monochrome = yuvFormat == YUVChromaSubsampling::Subsampling400;
 
     aomImage->cp = static_cast<aom_color_primaries_t>(colorInfo.colorPrimaries);
     aomImage->tc = static_cast<aom_transfer_characteristics_t>(colorInfo.transferCharacteristics);
@@ -353,19 +702,12 @@ aom_image_t* ConvertColorToAOMImage(
 
     if (aomImage->monochrome)
     {
-        MonoToY8(
+        ConvertChannelToY8(
             bgraImage,
+            BgraChannel::Red,
             reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_Y]),
-            static_cast<size_t>(aomImage->stride[AOM_PLANE_Y]));
-
-        const uint32_t uvHeight = GetUVHeight(bgraImage->height, aomFormat);
-
-        ZeroUVPlanes(
-            uvHeight,
-            reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_U]),
-            static_cast<size_t>(aomImage->stride[AOM_PLANE_U]),
-            reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_V]),
-            static_cast<size_t>(aomImage->stride[AOM_PLANE_V]));
+            static_cast<size_t>(aomImage->stride[AOM_PLANE_Y]),
+            simdLevel);
     }
     else
     {
@@ -374,18 +716,19 @@ aom_image_t* ConvertColorToAOMImage(
             // The IdentityMatrix format places the RGB values into the YUV planes
             // without any conversion.
             // This reduces the compression efficiency, but allows for fully lossless encoding.
-            ColorToIdentity8(
+            ConvertColorToIdentity8(
                 bgraImage,
                 reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_Y]),
                 static_cast<size_t>(aomImage->stride[AOM_PLANE_Y]),
                 reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_U]),
                 static_cast<size_t>(aomImage->stride[AOM_PLANE_U]),
                 reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_V]),
-                static_cast<size_t>(aomImage->stride[AOM_PLANE_V]));
+                static_cast<size_t>(aomImage->stride[AOM_PLANE_V]),
+                simdLevel);
         }
         else
         {
-            ColorToYUV8(
+            ConvertColorToYUV8(
                 bgraImage,
                 colorInfo,
                 yuvFormat,
@@ -394,7 +737,8 @@ aom_image_t* ConvertColorToAOMImage(
                 reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_U]),
                 static_cast<size_t>(aomImage->stride[AOM_PLANE_U]),
                 reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_V]),
-                static_cast<size_t>(aomImage->stride[AOM_PLANE_V]));
+                static_cast<size_t>(aomImage->stride[AOM_PLANE_V]),
+                simdLevel);
         }
     }
 
@@ -403,38 +747,30 @@ aom_image_t* ConvertColorToAOMImage(
 
 aom_image_t* ConvertAlphaToAOMImage(const BitmapData* bgraImage)
 {
-    // Chroma sub-sampling does not matter for the alpha channel
-    // YUV 4:0:0 would be a better format for the alpha image than YUV 4:2:0,
-    // but it appears that libaom does not currently support it.
-
-    constexpr aom_img_fmt aomFormat = AOM_IMG_FMT_I420;
+    return ConvertAlphaToAOMImage(bgraImage, GetSupportedSimdLevel());
+}
 
-    aom_image_t* aomImage = aom_img_alloc(nullptr, aomFormat, bgraImage->width, bgraImage->height, 16);
+aom_image_t* ConvertAlphaToAOMImage(const BitmapData* bgraImage, SimdLevel simdLevel)
+{
+    // The alpha image is encoded as a monochrome image, only the luma plane is allocated.
+    aom_image_t* aomImage = CreateMonochromeAOMImage(bgraImage->width, bgraImage->height);
     if (!aomImage)
     {
         return nullptr;
     }
 
     aomImage->range = AOM_CR_FULL_RANGE;
-    aomImage->monochrome = 1;
 
     aomImage->cp = AOM_CICP_CP_UNSPECIFIED;
     aomImage->tc = AOM_CICP_TC_UNSPECIFIED;
     aomImage->mc = AOM_CICP_MC_UNSPECIFIED;
 
-    AlphaToY8(
+    ConvertChannelToY8(
         bgraImage,
+        BgraChannel::Alpha,
         reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_Y]),
-        static_cast<size_t>(aomImage->stride[AOM_PLANE_Y]));
-
-    const uint32_t uvHeight = GetUVHeight(bgraImage->height, aomFormat);
-
-    ZeroUVPlanes(
-        uvHeight,
-        reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_U]),
-        static_cast<size_t>(aomImage->stride[AOM_PLANE_U]),
-        reinterpret_cast<uint8_t*>(aomImage->planes[AOM_PLANE_V]),
-        static_cast<size_t>(aomImage->stride[AOM_PLANE_V]));
+        static_cast<size_t>(aomImage->stride[AOM_PLANE_Y]),
+        simdLevel);
 
     return aomImage;
 }
@@ -13,6 +13,7 @@
 #pragma once
 
 #include "AvifNative.h"
+#include "CpuFeatures.h"
 #include "aom/aom_image.h"
 
 aom_image_t* ConvertColorToAOMImage(
@@ -21,4 +22,15 @@ aom_image_t* ConvertColorToAOMImage(
     YUVChromaSubsampling yuvFormat,
     aom_img_fmt aomFormat);
 
+// Converts the image using the specified instruction set, SimdLevel::None selects the scalar reference implementation.
+// The output is identical for every instruction set.
+aom_image_t* ConvertColorToAOMImage(
+    const BitmapData* bgraImage,
+    const CICPColorData& colorInfo,
+    YUVChromaSubsampling yuvFormat,
+    aom_img_fmt aomFormat,
+    SimdLevel simdLevel);
+
 aom_image_t* ConvertAlphaToAOMImage(const BitmapData* bgraImage);
+
+aom_image_t* ConvertAlphaToAOMImage(const BitmapData* bgraImage, SimdLevel simdLevel);
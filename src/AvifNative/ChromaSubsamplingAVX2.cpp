@@ -0,0 +1,396 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ChromaSubsamplingSIMD.h"
+
+#if AVIF_X86_SIMD_SUPPORTED
+
+#include <immintrin.h>
+
+// The functions in this file must only be called when GetSupportedSimdLevel() returns SimdLevel::AVX2.
+
+namespace
+{
+    struct YUVConstants
+    {
+        __m256i yR;
+        __m256i yG;
+        __m256i yB;
+        __m256i uR;
+        __m256i uG;
+        __m256i uB;
+        __m256i vR;
+        __m256i vG;
+        __m256i vB;
+    };
+
+    // The coefficients are stored in the low 16 bits of each 32-bit lane, so that _mm256_madd_epi16
+    // multiplies them with the 32-bit channel values that are less than 2^15.
+    __m256i SetCoefficiant(int32_t value)
+    {
+        return _mm256_set1_epi32(value & 0xffff);
+    }
+
+    YUVConstants GetYUVConstants(const FixedPointYUVCoefficiants& coefficiants)
+    {
+        YUVConstants constants;
+
+        constants.yR = SetCoefficiant(coefficiants.yR);
+        constants.yG = SetCoefficiant(coefficiants.yG);
+        constants.yB = SetCoefficiant(coefficiants.yB);
+        constants.uR = SetCoefficiant(coefficiants.uR);
+        constants.uG = SetCoefficiant(coefficiants.uG);
+        constants.uB = SetCoefficiant(coefficiants.uB);
+        constants.vR = SetCoefficiant(coefficiants.vR);
+        constants.vG = SetCoefficiant(coefficiants.vG);
+        constants.vB = SetCoefficiant(coefficiants.vB);
+
+        return constants;
+    }
+
+    __m256i ExtractChannel(__m256i pixels, BgraChannel channel)
+    {
+        const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(channel) * 8);
+
+        return _mm256_and_si256(_mm256_srl_epi32(pixels, shift), _mm256_set1_epi32(0xff));
+    }
+
+    void LoadChannels(const ColorBgra* src, __m256i& r, __m256i& g, __m256i& b)
+    {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+
+        r = ExtractChannel(pixels, BgraChannel::Red);
+        g = ExtractChannel(pixels, BgraChannel::Green);
+        b = ExtractChannel(pixels, BgraChannel::Blue);
+    }
+
+    __m256i DotProduct(__m256i r, __m256i g, __m256i b, __m256i coefficiantR, __m256i coefficiantG, __m256i coefficiantB)
+    {
+        return _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(r, coefficiantR), _mm256_madd_epi16(g, coefficiantG)), _mm256_madd_epi16(b, coefficiantB));
+    }
+
+    __m256i ConvertLuma(const YUVConstants& constants, __m256i r, __m256i g, __m256i b)
+    {
+        const __m256i value = DotProduct(r, g, b, constants.yR, constants.yG, constants.yB);
+
+        return _mm256_srli_epi32(_mm256_add_epi32(value, _mm256_set1_epi32(FixedPointHalf)), FixedPointPrecision);
+    }
+
+    // Converts the sums of 2^SampleCountShift pixels to chroma values, the results are clamped when they are packed.
+    template <int SampleCountShift>
+    __m256i ConvertChroma(__m256i r, __m256i g, __m256i b, __m256i coefficiantR, __m256i coefficiantG, __m256i coefficiantB)
+    {
+        const __m256i offset = _mm256_set1_epi32((128 << FixedPointPrecision) << SampleCountShift);
+        const __m256i value = DotProduct(r, g, b, coefficiantR, coefficiantG, coefficiantB);
+
+        return _mm256_srai_epi32(_mm256_add_epi32(value, offset), FixedPointPrecision + SampleCountShift);
+    }
+
+    __m128i PackWords(__m256i values)
+    {
+        return _mm_packs_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+    }
+
+    // Packs 16 32-bit values with unsigned saturation and stores them as bytes.
+    void Store16(uint8_t* dst, __m256i lo, __m256i hi)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(PackWords(lo), PackWords(hi)));
+    }
+
+    void Store8(uint8_t* dst, __m256i values)
+    {
+        const __m128i words = PackWords(values);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(words, words));
+    }
+
+    // Adds the horizontally adjacent values in 16 consecutive columns.
+    __m256i SumColumnPairs(__m256i lo, __m256i hi)
+    {
+        const __m256 loBits = _mm256_castsi256_ps(lo);
+        const __m256 hiBits = _mm256_castsi256_ps(hi);
+
+        const __m256i even = _mm256_castps_si256(_mm256_shuffle_ps(loBits, hiBits, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m256i odd = _mm256_castps_si256(_mm256_shuffle_ps(loBits, hiBits, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        // The shuffle operates within each 128-bit lane, so the sums are in the order 0, 1, 4, 5, 2, 3, 6, 7.
+        return _mm256_permute4x64_epi64(_mm256_add_epi32(even, odd), _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    // Converts 16 pixels to Y and returns their RGB values for the chroma conversion.
+    void ConvertRow16(
+        const YUVConstants& constants,
+        const ColorBgra* src,
+        uint8_t* dstY,
+        __m256i (&r)[2],
+        __m256i (&g)[2],
+        __m256i (&b)[2])
+    {
+        LoadChannels(src, r[0], g[0], b[0]);
+        LoadChannels(src + 8, r[1], g[1], b[1]);
+
+        Store16(dstY, ConvertLuma(constants, r[0], g[0], b[0]), ConvertLuma(constants, r[1], g[1], b[1]));
+    }
+
+    void ColorToYUV8444(
+        const BitmapData* bgraImage,
+        uint32_t width,
+        uint32_t height,
+        const YUVConstants& constants,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride)
+    {
+        for (size_t y = 0; y < height; ++y)
+        {
+            const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+            uint8_t* dstY = &yPlane[y * yPlaneStride];
+            uint8_t* dstU = &uPlane[y * uPlaneStride];
+            uint8_t* dstV = &vPlane[y * vPlaneStride];
+
+            for (size_t x = 0; x < width; x += 16)
+            {
+                __m256i r[2];
+                __m256i g[2];
+                __m256i b[2];
+
+                ConvertRow16(constants, src + x, dstY + x, r, g, b);
+
+                Store16(
+                    dstU + x,
+                    ConvertChroma<0>(r[0], g[0], b[0], constants.uR, constants.uG, constants.uB),
+                    ConvertChroma<0>(r[1], g[1], b[1], constants.uR, constants.uG, constants.uB));
+                Store16(
+                    dstV + x,
+                    ConvertChroma<0>(r[0], g[0], b[0], constants.vR, constants.vG, constants.vB),
+                    ConvertChroma<0>(r[1], g[1], b[1], constants.vR, constants.vG, constants.vB));
+            }
+        }
+    }
+
+    void ColorToYUV8422(
+        const BitmapData* bgraImage,
+        uint32_t width,
+        uint32_t height,
+        const YUVConstants& constants,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride)
+    {
+        for (size_t y = 0; y < height; ++y)
+        {
+            const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+            uint8_t* dstY = &yPlane[y * yPlaneStride];
+            uint8_t* dstU = &uPlane[y * uPlaneStride];
+            uint8_t* dstV = &vPlane[y * vPlaneStride];
+
+            for (size_t x = 0; x < width; x += 16)
+            {
+                __m256i r[2];
+                __m256i g[2];
+                __m256i b[2];
+
+                ConvertRow16(constants, src + x, dstY + x, r, g, b);
+
+                const __m256i sumR = SumColumnPairs(r[0], r[1]);
+                const __m256i sumG = SumColumnPairs(g[0], g[1]);
+                const __m256i sumB = SumColumnPairs(b[0], b[1]);
+
+                Store8(dstU + (x >> 1), ConvertChroma<1>(sumR, sumG, sumB, constants.uR, constants.uG, constants.uB));
+                Store8(dstV + (x >> 1), ConvertChroma<1>(sumR, sumG, sumB, constants.vR, constants.vG, constants.vB));
+            }
+        }
+    }
+
+    void ColorToYUV8420(
+        const BitmapData* bgraImage,
+        uint32_t width,
+        uint32_t height,
+        const YUVConstants& constants,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride)
+    {
+        for (size_t y = 0; y < height; y += 2)
+        {
+            const ColorBgra* src0 = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+            const ColorBgra* src1 = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + ((y + 1) * bgraImage->stride));
+            uint8_t* dstY0 = &yPlane[y * yPlaneStride];
+            uint8_t* dstY1 = &yPlane[(y + 1) * yPlaneStride];
+            uint8_t* dstU = &uPlane[(y >> 1) * uPlaneStride];
+            uint8_t* dstV = &vPlane[(y >> 1) * vPlaneStride];
+
+            for (size_t x = 0; x < width; x += 16)
+            {
+                __m256i r0[2];
+                __m256i g0[2];
+                __m256i b0[2];
+                __m256i r1[2];
+                __m256i g1[2];
+                __m256i b1[2];
+
+                ConvertRow16(constants, src0 + x, dstY0 + x, r0, g0, b0);
+                ConvertRow16(constants, src1 + x, dstY1 + x, r1, g1, b1);
+
+                const __m256i sumR = SumColumnPairs(_mm256_add_epi32(r0[0], r1[0]), _mm256_add_epi32(r0[1], r1[1]));
+                const __m256i sumG = SumColumnPairs(_mm256_add_epi32(g0[0], g1[0]), _mm256_add_epi32(g0[1], g1[1]));
+                const __m256i sumB = SumColumnPairs(_mm256_add_epi32(b0[0], b1[0]), _mm256_add_epi32(b0[1], b1[1]));
+
+                Store8(dstU + (x >> 1), ConvertChroma<2>(sumR, sumG, sumB, constants.uR, constants.uG, constants.uB));
+                Store8(dstV + (x >> 1), ConvertChroma<2>(sumR, sumG, sumB, constants.vR, constants.vG, constants.vB));
+            }
+        }
+    }
+
+    // Extracts one channel from 32 pixels.
+    __m256i PackChannel32(const __m256i (&pixels)[4], BgraChannel channel)
+    {
+        const __m256i words01 = _mm256_packs_epi32(ExtractChannel(pixels[0], channel), ExtractChannel(pixels[1], channel));
+        const __m256i words23 = _mm256_packs_epi32(ExtractChannel(pixels[2], channel), ExtractChannel(pixels[3], channel));
+        const __m256i bytes = _mm256_packus_epi16(words01, words23);
+
+        // The packing operates within each 128-bit lane, so the 32-bit groups
+        // are in the order 0, 2, 4, 6, 1, 3, 5, 7.
+        return _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+
+    void LoadPixels32(const ColorBgra* src, __m256i (&pixels)[4])
+    {
+        for (size_t i = 0; i < 4; ++i)
+        {
+            pixels[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + (i * 8)));
+        }
+    }
+
+    uint8_t GetChannel(const ColorBgra& pixel, BgraChannel channel)
+    {
+        return reinterpret_cast<const uint8_t*>(&pixel)[static_cast<size_t>(channel)];
+    }
+}
+
+void ColorToYUV8AVX2(
+    const BitmapData* bgraImage,
+    uint32_t width,
+    uint32_t height,
+    const FixedPointYUVCoefficiants& coefficiants,
+    YUVChromaSubsampling yuvFormat,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride)
+{
+    const YUVConstants constants = GetYUVConstants(coefficiants);
+
+    switch (yuvFormat)
+    {
+    case YUVChromaSubsampling::Subsampling420:
+        ColorToYUV8420(bgraImage, width, height, constants, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+        break;
+    case YUVChromaSubsampling::Subsampling422:
+        ColorToYUV8422(bgraImage, width, height, constants, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+        break;
+    case YUVChromaSubsampling::Subsampling444:
+        ColorToYUV8444(bgraImage, width, height, constants, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+        break;
+    default:
+        break;
+    }
+
+    // Avoid the AVX to SSE transition penalty in the code that runs after this function.
+    _mm256_zeroupper();
+}
+
+void ColorToIdentity8AVX2(
+    const BitmapData* bgraImage,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride)
+{
+    const size_t vectorWidth = bgraImage->width & ~static_cast<size_t>(31);
+
+    for (size_t y = 0; y < bgraImage->height; ++y)
+    {
+        const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+        uint8_t* dstY = &yPlane[y * yPlaneStride];
+        uint8_t* dstU = &uPlane[y * uPlaneStride];
+        uint8_t* dstV = &vPlane[y * vPlaneStride];
+
+        size_t x = 0;
+
+        for (; x < vectorWidth; x += 32)
+        {
+            __m256i pixels[4];
+            LoadPixels32(src + x, pixels);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstY + x), PackChannel32(pixels, BgraChannel::Green));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstU + x), PackChannel32(pixels, BgraChannel::Blue));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstV + x), PackChannel32(pixels, BgraChannel::Red));
+        }
+
+        for (; x < bgraImage->width; ++x)
+        {
+            dstY[x] = src[x].g;
+            dstU[x] = src[x].b;
+            dstV[x] = src[x].r;
+        }
+    }
+
+    _mm256_zeroupper();
+}
+
+void ChannelToY8AVX2(
+    const BitmapData* bgraImage,
+    BgraChannel channel,
+    uint8_t* yPlane,
+    size_t yPlaneStride)
+{
+    const size_t vectorWidth = bgraImage->width & ~static_cast<size_t>(31);
+
+    for (size_t y = 0; y < bgraImage->height; ++y)
+    {
+        const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+        uint8_t* dst = &yPlane[y * yPlaneStride];
+
+        size_t x = 0;
+
+        for (; x < vectorWidth; x += 32)
+        {
+            __m256i pixels[4];
+            LoadPixels32(src + x, pixels);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), PackChannel32(pixels, channel));
+        }
+
+        for (; x < bgraImage->width; ++x)
+        {
+            dst[x] = GetChannel(src[x], channel);
+        }
+    }
+
+    _mm256_zeroupper();
+}
+
+#endif // AVIF_X86_SIMD_SUPPORTED
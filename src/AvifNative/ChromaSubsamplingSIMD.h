@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AvifNative.h"
+#include "CpuFeatures.h"
+#include "YUVConversionHelpers.h"
+
+// The index of a channel in the ColorBgra structure.
+enum class BgraChannel
+{
+    Blue = 0,
+    Green,
+    Red,
+    Alpha
+};
+
+#if AVIF_X86_SIMD_SUPPORTED
+
+// The number of columns that the RGB to YUV kernels convert per iteration.
+constexpr uint32_t ColorToYUV8SSE2BlockWidth = 8;
+constexpr uint32_t ColorToYUV8AVX2BlockWidth = 16;
+
+// The RGB to YUV kernels produce the same output as the scalar fixed-point conversion in ChromaSubsampling.cpp.
+// They only convert the top-left width x height region of the image, the width must be a multiple
+// of the kernel block width and the height must be even when using 4:2:0 chroma subsampling.
+void ColorToYUV8SSE2(
+    const BitmapData* bgraImage,
+    uint32_t width,
+    uint32_t height,
+    const FixedPointYUVCoefficiants& coefficiants,
+    YUVChromaSubsampling yuvFormat,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride);
+
+void ColorToYUV8AVX2(
+    const BitmapData* bgraImage,
+    uint32_t width,
+    uint32_t height,
+    const FixedPointYUVCoefficiants& coefficiants,
+    YUVChromaSubsampling yuvFormat,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride);
+
+// The identity and single channel kernels convert the whole image.
+
+void ColorToIdentity8SSE2(
+    const BitmapData* bgraImage,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride);
+
+void ColorToIdentity8AVX2(
+    const BitmapData* bgraImage,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride);
+
+void ChannelToY8SSE2(
+    const BitmapData* bgraImage,
+    BgraChannel channel,
+    uint8_t* yPlane,
+    size_t yPlaneStride);
+
+void ChannelToY8AVX2(
+    const BitmapData* bgraImage,
+    BgraChannel channel,
+    uint8_t* yPlane,
+    size_t yPlaneStride);
+
+#endif // AVIF_X86_SIMD_SUPPORTED
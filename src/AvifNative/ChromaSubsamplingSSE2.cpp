@@ -0,0 +1,382 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ChromaSubsamplingSIMD.h"
+
+#if AVIF_X86_SIMD_SUPPORTED
+
+#include <string.h>
+#include <emmintrin.h>
+
+namespace
+{
+    struct YUVConstants
+    {
+        __m128i yR;
+        __m128i yG;
+        __m128i yB;
+        __m128i uR;
+        __m128i uG;
+        __m128i uB;
+        __m128i vR;
+        __m128i vG;
+        __m128i vB;
+    };
+
+    // The coefficients are stored in the low 16 bits of each 32-bit lane, so that _mm_madd_epi16
+    // multiplies them with the 32-bit channel values that are less than 2^15.
+    __m128i SetCoefficiant(int32_t value)
+    {
+        return _mm_set1_epi32(value & 0xffff);
+    }
+
+    YUVConstants GetYUVConstants(const FixedPointYUVCoefficiants& coefficiants)
+    {
+        YUVConstants constants;
+
+        constants.yR = SetCoefficiant(coefficiants.yR);
+        constants.yG = SetCoefficiant(coefficiants.yG);
+        constants.yB = SetCoefficiant(coefficiants.yB);
+        constants.uR = SetCoefficiant(coefficiants.uR);
+        constants.uG = SetCoefficiant(coefficiants.uG);
+        constants.uB = SetCoefficiant(coefficiants.uB);
+        constants.vR = SetCoefficiant(coefficiants.vR);
+        constants.vG = SetCoefficiant(coefficiants.vG);
+        constants.vB = SetCoefficiant(coefficiants.vB);
+
+        return constants;
+    }
+
+    __m128i ExtractChannel(__m128i pixels, BgraChannel channel)
+    {
+        const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(channel) * 8);
+
+        return _mm_and_si128(_mm_srl_epi32(pixels, shift), _mm_set1_epi32(0xff));
+    }
+
+    void LoadChannels(const ColorBgra* src, __m128i& r, __m128i& g, __m128i& b)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+
+        r = ExtractChannel(pixels, BgraChannel::Red);
+        g = ExtractChannel(pixels, BgraChannel::Green);
+        b = ExtractChannel(pixels, BgraChannel::Blue);
+    }
+
+    __m128i DotProduct(__m128i r, __m128i g, __m128i b, __m128i coefficiantR, __m128i coefficiantG, __m128i coefficiantB)
+    {
+        return _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(r, coefficiantR), _mm_madd_epi16(g, coefficiantG)), _mm_madd_epi16(b, coefficiantB));
+    }
+
+    __m128i ConvertLuma(const YUVConstants& constants, __m128i r, __m128i g, __m128i b)
+    {
+        const __m128i value = DotProduct(r, g, b, constants.yR, constants.yG, constants.yB);
+
+        return _mm_srli_epi32(_mm_add_epi32(value, _mm_set1_epi32(FixedPointHalf)), FixedPointPrecision);
+    }
+
+    // Converts the sums of 2^SampleCountShift pixels to chroma values, the results are clamped when they are packed.
+    template <int SampleCountShift>
+    __m128i ConvertChroma(__m128i r, __m128i g, __m128i b, __m128i coefficiantR, __m128i coefficiantG, __m128i coefficiantB)
+    {
+        const __m128i offset = _mm_set1_epi32((128 << FixedPointPrecision) << SampleCountShift);
+        const __m128i value = DotProduct(r, g, b, coefficiantR, coefficiantG, coefficiantB);
+
+        return _mm_srai_epi32(_mm_add_epi32(value, offset), FixedPointPrecision + SampleCountShift);
+    }
+
+    // Packs 8 32-bit values with unsigned saturation and stores them as bytes.
+    void Store8(uint8_t* dst, __m128i lo, __m128i hi)
+    {
+        const __m128i words = _mm_packs_epi32(lo, hi);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(words, words));
+    }
+
+    void Store4(uint8_t* dst, __m128i values)
+    {
+        const __m128i words = _mm_packs_epi32(values, values);
+        const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+
+        memcpy(dst, &bytes, sizeof(bytes));
+    }
+
+    // Adds the horizontally adjacent values in 8 consecutive columns.
+    __m128i SumColumnPairs(__m128i lo, __m128i hi)
+    {
+        const __m128 loBits = _mm_castsi128_ps(lo);
+        const __m128 hiBits = _mm_castsi128_ps(hi);
+
+        const __m128i even = _mm_castps_si128(_mm_shuffle_ps(loBits, hiBits, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(loBits, hiBits, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        return _mm_add_epi32(even, odd);
+    }
+
+    // Converts 8 pixels to Y and returns their RGB values for the chroma conversion.
+    void ConvertRow8(
+        const YUVConstants& constants,
+        const ColorBgra* src,
+        uint8_t* dstY,
+        __m128i (&r)[2],
+        __m128i (&g)[2],
+        __m128i (&b)[2])
+    {
+        LoadChannels(src, r[0], g[0], b[0]);
+        LoadChannels(src + 4, r[1], g[1], b[1]);
+
+        Store8(dstY, ConvertLuma(constants, r[0], g[0], b[0]), ConvertLuma(constants, r[1], g[1], b[1]));
+    }
+
+    void ColorToYUV8444(
+        const BitmapData* bgraImage,
+        uint32_t width,
+        uint32_t height,
+        const YUVConstants& constants,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride)
+    {
+        for (size_t y = 0; y < height; ++y)
+        {
+            const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+            uint8_t* dstY = &yPlane[y * yPlaneStride];
+            uint8_t* dstU = &uPlane[y * uPlaneStride];
+            uint8_t* dstV = &vPlane[y * vPlaneStride];
+
+            for (size_t x = 0; x < width; x += 8)
+            {
+                __m128i r[2];
+                __m128i g[2];
+                __m128i b[2];
+
+                ConvertRow8(constants, src + x, dstY + x, r, g, b);
+
+                Store8(
+                    dstU + x,
+                    ConvertChroma<0>(r[0], g[0], b[0], constants.uR, constants.uG, constants.uB),
+                    ConvertChroma<0>(r[1], g[1], b[1], constants.uR, constants.uG, constants.uB));
+                Store8(
+                    dstV + x,
+                    ConvertChroma<0>(r[0], g[0], b[0], constants.vR, constants.vG, constants.vB),
+                    ConvertChroma<0>(r[1], g[1], b[1], constants.vR, constants.vG, constants.vB));
+            }
+        }
+    }
+
+    void ColorToYUV8422(
+        const BitmapData* bgraImage,
+        uint32_t width,
+        uint32_t height,
+        const YUVConstants& constants,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride)
+    {
+        for (size_t y = 0; y < height; ++y)
+        {
+            const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+            uint8_t* dstY = &yPlane[y * yPlaneStride];
+            uint8_t* dstU = &uPlane[y * uPlaneStride];
+            uint8_t* dstV = &vPlane[y * vPlaneStride];
+
+            for (size_t x = 0; x < width; x += 8)
+            {
+                __m128i r[2];
+                __m128i g[2];
+                __m128i b[2];
+
+                ConvertRow8(constants, src + x, dstY + x, r, g, b);
+
+                const __m128i sumR = SumColumnPairs(r[0], r[1]);
+                const __m128i sumG = SumColumnPairs(g[0], g[1]);
+                const __m128i sumB = SumColumnPairs(b[0], b[1]);
+
+                Store4(dstU + (x >> 1), ConvertChroma<1>(sumR, sumG, sumB, constants.uR, constants.uG, constants.uB));
+                Store4(dstV + (x >> 1), ConvertChroma<1>(sumR, sumG, sumB, constants.vR, constants.vG, constants.vB));
+            }
+        }
+    }
+
+    void ColorToYUV8420(
+        const BitmapData* bgraImage,
+        uint32_t width,
+        uint32_t height,
+        const YUVConstants& constants,
+        uint8_t* yPlane,
+        size_t yPlaneStride,
+        uint8_t* uPlane,
+        size_t uPlaneStride,
+        uint8_t* vPlane,
+        size_t vPlaneStride)
+    {
+        for (size_t y = 0; y < height; y += 2)
+        {
+            const ColorBgra* src0 = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+            const ColorBgra* src1 = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + ((y + 1) * bgraImage->stride));
+            uint8_t* dstY0 = &yPlane[y * yPlaneStride];
+            uint8_t* dstY1 = &yPlane[(y + 1) * yPlaneStride];
+            uint8_t* dstU = &uPlane[(y >> 1) * uPlaneStride];
+            uint8_t* dstV = &vPlane[(y >> 1) * vPlaneStride];
+
+            for (size_t x = 0; x < width; x += 8)
+            {
+                __m128i r0[2];
+                __m128i g0[2];
+                __m128i b0[2];
+                __m128i r1[2];
+                __m128i g1[2];
+                __m128i b1[2];
+
+                ConvertRow8(constants, src0 + x, dstY0 + x, r0, g0, b0);
+                ConvertRow8(constants, src1 + x, dstY1 + x, r1, g1, b1);
+
+                const __m128i sumR = SumColumnPairs(_mm_add_epi32(r0[0], r1[0]), _mm_add_epi32(r0[1], r1[1]));
+                const __m128i sumG = SumColumnPairs(_mm_add_epi32(g0[0], g1[0]), _mm_add_epi32(g0[1], g1[1]));
+                const __m128i sumB = SumColumnPairs(_mm_add_epi32(b0[0], b1[0]), _mm_add_epi32(b0[1], b1[1]));
+
+                Store4(dstU + (x >> 1), ConvertChroma<2>(sumR, sumG, sumB, constants.uR, constants.uG, constants.uB));
+                Store4(dstV + (x >> 1), ConvertChroma<2>(sumR, sumG, sumB, constants.vR, constants.vG, constants.vB));
+            }
+        }
+    }
+
+    // Extracts one channel from 16 pixels.
+    __m128i PackChannel16(const __m128i (&pixels)[4], BgraChannel channel)
+    {
+        const __m128i lo = _mm_packs_epi32(ExtractChannel(pixels[0], channel), ExtractChannel(pixels[1], channel));
+        const __m128i hi = _mm_packs_epi32(ExtractChannel(pixels[2], channel), ExtractChannel(pixels[3], channel));
+
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    void LoadPixels16(const ColorBgra* src, __m128i (&pixels)[4])
+    {
+        for (size_t i = 0; i < 4; ++i)
+        {
+            pixels[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 4)));
+        }
+    }
+
+    uint8_t GetChannel(const ColorBgra& pixel, BgraChannel channel)
+    {
+        return reinterpret_cast<const uint8_t*>(&pixel)[static_cast<size_t>(channel)];
+    }
+}
+
+void ColorToYUV8SSE2(
+    const BitmapData* bgraImage,
+    uint32_t width,
+    uint32_t height,
+    const FixedPointYUVCoefficiants& coefficiants,
+    YUVChromaSubsampling yuvFormat,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride)
+{
+    const YUVConstants constants = GetYUVConstants(coefficiants);
+
+    switch (yuvFormat)
+    {
+    case YUVChromaSubsampling::Subsampling420:
+        ColorToYUV8420(bgraImage, width, height, constants, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+        break;
+    case YUVChromaSubsampling::Subsampling422:
+        ColorToYUV8422(bgraImage, width, height, constants, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+        break;
+    case YUVChromaSubsampling::Subsampling444:
+        ColorToYUV8444(bgraImage, width, height, constants, yPlane, yPlaneStride, uPlane, uPlaneStride, vPlane, vPlaneStride);
+        break;
+    default:
+        break;
+    }
+}
+
+void ColorToIdentity8SSE2(
+    const BitmapData* bgraImage,
+    uint8_t* yPlane,
+    size_t yPlaneStride,
+    uint8_t* uPlane,
+    size_t uPlaneStride,
+    uint8_t* vPlane,
+    size_t vPlaneStride)
+{
+    const size_t vectorWidth = bgraImage->width & ~static_cast<size_t>(15);
+
+    for (size_t y = 0; y < bgraImage->height; ++y)
+    {
+        const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+        uint8_t* dstY = &yPlane[y * yPlaneStride];
+        uint8_t* dstU = &uPlane[y * uPlaneStride];
+        uint8_t* dstV = &vPlane[y * vPlaneStride];
+
+        size_t x = 0;
+
+        for (; x < vectorWidth; x += 16)
+        {
+            __m128i pixels[4];
+            LoadPixels16(src + x, pixels);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstY + x), PackChannel16(pixels, BgraChannel::Green));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstU + x), PackChannel16(pixels, BgraChannel::Blue));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstV + x), PackChannel16(pixels, BgraChannel::Red));
+        }
+
+        for (; x < bgraImage->width; ++x)
+        {
+            dstY[x] = src[x].g;
+            dstU[x] = src[x].b;
+            dstV[x] = src[x].r;
+        }
+    }
+}
+
+void ChannelToY8SSE2(
+    const BitmapData* bgraImage,
+    BgraChannel channel,
+    uint8_t* yPlane,
+    size_t yPlaneStride)
+{
+    const size_t vectorWidth = bgraImage->width & ~static_cast<size_t>(15);
+
+    for (size_t y = 0; y < bgraImage->height; ++y)
+    {
+        const ColorBgra* src = reinterpret_cast<const ColorBgra*>(bgraImage->scan0 + (y * bgraImage->stride));
+        uint8_t* dst = &yPlane[y * yPlaneStride];
+
+        size_t x = 0;
+
+        for (; x < vectorWidth; x += 16)
+        {
+            __m128i pixels[4];
+            LoadPixels16(src + x, pixels);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), PackChannel16(pixels, channel));
+        }
+
+        for (; x < bgraImage->width; ++x)
+        {
+            dst[x] = GetChannel(src[x], channel);
+        }
+    }
+}
+
+#endif // AVIF_X86_SIMD_SUPPORTED
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "CpuFeatures.h"
+#include <stdint.h>
+
+#if AVIF_X86_SIMD_SUPPORTED
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if AVIF_X86_SIMD_SUPPORTED
+    struct CpuidRegisters
+    {
+        uint32_t eax;
+        uint32_t ebx;
+        uint32_t ecx;
+        uint32_t edx;
+    };
+
+    CpuidRegisters Cpuid(uint32_t leaf, uint32_t subleaf)
+    {
+        CpuidRegisters registers{};
+
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+
+        registers.eax = static_cast<uint32_t>(info[0]);
+        registers.ebx = static_cast<uint32_t>(info[1]);
+        registers.ecx = static_cast<uint32_t>(info[2]);
+        registers.edx = static_cast<uint32_t>(info[3]);
+#else
+        __cpuid_count(leaf, subleaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+
+        return registers;
+    }
+
+    uint64_t GetExtendedControlRegister()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t eax;
+        uint32_t edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+    }
+
+    SimdLevel DetectSimdLevel() noexcept
+    {
+        const uint32_t maxLeaf = Cpuid(0, 0).eax;
+
+        if (maxLeaf < 1)
+        {
+            return SimdLevel::None;
+        }
+
+        const CpuidRegisters features = Cpuid(1, 0);
+
+        constexpr uint32_t SSE2Bit = 1U << 26;
+        constexpr uint32_t OSXSaveBit = 1U << 27;
+        constexpr uint32_t AVXBit = 1U << 28;
+
+        if ((features.edx & SSE2Bit) == 0)
+        {
+            return SimdLevel::None;
+        }
+
+        if (maxLeaf >= 7 && (features.ecx & OSXSaveBit) != 0 && (features.ecx & AVXBit) != 0)
+        {
+            // The operating system must preserve the XMM and YMM registers across context switches.
+            constexpr uint64_t XmmYmmStateMask = 0x6;
+
+            if ((GetExtendedControlRegister() & XmmYmmStateMask) == XmmYmmStateMask)
+            {
+                constexpr uint32_t AVX2Bit = 1U << 5;
+
+                if ((Cpuid(7, 0).ebx & AVX2Bit) != 0)
+                {
+                    return SimdLevel::AVX2;
+                }
+            }
+        }
+
+        return SimdLevel::SSE2;
+    }
+#endif
+}
+
+SimdLevel GetSupportedSimdLevel() noexcept
+{
+#if AVIF_X86_SIMD_SUPPORTED
+    static const SimdLevel simdLevel = DetectSimdLevel();
+
+    return simdLevel;
+#else
+    return SimdLevel::None;
+#endif
+}
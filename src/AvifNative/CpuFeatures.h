@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AVIF_X86_SIMD_SUPPORTED 1
+#else
+#define AVIF_X86_SIMD_SUPPORTED 0
+#endif
+
+// The instruction set extensions that can be used by the image conversion code.
+enum class SimdLevel
+{
+    None,
+    SSE2,
+    AVX2
+};
+
+// Gets the highest instruction set level that is supported by both the processor and the operating system.
+// The processor features are only queried on the first call.
+SimdLevel GetSupportedSimdLevel() noexcept;
@@ -38,12 +38,17 @@
 
 
 #include "DecodedImageConverter.h"
-#include "Memory.h"
+#include "ImageDownsampler.h"
+#include <string.h>
+#include "ScopedAOMImage.h"
+#include "ThreadPool.h"
 #include "YUVConversionHelpers.h"
 #include "CICPEnums.h"
 #include <array>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <utility>
 
 namespace
 {
@@ -61,33 +66,325 @@ namespace
         return value;
     }
 
+    inline uint8_t ClampToUInt8(int32_t value)
+    {
+        if (value < 0)
+        {
+            return 0;
+        }
+        else if (value > 255)
+        {
+            return 255;
+        }
+
+        return static_cast<uint8_t>(value);
+    }
+
     inline uint32_t Min(uint32_t a, uint32_t b)
     {
         return a < b ? a : b;
     }
 
-    void GetCopySizes(
+    // The area of a decoded image or image grid tile that is copied to the output image.
+    struct CopyRegion
+    {
+        uint32_t srcLeft;
+        uint32_t srcTop;
+        uint32_t srcRight;
+        uint32_t srcBottom;
+        // The output pixel of (srcLeft, srcTop), and the distance in pixels between the
+        // output pixels of adjacent source columns and rows.
+        ColorBgra* dest;
+        ptrdiff_t destColumnStep;
+        ptrdiff_t destRowStep;
+
+        ColorBgra* GetDestinationRow(uint32_t y) const noexcept
+        {
+            return dest + (static_cast<ptrdiff_t>(y - srcTop) * destRowStep);
+        }
+    };
+
+    bool IsValidOutputTransform(const DecodeInfo* decodeInfo, const BitmapData* bgraImage)
+    {
+        switch (decodeInfo->outputRotation)
+        {
+        case OutputRotation::None:
+        case OutputRotation::Rotate90CCW:
+        case OutputRotation::Rotate180:
+        case OutputRotation::Rotate270CCW:
+            break;
+        default:
+            return false;
+        }
+
+        switch (decodeInfo->outputMirror)
+        {
+        case OutputMirror::None:
+        case OutputMirror::Vertical:
+        case OutputMirror::Horizontal:
+            break;
+        default:
+            return false;
+        }
+
+        // The output mapping steps are measured in whole pixels.
+        return (bgraImage->stride % sizeof(ColorBgra)) == 0;
+    }
+
+    // The output image is a window into the full image that starts at (outputX, outputY),
+    // only the part of the tile that overlaps the window is copied.
+    // Each window pixel (u, v) is mapped to its output pixel after the rotation and mirror transforms.
+    CopyRegion GetCopyRegion(
         const aom_image_t* image,
         const DecodeInfo* decodeInfo,
-        const BitmapData* bgraImage,
-        uint32_t& copyWidth,
-        uint32_t& copyHeight)
+        const BitmapData* bgraImage)
+    {
+        const bool swapDimensions = decodeInfo->outputRotation == OutputRotation::Rotate90CCW ||
+                                    decodeInfo->outputRotation == OutputRotation::Rotate270CCW;
+        const uint32_t windowWidth = swapDimensions ? bgraImage->height : bgraImage->width;
+        const uint32_t windowHeight = swapDimensions ? bgraImage->width : bgraImage->height;
+
+        const uint64_t tileLeft = static_cast<uint64_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
+        const uint64_t tileTop = static_cast<uint64_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight;
+        const uint64_t tileRight = tileLeft + image->d_w;
+        const uint64_t tileBottom = tileTop + image->d_h;
+
+        const uint64_t windowLeft = decodeInfo->outputX;
+        const uint64_t windowTop = decodeInfo->outputY;
+        const uint64_t windowRight = windowLeft + windowWidth;
+        const uint64_t windowBottom = windowTop + windowHeight;
+
+        const uint64_t left = tileLeft > windowLeft ? tileLeft : windowLeft;
+        const uint64_t top = tileTop > windowTop ? tileTop : windowTop;
+        const uint64_t right = tileRight < windowRight ? tileRight : windowRight;
+        const uint64_t bottom = tileBottom < windowBottom ? tileBottom : windowBottom;
+
+        CopyRegion region = {};
+
+        if (left < right && top < bottom)
+        {
+            region.srcLeft = static_cast<uint32_t>(left - tileLeft);
+            region.srcTop = static_cast<uint32_t>(top - tileTop);
+            region.srcRight = static_cast<uint32_t>(right - tileLeft);
+            region.srcBottom = static_cast<uint32_t>(bottom - tileTop);
+
+            // The output position is (x0 + u * dxu + v * dxv, y0 + u * dyu + v * dyv).
+            const ptrdiff_t lastWindowColumn = static_cast<ptrdiff_t>(windowWidth) - 1;
+            const ptrdiff_t lastWindowRow = static_cast<ptrdiff_t>(windowHeight) - 1;
+
+            ptrdiff_t x0 = 0;
+            ptrdiff_t y0 = 0;
+            ptrdiff_t dxu = 1;
+            ptrdiff_t dxv = 0;
+            ptrdiff_t dyu = 0;
+            ptrdiff_t dyv = 1;
+
+            switch (decodeInfo->outputRotation)
+            {
+            case OutputRotation::Rotate90CCW:
+                // (u, v) -> (v, lastWindowColumn - u)
+                x0 = 0;
+                y0 = lastWindowColumn;
+                dxu = 0;
+                dxv = 1;
+                dyu = -1;
+                dyv = 0;
+                break;
+            case OutputRotation::Rotate180:
+                // (u, v) -> (lastWindowColumn - u, lastWindowRow - v)
+                x0 = lastWindowColumn;
+                y0 = lastWindowRow;
+                dxu = -1;
+                dyv = -1;
+                break;
+            case OutputRotation::Rotate270CCW:
+                // (u, v) -> (lastWindowRow - v, u)
+                x0 = lastWindowRow;
+                y0 = 0;
+                dxu = 0;
+                dxv = -1;
+                dyu = 1;
+                dyv = 0;
+                break;
+            case OutputRotation::None:
+            default:
+                break;
+            }
+
+            switch (decodeInfo->outputMirror)
+            {
+            case OutputMirror::Vertical:
+                y0 = static_cast<ptrdiff_t>(bgraImage->height) - 1 - y0;
+                dyu = -dyu;
+                dyv = -dyv;
+                break;
+            case OutputMirror::Horizontal:
+                x0 = static_cast<ptrdiff_t>(bgraImage->width) - 1 - x0;
+                dxu = -dxu;
+                dxv = -dxv;
+                break;
+            case OutputMirror::None:
+            default:
+                break;
+            }
+
+            const ptrdiff_t stride = static_cast<ptrdiff_t>(bgraImage->stride / sizeof(ColorBgra));
+            const ptrdiff_t u = static_cast<ptrdiff_t>(left - windowLeft);
+            const ptrdiff_t v = static_cast<ptrdiff_t>(top - windowTop);
+
+            const ptrdiff_t destX = x0 + (u * dxu) + (v * dxv);
+            const ptrdiff_t destY = y0 + (u * dyu) + (v * dyv);
+
+            region.dest = reinterpret_cast<ColorBgra*>(bgraImage->scan0) + (destY * stride) + destX;
+            region.destColumnStep = dxu + (dyu * stride);
+            region.destRowStep = dxv + (dyv * stride);
+        }
+
+        return region;
+    }
+
+    // The width of the column strips that a transposing copy is split into. Each source row writes one pixel
+    // to each of the strip's output rows, so the output cache lines are filled by consecutive source rows
+    // before they are evicted.
+    constexpr uint32_t TransposeStripWidth = 64;
+
+    // The number of source rows in the tiles that a transposing update copies through a tile buffer,
+    // each tile column is one 64 byte cache line of its output row.
+    constexpr uint32_t TransposeTileHeight = 16;
+
+    // The height of the row bands that a non-transposing copy is split into for parallel conversion.
+    constexpr uint32_t ParallelRowBandHeight = 64;
+
+    // Regions smaller than this are converted on the calling thread, image grid tiles
+    // are already converted concurrently by the caller.
+    constexpr uint64_t ParallelConversionMinPixels = 1024 * 1024;
+
+    CopyRegion GetCopyBlock(const CopyRegion& region, bool transpose, size_t index)
+    {
+        CopyRegion block = region;
+
+        if (transpose)
+        {
+            block.srcLeft = region.srcLeft + (static_cast<uint32_t>(index) * TransposeStripWidth);
+            block.srcRight = Min(block.srcLeft + TransposeStripWidth, region.srcRight);
+            block.dest = region.dest + (static_cast<ptrdiff_t>(block.srcLeft - region.srcLeft) * region.destColumnStep);
+        }
+        else
+        {
+            block.srcTop = region.srcTop + (static_cast<uint32_t>(index) * ParallelRowBandHeight);
+            block.srcBottom = Min(block.srcTop + ParallelRowBandHeight, region.srcBottom);
+            block.dest = region.dest + (static_cast<ptrdiff_t>(block.srcTop - region.srcTop) * region.destRowStep);
+        }
+
+        return block;
+    }
+
+    // Updates a column strip of a transposing copy through a tile buffer. The output pixels of each tile are
+    // loaded into the buffer, func updates the tile region with the rows and columns in source order, and the
+    // tile is written back to the output image.
+    // This replaces a read-modify-write of a single pixel in each output row per source row with
+    // contiguous reads and writes of each output row.
+    template <typename Func>
+    void UpdateTransposedStrip(const CopyRegion& strip, Func&& func)
     {
-        copyWidth = image->d_w;
-        uint32_t maxWidth = image->d_w * (decodeInfo->tileColumnIndex + 1);
-        if (maxWidth > bgraImage->width)
+        ColorBgra tile[TransposeTileHeight * TransposeStripWidth];
+
+        const uint32_t tileWidth = strip.srcRight - strip.srcLeft;
+
+        for (uint32_t tileTop = strip.srcTop; tileTop < strip.srcBottom; tileTop += TransposeTileHeight)
         {
-            copyWidth -= (maxWidth - bgraImage->width);
+            const uint32_t tileHeight = Min(TransposeTileHeight, strip.srcBottom - tileTop);
+            ColorBgra* const dest = strip.GetDestinationRow(tileTop);
+
+            for (uint32_t x = 0; x < tileWidth; ++x)
+            {
+                const ColorBgra* outputRow = dest + (static_cast<ptrdiff_t>(x) * strip.destColumnStep);
+
+                for (uint32_t y = 0; y < tileHeight; ++y)
+                {
+                    tile[(y * TransposeStripWidth) + x] = outputRow[static_cast<ptrdiff_t>(y) * strip.destRowStep];
+                }
+            }
+
+            CopyRegion tileRegion;
+            tileRegion.srcLeft = strip.srcLeft;
+            tileRegion.srcTop = tileTop;
+            tileRegion.srcRight = strip.srcRight;
+            tileRegion.srcBottom = tileTop + tileHeight;
+            tileRegion.dest = tile;
+            tileRegion.destColumnStep = 1;
+            tileRegion.destRowStep = TransposeStripWidth;
+
+            func(tileRegion);
+
+            for (uint32_t x = 0; x < tileWidth; ++x)
+            {
+                ColorBgra* outputRow = dest + (static_cast<ptrdiff_t>(x) * strip.destColumnStep);
+
+                for (uint32_t y = 0; y < tileHeight; ++y)
+                {
+                    outputRow[static_cast<ptrdiff_t>(y) * strip.destRowStep] = tile[(y * TransposeStripWidth) + x];
+                }
+            }
         }
+    }
+
+    // Splits the copy region into blocks and invokes func for each block.
+    // When the rotation maps the source rows to output columns the blocks are column strips, this is a blocked
+    // transpose. When updatesOutput is true func only writes some of the channels of the output pixels, and the
+    // strips are updated through a tile buffer. Large regions are converted in parallel.
+    template <typename Func>
+    void ForEachCopyBlock(const CopyRegion& region, int maxThreads, bool updatesOutput, Func&& func)
+    {
+        if (region.srcLeft >= region.srcRight || region.srcTop >= region.srcBottom)
+        {
+            return;
+        }
+
+        const uint32_t width = region.srcRight - region.srcLeft;
+        const uint32_t height = region.srcBottom - region.srcTop;
+        const bool transpose = region.destColumnStep != 1 && region.destColumnStep != -1;
+
+        const size_t blockCount = transpose ? ((width + TransposeStripWidth - 1) / TransposeStripWidth)
+                                            : ((height + ParallelRowBandHeight - 1) / ParallelRowBandHeight);
+
+        const auto convertBlock = [&](size_t index)
+        {
+            const CopyRegion block = GetCopyBlock(region, transpose, index);
 
-        copyHeight = image->d_h;
-        uint32_t maxHeight = image->d_h * (decodeInfo->tileRowIndex + 1);
-        if (maxHeight > bgraImage->height)
+            if (transpose && updatesOutput)
+            {
+                UpdateTransposedStrip(block, func);
+            }
+            else
+            {
+                func(block);
+            }
+        };
+
+        if (maxThreads > 1 && blockCount > 1 && (static_cast<uint64_t>(width) * height) >= ParallelConversionMinPixels)
+        {
+            ThreadPool::GetShared().ParallelFor(blockCount, maxThreads, convertBlock);
+        }
+        else if (transpose)
         {
-            copyHeight -= (maxHeight - bgraImage->height);
+            for (size_t i = 0; i < blockCount; ++i)
+            {
+                convertBlock(i);
+            }
+        }
+        else
+        {
+            func(region);
         }
     }
 
+    template <typename Func>
+    void ForEachCopyBlock(const CopyRegion& region, int maxThreads, Func&& func)
+    {
+        ForEachCopyBlock(region, maxThreads, false, std::forward<Func>(func));
+    }
+
     class unknown_bit_depth_error : public std::runtime_error
     {
     public:
@@ -135,7 +432,7 @@ namespace
         return v;
     }
 
-    int avifLimitedToFullUV(int depth, int v)
+    constexpr int avifLimitedToFullUV(int depth, int v)
     {
         switch (depth) {
         case 8:
@@ -216,6 +513,66 @@ namespace
         }
     };
 
+    // A process-wide cache of the lookup tables, the tables only depend on the image format
+    // so they can be shared by all of the tiles in an image grid and by concurrent decodes.
+    class YUVLookupTableCache
+    {
+    public:
+        static std::shared_ptr<const YUVLookupTables> Get(const aom_image_t* image, bool isIdentityMatrix)
+        {
+            static YUVLookupTableCache cache;
+
+            return cache.GetOrCreate(image, isIdentityMatrix);
+        }
+
+    private:
+        // 4 bit depths * 2 ranges * identity/non-identity * color/monochrome
+        static constexpr size_t EntryCount = 4 * 2 * 2 * 2;
+
+        YUVLookupTableCache() : mutex(), entries()
+        {
+        }
+
+        static size_t GetBitDepthIndex(unsigned int bitDepth)
+        {
+            switch (bitDepth)
+            {
+            case 8:
+                return 0;
+            case 10:
+                return 1;
+            case 12:
+                return 2;
+            case 16:
+                return 3;
+            default:
+                throw unknown_bit_depth_error("The image has an unsupported bit depth, must be 8, 10, 12 or 16.");
+            }
+        }
+
+        std::shared_ptr<const YUVLookupTables> GetOrCreate(const aom_image_t* image, bool isIdentityMatrix)
+        {
+            size_t index = GetBitDepthIndex(image->bit_depth);
+            index = (index * 2) + (image->range == AOM_CR_STUDIO_RANGE ? 1 : 0);
+            index = (index * 2) + (isIdentityMatrix ? 1 : 0);
+            index = (index * 2) + (image->monochrome ? 1 : 0);
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            std::shared_ptr<const YUVLookupTables>& entry = entries[index];
+
+            if (!entry)
+            {
+                entry = std::make_shared<YUVLookupTables>(image, isIdentityMatrix);
+            }
+
+            return entry;
+        }
+
+        std::mutex mutex;
+        std::array<std::shared_ptr<const YUVLookupTables>, EntryCount> entries;
+    };
+
     constexpr std::array<uint8_t, 256> BuildIdentity8LimitedToFullYLookupTable()
     {
         std::array<uint8_t, 256> table = {};
@@ -228,11 +585,147 @@ namespace
         return table;
     }
 
+    constexpr std::array<uint8_t, 256> BuildYUV8LimitedToFullUVLookupTable()
+    {
+        std::array<uint8_t, 256> table = {};
+
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            table[i] = static_cast<uint8_t>(avifLimitedToFullUV(8, static_cast<int>(i)));
+        }
+
+        return table;
+    }
+
+    constexpr std::array<uint8_t, 256> BuildPassThroughLookupTable()
+    {
+        std::array<uint8_t, 256> table = {};
+
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            table[i] = static_cast<uint8_t>(i);
+        }
+
+        return table;
+    }
+
+    // The alpha sources provide the alpha channel to the color conversion functions, which
+    // allows each output pixel to be written in a single pass over the output image.
+
+    // Used when the image does not have an alpha image, or the alpha image is converted separately.
+    class OpaqueAlphaSource
+    {
+    public:
+        struct Row
+        {
+            uint8_t operator[](uint32_t) const noexcept
+            {
+                return 255;
+            }
+        };
+
+        Row GetRow(uint32_t) const noexcept
+        {
+            return Row();
+        }
+    };
+
+    class Alpha8Source
+    {
+    public:
+        struct Row
+        {
+            const uint8_t* ptrY;
+            const uint8_t* unormToAlpha;
+
+            uint8_t operator[](uint32_t x) const noexcept
+            {
+                return unormToAlpha[ptrY[x]];
+            }
+        };
+
+        explicit Alpha8Source(const aom_image_t* image) noexcept
+            : image(image), unormToAlpha(GetUnormToAlphaTable(image))
+        {
+        }
+
+        Row GetRow(uint32_t y) const noexcept
+        {
+            return Row{ &image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])], unormToAlpha };
+        }
+
+    private:
+        static const uint8_t* GetUnormToAlphaTable(const aom_image_t* image) noexcept
+        {
+            static constexpr std::array<uint8_t, 256> passThrough = BuildPassThroughLookupTable();
+            static constexpr std::array<uint8_t, 256> limitedToFullY = BuildIdentity8LimitedToFullYLookupTable();
+
+            return image->range == AOM_CR_STUDIO_RANGE ? limitedToFullY.data() : passThrough.data();
+        }
+
+        const aom_image_t* image;
+        const uint8_t* unormToAlpha;
+    };
+
+    class Alpha16Source
+    {
+    public:
+        struct Row
+        {
+            const uint16_t* ptrY;
+            const float* unormFloatTable;
+            uint32_t yuvMaxChannel;
+
+            uint8_t operator[](uint32_t x) const noexcept
+            {
+                // Clamp the value to the lookup table range
+                const uint32_t unormY = Min(ptrY[x], yuvMaxChannel);
+
+                const float A = Clamp(unormFloatTable[unormY], 0.0f, 1.0f);
+
+                return static_cast<uint8_t>(0.5f + (A * 255.0f));
+            }
+        };
+
+        // Throws unknown_bit_depth_error if the image bit depth is not supported.
+        explicit Alpha16Source(const aom_image_t* image)
+            : image(image), tables(YUVLookupTableCache::Get(image, false)), yuvMaxChannel((1 << image->bit_depth) - 1)
+        {
+        }
+
+        Row GetRow(uint32_t y) const noexcept
+        {
+            const uint16_t* ptrY = reinterpret_cast<const uint16_t*>(&image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])]);
+
+            return Row{ ptrY, tables->unormFloatTableY.get(), yuvMaxChannel };
+        }
+
+    private:
+        const aom_image_t* image;
+        std::shared_ptr<const YUVLookupTables> tables;
+        uint32_t yuvMaxChannel;
+    };
+
+    // Calls func with the alpha source that matches the bit depth of the alpha image.
+    template <typename Func>
+    void UseAlphaSource(const aom_image_t* alphaImage, Func&& func)
+    {
+        if (alphaImage->bit_depth > 8)
+        {
+            func(Alpha16Source(alphaImage));
+        }
+        else
+        {
+            func(Alpha8Source(alphaImage));
+        }
+    }
+
+    template <typename AlphaSource>
     void Identity16ToRGB8Color(
         const aom_image_t* image,
-        const DecodeInfo* decodeInfo,
+        const CopyRegion& copyRegion,
         const YUVLookupTables& tables,
-        BitmapData* bgraImage)
+        const AlphaSource& alphaSource)
     {
         uint32_t yuvMaxChannel = (1 << image->bit_depth) - 1;
         constexpr float rgbMaxChannel = 255.0f;
@@ -246,23 +739,17 @@ namespace
             vPlaneIndex = AOM_PLANE_U;
         }
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             const uint32_t uvJ = y >> image->y_chroma_shift;
             uint16_t* ptrY = reinterpret_cast<uint16_t*>(&image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])]);
             uint16_t* ptrU = reinterpret_cast<uint16_t*>(&image->planes[uPlaneIndex][(uvJ * image->stride[uPlaneIndex])]);
             uint16_t* ptrV = reinterpret_cast<uint16_t*>(&image->planes[vPlaneIndex][(uvJ * image->stride[vPlaneIndex])]);
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
-
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Unpack Identity into unorm
                 uint32_t uvI = x >> image->x_chroma_shift;
@@ -287,34 +774,30 @@ namespace
                 dstPtr->r = static_cast<uint8_t>(0.5f + (R * rgbMaxChannel));
                 dstPtr->g = static_cast<uint8_t>(0.5f + (G * rgbMaxChannel));
                 dstPtr->b = static_cast<uint8_t>(0.5f + (B * rgbMaxChannel));
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
+    template <typename AlphaSource>
     void Identity16ToRGB8Mono(
         const aom_image_t* image,
-        const DecodeInfo* decodeInfo,
+        const CopyRegion& copyRegion,
         const YUVLookupTables& tables,
-        BitmapData* bgraImage)
+        const AlphaSource& alphaSource)
     {
         uint32_t yuvMaxChannel = (1 << image->bit_depth) - 1;
         constexpr float rgbMaxChannel = 255.0f;
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             uint16_t* ptrY = reinterpret_cast<uint16_t*>(&image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])]);
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
-
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Clamp the value to the lookup table range
                 uint32_t unormY = Min(ptrY[x], yuvMaxChannel);
@@ -327,15 +810,17 @@ namespace
                 dstPtr->g = gray;
                 dstPtr->b = gray;
                 dstPtr->r = gray;
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
+    template <typename AlphaSource>
     void Identity8ToRGB8Color(
         const aom_image_t* image,
-        const DecodeInfo* decodeInfo,
-        BitmapData* bgraImage)
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
     {
         uint32_t uPlaneIndex = AOM_PLANE_U;
         uint32_t vPlaneIndex = AOM_PLANE_V;
@@ -346,25 +831,19 @@ namespace
             vPlaneIndex = AOM_PLANE_U;
         }
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
         static constexpr std::array<uint8_t, 256> limitedToFullY = BuildIdentity8LimitedToFullYLookupTable();
 
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             const uint32_t uvJ = y >> image->y_chroma_shift;
             uint8_t* ptrY = &image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])];
             uint8_t* ptrU = &image->planes[uPlaneIndex][(uvJ * image->stride[uPlaneIndex])];
             uint8_t* ptrV = &image->planes[vPlaneIndex][(uvJ * image->stride[vPlaneIndex])];
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
-
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Unpack Identity into unorm
                 uint32_t uvI = x >> image->x_chroma_shift;
@@ -384,32 +863,28 @@ namespace
                 dstPtr->g = unormY;
                 dstPtr->b = unormU;
                 dstPtr->r = unormV;
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
+    template <typename AlphaSource>
     void Identity8ToRGB8Mono(
         const aom_image_t* image,
-        const DecodeInfo* decodeInfo,
-        BitmapData* bgraImage)
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
     {
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
         static constexpr std::array<uint8_t, 256> limitedToFullY = BuildIdentity8LimitedToFullYLookupTable();
 
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             uint8_t* ptrY = &image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])];
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
-
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Unpack Identity into unorm
                 uint8_t unormY = ptrY[x];
@@ -425,17 +900,19 @@ namespace
                 dstPtr->r = gray;
                 dstPtr->g = gray;
                 dstPtr->b = gray;
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
+    template <typename AlphaSource>
     void YUV16ToRGB8Color(
         const aom_image_t* image,
         const YUVCoefficiants& yuvCoefficiants,
         const YUVLookupTables& tables,
-        const DecodeInfo* decodeInfo,
-        BitmapData* bgraImage)
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
     {
         const float kr = yuvCoefficiants.kr;
         const float kg = yuvCoefficiants.kg;
@@ -453,23 +930,17 @@ namespace
             vPlaneIndex = AOM_PLANE_U;
         }
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             const uint32_t uvJ = y >> image->y_chroma_shift;
             uint16_t* ptrY = reinterpret_cast<uint16_t*>(&image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])]);
             uint16_t* ptrU = reinterpret_cast<uint16_t*>(&image->planes[uPlaneIndex][(uvJ * image->stride[uPlaneIndex])]);
             uint16_t* ptrV = reinterpret_cast<uint16_t*>(&image->planes[vPlaneIndex][(uvJ * image->stride[vPlaneIndex])]);
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
-
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Unpack YUV into unorm
                 uint32_t uvI = x >> image->x_chroma_shift;
@@ -494,17 +965,19 @@ namespace
                 dstPtr->r = static_cast<uint8_t>(0.5f + (R * rgbMaxChannel));
                 dstPtr->g = static_cast<uint8_t>(0.5f + (G * rgbMaxChannel));
                 dstPtr->b = static_cast<uint8_t>(0.5f + (B * rgbMaxChannel));
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
+    template <typename AlphaSource>
     void YUV16ToRGB8Mono(
         const aom_image_t* image,
         const YUVCoefficiants& yuvCoefficiants,
         const YUVLookupTables& tables,
-        const DecodeInfo* decodeInfo,
-        BitmapData* bgraImage)
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
     {
         const float kr = yuvCoefficiants.kr;
         const float kg = yuvCoefficiants.kg;
@@ -513,20 +986,14 @@ namespace
         uint32_t yuvMaxChannel = (1 << image->bit_depth) - 1;
         constexpr float rgbMaxChannel = 255.0f;
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             uint16_t* ptrY = reinterpret_cast<uint16_t*>(&image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])]);
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
-
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Clamp the value to the lookup table range
                 uint32_t unormY = Min(ptrY[x], yuvMaxChannel);
@@ -546,17 +1013,91 @@ namespace
                 dstPtr->r = static_cast<uint8_t>(0.5f + (R * rgbMaxChannel));
                 dstPtr->g = static_cast<uint8_t>(0.5f + (G * rgbMaxChannel));
                 dstPtr->b = static_cast<uint8_t>(0.5f + (B * rgbMaxChannel));
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
+            }
+        }
+    }
+
+#if AVIF_FIXED_POINT_YUV_CONVERSION
+    template <typename AlphaSource>
+    void YUV8ToRGB8ColorFixedPoint(
+        const aom_image_t* image,
+        const FixedPointYUVCoefficiants& coefficiants,
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
+    {
+        uint32_t uPlaneIndex = AOM_PLANE_U;
+        uint32_t vPlaneIndex = AOM_PLANE_V;
+
+        if (image->fmt & AOM_IMG_FMT_UV_FLIP)
+        {
+            uPlaneIndex = AOM_PLANE_V;
+            vPlaneIndex = AOM_PLANE_U;
+        }
+
+        static constexpr std::array<uint8_t, 256> limitedToFullY = BuildIdentity8LimitedToFullYLookupTable();
+        static constexpr std::array<uint8_t, 256> limitedToFullUV = BuildYUV8LimitedToFullUVLookupTable();
+
+        const bool isLimitedRange = image->range == AOM_CR_STUDIO_RANGE;
+
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
+        {
+            const uint32_t uvJ = y >> image->y_chroma_shift;
+            uint8_t* ptrY = &image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])];
+            uint8_t* ptrU = &image->planes[uPlaneIndex][(uvJ * image->stride[uPlaneIndex])];
+            uint8_t* ptrV = &image->planes[vPlaneIndex][(uvJ * image->stride[vPlaneIndex])];
+
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
+
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
+            {
+                // Unpack YUV into unorm
+                uint32_t uvI = x >> image->x_chroma_shift;
+                uint8_t unormY = ptrY[x];
+                uint8_t unormU = ptrU[uvI];
+                uint8_t unormV = ptrV[uvI];
+
+                // adjust for limited/full color range, if need be
+                if (isLimitedRange)
+                {
+                    unormY = limitedToFullY[unormY];
+                    unormU = limitedToFullUV[unormU];
+                    unormV = limitedToFullUV[unormV];
+                }
+
+                // See FixedPointYUVCoefficiants for the rounding model.
+                const int32_t Y = (static_cast<int32_t>(unormY) << FixedPointPrecision) + FixedPointHalf;
+                const int32_t Cb = (2 * static_cast<int32_t>(unormU)) - 255;
+                const int32_t Cr = (2 * static_cast<int32_t>(unormV)) - 255;
+
+                dstPtr->r = ClampToUInt8((Y + (coefficiants.rV * Cr)) >> FixedPointPrecision);
+                dstPtr->g = ClampToUInt8((Y - (coefficiants.gU * Cb) - (coefficiants.gV * Cr)) >> FixedPointPrecision);
+                dstPtr->b = ClampToUInt8((Y + (coefficiants.bU * Cb)) >> FixedPointPrecision);
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
+    // The Y value of a gray scale image is the RGB value, so only the range needs to be converted.
+    template <typename AlphaSource>
+    void YUV8ToRGB8MonoFixedPoint(
+        const aom_image_t* image,
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
+    {
+        Identity8ToRGB8Mono(image, copyRegion, alphaSource);
+    }
+#else
+    template <typename AlphaSource>
     void YUV8ToRGB8Color(
         const aom_image_t* image,
         const YUVCoefficiants& yuvCoefficiants,
         const YUVLookupTables& tables,
-        const DecodeInfo* decodeInfo,
-        BitmapData* bgraImage)
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
     {
         const float kr = yuvCoefficiants.kr;
         const float kg = yuvCoefficiants.kg;
@@ -573,23 +1114,17 @@ namespace
             vPlaneIndex = AOM_PLANE_U;
         }
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             const uint32_t uvJ = y >> image->y_chroma_shift;
             uint8_t* ptrY = &image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])];
             uint8_t* ptrU = &image->planes[uPlaneIndex][(uvJ * image->stride[uPlaneIndex])];
             uint8_t* ptrV = &image->planes[vPlaneIndex][(uvJ * image->stride[vPlaneIndex])];
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
-
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Unpack YUV into unorm
                 uint32_t uvI = x >> image->x_chroma_shift;
@@ -612,17 +1147,19 @@ namespace
                 dstPtr->r = static_cast<uint8_t>(0.5f + (R * rgbMaxChannel));
                 dstPtr->g = static_cast<uint8_t>(0.5f + (G * rgbMaxChannel));
                 dstPtr->b = static_cast<uint8_t>(0.5f + (B * rgbMaxChannel));
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
+    template <typename AlphaSource>
     void YUV8ToRGB8Mono(
         const aom_image_t* image,
         const YUVCoefficiants& yuvCoefficiants,
         const YUVLookupTables& tables,
-        const DecodeInfo* decodeInfo,
-        BitmapData* bgraImage)
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
     {
         const float kr = yuvCoefficiants.kr;
         const float kg = yuvCoefficiants.kg;
@@ -630,20 +1167,14 @@ namespace
 
         constexpr float rgbMaxChannel = 255.0f;
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
             uint8_t* ptrY = &image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])];
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
-
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
                 // Unpack YUV into unorm
                 uint8_t unormY = ptrY[x];
@@ -663,320 +1194,465 @@ namespace
                 dstPtr->r = static_cast<uint8_t>(0.5f + (R * rgbMaxChannel));
                 dstPtr->g = static_cast<uint8_t>(0.5f + (G * rgbMaxChannel));
                 dstPtr->b = static_cast<uint8_t>(0.5f + (B * rgbMaxChannel));
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
-    void YUV16ToAlpha8(
-        const aom_image_t* image,
-        const DecodeInfo* decodeInfo,
-        const YUVLookupTables& tables,
-        BitmapData* bgraImage)
-    {
-        uint32_t yuvMaxChannel = (1 << image->bit_depth) - 1;
-        constexpr float rgbMaxChannel = 255.0f;
-
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
+#endif // AVIF_FIXED_POINT_YUV_CONVERSION
 
-        for (uint32_t y = 0; y < copyHeight; ++y)
+    // Writes the alpha channel when the alpha image is converted separately from the color image.
+    template <typename AlphaSource>
+    void WriteAlphaChannel(
+        const CopyRegion& copyRegion,
+        const AlphaSource& alphaSource)
+    {
+        for (uint32_t y = copyRegion.srcTop; y < copyRegion.srcBottom; ++y)
         {
-            uint16_t* ptrY = reinterpret_cast<uint16_t*>(&image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])]);
+            const typename AlphaSource::Row alphaRow = alphaSource.GetRow(y);
 
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
+            ColorBgra* dstPtr = copyRegion.GetDestinationRow(y);
 
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
-
-            for (uint32_t x = 0; x < copyWidth; ++x)
+            for (uint32_t x = copyRegion.srcLeft; x < copyRegion.srcRight; ++x)
             {
-                // Clamp the value to the lookup table range
-                uint32_t unormY = Min(ptrY[x], yuvMaxChannel);
-
-                // Convert unorm to float
-                const float Y = tables.unormFloatTableY[unormY];
-
-                float A = Clamp(Y, 0.0f, 1.0f);
-
-                dstPtr->a = static_cast<uint8_t>(0.5f + (A * rgbMaxChannel));
-                ++dstPtr;
+                dstPtr->a = alphaRow[x];
+                dstPtr += copyRegion.destColumnStep;
             }
         }
     }
 
-    void YUV8ToAlpha8(
+    template <typename AlphaSource>
+    void WriteAlphaPixels(
         const aom_image_t* image,
         const DecodeInfo* decodeInfo,
-        const YUVLookupTables& tables,
-        BitmapData* bgraImage)
+        const AlphaSource& alphaSource,
+        BitmapData* outputImage,
+        int maxThreads)
     {
-        constexpr float rgbMaxChannel = 255.0f;
+        const CopyRegion copyRegion = GetCopyRegion(image, decodeInfo, outputImage);
 
-        uint32_t copyWidth;
-        uint32_t copyHeight;
-        GetCopySizes(image, decodeInfo, bgraImage, copyWidth, copyHeight);
-
-        for (uint32_t y = 0; y < copyHeight; ++y)
+        // The alpha channel is written to the pixels that the color image conversion produced.
+        ForEachCopyBlock(copyRegion, maxThreads, true, [&](const CopyRegion& block)
         {
-            uint8_t* ptrY = &image->planes[AOM_PLANE_Y][(y * image->stride[AOM_PLANE_Y])];
-
-            const size_t destX = static_cast<size_t>(decodeInfo->tileColumnIndex) * decodeInfo->expectedWidth;
-            const size_t destY = static_cast<size_t>(y) + (static_cast<size_t>(decodeInfo->tileRowIndex) * decodeInfo->expectedHeight);
+            WriteAlphaChannel(block, alphaSource);
+        });
+    }
 
-            ColorBgra* dstPtr = reinterpret_cast<ColorBgra*>(bgraImage->scan0 + (destY * bgraImage->stride) + (destX * sizeof(ColorBgra)));
+    // Downsamples the image in the YUV domain when the caller requested a reduced size decode,
+    // the tile placement is scaled to match the downsampled image.
+    DecoderStatus PrepareForConversion(
+        const aom_image_t* frame,
+        const DecodeInfo* decodeInfo,
+        AvifNative::ScopedAOMImage& downsampledFrame,
+        DecodeInfo& downsampledDecodeInfo,
+        const aom_image_t*& image,
+        const DecodeInfo*& imageDecodeInfo)
+    {
+        image = frame;
+        imageDecodeInfo = decodeInfo;
 
-            for (uint32_t x = 0; x < copyWidth; ++x)
+        if (decodeInfo->downsampleShift != 0)
+        {
+            downsampledFrame.reset(DownsampleImage(frame, decodeInfo->downsampleShift));
+            if (!downsampledFrame)
             {
-                // Unpack YUV into unorm
-                uint8_t unormY = ptrY[x];
-
-                // Convert unorm to float
-                const float Y = tables.unormFloatTableY[unormY];
+                return DecoderStatus::OutOfMemory;
+            }
 
-                float A = Clamp(Y, 0.0f, 1.0f);
+            downsampledDecodeInfo = *decodeInfo;
+            downsampledDecodeInfo.expectedWidth = GetDownsampledDimension(decodeInfo->expectedWidth, decodeInfo->downsampleShift);
+            downsampledDecodeInfo.expectedHeight = GetDownsampledDimension(decodeInfo->expectedHeight, decodeInfo->downsampleShift);
 
-                dstPtr->a = static_cast<uint8_t>(0.5f + (A * rgbMaxChannel));
-                ++dstPtr;
-            }
+            image = downsampledFrame.get();
+            imageDecodeInfo = &downsampledDecodeInfo;
         }
-    }
-}
 
-DecoderStatus ConvertColorImage(
-    const aom_image_t* frame,
-    const CICPColorData* containerColorInfo,
-    DecodeInfo* decodeInfo,
-    BitmapData* outputImage)
-{
-    if (!frame || !outputImage)
-    {
-        return DecoderStatus::NullParameter;
+        return DecoderStatus::Ok;
     }
 
-    const bool isFirstTile = decodeInfo->tileColumnIndex == 0 && decodeInfo->tileRowIndex == 0;
-
-    if (isFirstTile)
+    DecoderStatus CheckColorImageFormat(
+        const aom_image_t* frame,
+        const CICPColorData* containerColorInfo,
+        DecodeInfo* decodeInfo,
+        CICPColorData& colorInfo)
     {
-        if (decodeInfo->expectedWidth == 0 && decodeInfo->expectedHeight == 0)
-        {
-            decodeInfo->expectedWidth = frame->d_w;
-            decodeInfo->expectedHeight = frame->d_h;
-        }
+        // The bit depth is set by the first image or tile that is decoded, the remaining tiles are checked against it.
+        const bool isFirstTile = decodeInfo->bitDepth == 0;
 
-        decodeInfo->bitDepth = frame->bit_depth;
-        if (frame->monochrome)
-        {
-            decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling400;
-        }
-        else if (containerColorInfo && containerColorInfo->matrixCoefficients == CICPMatrixCoefficients::Identity
-                 || !containerColorInfo && frame->mc == AOM_CICP_MC_IDENTITY)
+        if (isFirstTile)
         {
-            decodeInfo->chromaSubsampling = YUVChromaSubsampling::IdentityMatrix;
+            if (decodeInfo->expectedWidth == 0 && decodeInfo->expectedHeight == 0)
+            {
+                decodeInfo->expectedWidth = frame->d_w;
+                decodeInfo->expectedHeight = frame->d_h;
+            }
+
+            decodeInfo->bitDepth = frame->bit_depth;
+            if (frame->monochrome)
+            {
+                decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling400;
+            }
+            else if ((containerColorInfo && containerColorInfo->matrixCoefficients == CICPMatrixCoefficients::Identity)
+                     || (!containerColorInfo && frame->mc == AOM_CICP_MC_IDENTITY))
+            {
+                decodeInfo->chromaSubsampling = YUVChromaSubsampling::IdentityMatrix;
+            }
+            else
+            {
+                switch (frame->fmt)
+                {
+                case AOM_IMG_FMT_I420:
+                case AOM_IMG_FMT_AOMI420:
+                case AOM_IMG_FMT_I42016:
+                case AOM_IMG_FMT_YV12:
+                case AOM_IMG_FMT_AOMYV12:
+                case AOM_IMG_FMT_YV1216:
+                    decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling420;
+                    break;
+                case AOM_IMG_FMT_I422:
+                case AOM_IMG_FMT_I42216:
+                    decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling422;
+                    break;
+                case AOM_IMG_FMT_I444:
+                case AOM_IMG_FMT_I44416:
+                    decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling444;
+                    break;
+                case AOM_IMG_FMT_NONE:
+                default:
+                    return DecoderStatus::UnknownYUVFormat;
+                }
+            }
         }
         else
         {
-            switch (frame->fmt)
+            if (frame->bit_depth != decodeInfo->bitDepth)
+            {
+                return DecoderStatus::TileFormatMismatch;
+            }
+
+            switch (decodeInfo->chromaSubsampling)
             {
-            case AOM_IMG_FMT_I420:
-            case AOM_IMG_FMT_AOMI420:
-            case AOM_IMG_FMT_I42016:
-            case AOM_IMG_FMT_YV12:
-            case AOM_IMG_FMT_AOMYV12:
-            case AOM_IMG_FMT_YV1216:
-                decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling420;
+            case YUVChromaSubsampling::Subsampling400:
+                if (!frame->monochrome)
+                {
+                    return DecoderStatus::TileFormatMismatch;
+                }
+                break;
+            case YUVChromaSubsampling::Subsampling420:
+                if (frame->fmt != AOM_IMG_FMT_I420
+                    && frame->fmt != AOM_IMG_FMT_AOMI420
+                    && frame->fmt != AOM_IMG_FMT_I42016
+                    && frame->fmt != AOM_IMG_FMT_YV12
+                    && frame->fmt != AOM_IMG_FMT_AOMYV12
+                    && frame->fmt != AOM_IMG_FMT_YV1216)
+                {
+                    return DecoderStatus::TileFormatMismatch;
+                }
                 break;
-            case AOM_IMG_FMT_I422:
-            case AOM_IMG_FMT_I42216:
-                decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling422;
+            case YUVChromaSubsampling::Subsampling422:
+                if (frame->fmt != AOM_IMG_FMT_I422 && frame->fmt != AOM_IMG_FMT_I42216)
+                {
+                    return DecoderStatus::TileFormatMismatch;
+                }
                 break;
-            case AOM_IMG_FMT_I444:
-            case AOM_IMG_FMT_I44416:
-                decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling444;
+            case YUVChromaSubsampling::Subsampling444:
+                if (frame->fmt != AOM_IMG_FMT_I444 && frame->fmt != AOM_IMG_FMT_I44416)
+                {
+                    return DecoderStatus::TileFormatMismatch;
+                }
+                break;
+            case YUVChromaSubsampling::IdentityMatrix:
+                if (!containerColorInfo && frame->mc != AOM_CICP_MC_IDENTITY)
+                {
+                    return DecoderStatus::TileFormatMismatch;
+                }
                 break;
-            case AOM_IMG_FMT_NONE:
             default:
                 return DecoderStatus::UnknownYUVFormat;
             }
         }
-    }
-    else
-    {
-        if (frame->bit_depth != decodeInfo->bitDepth)
+
+        if (containerColorInfo)
         {
-            return DecoderStatus::TileFormatMismatch;
+            colorInfo = *containerColorInfo;
         }
-
-        switch (decodeInfo->chromaSubsampling)
+        else
         {
-        case YUVChromaSubsampling::Subsampling400:
-            if (!frame->monochrome)
-            {
-                return DecoderStatus::TileFormatMismatch;
-            }
-            break;
-        case YUVChromaSubsampling::Subsampling420:
-            if (frame->fmt != AOM_IMG_FMT_I420
-                && frame->fmt != AOM_IMG_FMT_AOMI420
-                && frame->fmt != AOM_IMG_FMT_I42016
-                && frame->fmt != AOM_IMG_FMT_YV12
-                && frame->fmt != AOM_IMG_FMT_AOMYV12
-                && frame->fmt != AOM_IMG_FMT_YV1216)
-            {
-                return DecoderStatus::TileFormatMismatch;
-            }
-            break;
-        case YUVChromaSubsampling::Subsampling422:
-            if (frame->fmt != AOM_IMG_FMT_I422 && frame->fmt != AOM_IMG_FMT_I42216)
-            {
-                return DecoderStatus::TileFormatMismatch;
-            }
-            break;
-        case YUVChromaSubsampling::Subsampling444:
-            if (frame->fmt != AOM_IMG_FMT_I444 && frame->fmt != AOM_IMG_FMT_I44416)
+            colorInfo.colorPrimaries = static_cast<CICPColorPrimaries>(frame->cp);
+            colorInfo.transferCharacteristics = static_cast<CICPTransferCharacteristics>(frame->tc);
+            colorInfo.matrixCoefficients = static_cast<CICPMatrixCoefficients>(frame->mc);
+            colorInfo.fullRange = frame->range == aom_color_range::AOM_CR_FULL_RANGE;
+
+            if (isFirstTile)
             {
-                return DecoderStatus::TileFormatMismatch;
+                decodeInfo->firstTileColorData.colorPrimaries = colorInfo.colorPrimaries;
+                decodeInfo->firstTileColorData.transferCharacteristics = colorInfo.transferCharacteristics;
+                decodeInfo->firstTileColorData.matrixCoefficients = colorInfo.matrixCoefficients;
+                decodeInfo->firstTileColorData.fullRange = colorInfo.fullRange;
             }
-            break;
-        case YUVChromaSubsampling::IdentityMatrix:
-            if (!containerColorInfo && frame->mc != AOM_CICP_MC_IDENTITY)
+            else
             {
-                return DecoderStatus::TileFormatMismatch;
+                if (decodeInfo->firstTileColorData.colorPrimaries != colorInfo.colorPrimaries ||
+                    decodeInfo->firstTileColorData.transferCharacteristics != colorInfo.transferCharacteristics ||
+                    decodeInfo->firstTileColorData.matrixCoefficients != colorInfo.matrixCoefficients ||
+                    decodeInfo->firstTileColorData.fullRange != colorInfo.fullRange)
+                {
+                    return DecoderStatus::TileNclxProfileMismatch;
+                }
             }
-            break;
-        default:
-            return DecoderStatus::UnknownYUVFormat;
         }
-    }
 
-    CICPColorData colorInfo = {};
-
-    if (containerColorInfo)
-    {
-        colorInfo = *containerColorInfo;
+        return DecoderStatus::Ok;
     }
-    else
+
+    DecoderStatus CheckAlphaImageFormat(
+        const aom_image_t* frame,
+        DecodeInfo* decodeInfo)
     {
-        colorInfo.colorPrimaries = static_cast<CICPColorPrimaries>(frame->cp);
-        colorInfo.transferCharacteristics = static_cast<CICPTransferCharacteristics>(frame->tc);
-        colorInfo.matrixCoefficients = static_cast<CICPMatrixCoefficients>(frame->mc);
-        colorInfo.fullRange = frame->range == aom_color_range::AOM_CR_FULL_RANGE;
+        // The bit depth is set by the first image or tile that is decoded, the remaining tiles are checked against it.
+        const bool isFirstTile = decodeInfo->bitDepth == 0;
 
         if (isFirstTile)
         {
-            decodeInfo->firstTileColorData.colorPrimaries = colorInfo.colorPrimaries;
-            decodeInfo->firstTileColorData.transferCharacteristics = colorInfo.transferCharacteristics;
-            decodeInfo->firstTileColorData.matrixCoefficients = colorInfo.matrixCoefficients;
-            decodeInfo->firstTileColorData.fullRange = colorInfo.fullRange;
+            if (decodeInfo->expectedWidth == 0 && decodeInfo->expectedHeight == 0)
+            {
+                decodeInfo->expectedWidth = frame->d_w;
+                decodeInfo->expectedHeight = frame->d_h;
+            }
+            decodeInfo->bitDepth = frame->bit_depth;
+            decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling400;
         }
         else
         {
-            if (decodeInfo->firstTileColorData.colorPrimaries != colorInfo.colorPrimaries ||
-                decodeInfo->firstTileColorData.transferCharacteristics != colorInfo.transferCharacteristics ||
-                decodeInfo->firstTileColorData.matrixCoefficients != colorInfo.matrixCoefficients ||
-                decodeInfo->firstTileColorData.fullRange != colorInfo.fullRange)
+            if (frame->bit_depth != decodeInfo->bitDepth)
             {
-                return DecoderStatus::TileNclxProfileMismatch;
+                return DecoderStatus::TileFormatMismatch;
             }
         }
+
+        return DecoderStatus::Ok;
     }
 
-    try
+    // The color and alpha images can only be converted together when they cover the same area of the output image.
+    bool HasSameLayout(
+        const aom_image_t* colorImage,
+        const DecodeInfo* colorDecodeInfo,
+        const aom_image_t* alphaImage,
+        const DecodeInfo* alphaDecodeInfo)
     {
+        return colorImage->d_w == alphaImage->d_w
+            && colorImage->d_h == alphaImage->d_h
+            && colorDecodeInfo->expectedWidth == alphaDecodeInfo->expectedWidth
+            && colorDecodeInfo->expectedHeight == alphaDecodeInfo->expectedHeight
+            && colorDecodeInfo->tileColumnIndex == alphaDecodeInfo->tileColumnIndex
+            && colorDecodeInfo->tileRowIndex == alphaDecodeInfo->tileRowIndex
+            && colorDecodeInfo->outputX == alphaDecodeInfo->outputX
+            && colorDecodeInfo->outputY == alphaDecodeInfo->outputY
+            && colorDecodeInfo->outputRotation == alphaDecodeInfo->outputRotation
+            && colorDecodeInfo->outputMirror == alphaDecodeInfo->outputMirror;
+    }
+
+    template <typename AlphaSource>
+    void ConvertColorPixels(
+        const aom_image_t* image,
+        const CICPColorData& colorInfo,
+        const DecodeInfo* decodeInfo,
+        const AlphaSource& alphaSource,
+        BitmapData* outputImage,
+        int maxThreads)
+    {
+        const CopyRegion copyRegion = GetCopyRegion(image, decodeInfo, outputImage);
+
         if (colorInfo.matrixCoefficients == CICPMatrixCoefficients::Identity)
         {
             // The Identity matrix coefficient contains RGB color values.
 
-            if (frame->bit_depth > 8)
+            if (image->bit_depth > 8)
             {
-                std::unique_ptr<YUVLookupTables> lookupTable = std::make_unique<YUVLookupTables>(frame, true);
+                std::shared_ptr<const YUVLookupTables> lookupTable = YUVLookupTableCache::Get(image, true);
 
-                if (frame->monochrome)
+                if (image->monochrome)
                 {
-                    Identity16ToRGB8Mono(frame,
-                        decodeInfo,
-                        *lookupTable,
-                        outputImage);
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        Identity16ToRGB8Mono(image,
+                            block,
+                            *lookupTable,
+                            alphaSource);
+                    });
                 }
                 else
                 {
-                    Identity16ToRGB8Color(frame,
-                        decodeInfo,
-                        *lookupTable,
-                        outputImage);
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        Identity16ToRGB8Color(image,
+                            block,
+                            *lookupTable,
+                            alphaSource);
+                    });
                 }
             }
             else
             {
-                if (frame->monochrome)
+                if (image->monochrome)
                 {
-                    Identity8ToRGB8Mono(frame,
-                        decodeInfo,
-                        outputImage);
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        Identity8ToRGB8Mono(image,
+                            block,
+                            alphaSource);
+                    });
                 }
                 else
                 {
-                    Identity8ToRGB8Color(frame,
-                        decodeInfo,
-                        outputImage);
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        Identity8ToRGB8Color(image,
+                            block,
+                            alphaSource);
+                    });
                 }
             }
         }
         else
         {
-            std::unique_ptr<YUVLookupTables> lookupTable = std::make_unique<YUVLookupTables>(frame, false);
-
             YUVCoefficiants yuvCoefficiants;
             GetYUVCoefficiants(colorInfo, yuvCoefficiants);
 
-            if (frame->bit_depth > 8)
+            if (image->bit_depth > 8)
             {
-                if (frame->monochrome)
+                std::shared_ptr<const YUVLookupTables> lookupTable = YUVLookupTableCache::Get(image, false);
+
+                if (image->monochrome)
                 {
-                    YUV16ToRGB8Mono(frame,
-                        yuvCoefficiants,
-                        *lookupTable,
-                        decodeInfo,
-                        outputImage);
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        YUV16ToRGB8Mono(image,
+                            yuvCoefficiants,
+                            *lookupTable,
+                            block,
+                            alphaSource);
+                    });
                 }
                 else
                 {
-                    YUV16ToRGB8Color(frame,
-                        yuvCoefficiants,
-                        *lookupTable,
-                        decodeInfo,
-                        outputImage);
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        YUV16ToRGB8Color(image,
+                            yuvCoefficiants,
+                            *lookupTable,
+                            block,
+                            alphaSource);
+                    });
                 }
             }
             else
             {
-                if (frame->monochrome)
+#if AVIF_FIXED_POINT_YUV_CONVERSION
+                if (image->monochrome)
                 {
-                    YUV8ToRGB8Mono(frame,
-                        yuvCoefficiants,
-                        *lookupTable,
-                        decodeInfo,
-                        outputImage);
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        YUV8ToRGB8MonoFixedPoint(image,
+                            block,
+                            alphaSource);
+                    });
                 }
                 else
                 {
-                    YUV8ToRGB8Color(frame,
-                        yuvCoefficiants,
-                        *lookupTable,
-                        decodeInfo,
-                        outputImage);
+                    FixedPointYUVCoefficiants fixedPointCoefficiants;
+                    GetFixedPointYUVCoefficiants(yuvCoefficiants, fixedPointCoefficiants);
+
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        YUV8ToRGB8ColorFixedPoint(image,
+                            fixedPointCoefficiants,
+                            block,
+                            alphaSource);
+                    });
+                }
+#else
+                std::shared_ptr<const YUVLookupTables> lookupTable = YUVLookupTableCache::Get(image, false);
+
+                if (image->monochrome)
+                {
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        YUV8ToRGB8Mono(image,
+                            yuvCoefficiants,
+                            *lookupTable,
+                            block,
+                            alphaSource);
+                    });
                 }
+                else
+                {
+                    ForEachCopyBlock(copyRegion, maxThreads, [&](const CopyRegion& block)
+                    {
+                        YUV8ToRGB8Color(image,
+                            yuvCoefficiants,
+                            *lookupTable,
+                            block,
+                            alphaSource);
+                    });
+                }
+#endif
             }
         }
     }
+}
+
+DecoderStatus ConvertColorImage(
+    const aom_image_t* frame,
+    const CICPColorData* containerColorInfo,
+    DecodeInfo* decodeInfo,
+    BitmapData* outputImage,
+    int maxThreads)
+{
+    if (!frame || !outputImage)
+    {
+        return DecoderStatus::NullParameter;
+    }
+
+    if (decodeInfo->downsampleShift > MaxDownsampleShift || !IsValidOutputTransform(decodeInfo, outputImage))
+    {
+        return DecoderStatus::InvalidParameter;
+    }
+
+    CICPColorData colorInfo = {};
+
+    DecoderStatus status = CheckColorImageFormat(frame, containerColorInfo, decodeInfo, colorInfo);
+    if (status != DecoderStatus::Ok)
+    {
+        return status;
+    }
+
+    AvifNative::ScopedAOMImage downsampledFrame;
+    DecodeInfo downsampledDecodeInfo = {};
+
+    try
+    {
+        const aom_image_t* image;
+        const DecodeInfo* imageDecodeInfo;
+
+        status = PrepareForConversion(frame, decodeInfo, downsampledFrame, downsampledDecodeInfo, image, imageDecodeInfo);
+        if (status != DecoderStatus::Ok)
+        {
+            return status;
+        }
+
+        // The alpha channel is set to opaque in the same pass, an alpha image is written over it
+        // when the color and alpha images are converted separately.
+        ConvertColorPixels(image, colorInfo, imageDecodeInfo, OpaqueAlphaSource(), outputImage, maxThreads);
+    }
     catch (const std::bad_alloc&)
     {
         return DecoderStatus::OutOfMemory;
     }
     catch (const unknown_bit_depth_error&)
     {
-        // The YUVLookupTables constructor throws this for unsupported image bit depths.
+        // The YUVLookupTableCache throws this for unsupported image bit depths.
         return DecoderStatus::UnsupportedBitDepth;
     }
 
@@ -986,51 +1662,140 @@ DecoderStatus ConvertColorImage(
 DecoderStatus ConvertAlphaImage(
     const aom_image_t* frame,
     DecodeInfo* decodeInfo,
-    BitmapData* outputBGRAImageData)
+    BitmapData* outputBGRAImageData,
+    int maxThreads)
 {
     if (!frame || !outputBGRAImageData)
     {
         return DecoderStatus::NullParameter;
     }
 
-    const bool isFirstTile = decodeInfo->tileColumnIndex == 0 && decodeInfo->tileRowIndex == 0;
+    if (decodeInfo->downsampleShift > MaxDownsampleShift || !IsValidOutputTransform(decodeInfo, outputBGRAImageData))
+    {
+        return DecoderStatus::InvalidParameter;
+    }
 
-    if (isFirstTile)
+    DecoderStatus status = CheckAlphaImageFormat(frame, decodeInfo);
+    if (status != DecoderStatus::Ok)
     {
-        if (decodeInfo->expectedWidth == 0 && decodeInfo->expectedHeight == 0)
-        {
-            decodeInfo->expectedWidth = frame->d_w;
-            decodeInfo->expectedHeight = frame->d_h;
-        }
-        decodeInfo->bitDepth = frame->bit_depth;
-        decodeInfo->chromaSubsampling = YUVChromaSubsampling::Subsampling400;
+        return status;
     }
-    else
+
+    AvifNative::ScopedAOMImage downsampledFrame;
+    DecodeInfo downsampledDecodeInfo = {};
+
+    try
     {
-        if (frame->bit_depth != decodeInfo->bitDepth)
+        const aom_image_t* image;
+        const DecodeInfo* imageDecodeInfo;
+
+        status = PrepareForConversion(frame, decodeInfo, downsampledFrame, downsampledDecodeInfo, image, imageDecodeInfo);
+        if (status != DecoderStatus::Ok)
         {
-            return DecoderStatus::TileFormatMismatch;
+            return status;
         }
+
+        UseAlphaSource(image, [&](const auto& alphaSource)
+        {
+            WriteAlphaPixels(image, imageDecodeInfo, alphaSource, outputBGRAImageData, maxThreads);
+        });
+    }
+    catch (const std::bad_alloc&)
+    {
+        return DecoderStatus::OutOfMemory;
+    }
+    catch (const unknown_bit_depth_error&)
+    {
+        // The YUVLookupTableCache throws this for unsupported image bit depths.
+        return DecoderStatus::UnsupportedBitDepth;
+    }
+
+    return DecoderStatus::Ok;
+}
+
+DecoderStatus ConvertColorAndAlphaImage(
+    const aom_image_t* colorFrame,
+    const aom_image_t* alphaFrame,
+    const CICPColorData* containerColorInfo,
+    DecodeInfo* colorDecodeInfo,
+    DecodeInfo* alphaDecodeInfo,
+    BitmapData* outputImage,
+    int maxThreads)
+{
+    if (!colorFrame || !alphaFrame || !outputImage)
+    {
+        return DecoderStatus::NullParameter;
     }
 
+    if (colorDecodeInfo->downsampleShift > MaxDownsampleShift || !IsValidOutputTransform(colorDecodeInfo, outputImage) ||
+        alphaDecodeInfo->downsampleShift > MaxDownsampleShift || !IsValidOutputTransform(alphaDecodeInfo, outputImage))
+    {
+        return DecoderStatus::InvalidParameter;
+    }
+
+    CICPColorData colorInfo = {};
+
+    DecoderStatus status = CheckColorImageFormat(colorFrame, containerColorInfo, colorDecodeInfo, colorInfo);
+    if (status != DecoderStatus::Ok)
+    {
+        return status;
+    }
+
+    status = CheckAlphaImageFormat(alphaFrame, alphaDecodeInfo);
+    if (status != DecoderStatus::Ok)
+    {
+        return status;
+    }
+
+    AvifNative::ScopedAOMImage downsampledColorFrame;
+    DecodeInfo downsampledColorDecodeInfo = {};
+    AvifNative::ScopedAOMImage downsampledAlphaFrame;
+    DecodeInfo downsampledAlphaDecodeInfo = {};
+
     try
     {
-        std::unique_ptr<YUVLookupTables> lookupTable = std::make_unique<YUVLookupTables>(frame, false);
+        const aom_image_t* colorImage;
+        const DecodeInfo* colorImageDecodeInfo;
+        const aom_image_t* alphaImage;
+        const DecodeInfo* alphaImageDecodeInfo;
+
+        status = PrepareForConversion(colorFrame,
+                                      colorDecodeInfo,
+                                      downsampledColorFrame,
+                                      downsampledColorDecodeInfo,
+                                      colorImage,
+                                      colorImageDecodeInfo);
+        if (status != DecoderStatus::Ok)
+        {
+            return status;
+        }
 
-        if (frame->bit_depth > 8)
+        status = PrepareForConversion(alphaFrame,
+                                      alphaDecodeInfo,
+                                      downsampledAlphaFrame,
+                                      downsampledAlphaDecodeInfo,
+                                      alphaImage,
+                                      alphaImageDecodeInfo);
+        if (status != DecoderStatus::Ok)
         {
-            YUV16ToAlpha8(frame,
-                decodeInfo,
-                *lookupTable,
-                outputBGRAImageData);
+            return status;
+        }
+
+        if (HasSameLayout(colorImage, colorImageDecodeInfo, alphaImage, alphaImageDecodeInfo))
+        {
+            UseAlphaSource(alphaImage, [&](const auto& alphaSource)
+            {
+                ConvertColorPixels(colorImage, colorInfo, colorImageDecodeInfo, alphaSource, outputImage, maxThreads);
+            });
         }
         else
         {
-            YUV8ToAlpha8(frame,
-                decodeInfo,
-                *lookupTable,
-                outputBGRAImageData);
+            ConvertColorPixels(colorImage, colorInfo, colorImageDecodeInfo, OpaqueAlphaSource(), outputImage, maxThreads);
 
+            UseAlphaSource(alphaImage, [&](const auto& alphaSource)
+            {
+                WriteAlphaPixels(alphaImage, alphaImageDecodeInfo, alphaSource, outputImage, maxThreads);
+            });
         }
     }
     catch (const std::bad_alloc&)
@@ -1039,7 +1804,7 @@ DecoderStatus ConvertAlphaImage(
     }
     catch (const unknown_bit_depth_error&)
     {
-        // The YUVLookupTables constructor throws this for unsupported image bit depths.
+        // The YUVLookupTableCache throws this for unsupported image bit depths.
         return DecoderStatus::UnsupportedBitDepth;
     }
 
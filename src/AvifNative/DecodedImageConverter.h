@@ -15,13 +15,27 @@
 #include "AvifNative.h"
 #include <aom/aom_image.h>
 
+// The maxThreads parameter limits the number of threads that are used to convert large images.
+
 DecoderStatus ConvertColorImage(
     const aom_image_t* frame,
     const CICPColorData* containerColorInfo,
     DecodeInfo* decodeInfo,
-    BitmapData* outputBGRAImageData);
+    BitmapData* outputBGRAImageData,
+    int maxThreads);
 
 DecoderStatus ConvertAlphaImage(
     const aom_image_t* frame,
     DecodeInfo* decodeInfo,
-    BitmapData* outputBGRAImageData);
+    BitmapData* outputBGRAImageData,
+    int maxThreads);
+
+// Converts the color and alpha images in a single pass over the output image.
+DecoderStatus ConvertColorAndAlphaImage(
+    const aom_image_t* colorFrame,
+    const aom_image_t* alphaFrame,
+    const CICPColorData* containerColorInfo,
+    DecodeInfo* colorDecodeInfo,
+    DecodeInfo* alphaDecodeInfo,
+    BitmapData* outputImage,
+    int maxThreads);
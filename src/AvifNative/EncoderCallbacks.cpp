@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "EncoderCallbacks.h"
+
+EncoderCallbacks::EncoderCallbacks(ProgressContext* progressContext, CompressedAV1OutputAlloc outputAllocator, CompressedTileReady tileReady)
+    : progressContext(progressContext), outputAllocator(outputAllocator), tileReady(tileReady), mutex(), cancelled(false)
+{
+}
+
+bool EncoderCallbacks::ReportProgress()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (cancelled.load())
+    {
+        return false;
+    }
+
+    if (!progressContext->progressCallback(++progressContext->progressDone, progressContext->progressTotal))
+    {
+        cancelled = true;
+        return false;
+    }
+
+    return true;
+}
+
+void* EncoderCallbacks::AllocateOutput(size_t sizeInBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return outputAllocator(sizeInBytes);
+}
+
+bool EncoderCallbacks::ReportTileCompleted(uint32_t tileIndex, void* compressedColorImage, void* compressedAlphaImage)
+{
+    if (!tileReady)
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return tileReady(tileIndex, compressedColorImage, compressedAlphaImage);
+}
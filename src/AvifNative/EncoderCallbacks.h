@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AvifNative.h"
+#include <atomic>
+#include <mutex>
+
+// Wraps the caller-provided progress, output allocation and tile completion callbacks.
+// The managed callbacks are not thread-safe, so the calls are serialized when
+// multiple images are being encoded concurrently.
+class EncoderCallbacks
+{
+public:
+    EncoderCallbacks(ProgressContext* progressContext, CompressedAV1OutputAlloc outputAllocator, CompressedTileReady tileReady = nullptr);
+
+    EncoderCallbacks(const EncoderCallbacks&) = delete;
+    EncoderCallbacks& operator=(const EncoderCallbacks&) = delete;
+
+    // Reports that an encoding stage has completed.
+    // Returns false if the user has cancelled the operation.
+    bool ReportProgress();
+
+    void* AllocateOutput(size_t sizeInBytes);
+
+    // Passes a completed image grid tile to the caller, if the caller requested it.
+    // Returns false if the caller could not process the tile.
+    bool ReportTileCompleted(uint32_t tileIndex, void* compressedColorImage, void* compressedAlphaImage);
+
+    bool IsCancelled() const noexcept
+    {
+        return cancelled.load();
+    }
+
+private:
+    ProgressContext* progressContext;
+    CompressedAV1OutputAlloc outputAllocator;
+    CompressedTileReady tileReady;
+    std::mutex mutex;
+    std::atomic<bool> cancelled;
+};
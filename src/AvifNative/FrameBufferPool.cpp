@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "FrameBufferPool.h"
+#include <new>
+#include <string.h>
+
+namespace
+{
+    // The buffer sizes are rounded up to a multiple of this value so that
+    // frames with slightly different sizes can share a bucket.
+    constexpr size_t BucketGranularity = 64 * 1024;
+
+    // The maximum number of unused bytes that the pool keeps, any buffers
+    // that are returned after this limit has been reached are freed.
+    constexpr size_t MaxRetainedBytes = 256 * 1024 * 1024;
+
+    size_t GetBucketSize(size_t minSize) noexcept
+    {
+        return ((minSize + BucketGranularity - 1) / BucketGranularity) * BucketGranularity;
+    }
+}
+
+FrameBufferPool::FrameBufferPool() : mutex(), freeBuffers(), retainedBytes(0)
+{
+}
+
+FrameBufferPool& FrameBufferPool::GetShared()
+{
+    // The pool is intentionally never destroyed, this avoids any issues with
+    // the static destructors running while a decoder is still active.
+    static FrameBufferPool* pool = new FrameBufferPool();
+
+    return *pool;
+}
+
+int FrameBufferPool::GetFrameBuffer(void* priv, size_t minSize, aom_codec_frame_buffer_t* frameBuffer) noexcept
+{
+    if (!priv || !frameBuffer || minSize == 0)
+    {
+        return -1;
+    }
+
+    FrameBufferPool* pool = static_cast<FrameBufferPool*>(priv);
+    const size_t bucketSize = GetBucketSize(minSize);
+
+    uint8_t* data;
+
+    try
+    {
+        data = pool->Rent(bucketSize);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return -1;
+    }
+
+    // libaom requires the frame buffer memory to be zero initialized.
+    memset(data, 0, bucketSize);
+
+    frameBuffer->data = data;
+    frameBuffer->size = bucketSize;
+    frameBuffer->priv = nullptr;
+
+    return 0;
+}
+
+int FrameBufferPool::ReleaseFrameBuffer(void* priv, aom_codec_frame_buffer_t* frameBuffer) noexcept
+{
+    if (!priv || !frameBuffer)
+    {
+        return -1;
+    }
+
+    if (frameBuffer->data)
+    {
+        FrameBufferPool* pool = static_cast<FrameBufferPool*>(priv);
+
+        pool->Return(frameBuffer->data, frameBuffer->size);
+
+        frameBuffer->data = nullptr;
+        frameBuffer->size = 0;
+    }
+
+    return 0;
+}
+
+uint8_t* FrameBufferPool::Rent(size_t bucketSize)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto bucket = freeBuffers.find(bucketSize);
+
+        if (bucket != freeBuffers.end() && !bucket->second.empty())
+        {
+            uint8_t* data = bucket->second.back().release();
+            bucket->second.pop_back();
+            retainedBytes -= bucketSize;
+
+            return data;
+        }
+    }
+
+    return new uint8_t[bucketSize];
+}
+
+void FrameBufferPool::Return(uint8_t* data, size_t bucketSize)
+{
+    std::unique_ptr<uint8_t[]> buffer(data);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (bucketSize <= MaxRetainedBytes - retainedBytes)
+    {
+        try
+        {
+            freeBuffers[bucketSize].push_back(std::move(buffer));
+            retainedBytes += bucketSize;
+        }
+        catch (const std::bad_alloc&)
+        {
+            // The buffer is freed when it cannot be added to the pool.
+        }
+    }
+}
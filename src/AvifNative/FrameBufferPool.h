@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <aom/aom_frame_buffer.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A process-wide pool of the libaom decoder frame buffers.
+//
+// The buffers are grouped into size buckets and returned to the pool when libaom releases
+// them, so decoding a series of tiles or images with the same dimensions reuses the
+// existing buffers instead of allocating new ones for every decoder instance.
+class FrameBufferPool
+{
+public:
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    // Gets the process-wide frame buffer pool.
+    static FrameBufferPool& GetShared();
+
+    // The aom_get_frame_buffer_cb_fn_t callback, priv must point to a FrameBufferPool.
+    static int GetFrameBuffer(void* priv, size_t minSize, aom_codec_frame_buffer_t* frameBuffer) noexcept;
+
+    // The aom_release_frame_buffer_cb_fn_t callback, priv must point to a FrameBufferPool.
+    static int ReleaseFrameBuffer(void* priv, aom_codec_frame_buffer_t* frameBuffer) noexcept;
+
+private:
+    FrameBufferPool();
+
+    uint8_t* Rent(size_t bucketSize);
+    void Return(uint8_t* data, size_t bucketSize);
+
+    std::mutex mutex;
+    std::map<size_t, std::vector<std::unique_ptr<uint8_t[]>>> freeBuffers;
+    size_t retainedBytes;
+};
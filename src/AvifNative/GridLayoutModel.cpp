@@ -0,0 +1,392 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "GridLayoutModel.h"
+#include <algorithm>
+
+namespace
+{
+    // Although the HEIF specification (ISO/IEC 23008-12:2017) allows an image grid to have up to 256 tiles
+    // in each direction (65536 total), the ISO base media file format (ISO/IEC 14496-12:2015) limits
+    // an item reference box to 65535 items.
+    // Because of this we limit the maximum number of tiles in each direction to 250.
+    constexpr uint32_t MaxTileCount = 250;
+    // The MIAF specification (ISO/IEC 23000-22:2019) requires that the tile size be at least 64x64 pixels.
+    constexpr uint32_t MinTileSize = 64;
+    // The tiles are limited to the AV1 level 5.1 picture size, this bounds the memory that
+    // the encoder uses for each tile.
+    constexpr uint32_t MaxTileDimension = 8192;
+    constexpr uint64_t MaxTilePixelCount = 8912896;
+
+    // The tiles may not be longer than this many times their other dimension, long and narrow tiles
+    // have more tile boundary for their area.
+    constexpr uint32_t MaxTileAspectRatio = 4;
+
+    // The constants below were measured with libaom 3.6 by encoding 1280x768 and 512x384 images at quality 85
+    // with one thread, using the CPU time of the best of several runs.
+
+    // The relative time it takes to encode a pixel at each compression speed.
+    constexpr double FastPixelCost = 1.0;
+    constexpr double MediumPixelCost = 9.0;
+    constexpr double SlowPixelCost = 120.0;
+    // The fixed cost of encoding a tile, in pixels at the compression speed of the tile.
+    // This covers the per-frame work that does not scale with the tile size, the encoders are reused
+    // for the tiles so their setup is not included.
+    constexpr double TileSetupCost = 1000.0;
+    // The padding of the tiles that extend past the edges of the image repeats the last column and row,
+    // the encoder uses large blocks for it so a padding pixel takes less time than an image pixel.
+    constexpr double TilePaddingEncodeCost = 0.3;
+    // The row-based multi-threading processes the superblock rows as a wavefront, each row is kept
+    // this many superblocks behind the row above it.
+    constexpr uint32_t WavefrontLag = 2;
+
+    // The tiles are encoded independently, so the blocks on each side of a tile boundary cannot be
+    // predicted from the other tile.
+    // The cost of a tile boundary is estimated in pixels for each pixel of its length, and every tile
+    // after the first adds its own sequence header and container entries, which are about 48 bytes.
+    constexpr double TileBoundaryCost = 16.0;
+    constexpr double TileHeaderCost = 640.0;
+    // The size of a padding pixel relative to an image pixel.
+    constexpr double TilePaddingCost = 0.15;
+    // The largest predicted size increase that a grid layout may have.
+    constexpr double MaxSizeOverhead = 0.02;
+    // A grid layout must reduce the encode time by this many times its size overhead to be
+    // preferred over a layout with fewer tiles, e.g. a 1% larger file must be at least 10% faster.
+    constexpr double SizeOverheadWeight = 10.0;
+
+    double GetPixelCost(CompressionSpeed compressionSpeed)
+    {
+        switch (compressionSpeed)
+        {
+        case CompressionSpeed::Fast:
+            return FastPixelCost;
+        case CompressionSpeed::Medium:
+            return MediumPixelCost;
+        case CompressionSpeed::Slow:
+        case CompressionSpeed::VerySlow:
+        default:
+            return SlowPixelCost;
+        }
+    }
+
+    uint32_t DivideRoundUp(uint32_t value, uint32_t divisor)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(value) + divisor - 1) / divisor);
+    }
+
+    uint32_t RoundUpToMultiple(uint32_t value, uint32_t multiple)
+    {
+        return DivideRoundUp(value, multiple) * multiple;
+    }
+
+    // The speedup of the row-based multi-threading wavefront over a single thread.
+    // The threads take turns encoding the superblock rows, so the encode time is limited either by
+    // the number of rows that each thread encodes or by the lag between the first and last rows.
+    double GetWavefrontSpeedup(uint32_t superblockColumns, uint32_t superblockRows, uint32_t threadCount)
+    {
+        const double threadLimitedTime = (static_cast<double>(DivideRoundUp(superblockRows, threadCount)) * superblockColumns) +
+                                         (static_cast<double>(threadCount - 1) * WavefrontLag);
+        const double dependencyLimitedTime = superblockColumns + (static_cast<double>(superblockRows - 1) * WavefrontLag);
+
+        return (static_cast<double>(superblockColumns) * superblockRows) / std::max(threadLimitedTime, dependencyLimitedTime);
+    }
+
+    struct TileSize
+    {
+        uint32_t size;
+        uint32_t count;
+    };
+
+    // Returns the tile sizes for an image dimension, the tiles are a multiple of the smallest superblock size
+    // and the last tile extends past the edge of the image when the size does not divide the dimension.
+    // Only the smallest tile size is kept for each tile count, because it has the least padding.
+    std::vector<TileSize> GetTileSizes(uint32_t imageDimension)
+    {
+        std::vector<TileSize> tileSizes;
+        tileSizes.push_back({ imageDimension, 1 });
+
+        for (uint32_t tileSize = MinTileSize; tileSize < imageDimension; tileSize += MinTileSize)
+        {
+            const uint32_t tileCount = DivideRoundUp(imageDimension, tileSize);
+
+            if (tileCount <= MaxTileCount && tileCount != tileSizes.back().count)
+            {
+                tileSizes.push_back({ tileSize, tileCount });
+            }
+        }
+
+        return tileSizes;
+    }
+
+    // Rounds the tile size up to a multiple of the superblock size that libaom uses for the tiles, so that
+    // the tile boundaries are on superblock boundaries.
+    // Returns false if the tiles in the last column or row would start outside of the image, or if
+    // the tiles are smaller than the MIAF minimum or too long and narrow.
+    bool AlignTilesToSuperblocks(
+        uint32_t imageWidth,
+        uint32_t imageHeight,
+        CompressionSpeed compressionSpeed,
+        ImageGridLayout& layout)
+    {
+        if (layout.tileColumnCount == 1 && layout.tileRowCount == 1)
+        {
+            return true;
+        }
+
+        // libaom selects the superblock size from the size of the aligned tile, rounding the tile up can
+        // move it past the size where the encoder switches to 128x128 superblocks, so the tile is aligned
+        // again until the superblock size of the aligned tile does not change.
+        uint32_t superblockSize = 0;
+        uint32_t alignedSuperblockSize = GetSuperblockSize(layout.tileWidth, layout.tileHeight, compressionSpeed);
+
+        while (superblockSize != alignedSuperblockSize)
+        {
+            superblockSize = alignedSuperblockSize;
+
+            // A tile that spans the full image dimension does not have a tile boundary on that side.
+            if (layout.tileColumnCount > 1)
+            {
+                layout.tileWidth = RoundUpToMultiple(layout.tileWidth, superblockSize);
+            }
+
+            if (layout.tileRowCount > 1)
+            {
+                layout.tileHeight = RoundUpToMultiple(layout.tileHeight, superblockSize);
+            }
+
+            alignedSuperblockSize = GetSuperblockSize(layout.tileWidth, layout.tileHeight, compressionSpeed);
+        }
+
+        return layout.tileWidth >= MinTileSize && layout.tileHeight >= MinTileSize &&
+               (static_cast<uint64_t>(layout.tileColumnCount - 1) * layout.tileWidth) < imageWidth &&
+               (static_cast<uint64_t>(layout.tileRowCount - 1) * layout.tileHeight) < imageHeight &&
+               layout.tileWidth <= static_cast<uint64_t>(layout.tileHeight) * MaxTileAspectRatio &&
+               layout.tileHeight <= static_cast<uint64_t>(layout.tileWidth) * MaxTileAspectRatio;
+    }
+
+    GridLayoutCost PredictGridLayoutCost(
+        uint32_t imageWidth,
+        uint32_t imageHeight,
+        const ImageGridLayout& layout,
+        CompressionSpeed compressionSpeed,
+        int maxThreads,
+        int poolConcurrency)
+    {
+        const size_t tileCount = static_cast<size_t>(layout.tileColumnCount) * layout.tileRowCount;
+
+        const double imagePixelCount = static_cast<double>(imageWidth) * imageHeight;
+        const double paddingPixelCount = (static_cast<double>(tileCount) * layout.tileWidth * layout.tileHeight) - imagePixelCount;
+
+        // The tiles in the last column and row have less work than the others when they are padded,
+        // the encode time uses the average cost of the tiles.
+        const double averageTilePixelCount = (imagePixelCount + (paddingPixelCount * TilePaddingEncodeCost)) / static_cast<double>(tileCount);
+        const double tileCost = (averageTilePixelCount + TileSetupCost) * GetPixelCost(compressionSpeed);
+
+        // The tiles are scheduled in the same way as CompressImageGrid.
+        const GridThreadBudget budget = GetGridThreadBudget(maxThreads, compressionSpeed, &layout, tileCount, poolConcurrency);
+        const uint32_t superblockSize = GetSuperblockSize(layout.tileWidth, layout.tileHeight, compressionSpeed);
+        const int tileThreads = std::min(budget.threadsPerTile, GetUsefulAOMThreadCount(layout.tileWidth, layout.tileHeight, compressionSpeed));
+        const double tileSpeedup = GetWavefrontSpeedup(
+            DivideRoundUp(layout.tileWidth, superblockSize),
+            DivideRoundUp(layout.tileHeight, superblockSize),
+            static_cast<uint32_t>(tileThreads));
+        const size_t tileConcurrency = static_cast<size_t>(budget.tileConcurrency);
+        const size_t tileWaves = (tileCount + tileConcurrency - 1) / tileConcurrency;
+
+        const uint64_t boundaryLength = (static_cast<uint64_t>(layout.tileColumnCount - 1) * imageHeight) +
+                                        (static_cast<uint64_t>(layout.tileRowCount - 1) * imageWidth);
+
+        GridLayoutCost cost;
+        cost.encodeTime = (static_cast<double>(tileWaves) * tileCost) / tileSpeedup;
+        cost.sizeOverhead = ((static_cast<double>(boundaryLength) * TileBoundaryCost) +
+                             (static_cast<double>(tileCount - 1) * TileHeaderCost) +
+                             (paddingPixelCount * TilePaddingCost)) / imagePixelCount;
+
+        return cost;
+    }
+}
+
+// libaom selects the superblock size from the frame size and the encoder speed, the real-time mode
+// that the Fast speed uses switches to 128x128 superblocks above 720p and the Medium speed above 480p.
+// The Slow and VerySlow speeds always use 128x128 superblocks.
+uint32_t GetSuperblockSize(uint32_t width, uint32_t height, CompressionSpeed compressionSpeed)
+{
+    const uint32_t minDimension = std::min(width, height);
+
+    switch (compressionSpeed)
+    {
+    case CompressionSpeed::Fast:
+        return minDimension > 720 ? 128 : 64;
+    case CompressionSpeed::Medium:
+        return minDimension > 480 ? 128 : 64;
+    case CompressionSpeed::Slow:
+    case CompressionSpeed::VerySlow:
+    default:
+        return 128;
+    }
+}
+
+// Adding row-based multi-threading threads stops reducing the encode time when every
+// superblock row has a thread, or when the first thread finishes its row before the
+// last thread can start.
+int GetUsefulAOMThreadCount(uint32_t width, uint32_t height, CompressionSpeed compressionSpeed)
+{
+    const uint32_t superblockSize = GetSuperblockSize(width, height, compressionSpeed);
+
+    const uint32_t superblockColumns = DivideRoundUp(width, superblockSize);
+    const uint32_t superblockRows = DivideRoundUp(height, superblockSize);
+
+    return static_cast<int>(std::max(std::min(superblockRows, DivideRoundUp(superblockColumns, WavefrontLag)), 1U));
+}
+
+// The tiles are given as many encoder threads as they can use, and the remaining
+// threads are used to encode multiple tiles at the same time.
+GridThreadBudget GetGridThreadBudget(
+    int maxThreads,
+    CompressionSpeed compressionSpeed,
+    const ImageGridLayout* gridLayout,
+    size_t encodedTileCount,
+    int poolConcurrency)
+{
+    const int threadCount = std::max(maxThreads, 1);
+    const int tileCount = static_cast<int>(encodedTileCount);
+    const int usefulThreadsPerTile = GetUsefulAOMThreadCount(gridLayout->tileWidth, gridLayout->tileHeight, compressionSpeed);
+
+    GridThreadBudget budget;
+
+    budget.tileConcurrency = std::min(std::max(threadCount / usefulThreadsPerTile, 1), std::min(tileCount, poolConcurrency));
+    budget.threadsPerTile = std::max(threadCount / budget.tileConcurrency, 1);
+
+    return budget;
+}
+
+std::vector<GridLayoutCandidate> GetGridLayoutCandidates(
+    uint32_t imageWidth,
+    uint32_t imageHeight,
+    CompressionSpeed compressionSpeed,
+    int maxThreads,
+    int poolConcurrency)
+{
+    const std::vector<TileSize> columnSizes = GetTileSizes(imageWidth);
+    const std::vector<TileSize> rowSizes = GetTileSizes(imageHeight);
+
+    std::vector<GridLayoutCandidate> candidates;
+    candidates.reserve(columnSizes.size() * rowSizes.size());
+
+    for (const TileSize& row : rowSizes)
+    {
+        for (const TileSize& column : columnSizes)
+        {
+            GridLayoutCandidate candidate;
+            candidate.layout.tileColumnCount = column.count;
+            candidate.layout.tileRowCount = row.count;
+            candidate.layout.tileWidth = column.size;
+            candidate.layout.tileHeight = row.size;
+
+            if (!AlignTilesToSuperblocks(imageWidth, imageHeight, compressionSpeed, candidate.layout))
+            {
+                continue;
+            }
+
+            candidate.cost = PredictGridLayoutCost(
+                imageWidth,
+                imageHeight,
+                candidate.layout,
+                compressionSpeed,
+                maxThreads,
+                poolConcurrency);
+            candidate.withinTileLimits = candidate.layout.tileWidth <= MaxTileDimension &&
+                                         candidate.layout.tileHeight <= MaxTileDimension &&
+                                         static_cast<uint64_t>(candidate.layout.tileWidth) * candidate.layout.tileHeight <= MaxTilePixelCount;
+            candidate.feasible = candidate.withinTileLimits && candidate.cost.sizeOverhead <= MaxSizeOverhead;
+
+            candidates.push_back(candidate);
+        }
+    }
+
+    return candidates;
+}
+
+ImageGridLayout SelectGridLayout(
+    uint32_t imageWidth,
+    uint32_t imageHeight,
+    CompressionSpeed compressionSpeed,
+    int maxThreads,
+    int poolConcurrency)
+{
+    ImageGridLayout singleTile;
+    singleTile.tileColumnCount = 1;
+    singleTile.tileRowCount = 1;
+    singleTile.tileWidth = imageWidth;
+    singleTile.tileHeight = imageHeight;
+
+    if (compressionSpeed == CompressionSpeed::VerySlow)
+    {
+        // Tiles are not used for the very slow compression speed.
+        return singleTile;
+    }
+
+    const std::vector<GridLayoutCandidate> candidates = GetGridLayoutCandidates(
+        imageWidth,
+        imageHeight,
+        compressionSpeed,
+        maxThreads,
+        poolConcurrency);
+
+    const GridLayoutCandidate* selected = nullptr;
+    double selectedScore = 0.0;
+
+    for (const GridLayoutCandidate& candidate : candidates)
+    {
+        if (candidate.feasible)
+        {
+            const double score = candidate.cost.encodeTime * (1.0 + (SizeOverheadWeight * candidate.cost.sizeOverhead));
+
+            if (!selected || score < selectedScore)
+            {
+                selected = &candidate;
+                selectedScore = score;
+            }
+        }
+    }
+
+    if (!selected)
+    {
+        // The image is too large to be encoded within the size overhead limit, use the layout with
+        // the lowest size overhead that is within the encoder limits.
+        for (const GridLayoutCandidate& candidate : candidates)
+        {
+            if (candidate.withinTileLimits && (!selected || candidate.cost.sizeOverhead < selected->cost.sizeOverhead))
+            {
+                selected = &candidate;
+            }
+        }
+
+        if (!selected)
+        {
+            // The image cannot be split into tiles that are within the encoder limits, use the
+            // smallest tiles to minimize the memory usage.
+            for (const GridLayoutCandidate& candidate : candidates)
+            {
+                const uint64_t tilePixelCount = static_cast<uint64_t>(candidate.layout.tileWidth) * candidate.layout.tileHeight;
+
+                if (!selected ||
+                    tilePixelCount < static_cast<uint64_t>(selected->layout.tileWidth) * selected->layout.tileHeight)
+                {
+                    selected = &candidate;
+                }
+            }
+        }
+    }
+
+    return selected ? selected->layout : singleTile;
+}
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AvifNative.h"
+#include <vector>
+
+struct GridThreadBudget
+{
+    int tileConcurrency;
+    int threadsPerTile;
+};
+
+// The predicted cost of encoding an image with a grid layout.
+struct GridLayoutCost
+{
+    // The predicted encode time, in units of the time it takes to encode one pixel at the Fast speed with one thread.
+    double encodeTime;
+    // The predicted compressed size increase from splitting the image into tiles, as a fraction of the image size.
+    double sizeOverhead;
+};
+
+struct GridLayoutCandidate
+{
+    ImageGridLayout layout;
+    GridLayoutCost cost;
+    // False if the tiles are larger than the encoder limits.
+    bool withinTileLimits;
+    // False if the tiles are larger than the encoder limits, or the size overhead is above the limit.
+    bool feasible;
+};
+
+// The superblock size that libaom selects for a frame of the specified size.
+uint32_t GetSuperblockSize(uint32_t width, uint32_t height, CompressionSpeed compressionSpeed);
+
+// The number of encoder threads that a single tile can keep busy.
+int GetUsefulAOMThreadCount(uint32_t width, uint32_t height, CompressionSpeed compressionSpeed);
+
+// Splits the thread budget between tile-level and libaom-level parallelism.
+GridThreadBudget GetGridThreadBudget(
+    int maxThreads,
+    CompressionSpeed compressionSpeed,
+    const ImageGridLayout* gridLayout,
+    size_t encodedTileCount,
+    int poolConcurrency);
+
+// Returns the grid layouts that split the image into tiles with a size that is a multiple of the superblock size,
+// the single tile layout is always the first candidate.
+// The tiles in the last column and row can extend past the right and bottom edges of the image.
+std::vector<GridLayoutCandidate> GetGridLayoutCandidates(
+    uint32_t imageWidth,
+    uint32_t imageHeight,
+    CompressionSpeed compressionSpeed,
+    int maxThreads,
+    int poolConcurrency);
+
+// Selects the grid layout with the lowest predicted encode time, a single tile layout is
+// returned when the image should not be split into tiles.
+ImageGridLayout SelectGridLayout(
+    uint32_t imageWidth,
+    uint32_t imageHeight,
+    CompressionSpeed compressionSpeed,
+    int maxThreads,
+    int poolConcurrency);
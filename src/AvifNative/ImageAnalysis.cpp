@@ -0,0 +1,342 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ImageAnalysis.h"
+#include "ImageAnalysisSIMD.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <mutex>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // The number of image rows in each unit of parallel work.
+    constexpr uint32_t AnalysisBandHeight = 64;
+
+    uint32_t ToUInt32(ColorBgra color)
+    {
+        uint32_t value;
+        memcpy(&value, &color, sizeof(value));
+
+        return value;
+    }
+
+    constexpr uint64_t HashMultiplier = 0x9E3779B97F4A7C15ULL;
+
+    uint64_t RotateLeft(uint64_t value, int count)
+    {
+        return (value << count) | (value >> (64 - count));
+    }
+
+    uint64_t MixHash(uint64_t hash)
+    {
+        hash ^= hash >> 32;
+        hash *= 0xD6E8FEB86659FD93ULL;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
+
+    // Hashes a row of pixels, the row index is included in the hash so that the row hashes
+    // can be combined in any order.
+    // The hash is only used to find the tiles that may be identical, the tiles are compared
+    // before they are treated as duplicates.
+    uint64_t HashRow(const ColorBgra* pixels, uint32_t count, uint32_t y)
+    {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(pixels);
+        const size_t size = static_cast<size_t>(count) * sizeof(ColorBgra);
+
+        // The row is hashed in four independent lanes to hide the multiply latency.
+        uint64_t lanes[4] = { y, y + HashMultiplier, RotateLeft(y, 16), RotateLeft(y, 32) + HashMultiplier };
+        size_t offset = 0;
+
+        for (; offset + sizeof(lanes) <= size; offset += sizeof(lanes))
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                uint64_t word;
+                memcpy(&word, data + offset + (i * sizeof(uint64_t)), sizeof(word));
+
+                lanes[i] = (lanes[i] ^ word) * HashMultiplier;
+                lanes[i] ^= lanes[i] >> 29;
+            }
+        }
+
+        for (; offset < size; offset += sizeof(ColorBgra))
+        {
+            uint32_t word;
+            memcpy(&word, data + offset, sizeof(word));
+
+            lanes[0] = (lanes[0] ^ word) * HashMultiplier;
+            lanes[0] ^= lanes[0] >> 29;
+        }
+
+        return MixHash(lanes[0] + RotateLeft(lanes[1], 17) + RotateLeft(lanes[2], 31) + RotateLeft(lanes[3], 47));
+    }
+
+    const uint8_t* GetTileRow(const BitmapData* image, const ImageGridLayout& layout, uint32_t tileIndex, uint32_t y)
+    {
+        const uint32_t row = tileIndex / layout.tileColumnCount;
+        const uint32_t column = tileIndex % layout.tileColumnCount;
+
+        return image->scan0 + ((static_cast<size_t>(row) * layout.tileHeight + y) * image->stride) +
+                              (static_cast<size_t>(column) * layout.tileWidth * sizeof(ColorBgra));
+    }
+
+    // The tiles in the last column and row of the grid can extend past the right and bottom edges of the image,
+    // the encoder pads them by repeating the last column and row of the image.
+    // Only the part of each tile that is inside the image is analyzed.
+    struct TileExtent
+    {
+        uint32_t width;
+        uint32_t height;
+    };
+
+    TileExtent GetTileExtent(const BitmapData* image, const ImageGridLayout& layout, uint32_t tileIndex)
+    {
+        const uint32_t row = tileIndex / layout.tileColumnCount;
+        const uint32_t column = tileIndex % layout.tileColumnCount;
+
+        TileExtent extent;
+        extent.width = std::min(layout.tileWidth, image->width - (column * layout.tileWidth));
+        extent.height = std::min(layout.tileHeight, image->height - (row * layout.tileHeight));
+
+        return extent;
+    }
+
+    PixelAnalysis CreatePixelAnalysis()
+    {
+        PixelAnalysis analysis;
+
+        analysis.grayscale = true;
+        analysis.opaque = true;
+        analysis.solidColor = true;
+
+        return analysis;
+    }
+
+    struct TileState
+    {
+        TileState() : pixels(CreatePixelAnalysis()), referenceColor(), contentHash(0)
+        {
+        }
+
+        PixelAnalysis pixels;
+        ColorBgra referenceColor;
+        // The XOR of the row hashes.
+        uint64_t contentHash;
+    };
+
+    bool TilesAreEqual(
+        const BitmapData* image,
+        const ImageGridLayout& layout,
+        const TileAnalysis* tiles,
+        uint32_t first,
+        uint32_t second)
+    {
+        const TileAnalysis& firstTile = tiles[first];
+        const TileAnalysis& secondTile = tiles[second];
+
+        if (firstTile.grayscale != secondTile.grayscale ||
+            firstTile.opaque != secondTile.opaque ||
+            firstTile.solidColor != secondTile.solidColor)
+        {
+            return false;
+        }
+
+        // The padding of a solid color edge tile has the same color.
+        if (firstTile.solidColor)
+        {
+            return ToUInt32(firstTile.color) == ToUInt32(secondTile.color);
+        }
+
+        const TileExtent extent = GetTileExtent(image, layout, first);
+        const TileExtent secondExtent = GetTileExtent(image, layout, second);
+
+        if (extent.width != secondExtent.width || extent.height != secondExtent.height)
+        {
+            return false;
+        }
+
+        const size_t rowSize = static_cast<size_t>(extent.width) * sizeof(ColorBgra);
+
+        for (uint32_t y = 0; y < extent.height; ++y)
+        {
+            if (memcmp(GetTileRow(image, layout, first, y), GetTileRow(image, layout, second, y), rowSize) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Sets the duplicateTileIndex of each tile to the first tile that has identical pixels.
+    // The tiles with equal hashes are compared, so a hash collision cannot cause different tiles to be merged.
+    void FindDuplicateTiles(
+        const BitmapData* image,
+        const ImageGridLayout& layout,
+        const std::vector<TileState>& tileStates,
+        TileAnalysis* tiles)
+    {
+        const uint32_t tileCount = static_cast<uint32_t>(tileStates.size());
+
+        // The indexes of the unique tiles for each hash value.
+        std::unordered_map<uint64_t, std::vector<uint32_t>> uniqueTiles;
+        uniqueTiles.reserve(tileCount);
+
+        for (uint32_t i = 0; i < tileCount; ++i)
+        {
+            // The solid color tiles are grouped by their color, the content hash of a padded edge tile
+            // covers fewer pixels than the other tiles.
+            const uint64_t key = tiles[i].solidColor ? ToUInt32(tiles[i].color) : tileStates[i].contentHash;
+
+            std::vector<uint32_t>& candidates = uniqueTiles[key];
+
+            tiles[i].duplicateTileIndex = i;
+
+            for (uint32_t candidate : candidates)
+            {
+                if (TilesAreEqual(image, layout, tiles, candidate, i))
+                {
+                    tiles[i].duplicateTileIndex = candidate;
+                    break;
+                }
+            }
+
+            if (tiles[i].duplicateTileIndex == i)
+            {
+                candidates.push_back(i);
+            }
+        }
+    }
+
+    void AnalyzePixels(
+        const ColorBgra* pixels,
+        uint32_t count,
+        ColorBgra referenceColor,
+        PixelAnalysis& analysis,
+        SimdLevel simdLevel)
+    {
+        switch (simdLevel)
+        {
+#if AVIF_X86_SIMD_SUPPORTED
+        case SimdLevel::AVX2:
+            AnalyzePixelsAVX2(pixels, count, referenceColor, analysis);
+            break;
+        case SimdLevel::SSE2:
+            AnalyzePixelsSSE2(pixels, count, referenceColor, analysis);
+            break;
+#endif
+        default:
+            for (uint32_t x = 0; x < count; ++x)
+            {
+                const ColorBgra& pixel = pixels[x];
+
+                analysis.grayscale &= pixel.r == pixel.g && pixel.g == pixel.b;
+                analysis.opaque &= pixel.a == 255;
+                analysis.solidColor &= ToUInt32(pixel) == ToUInt32(referenceColor);
+            }
+            break;
+        }
+    }
+}
+
+void AnalyzeImageTiles(const BitmapData* image, const ImageGridLayout* gridLayout, int maxThreads, TileAnalysis* tiles)
+{
+    ImageGridLayout layout;
+
+    if (gridLayout)
+    {
+        layout = *gridLayout;
+    }
+    else
+    {
+        layout.tileColumnCount = 1;
+        layout.tileRowCount = 1;
+        layout.tileWidth = image->width;
+        layout.tileHeight = image->height;
+    }
+
+    const uint32_t tileCount = layout.tileColumnCount * layout.tileRowCount;
+    // There is nothing to deduplicate when the image is a single tile.
+    const bool hashTiles = tileCount > 1;
+    const uint32_t bandsPerTile = (layout.tileHeight + AnalysisBandHeight - 1) / AnalysisBandHeight;
+    const SimdLevel simdLevel = GetSupportedSimdLevel();
+
+    std::vector<TileState> tileStates;
+    tileStates.reserve(tileCount);
+
+    for (uint32_t i = 0; i < tileCount; ++i)
+    {
+        tileStates.emplace_back();
+        tileStates.back().referenceColor = *reinterpret_cast<const ColorBgra*>(GetTileRow(image, layout, i, 0));
+    }
+
+    std::mutex mergeMutex;
+
+    // The bands of each tile are analyzed independently and then merged into the tile state,
+    // which allows the rows of a single large tile to be processed in parallel.
+    ThreadPool::GetShared().ParallelFor(static_cast<size_t>(tileCount) * bandsPerTile, std::max(maxThreads, 1), [&](size_t index)
+    {
+        const uint32_t tileIndex = static_cast<uint32_t>(index / bandsPerTile);
+        const uint32_t band = static_cast<uint32_t>(index % bandsPerTile);
+
+        TileState& tileState = tileStates[tileIndex];
+        const TileExtent extent = GetTileExtent(image, layout, tileIndex);
+
+        PixelAnalysis pixels = CreatePixelAnalysis();
+        uint64_t contentHash = 0;
+
+        const uint32_t top = band * AnalysisBandHeight;
+        const uint32_t bottom = std::min(top + AnalysisBandHeight, extent.height);
+
+        for (uint32_t y = top; y < bottom; ++y)
+        {
+            const ColorBgra* src = reinterpret_cast<const ColorBgra*>(GetTileRow(image, layout, tileIndex, y));
+
+            AnalyzePixels(src, extent.width, tileState.referenceColor, pixels, simdLevel);
+
+            if (hashTiles)
+            {
+                // The row is still in the cache from the analysis.
+                contentHash ^= HashRow(src, extent.width, y);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+
+        tileState.pixels.grayscale &= pixels.grayscale;
+        tileState.pixels.opaque &= pixels.opaque;
+        tileState.pixels.solidColor &= pixels.solidColor;
+        tileState.contentHash ^= contentHash;
+    });
+
+    for (uint32_t i = 0; i < tileCount; ++i)
+    {
+        const TileState& tileState = tileStates[i];
+        TileAnalysis& tile = tiles[i];
+
+        tile.grayscale = tileState.pixels.grayscale;
+        tile.opaque = tileState.pixels.opaque;
+        tile.solidColor = tileState.pixels.solidColor;
+        tile.color = tileState.referenceColor;
+        tile.duplicateTileIndex = i;
+    }
+
+    if (hashTiles)
+    {
+        FindDuplicateTiles(image, layout, tileStates, tiles);
+    }
+}
@@ -0,0 +1,30 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AvifNative.h"
+
+// The per-pixel properties of a set of pixels, each field is true if it holds for all of the pixels.
+struct PixelAnalysis
+{
+    bool grayscale;
+    bool opaque;
+    // The pixels are all equal to the reference color that was passed to the analysis function.
+    bool solidColor;
+};
+
+// Analyzes the image and writes the properties of each tile to the tiles array, including the
+// earlier tile that each tile is identical to.
+// The image is split into bands of rows that are processed in parallel using at most maxThreads threads.
+// If gridLayout is null the whole image is treated as a single tile.
+void AnalyzeImageTiles(const BitmapData* image, const ImageGridLayout* gridLayout, int maxThreads, TileAnalysis* tiles);
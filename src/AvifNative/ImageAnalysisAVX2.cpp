@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ImageAnalysisSIMD.h"
+
+#if AVIF_X86_SIMD_SUPPORTED
+
+#include <immintrin.h>
+#include <string.h>
+
+// The functions in this file must only be called when GetSupportedSimdLevel() returns SimdLevel::AVX2.
+
+namespace
+{
+    // Sets every lane of the vector to the 32-bit value of the color.
+    __m256i BroadcastColor(ColorBgra color)
+    {
+        int32_t value;
+        memcpy(&value, &color, sizeof(value));
+
+        return _mm256_set1_epi32(value);
+    }
+}
+
+void AnalyzePixelsAVX2(
+    const ColorBgra* pixels,
+    uint32_t count,
+    ColorBgra referenceColor,
+    PixelAnalysis& analysis)
+{
+    const __m256i reference = BroadcastColor(referenceColor);
+    const __m256i colorMask = _mm256_set1_epi32(0x0000ffff);
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int32_t>(0xff000000));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i allSet = _mm256_set1_epi32(-1);
+
+    // The grayscale test XORs each pixel with itself shifted right by one channel, the
+    // low 16 bits of the result are zero when the blue, green and red values are equal.
+    __m256i colorDifference = zero;
+    __m256i opaque = allSet;
+    __m256i solidColor = allSet;
+
+    const uint32_t vectorCount = count & ~7U;
+    uint32_t x = 0;
+
+    for (; x < vectorCount; x += 8)
+    {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + x));
+        const __m256i alphaIs255 = _mm256_cmpeq_epi32(_mm256_and_si256(value, alphaMask), alphaMask);
+
+        colorDifference = _mm256_or_si256(colorDifference, _mm256_and_si256(_mm256_xor_si256(value, _mm256_srli_epi32(value, 8)), colorMask));
+        opaque = _mm256_and_si256(opaque, alphaIs255);
+        solidColor = _mm256_and_si256(solidColor, _mm256_cmpeq_epi32(value, reference));
+    }
+
+    analysis.grayscale &= _mm256_movemask_epi8(_mm256_cmpeq_epi32(colorDifference, zero)) == -1;
+    analysis.opaque &= _mm256_movemask_epi8(opaque) == -1;
+    analysis.solidColor &= _mm256_movemask_epi8(solidColor) == -1;
+
+    for (; x < count; ++x)
+    {
+        const ColorBgra& pixel = pixels[x];
+
+        analysis.grayscale &= pixel.r == pixel.g && pixel.g == pixel.b;
+        analysis.opaque &= pixel.a == 255;
+            analysis.solidColor &= pixel.b == referenceColor.b && pixel.g == referenceColor.g &&
+                               pixel.r == referenceColor.r && pixel.a == referenceColor.a;
+    }
+}
+
+#endif // AVIF_X86_SIMD_SUPPORTED
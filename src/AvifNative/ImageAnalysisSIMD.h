@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CpuFeatures.h"
+#include "ImageAnalysis.h"
+
+#if AVIF_X86_SIMD_SUPPORTED
+
+// Combines the properties of count pixels with the existing values in analysis.
+void AnalyzePixelsSSE2(
+    const ColorBgra* pixels,
+    uint32_t count,
+    ColorBgra referenceColor,
+    PixelAnalysis& analysis);
+
+void AnalyzePixelsAVX2(
+    const ColorBgra* pixels,
+    uint32_t count,
+    ColorBgra referenceColor,
+    PixelAnalysis& analysis);
+
+#endif // AVIF_X86_SIMD_SUPPORTED
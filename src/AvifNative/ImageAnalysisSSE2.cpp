@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ImageAnalysisSIMD.h"
+
+#if AVIF_X86_SIMD_SUPPORTED
+
+#include <emmintrin.h>
+#include <string.h>
+
+namespace
+{
+    // Sets every lane of the vector to the 32-bit value of the color.
+    __m128i BroadcastColor(ColorBgra color)
+    {
+        int32_t value;
+        memcpy(&value, &color, sizeof(value));
+
+        return _mm_set1_epi32(value);
+    }
+}
+
+void AnalyzePixelsSSE2(
+    const ColorBgra* pixels,
+    uint32_t count,
+    ColorBgra referenceColor,
+    PixelAnalysis& analysis)
+{
+    const __m128i reference = BroadcastColor(referenceColor);
+    const __m128i colorMask = _mm_set1_epi32(0x0000ffff);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int32_t>(0xff000000));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i allSet = _mm_set1_epi32(-1);
+
+    // The grayscale test XORs each pixel with itself shifted right by one channel, the
+    // low 16 bits of the result are zero when the blue, green and red values are equal.
+    __m128i colorDifference = zero;
+    __m128i opaque = allSet;
+    __m128i solidColor = allSet;
+
+    const uint32_t vectorCount = count & ~3U;
+    uint32_t x = 0;
+
+    for (; x < vectorCount; x += 4)
+    {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + x));
+        const __m128i alphaIs255 = _mm_cmpeq_epi32(_mm_and_si128(value, alphaMask), alphaMask);
+
+        colorDifference = _mm_or_si128(colorDifference, _mm_and_si128(_mm_xor_si128(value, _mm_srli_epi32(value, 8)), colorMask));
+        opaque = _mm_and_si128(opaque, alphaIs255);
+        solidColor = _mm_and_si128(solidColor, _mm_cmpeq_epi32(value, reference));
+    }
+
+    analysis.grayscale &= _mm_movemask_epi8(_mm_cmpeq_epi32(colorDifference, zero)) == 0xffff;
+    analysis.opaque &= _mm_movemask_epi8(opaque) == 0xffff;
+    analysis.solidColor &= _mm_movemask_epi8(solidColor) == 0xffff;
+
+    for (; x < count; ++x)
+    {
+        const ColorBgra& pixel = pixels[x];
+
+        analysis.grayscale &= pixel.r == pixel.g && pixel.g == pixel.b;
+        analysis.opaque &= pixel.a == 255;
+            analysis.solidColor &= pixel.b == referenceColor.b && pixel.g == referenceColor.g &&
+                               pixel.r == referenceColor.r && pixel.a == referenceColor.a;
+    }
+}
+
+#endif // AVIF_X86_SIMD_SUPPORTED
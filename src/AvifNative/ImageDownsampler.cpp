@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ImageDownsampler.h"
+#include "ScopedAOMImage.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    template <typename T>
+    void DownsamplePlane(
+        const uint8_t* srcPlane,
+        int srcStride,
+        uint32_t srcWidth,
+        uint32_t srcHeight,
+        uint8_t* dstPlane,
+        int dstStride,
+        uint32_t dstWidth,
+        uint32_t dstHeight,
+        uint32_t downsampleShift)
+    {
+        const uint32_t blockSize = 1U << downsampleShift;
+
+        // The source rows are read in order and summed into one accumulator per output column.
+        std::vector<uint32_t> columnSums(dstWidth);
+
+        for (uint32_t y = 0; y < dstHeight; ++y)
+        {
+            const uint32_t srcY = y << downsampleShift;
+            const uint32_t blockHeight = srcHeight - srcY < blockSize ? srcHeight - srcY : blockSize;
+
+            std::fill(columnSums.begin(), columnSums.end(), 0U);
+
+            for (uint32_t blockY = 0; blockY < blockHeight; ++blockY)
+            {
+                const T* src = reinterpret_cast<const T*>(srcPlane + (static_cast<size_t>(srcY + blockY) * srcStride));
+
+                for (uint32_t x = 0; x < srcWidth; ++x)
+                {
+                    columnSums[x >> downsampleShift] += src[x];
+                }
+            }
+
+            T* dst = reinterpret_cast<T*>(dstPlane + (static_cast<size_t>(y) * dstStride));
+
+            for (uint32_t x = 0; x < dstWidth; ++x)
+            {
+                const uint32_t srcX = x << downsampleShift;
+                const uint32_t blockWidth = srcWidth - srcX < blockSize ? srcWidth - srcX : blockSize;
+                const uint32_t sampleCount = blockWidth * blockHeight;
+
+                dst[x] = static_cast<T>((columnSums[x] + (sampleCount / 2)) / sampleCount);
+            }
+        }
+    }
+}
+
+aom_image_t* DownsampleImage(const aom_image_t* image, uint32_t downsampleShift)
+{
+    if (!image || downsampleShift == 0 || downsampleShift > MaxDownsampleShift)
+    {
+        return nullptr;
+    }
+
+    const uint32_t dstWidth = GetDownsampledDimension(image->d_w, downsampleShift);
+    const uint32_t dstHeight = GetDownsampledDimension(image->d_h, downsampleShift);
+
+    AvifNative::ScopedAOMImage downsampled(aom_img_alloc(nullptr, image->fmt, dstWidth, dstHeight, 16));
+    if (!downsampled)
+    {
+        return nullptr;
+    }
+
+    downsampled->bit_depth = image->bit_depth;
+    downsampled->monochrome = image->monochrome;
+    downsampled->cp = image->cp;
+    downsampled->tc = image->tc;
+    downsampled->mc = image->mc;
+    downsampled->range = image->range;
+    downsampled->csp = image->csp;
+
+    // The chroma planes of a monochrome image are not used by the color conversion.
+    const int planeCount = image->monochrome ? 1 : 3;
+    const bool highBitDepth = (image->fmt & AOM_IMG_FMT_HIGHBITDEPTH) != 0;
+
+    for (int plane = 0; plane < planeCount; ++plane)
+    {
+        const uint32_t xShift = plane == AOM_PLANE_Y ? 0 : image->x_chroma_shift;
+        const uint32_t yShift = plane == AOM_PLANE_Y ? 0 : image->y_chroma_shift;
+
+        const uint32_t srcWidth = (image->d_w + xShift) >> xShift;
+        const uint32_t srcHeight = (image->d_h + yShift) >> yShift;
+        const uint32_t planeWidth = (dstWidth + xShift) >> xShift;
+        const uint32_t planeHeight = (dstHeight + yShift) >> yShift;
+
+        if (highBitDepth)
+        {
+            DownsamplePlane<uint16_t>(image->planes[plane], image->stride[plane], srcWidth, srcHeight,
+                downsampled->planes[plane], downsampled->stride[plane], planeWidth, planeHeight,
+                downsampleShift);
+        }
+        else
+        {
+            DownsamplePlane<uint8_t>(image->planes[plane], image->stride[plane], srcWidth, srcHeight,
+                downsampled->planes[plane], downsampled->stride[plane], planeWidth, planeHeight,
+                downsampleShift);
+        }
+    }
+
+    return downsampled.release();
+}
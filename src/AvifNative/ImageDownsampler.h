@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "aom/aom_image.h"
+#include <stdint.h>
+
+// The largest supported downsample shift, this keeps the 16-bit box filter sums within 32 bits.
+constexpr uint32_t MaxDownsampleShift = 8;
+
+// Gets the size of an image dimension after it has been downsampled, partial blocks at the edge of
+// the image are rounded up to a full output pixel.
+inline uint32_t GetDownsampledDimension(uint32_t value, uint32_t downsampleShift)
+{
+    return (value + ((1U << downsampleShift) - 1)) >> downsampleShift;
+}
+
+// Creates a copy of the image that is downsampled by (1 << downsampleShift) using a box filter.
+// The planes are filtered in the YUV domain, so the output has the same format and chroma subsampling as the input.
+// Returns nullptr if the output image could not be allocated.
+aom_image_t* DownsampleImage(const aom_image_t* image, uint32_t downsampleShift);
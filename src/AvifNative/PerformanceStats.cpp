@@ -0,0 +1,36 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "PerformanceStats.h"
+#include <stdlib.h>
+
+size_t GetAOMImageBufferSize(const aom_image* image)
+{
+    if (!image)
+    {
+        return 0;
+    }
+
+    size_t size = 0;
+
+    for (int plane = AOM_PLANE_Y; plane <= AOM_PLANE_V; plane++)
+    {
+        if (image->planes[plane])
+        {
+            const unsigned int height = plane == AOM_PLANE_Y ? image->d_h : (image->d_h + image->y_chroma_shift) >> image->y_chroma_shift;
+
+            size += static_cast<size_t>(abs(image->stride[plane])) * height;
+        }
+    }
+
+    return size;
+}
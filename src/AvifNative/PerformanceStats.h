@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "aom/aom_image.h"
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+// Adds the time between its construction and destruction to a statistics field, in nanoseconds.
+// The timer does nothing if the field is null, which allows the statistics to be optional.
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(uint64_t* elapsedNanoseconds) noexcept
+        : elapsedNanoseconds(elapsedNanoseconds), start()
+    {
+        if (elapsedNanoseconds)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedStageTimer()
+    {
+        if (elapsedNanoseconds)
+        {
+            const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+
+            *elapsedNanoseconds += static_cast<uint64_t>(elapsed.count());
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    uint64_t* const elapsedNanoseconds;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Gets the number of bytes in the planes of an image, the image can be null.
+size_t GetAOMImageBufferSize(const aom_image* image);
@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "aom/aom_image.h"
+#include <memory>
+#include <stdlib.h>
+
+namespace AvifNative
+{
+    namespace details
+    {
+        struct aom_image_deleter
+        {
+            void operator()(aom_image* img) noexcept
+            {
+                if (img)
+                {
+                    // The monochrome encoder images wrap a luma plane that is stored in user_priv,
+                    // aom_img_free does not release the data of a wrapped image.
+                    void* wrappedImageData = img->img_data_owner ? nullptr : img->user_priv;
+
+                    aom_img_free(img);
+                    free(wrappedImageData);
+                }
+            }
+        };
+    }
+
+    typedef std::unique_ptr<aom_image, details::aom_image_deleter> ScopedAOMImage;
+}
@@ -0,0 +1,519 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "TargetSizeSearch.h"
+#include "AV1Encoder.h"
+#include "ThreadPool.h"
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace
+{
+    // Quantizer 0 is lossless, which is only used for the highest quality setting.
+    constexpr int MinSearchQuantizer = 1;
+    constexpr int MaxSearchQuantizer = 63;
+
+    // The first round of probes is spread over the whole quantizer range, and the second round covers
+    // every quantizer between the two first round probes that the target size falls between.
+    constexpr int ProbesPerRound = 8;
+    constexpr uint32_t ProbeRoundCount = 2;
+    constexpr uint32_t MaxRefineEncodes = TargetSizeSearchProgressSteps - ProbeRoundCount;
+
+    // The proxy image is downsampled to approximately this many pixels.
+    constexpr uint64_t ProxyPixelCount = 512 * 512;
+
+    bool AVIF_NATIVE_CALL IgnoreSearchProgress(uint32_t, uint32_t)
+    {
+        return true;
+    }
+
+    void* AVIF_NATIVE_CALL AllocateSearchOutput(size_t sizeInBytes)
+    {
+        return malloc(sizeInBytes);
+    }
+
+    bool ReportSearchProgress(ProgressContext* progressContext)
+    {
+        return progressContext->progressCallback(++progressContext->progressDone, progressContext->progressTotal);
+    }
+
+    int GetQualityForQuantizer(int quantizer)
+    {
+        // Several quality values can map to the same quantizer, the highest one is used.
+        for (int quality = 99; quality > 0; quality--)
+        {
+            if (ConvertQualityToQuantizer(quality) == quantizer)
+            {
+                return quality;
+            }
+        }
+
+        return 0;
+    }
+
+    // The compressed size of the proxy image at each probed quantizer, scaled to the full image size.
+    class ProxySizeModel
+    {
+    public:
+        explicit ProxySizeModel(double scale) : sizes(), scale(scale)
+        {
+        }
+
+        void Add(int quantizer, uint64_t compressedSize)
+        {
+            sizes[quantizer] = std::max<uint64_t>(compressedSize, 1);
+        }
+
+        bool IsProbed(int quantizer) const
+        {
+            return sizes[quantizer] != 0;
+        }
+
+        // The quantizers that have not been probed are interpolated between the nearest probes,
+        // the compressed size falls approximately exponentially as the quantizer increases.
+        double Estimate(int quantizer) const
+        {
+            int lower = quantizer;
+            while (lower >= MinSearchQuantizer && sizes[lower] == 0)
+            {
+                lower--;
+            }
+
+            int upper = quantizer;
+            while (upper <= MaxSearchQuantizer && sizes[upper] == 0)
+            {
+                upper++;
+            }
+
+            double size;
+
+            if (lower >= MinSearchQuantizer && upper <= MaxSearchQuantizer && lower != upper)
+            {
+                const double t = static_cast<double>(quantizer - lower) / (upper - lower);
+
+                size = exp(log(static_cast<double>(sizes[lower])) * (1.0 - t) + log(static_cast<double>(sizes[upper])) * t);
+            }
+            else if (lower >= MinSearchQuantizer)
+            {
+                size = static_cast<double>(sizes[lower]);
+            }
+            else if (upper <= MaxSearchQuantizer)
+            {
+                size = static_cast<double>(sizes[upper]);
+            }
+            else
+            {
+                size = 0.0;
+            }
+
+            return size * scale;
+        }
+
+    private:
+        std::array<uint64_t, MaxSearchQuantizer + 1> sizes;
+        const double scale;
+    };
+
+    // Downsamples the image by an integer factor using a box filter.
+    std::vector<ColorBgra> CreateProxyImage(const BitmapData* image, uint32_t factor, int maxThreads, BitmapData& proxy)
+    {
+        const uint32_t proxyWidth = (image->width + factor - 1) / factor;
+        const uint32_t proxyHeight = (image->height + factor - 1) / factor;
+
+        std::vector<ColorBgra> pixels(static_cast<size_t>(proxyWidth) * proxyHeight);
+
+        ThreadPool::GetShared().ParallelFor(proxyHeight, std::max(maxThreads, 1), [&](size_t proxyY)
+        {
+            const uint32_t top = static_cast<uint32_t>(proxyY) * factor;
+            const uint32_t bottom = std::min(top + factor, image->height);
+
+            ColorBgra* dst = &pixels[proxyY * proxyWidth];
+
+            for (uint32_t proxyX = 0; proxyX < proxyWidth; proxyX++)
+            {
+                const uint32_t left = proxyX * factor;
+                const uint32_t right = std::min(left + factor, image->width);
+
+                uint32_t sumB = 0;
+                uint32_t sumG = 0;
+                uint32_t sumR = 0;
+                uint32_t sumA = 0;
+
+                for (uint32_t y = top; y < bottom; y++)
+                {
+                    const ColorBgra* src = reinterpret_cast<const ColorBgra*>(image->scan0 + (static_cast<size_t>(y) * image->stride)) + left;
+
+                    for (uint32_t x = left; x < right; x++)
+                    {
+                        sumB += src->b;
+                        sumG += src->g;
+                        sumR += src->r;
+                        sumA += src->a;
+                        src++;
+                    }
+                }
+
+                const uint32_t count = (bottom - top) * (right - left);
+                const uint32_t half = count / 2;
+
+                dst->b = static_cast<uint8_t>((sumB + half) / count);
+                dst->g = static_cast<uint8_t>((sumG + half) / count);
+                dst->r = static_cast<uint8_t>((sumR + half) / count);
+                dst->a = static_cast<uint8_t>((sumA + half) / count);
+                dst++;
+            }
+        });
+
+        proxy.scan0 = reinterpret_cast<uint8_t*>(pixels.data());
+        proxy.width = proxyWidth;
+        proxy.height = proxyHeight;
+        proxy.stride = proxyWidth * static_cast<uint32_t>(sizeof(ColorBgra));
+
+        return pixels;
+    }
+
+    // Encodes the image with the same functions that are used to save it, and discards the compressed data.
+    EncoderStatus MeasureCompressedSize(
+        const BitmapData* image,
+        const ImageGridLayout* gridLayout,
+        const uint32_t* duplicateTileIndexes,
+        const uint32_t* duplicateAlphaTileIndexes,
+        const EncoderOptions& encodeOptions,
+        const CICPColorData& colorInfo,
+        bool encodeAlpha,
+        uint64_t& compressedSize)
+    {
+        EncoderSession session(encodeOptions);
+        ProgressContext progressContext = { IgnoreSearchProgress, 0, 0 };
+
+        EncoderStatus status;
+        compressedSize = 0;
+
+        if (gridLayout)
+        {
+            const size_t tileCount = static_cast<size_t>(gridLayout->tileColumnCount) * gridLayout->tileRowCount;
+
+            std::vector<void*> colorImages(tileCount);
+            std::vector<void*> alphaImages(encodeAlpha ? tileCount : 0);
+            std::vector<EncodeStats> tileStats(tileCount);
+
+            status = CompressImageGrid(
+                &session,
+                image,
+                gridLayout,
+                duplicateTileIndexes,
+                duplicateAlphaTileIndexes,
+                &progressContext,
+                colorInfo,
+                AllocateSearchOutput,
+                colorImages.data(),
+                encodeAlpha ? alphaImages.data() : nullptr,
+                nullptr,
+                tileStats.data());
+
+            for (size_t i = 0; i < tileCount; i++)
+            {
+                free(colorImages[i]);
+                compressedSize += tileStats[i].color.compressedSize + tileStats[i].alpha.compressedSize;
+            }
+
+            for (void* alphaImage : alphaImages)
+            {
+                free(alphaImage);
+            }
+        }
+        else
+        {
+            void* colorImage = nullptr;
+            void* alphaImage = nullptr;
+            EncodeStats stats = {};
+
+            status = CompressImage(
+                &session,
+                image,
+                &progressContext,
+                colorInfo,
+                AllocateSearchOutput,
+                &colorImage,
+                encodeAlpha ? &alphaImage : nullptr,
+                &stats);
+
+            free(colorImage);
+            free(alphaImage);
+
+            compressedSize = stats.color.compressedSize + stats.alpha.compressedSize;
+        }
+
+        return status;
+    }
+
+    // Encodes the proxy image at each quantizer concurrently, each probe uses a single encoder thread.
+    EncoderStatus ProbeQuantizers(
+        const std::vector<int>& quantizers,
+        const BitmapData* proxy,
+        const EncoderOptions& encodeOptions,
+        const CICPColorData& colorInfo,
+        bool encodeAlpha,
+        ProxySizeModel& model)
+    {
+        std::vector<uint64_t> sizes(quantizers.size());
+        std::vector<EncoderStatus> statuses(quantizers.size(), EncoderStatus::Ok);
+
+        ThreadPool::GetShared().ParallelFor(quantizers.size(), std::max(encodeOptions.maxThreads, 1), [&](size_t index)
+        {
+            EncoderOptions probeOptions = encodeOptions;
+            probeOptions.quality = GetQualityForQuantizer(quantizers[index]);
+            probeOptions.maxThreads = 1;
+
+            statuses[index] = MeasureCompressedSize(proxy, nullptr, nullptr, nullptr, probeOptions, colorInfo, encodeAlpha, sizes[index]);
+        });
+
+        for (size_t i = 0; i < quantizers.size(); i++)
+        {
+            if (statuses[i] != EncoderStatus::Ok)
+            {
+                return statuses[i];
+            }
+
+            model.Add(quantizers[i], sizes[i]);
+        }
+
+        return EncoderStatus::Ok;
+    }
+
+    // Picks up to ProbesPerRound evenly spaced quantizers in [first, last] that have not been probed.
+    std::vector<int> SelectProbeQuantizers(int first, int last, const ProxySizeModel& model)
+    {
+        std::vector<int> unprobed;
+
+        for (int quantizer = first; quantizer <= last; quantizer++)
+        {
+            if (!model.IsProbed(quantizer))
+            {
+                unprobed.push_back(quantizer);
+            }
+        }
+
+        if (unprobed.size() <= static_cast<size_t>(ProbesPerRound))
+        {
+            return unprobed;
+        }
+
+        std::vector<int> quantizers;
+        quantizers.reserve(ProbesPerRound);
+
+        for (int i = 0; i < ProbesPerRound; i++)
+        {
+            const size_t index = (i * (unprobed.size() - 1) + ((ProbesPerRound - 1) / 2)) / (ProbesPerRound - 1);
+
+            quantizers.push_back(unprobed[index]);
+        }
+
+        return quantizers;
+    }
+
+    // Gets the lowest quantizer in (first, last) that the model predicts will fit in the target size, or zero.
+    int PredictQuantizer(const ProxySizeModel& model, double correction, int first, int last, uint64_t targetSize)
+    {
+        for (int quantizer = first + 1; quantizer < last; quantizer++)
+        {
+            if (model.Estimate(quantizer) * correction <= static_cast<double>(targetSize))
+            {
+                return quantizer;
+            }
+        }
+
+        return 0;
+    }
+}
+
+EncoderStatus SearchTargetSizeQuality(
+    const BitmapData* image,
+    const ImageGridLayout* gridLayout,
+    const uint32_t* duplicateTileIndexes,
+    const uint32_t* duplicateAlphaTileIndexes,
+    const EncoderOptions& encodeOptions,
+    const CICPColorData& colorInfo,
+    bool encodeAlpha,
+    uint64_t targetSize,
+    ProgressContext* progressContext,
+    TargetSizeResult* result)
+{
+    *result = {};
+
+    const uint64_t imagePixelCount = static_cast<uint64_t>(image->width) * image->height;
+    const uint32_t proxyFactor = std::max(static_cast<uint32_t>(ceil(sqrt(static_cast<double>(imagePixelCount) / ProxyPixelCount))), 1U);
+
+    BitmapData proxy = *image;
+    std::vector<ColorBgra> proxyPixels;
+
+    if (proxyFactor > 1)
+    {
+        proxyPixels = CreateProxyImage(image, proxyFactor, encodeOptions.maxThreads, proxy);
+    }
+
+    // The probes of an image that is small enough to be its own proxy are exact, unless the
+    // image is saved as a grid.
+    const bool probesAreExact = proxyFactor == 1 && !gridLayout;
+    const double proxyScale = static_cast<double>(imagePixelCount) / (static_cast<double>(proxy.width) * proxy.height);
+
+    ProxySizeModel model(proxyScale);
+
+    // The first round finds the two probes that the target size falls between, and the second round
+    // probes the quantizers between them.
+    int lastTooLarge = MinSearchQuantizer - 1;
+    int firstFitting = MaxSearchQuantizer + 1;
+
+    for (uint32_t round = 0; round < ProbeRoundCount; round++)
+    {
+        const std::vector<int> quantizers = SelectProbeQuantizers(lastTooLarge + 1, firstFitting - 1, model);
+
+        if (!quantizers.empty())
+        {
+            EncoderStatus status = ProbeQuantizers(quantizers, &proxy, encodeOptions, colorInfo, encodeAlpha, model);
+            if (status != EncoderStatus::Ok)
+            {
+                return status;
+            }
+
+            result->probeEncodeCount += static_cast<uint32_t>(quantizers.size());
+
+            for (int quantizer : quantizers)
+            {
+                if (model.Estimate(quantizer) <= static_cast<double>(targetSize))
+                {
+                    firstFitting = std::min(firstFitting, quantizer);
+                }
+                else
+                {
+                    lastTooLarge = std::max(lastTooLarge, quantizer);
+                }
+            }
+        }
+
+        if (!ReportSearchProgress(progressContext))
+        {
+            return EncoderStatus::UserCancelled;
+        }
+    }
+
+    uint32_t progressStepsDone = ProbeRoundCount;
+    int quantizer;
+    uint64_t compressedSize = 0;
+
+    if (probesAreExact)
+    {
+        quantizer = firstFitting;
+
+        // The lowest quality is always probed, so the exact size is known when the target is not met.
+        compressedSize = static_cast<uint64_t>(model.Estimate(std::min(quantizer, MaxSearchQuantizer)));
+    }
+    else
+    {
+        // The proxy does not have the same amount of detail per pixel as the full image, so the
+        // ratio between the full and proxy sizes of the last encode corrects the later predictions.
+        double correction = 1.0;
+        lastTooLarge = MinSearchQuantizer - 1;
+        firstFitting = MaxSearchQuantizer + 1;
+
+        for (uint32_t i = 0; i < MaxRefineEncodes && firstFitting != lastTooLarge + 1; i++)
+        {
+            int candidate = PredictQuantizer(model, correction, lastTooLarge, firstFitting, targetSize);
+
+            if (candidate == 0)
+            {
+                if (firstFitting <= MaxSearchQuantizer)
+                {
+                    break;
+                }
+
+                // Check if the image fits at the lowest quality.
+                candidate = MaxSearchQuantizer;
+            }
+            else if (firstFitting > MaxSearchQuantizer && i == (MaxRefineEncodes - 1))
+            {
+                // None of the encodes fit, so the last encode is reserved for the lowest quality.
+                // The target is only reported as not met after the size of that encode is known.
+                candidate = MaxSearchQuantizer;
+            }
+
+            EncoderOptions refineOptions = encodeOptions;
+            refineOptions.quality = GetQualityForQuantizer(candidate);
+
+            uint64_t size;
+            EncoderStatus status = MeasureCompressedSize(
+                image,
+                gridLayout,
+                duplicateTileIndexes,
+                duplicateAlphaTileIndexes,
+                refineOptions,
+                colorInfo,
+                encodeAlpha,
+                size);
+            if (status != EncoderStatus::Ok)
+            {
+                return status;
+            }
+
+            result->refineEncodeCount++;
+            correction = static_cast<double>(size) / std::max(model.Estimate(candidate), 1.0);
+
+            if (size <= targetSize)
+            {
+                firstFitting = candidate;
+                compressedSize = size;
+            }
+            else
+            {
+                lastTooLarge = candidate;
+
+                // This is the size that is reported when the target is not met.
+                if (candidate == MaxSearchQuantizer)
+                {
+                    compressedSize = size;
+                }
+            }
+
+            progressStepsDone++;
+            if (!ReportSearchProgress(progressContext))
+            {
+                return EncoderStatus::UserCancelled;
+            }
+        }
+
+        quantizer = firstFitting;
+    }
+
+    result->targetSizeMet = quantizer <= MaxSearchQuantizer;
+
+    if (!result->targetSizeMet)
+    {
+        quantizer = MaxSearchQuantizer;
+    }
+
+    result->quality = GetQualityForQuantizer(quantizer);
+    result->quantizer = ConvertQualityToQuantizer(result->quality);
+    result->compressedSize = compressedSize;
+
+    for (; progressStepsDone < TargetSizeSearchProgressSteps; progressStepsDone++)
+    {
+        if (!ReportSearchProgress(progressContext))
+        {
+            return EncoderStatus::UserCancelled;
+        }
+    }
+
+    return EncoderStatus::Ok;
+}
@@ -0,0 +1,29 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AvifNative.h"
+
+// Finds the highest quality that compresses the image to at most targetSize bytes, see FindTargetSizeQuality.
+// The probe encodes of the downsampled proxy image run in parallel with one encoder thread each.
+EncoderStatus SearchTargetSizeQuality(
+    const BitmapData* image,
+    const ImageGridLayout* gridLayout,
+    const uint32_t* duplicateTileIndexes,
+    const uint32_t* duplicateAlphaTileIndexes,
+    const EncoderOptions& encodeOptions,
+    const CICPColorData& colorInfo,
+    bool encodeAlpha,
+    uint64_t targetSize,
+    ProgressContext* progressContext,
+    TargetSizeResult* result);
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#ifdef _WIN32
+
 #include <WinSDKVer.h>
 
 // Set the minimum OS version to Windows 7
@@ -21,3 +23,5 @@
 #define NTDDI_VERSION 0x06010000
 
 #include <SDKDDKVer.h>
+
+#endif // _WIN32
@@ -0,0 +1,228 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
+
+namespace
+{
+    constexpr size_t NotAWorkerThread = static_cast<size_t>(-1);
+
+    // The index of the queue that is owned by the current thread, or NotAWorkerThread
+    // if the current thread does not belong to the pool.
+    thread_local size_t currentWorkerQueue = NotAWorkerThread;
+
+    struct ParallelForState
+    {
+        ParallelForState(size_t count, const std::function<void(size_t)>* body)
+            : nextIndex(0), completedCount(0), count(count), body(body), failed(false), exception()
+        {
+        }
+
+        std::atomic<size_t> nextIndex;
+        std::atomic<size_t> completedCount;
+        const size_t count;
+        // A runner that starts after all of the indexes have been claimed will never
+        // access the body, so it is safe to reference the caller's function object.
+        const std::function<void(size_t)>* const body;
+        std::atomic<bool> failed;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable completed;
+    };
+
+    void RunParallelForLoop(ParallelForState& state)
+    {
+        while (true)
+        {
+            const size_t index = state.nextIndex.fetch_add(1);
+
+            if (index >= state.count)
+            {
+                break;
+            }
+
+            // The remaining iterations are skipped after one of them has failed.
+            if (!state.failed.load(std::memory_order_relaxed))
+            {
+                try
+                {
+                    (*state.body)(index);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+
+                    if (!state.exception)
+                    {
+                        state.exception = std::current_exception();
+                    }
+                    state.failed = true;
+                }
+            }
+
+            if ((state.completedCount.fetch_add(1) + 1) == state.count)
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.completed.notify_all();
+            }
+        }
+    }
+}
+
+ThreadPool::ThreadPool(int threadCount) : queues(), workers(), queuedTaskCount(0), nextQueue(0), sleepMutex(), wakeCondition()
+{
+    queues.reserve(threadCount);
+    for (int i = 0; i < threadCount; i++)
+    {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    workers.reserve(threadCount);
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::WorkerMain, this, static_cast<size_t>(i));
+    }
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+    // The pool is intentionally never destroyed, joining the worker threads from a static
+    // destructor can deadlock when the DLL is unloaded because the loader lock is held.
+    static ThreadPool* pool = new ThreadPool(std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0));
+
+    return *pool;
+}
+
+void ThreadPool::ParallelFor(size_t count, int maxConcurrency, const std::function<void(size_t)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const size_t concurrency = std::min(static_cast<size_t>(std::max(maxConcurrency, 1)), count);
+
+    if (concurrency == 1 || workers.empty())
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            body(i);
+        }
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>(count, &body);
+
+    // The calling thread is one of the loop runners.
+    const size_t helperCount = std::min(concurrency - 1, workers.size());
+
+    for (size_t i = 0; i < helperCount; i++)
+    {
+        Submit([state]() { RunParallelForLoop(*state); });
+    }
+
+    RunParallelForLoop(*state);
+
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->completed.wait(lock, [&state]() { return state->completedCount.load() == state->count; });
+    }
+
+    if (state->exception)
+    {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+void ThreadPool::Submit(Task&& task)
+{
+    size_t queueIndex = currentWorkerQueue;
+
+    if (queueIndex == NotAWorkerThread)
+    {
+        queueIndex = nextQueue.fetch_add(1) % queues.size();
+    }
+
+    {
+        WorkerQueue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    queuedTaskCount.fetch_add(1);
+
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wakeCondition.notify_one();
+}
+
+bool ThreadPool::TryPop(size_t queueIndex, Task& task)
+{
+    WorkerQueue& queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+
+    // The owning worker takes the most recently queued task, which is the most likely to have its data in the cache.
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    queuedTaskCount.fetch_sub(1);
+
+    return true;
+}
+
+bool ThreadPool::TrySteal(size_t thiefIndex, Task& task)
+{
+    const size_t queueCount = queues.size();
+
+    for (size_t i = 1; i < queueCount; i++)
+    {
+        WorkerQueue& queue = *queues[(thiefIndex + i) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty())
+        {
+            // Thieves take the oldest task to reduce contention with the owning worker.
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            queuedTaskCount.fetch_sub(1);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::WorkerMain(size_t queueIndex)
+{
+    currentWorkerQueue = queueIndex;
+
+    while (true)
+    {
+        Task task;
+
+        if (TryPop(queueIndex, task) || TrySteal(queueIndex, task))
+        {
+            task();
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeCondition.wait(lock, [this]() { return queuedTaskCount.load() != 0; });
+        }
+    }
+}
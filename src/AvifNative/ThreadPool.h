@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing thread pool that is shared by all of the native encode and decode operations.
+//
+// Each worker thread owns a task queue, new tasks are pushed onto the queue of the submitting worker
+// (or distributed round-robin when submitted from outside the pool) and idle workers steal from the
+// front of the other queues.
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Gets the process-wide thread pool.
+    static ThreadPool& GetShared();
+
+    // The number of threads that can execute work, including the calling thread.
+    int GetConcurrencyLevel() const noexcept
+    {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    // Invokes body(index) for each index in [0, count) using at most maxConcurrency threads.
+    // The calling thread participates in the loop, and the first exception thrown by body
+    // is rethrown on the calling thread after all of the running iterations have finished.
+    void ParallelFor(size_t count, int maxConcurrency, const std::function<void(size_t)>& body);
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    explicit ThreadPool(int threadCount);
+
+    void Submit(Task&& task);
+    bool TryPop(size_t queueIndex, Task& task);
+    bool TrySteal(size_t thiefIndex, Task& task);
+    void WorkerMain(size_t queueIndex);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queuedTaskCount;
+    std::atomic<size_t> nextQueue;
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+};
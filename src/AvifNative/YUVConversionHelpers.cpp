@@ -37,7 +37,9 @@
 */
 
 #include "YUVConversionHelpers.h"
+#include <math.h>
 #include <memory>
+#include <string.h>
 
 namespace
 {
@@ -139,6 +141,11 @@ namespace
         }
         return false;
     }
+
+    int32_t ToFixedPoint(double value)
+    {
+        return static_cast<int32_t>(floor((value * FixedPointOne) + 0.5));
+    }
 }
 
 void GetYUVCoefficiants(const CICPColorData& colorInfo, YUVCoefficiants& yuvData)
@@ -176,3 +183,33 @@ void GetYUVCoefficiants(const CICPColorData& colorInfo, YUVCoefficiants& yuvData
     yuvData.kg = kg;
     yuvData.kb = kb;
 }
+
+void GetFixedPointYUVCoefficiants(
+    const YUVCoefficiants& yuvCoefficiants,
+    FixedPointYUVCoefficiants& fixedPointCoefficiants)
+{
+    const double kr = yuvCoefficiants.kr;
+    const double kg = yuvCoefficiants.kg;
+    const double kb = yuvCoefficiants.kb;
+
+    fixedPointCoefficiants.yR = ToFixedPoint(kr);
+    fixedPointCoefficiants.yB = ToFixedPoint(kb);
+    fixedPointCoefficiants.yG = FixedPointOne - fixedPointCoefficiants.yR - fixedPointCoefficiants.yB;
+
+    // U = (B - Y) / (2 * (1 - kb)), the B coefficient is always 0.5.
+    fixedPointCoefficiants.uB = FixedPointHalf;
+    fixedPointCoefficiants.uR = ToFixedPoint(-kr / (2 * (1 - kb)));
+    fixedPointCoefficiants.uG = -fixedPointCoefficiants.uB - fixedPointCoefficiants.uR;
+
+    // V = (R - Y) / (2 * (1 - kr)), the R coefficient is always 0.5.
+    fixedPointCoefficiants.vR = FixedPointHalf;
+    fixedPointCoefficiants.vB = ToFixedPoint(-kb / (2 * (1 - kr)));
+    fixedPointCoefficiants.vG = -fixedPointCoefficiants.vR - fixedPointCoefficiants.vB;
+
+    // The chroma terms are multiplied by (2C - 255), which is twice the distance from the
+    // center of the 8-bit range, so the coefficients are half of the real values.
+    fixedPointCoefficiants.rV = ToFixedPoint(1 - kr);
+    fixedPointCoefficiants.gU = ToFixedPoint((kb * (1 - kb)) / kg);
+    fixedPointCoefficiants.gV = ToFixedPoint((kr * (1 - kr)) / kg);
+    fixedPointCoefficiants.bU = ToFixedPoint(1 - kb);
+}
@@ -13,6 +13,7 @@
 #pragma once
 
 #include "AvifNative.h"
+#include <stdint.h>
 
 struct YUVCoefficiants
 {
@@ -24,3 +25,57 @@ struct YUVCoefficiants
 void GetYUVCoefficiants(
     const CICPColorData& colorInfo,
     YUVCoefficiants& yuvData);
+
+// The 8-bit YUV conversions use fixed-point integer math unless AVIF_FLOAT_YUV_CONVERSION
+// is defined, the floating point conversions are kept to validate the fixed-point results.
+#if !defined(AVIF_FLOAT_YUV_CONVERSION)
+#define AVIF_FIXED_POINT_YUV_CONVERSION 1
+#else
+#define AVIF_FIXED_POINT_YUV_CONVERSION 0
+#endif
+
+// The number of fractional bits in the fixed-point coefficients.
+constexpr int FixedPointPrecision = 14;
+constexpr int32_t FixedPointOne = 1 << FixedPointPrecision;
+constexpr int32_t FixedPointHalf = 1 << (FixedPointPrecision - 1);
+
+// The 8-bit fixed-point conversion coefficients.
+//
+// Each coefficient is the real value multiplied by 2^14 and rounded to the nearest integer,
+// the coefficients that are derived from other values are adjusted so that white maps to
+// Y = 255 and every gray maps to U = V = 128 without any rounding error.
+//
+// RGB -> YUV, where R, G and B are 8-bit values:
+//   Y = (yR * R + yG * G + yB * B + 2^13) >> 14
+//   U = (uR * R + uG * G + uB * B + (128 << 14)) >> 14
+//   V = (vR * R + vG * G + vB * B + (128 << 14)) >> 14
+//
+// When the chroma is subsampled R, G and B are replaced by the sums of the N = 1, 2 or 4 pixels
+// in the block, and the chroma offset and shift become (128 * N) << 14 and 14 + log2(N).
+//
+// YUV -> RGB, where Y, U and V are full range 8-bit values:
+//   R = (Y << 14 + rV * (2V - 255) + 2^13) >> 14
+//   G = (Y << 14 - gU * (2U - 255) - gV * (2V - 255) + 2^13) >> 14
+//   B = (Y << 14 + bU * (2U - 255) + 2^13) >> 14
+//
+// All of the results are clamped to [0, 255], the shifts are arithmetic (floor division).
+struct FixedPointYUVCoefficiants
+{
+    int32_t yR;
+    int32_t yG;
+    int32_t yB;
+    int32_t uR;
+    int32_t uG;
+    int32_t uB;
+    int32_t vR;
+    int32_t vG;
+    int32_t vB;
+    int32_t rV;
+    int32_t gU;
+    int32_t gV;
+    int32_t bU;
+};
+
+void GetFixedPointYUVCoefficiants(
+    const YUVCoefficiants& yuvCoefficiants,
+    FixedPointYUVCoefficiants& fixedPointCoefficiants);
@@ -0,0 +1,231 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+using AvifFileType.AvifContainer;
+using AvifFileType.Interop;
+using System;
+using System.Diagnostics;
+using System.Globalization;
+using System.Text;
+
+namespace AvifFileType
+{
+    /// <summary>
+    /// Collects the per-stage timing and memory statistics of a save operation.
+    /// </summary>
+    /// <remarks>
+    /// The report is written to the <c>AvifFileType.Save</c> trace source, which is disabled by default.
+    /// It can be enabled with a <c>system.diagnostics</c> section in the application configuration file.
+    /// </remarks>
+    internal sealed class AvifSaveReport
+    {
+        private static readonly TraceSource SaveTraceSource = new TraceSource("AvifFileType.Save", SourceLevels.Off);
+
+        private readonly int width;
+        private readonly int height;
+        private readonly Stopwatch stopwatch;
+        private ImageGridMetadata imageGridMetadata;
+        private uint[] duplicateTileIndexes;
+        private ulong targetSize;
+        private TargetSizeResult? targetSizeResult;
+        private TimeSpan analysisTime;
+        private TimeSpan searchTime;
+        private TimeSpan compressionTime;
+        private TimeSpan writeTime;
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="AvifSaveReport"/> class, and starts timing the save.
+        /// </summary>
+        /// <param name="width">The image width.</param>
+        /// <param name="height">The image height.</param>
+        public AvifSaveReport(int width, int height)
+        {
+            this.width = width;
+            this.height = height;
+            this.stopwatch = Stopwatch.StartNew();
+            this.TileStats = new EncodeStats[1];
+        }
+
+        /// <summary>
+        /// Gets the encoder statistics of each image grid tile, or of the whole image if it is not split into a grid.
+        /// </summary>
+        public EncodeStats[] TileStats { get; private set; }
+
+        /// <summary>
+        /// Records the end of the image analysis stage.
+        /// </summary>
+        /// <param name="imageGridMetadata">The image grid, or <see langword="null"/> if the image is encoded as a single tile.</param>
+        /// <param name="duplicateTileIndexes">
+        /// The index of the first tile with identical pixels for each image grid tile, or <see langword="null"/>.
+        /// </param>
+        public void AnalysisCompleted(ImageGridMetadata imageGridMetadata, uint[] duplicateTileIndexes)
+        {
+            this.analysisTime = this.stopwatch.Elapsed;
+            this.imageGridMetadata = imageGridMetadata;
+            this.duplicateTileIndexes = duplicateTileIndexes;
+
+            if (imageGridMetadata != null)
+            {
+                this.TileStats = new EncodeStats[imageGridMetadata.TileCount];
+            }
+        }
+
+        /// <summary>
+        /// Records the end of the target file size search stage.
+        /// </summary>
+        /// <param name="targetSize">The target size of the compressed images in bytes.</param>
+        /// <param name="result">The search result.</param>
+        public void TargetSizeSearchCompleted(ulong targetSize, TargetSizeResult result)
+        {
+            this.searchTime = this.stopwatch.Elapsed - this.analysisTime;
+            this.targetSize = targetSize;
+            this.targetSizeResult = result;
+        }
+
+        /// <summary>
+        /// Records the end of the compression stage.
+        /// </summary>
+        /// <remarks>
+        /// The image grid tiles are written to the file as they are compressed, so the compression
+        /// stage of an image grid includes most of the time that is spent writing the file.
+        /// </remarks>
+        public void CompressionCompleted()
+        {
+            this.compressionTime = this.stopwatch.Elapsed - this.analysisTime - this.searchTime;
+        }
+
+        /// <summary>
+        /// Records the end of the save, and writes the report to the trace source if it is enabled.
+        /// </summary>
+        /// <param name="options">The encoder options that the image was saved with.</param>
+        public void SaveCompleted(EncoderOptions options)
+        {
+            this.stopwatch.Stop();
+            this.writeTime = this.stopwatch.Elapsed - this.analysisTime - this.searchTime - this.compressionTime;
+
+            if (SaveTraceSource.Switch.ShouldTrace(TraceEventType.Information))
+            {
+                SaveTraceSource.TraceEvent(TraceEventType.Information, 0, Format(options));
+            }
+        }
+
+        private string Format(EncoderOptions options)
+        {
+            StringBuilder builder = new StringBuilder();
+
+            builder.AppendFormat(CultureInfo.InvariantCulture,
+                                 "AVIF save: {0}x{1}, {2}, quality {3}, {4}, {5} threads",
+                                 this.width,
+                                 this.height,
+                                 options.yuvFormat,
+                                 options.quality,
+                                 options.compressionSpeed,
+                                 options.maxThreads);
+
+            if (this.imageGridMetadata != null)
+            {
+                builder.AppendFormat(CultureInfo.InvariantCulture,
+                                     ", {0}x{1} grid of {2}x{3} tiles",
+                                     this.imageGridMetadata.TileColumnCount,
+                                     this.imageGridMetadata.TileRowCount,
+                                     this.imageGridMetadata.TileImageWidth,
+                                     this.imageGridMetadata.TileImageHeight);
+            }
+
+            builder.AppendLine();
+            builder.AppendFormat(CultureInfo.InvariantCulture,
+                                 "Total {0:F2} ms: analysis {1:F2} ms, target size search {2:F2} ms, compression {3:F2} ms, write {4:F2} ms",
+                                 this.stopwatch.Elapsed.TotalMilliseconds,
+                                 this.analysisTime.TotalMilliseconds,
+                                 this.searchTime.TotalMilliseconds,
+                                 this.compressionTime.TotalMilliseconds,
+                                 this.writeTime.TotalMilliseconds);
+            builder.AppendLine();
+
+            if (this.targetSizeResult.HasValue)
+            {
+                TargetSizeResult result = this.targetSizeResult.Value;
+
+                builder.AppendFormat(CultureInfo.InvariantCulture,
+                                     "Target size {0} bytes: quality {1}, quantizer {2}, {3} proxy encodes, {4} full encodes{5}",
+                                     this.targetSize,
+                                     result.quality,
+                                     result.quantizer,
+                                     result.probeEncodeCount,
+                                     result.refineEncodeCount,
+                                     result.targetSizeMet ? string.Empty : ", target size not met");
+                builder.AppendLine();
+            }
+
+            EncodeStats[] tileStats = this.TileStats;
+            ulong compressedSize = 0;
+            ulong largestFrameBufferSize = 0;
+
+            for (int i = 0; i < tileStats.Length; i++)
+            {
+                if (this.duplicateTileIndexes != null && this.duplicateTileIndexes[i] != (uint)i)
+                {
+                    builder.AppendFormat(CultureInfo.InvariantCulture, "Tile {0}: duplicate of tile {1}", i, this.duplicateTileIndexes[i]);
+                    builder.AppendLine();
+                    continue;
+                }
+
+                EncodeStats stats = tileStats[i];
+
+                builder.AppendFormat(CultureInfo.InvariantCulture, "Tile {0}: {1:F2} ms, callbacks {2:F2} ms, frame buffers {3} bytes",
+                                     i,
+                                     ToMilliseconds(stats.totalTime),
+                                     ToMilliseconds(stats.callbackTime),
+                                     stats.frameBufferSize);
+                AppendImageStats(builder, "color", stats.color);
+                AppendImageStats(builder, "alpha", stats.alpha);
+                builder.AppendLine();
+
+                compressedSize += stats.color.compressedSize + stats.alpha.compressedSize;
+                largestFrameBufferSize = Math.Max(largestFrameBufferSize, stats.frameBufferSize);
+            }
+
+            builder.AppendFormat(CultureInfo.InvariantCulture,
+                                 "Compressed size {0} bytes, largest tile frame buffers {1} bytes",
+                                 compressedSize,
+                                 largestFrameBufferSize);
+
+            return builder.ToString();
+        }
+
+        private static void AppendImageStats(StringBuilder builder, string name, EncodeImageStats stats)
+        {
+            if (stats.threadCount == 0)
+            {
+                // The image was not encoded.
+                return;
+            }
+
+            builder.AppendFormat(CultureInfo.InvariantCulture,
+                                 "; {0}: {1} bytes, quantizer {2}, {3} threads, conversion {4:F2} ms, encode {5:F2} ms, " +
+                                 "flush {6:F2} ms, output copy {7:F2} ms, callbacks {8:F2} ms",
+                                 name,
+                                 stats.compressedSize,
+                                 stats.quantizer,
+                                 stats.threadCount,
+                                 ToMilliseconds(stats.conversionTime),
+                                 ToMilliseconds(stats.encodeTime),
+                                 ToMilliseconds(stats.flushTime),
+                                 ToMilliseconds(stats.outputCopyTime),
+                                 ToMilliseconds(stats.callbackTime));
+        }
+
+        private static double ToMilliseconds(ulong nanoseconds)
+        {
+            return nanoseconds / 1000000.0;
+        }
+    }
+}
@@ -16,6 +16,8 @@ using System.Diagnostics;
 
 namespace AvifFileType
 {
+    internal delegate void CompressedImageGridTileHandler(int tileIndex, CompressedAV1Image color, CompressedAV1Image alpha);
+
     [DebuggerDisplay("{DebuggerDisplay,nq}")]
     internal sealed class CompressedAV1Image
         : IDisposable
@@ -0,0 +1,145 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using AvifFileType.AvifContainer;
+using AvifFileType.Interop;
+
+namespace AvifFileType
+{
+    /// <summary>
+    /// The properties of an image that are used to select the encoder options.
+    /// </summary>
+    internal sealed class ImageAnalysis
+    {
+        private readonly TileAnalysis[] tiles;
+
+        public ImageAnalysis(TileAnalysis[] tiles, ImageGridMetadata imageGridMetadata)
+        {
+            if (tiles is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(tiles));
+            }
+
+            this.tiles = tiles;
+            this.ImageGridMetadata = imageGridMetadata;
+
+            bool grayscale = true;
+            bool opaque = true;
+            int uniqueTileCount = 0;
+            int uniqueTransparentTileCount = 0;
+
+            for (int i = 0; i < tiles.Length; i++)
+            {
+                grayscale &= tiles[i].grayscale;
+                opaque &= tiles[i].opaque;
+
+                if (tiles[i].duplicateTileIndex == (uint)i)
+                {
+                    uniqueTileCount++;
+
+                    if (!tiles[i].opaque)
+                    {
+                        uniqueTransparentTileCount++;
+                    }
+                }
+            }
+
+            this.IsGrayscale = grayscale;
+            this.HasTransparency = !opaque;
+            this.UniqueTileCount = uniqueTileCount;
+            this.UniqueTransparentTileCount = uniqueTransparentTileCount;
+        }
+
+        /// <summary>
+        /// Gets the image grid that the tile properties were computed for.
+        /// </summary>
+        /// <value>
+        /// The image grid, or <see langword="null"/> if the image was analyzed as a single tile.
+        /// </value>
+        public ImageGridMetadata ImageGridMetadata { get; }
+
+        public bool IsGrayscale { get; }
+
+        public bool HasTransparency { get; }
+
+        public int TileCount => this.tiles.Length;
+
+        /// <summary>
+        /// Gets the number of tiles that do not have the same pixels as an earlier tile.
+        /// </summary>
+        public int UniqueTileCount { get; }
+
+        /// <summary>
+        /// Gets the number of unique tiles that have at least one alpha value that is not 255.
+        /// </summary>
+        public int UniqueTransparentTileCount { get; }
+
+        /// <summary>
+        /// Gets the number of alpha images that are encoded for an image grid with transparency.
+        /// </summary>
+        /// <value>
+        /// The number of unique transparent tiles, plus one alpha image that is shared by all of the opaque tiles.
+        /// </value>
+        public int EncodedAlphaTileCount => this.UniqueTransparentTileCount + (this.UniqueTileCount > this.UniqueTransparentTileCount ? 1 : 0);
+
+        /// <summary>
+        /// Gets the index of the first tile with identical pixels for each tile.
+        /// </summary>
+        /// <returns>
+        /// An array with one entry for each tile, the entry is the index of the tile itself
+        /// if there is no earlier tile with the same pixels.
+        /// </returns>
+        public uint[] GetDuplicateTileIndexes()
+        {
+            uint[] duplicateTileIndexes = new uint[this.tiles.Length];
+
+            for (int i = 0; i < duplicateTileIndexes.Length; i++)
+            {
+                duplicateTileIndexes[i] = this.tiles[i].duplicateTileIndex;
+            }
+
+            return duplicateTileIndexes;
+        }
+
+        /// <summary>
+        /// Gets the index of the first tile with identical alpha values for each tile.
+        /// </summary>
+        /// <returns>
+        /// An array with one entry for each tile. The opaque tiles share the alpha image of the first
+        /// opaque tile, and the other tiles use the same index as <see cref="GetDuplicateTileIndexes"/>.
+        /// </returns>
+        public uint[] GetDuplicateAlphaTileIndexes()
+        {
+            uint[] duplicateAlphaTileIndexes = new uint[this.tiles.Length];
+            int firstOpaqueTileIndex = -1;
+
+            for (int i = 0; i < duplicateAlphaTileIndexes.Length; i++)
+            {
+                if (this.tiles[i].opaque)
+                {
+                    if (firstOpaqueTileIndex == -1)
+                    {
+                        firstOpaqueTileIndex = i;
+                    }
+
+                    duplicateAlphaTileIndexes[i] = (uint)firstOpaqueTileIndex;
+                }
+                else
+                {
+                    duplicateAlphaTileIndexes[i] = this.tiles[i].duplicateTileIndex;
+                }
+            }
+
+            return duplicateAlphaTileIndexes;
+        }
+    }
+}
@@ -19,47 +19,153 @@ namespace AvifFileType.Interop
     {
         private const string DllName = "AvifNative_x86.dll";
 
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern EncoderStatus CreateEncoderSession(EncoderOptions options, out EncoderSessionHandle session);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern void DestroyEncoderSession(IntPtr session);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern void TrimEncoderSession(EncoderSessionHandle session);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern EncoderStatus AnalyzeImage(
+            [In] ref BitmapData image,
+            [In] ref ImageGridLayout gridLayout,
+            int maxThreads,
+            [Out] TileAnalysis[] tiles);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern EncoderStatus AnalyzeImage(
+            [In] ref BitmapData image,
+            IntPtr gridLayout_MustBeZero,
+            int maxThreads,
+            [Out] TileAnalysis[] tiles);
+
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         internal static unsafe extern EncoderStatus CompressImage(
+            EncoderSessionHandle session,
             [In] ref BitmapData image,
-            EncoderOptions options,
             [In, Out] ProgressContext progressContext,
             [In] ref CICPColorData colorInfo,
             [MarshalAs(UnmanagedType.FunctionPtr)] CompressedAV1OutputAlloc outputAllocator,
             out IntPtr colorImage,
-            out IntPtr alphaImage);
+            out IntPtr alphaImage,
+            out EncodeStats stats);
 
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         internal static unsafe extern EncoderStatus CompressImage(
+            EncoderSessionHandle session,
             [In] ref BitmapData image,
-            EncoderOptions options,
             [In, Out] ProgressContext progressContext,
             [In] ref CICPColorData colorInfo,
             [MarshalAs(UnmanagedType.FunctionPtr)] CompressedAV1OutputAlloc outputAllocator,
             out IntPtr colorImage,
-            IntPtr alphaImage_MustBeZero);
+            IntPtr alphaImage_MustBeZero,
+            out EncodeStats stats);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static unsafe extern EncoderStatus CompressImageGrid(
+            EncoderSessionHandle session,
+            [In] ref BitmapData image,
+            [In] ref ImageGridLayout gridLayout,
+            [In] uint[] duplicateTileIndexes,
+            [In] uint[] duplicateAlphaTileIndexes,
+            [In, Out] ProgressContext progressContext,
+            [In] ref CICPColorData colorInfo,
+            [MarshalAs(UnmanagedType.FunctionPtr)] CompressedAV1OutputAlloc outputAllocator,
+            [Out] IntPtr[] colorImages,
+            [Out] IntPtr[] alphaImages,
+            [MarshalAs(UnmanagedType.FunctionPtr)] CompressedTileReady tileReady,
+            [Out] EncodeStats[] tileStats);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern EncoderStatus FindTargetSizeQuality(
+            [In] ref BitmapData image,
+            [In] ref ImageGridLayout gridLayout,
+            [In] uint[] duplicateTileIndexes,
+            [In] uint[] duplicateAlphaTileIndexes,
+            EncoderOptions options,
+            [In] ref CICPColorData colorInfo,
+            [MarshalAs(UnmanagedType.U1)] bool encodeAlpha,
+            ulong targetSize,
+            [In, Out] ProgressContext progressContext,
+            out TargetSizeResult result);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern EncoderStatus FindTargetSizeQuality(
+            [In] ref BitmapData image,
+            IntPtr gridLayout_MustBeZero,
+            IntPtr duplicateTileIndexes_MustBeZero,
+            IntPtr duplicateAlphaTileIndexes_MustBeZero,
+            EncoderOptions options,
+            [In] ref CICPColorData colorInfo,
+            [MarshalAs(UnmanagedType.U1)] bool encodeAlpha,
+            ulong targetSize,
+            [In, Out] ProgressContext progressContext,
+            out TargetSizeResult result);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern EncoderStatus SelectImageGridLayout(
+            uint width,
+            uint height,
+            CompressionSpeed compressionSpeed,
+            int maxThreads,
+            out ImageGridLayout gridLayout);
 
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         internal static extern unsafe DecoderStatus DecompressColorImage(
             byte* compressedColorImage,
             UIntPtr compressedColorImageSize,
+            DecoderOptions decoderOptions,
             [In] ref CICPColorData colorInfo,
             [In, Out] DecodeInfo decodeInfo,
-            [In] ref BitmapData fullImage);
+            [In] ref BitmapData fullImage,
+            out DecodeStats stats);
 
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         internal static extern unsafe DecoderStatus DecompressColorImage(
             byte* compressedColorImage,
             UIntPtr compressedColorImageSize,
+            DecoderOptions decoderOptions,
             IntPtr colorInfo_MustBeZero,
             [In, Out] DecodeInfo decodeInfo,
-            [In] ref BitmapData fullImage);
+            [In] ref BitmapData fullImage,
+            out DecodeStats stats);
 
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         internal static extern unsafe DecoderStatus DecompressAlphaImage(
             byte* compressedAlphaImage,
             UIntPtr compressedAlphaImageSize,
+            DecoderOptions decoderOptions,
             [In, Out] DecodeInfo decodeInfo,
-            [In] ref BitmapData fullImage);
+            [In] ref BitmapData fullImage,
+            out DecodeStats stats);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern unsafe DecoderStatus DecompressImage(
+            byte* compressedColorImage,
+            UIntPtr compressedColorImageSize,
+            byte* compressedAlphaImage,
+            UIntPtr compressedAlphaImageSize,
+            DecoderOptions decoderOptions,
+            [In] ref CICPColorData colorInfo,
+            [In, Out] DecodeInfo colorDecodeInfo,
+            [In, Out] DecodeInfo alphaDecodeInfo,
+            [In] ref BitmapData fullImage,
+            out DecodeStats stats);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        internal static extern unsafe DecoderStatus DecompressImage(
+            byte* compressedColorImage,
+            UIntPtr compressedColorImageSize,
+            byte* compressedAlphaImage,
+            UIntPtr compressedAlphaImageSize,
+            DecoderOptions decoderOptions,
+            IntPtr colorInfo_MustBeZero,
+            [In, Out] DecodeInfo colorDecodeInfo,
+            [In, Out] DecodeInfo alphaDecodeInfo,
+            [In] ref BitmapData fullImage,
+            out DecodeStats stats);
     }
 }
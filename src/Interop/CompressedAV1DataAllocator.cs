@@ -20,6 +20,10 @@ namespace AvifFileType.Interop
     [UnmanagedFunctionPointer(CallingConvention.StdCall)]
     internal delegate IntPtr CompressedAV1OutputAlloc(UIntPtr sizeInBytes);
 
+    [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.U1)]
+    internal delegate bool CompressedTileReady(uint tileIndex, IntPtr compressedColorImage, IntPtr compressedAlphaImage);
+
     internal sealed class CompressedAV1DataAllocator
         : IDisposable
     {
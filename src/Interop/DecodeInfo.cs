@@ -21,6 +21,11 @@ namespace AvifFileType.Interop
         public uint expectedHeight;
         public uint tileColumnIndex;
         public uint tileRowIndex;
+        public uint downsampleShift;
+        public uint outputX;
+        public uint outputY;
+        public OutputRotation outputRotation;
+        public OutputMirror outputMirror;
         public YUVChromaSubsampling chromaSubsampling;
         public uint bitDepth;
         public CICPColorData firstTileColorData;
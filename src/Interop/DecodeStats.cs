@@ -0,0 +1,30 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+using System.Runtime.InteropServices;
+
+namespace AvifFileType.Interop
+{
+    /// <summary>
+    /// The decoder statistics of an image or image grid tile, the times are in nanoseconds.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct DecodeStats
+    {
+        public ulong colorDecodeTime;
+        public ulong alphaDecodeTime;
+        public ulong conversionTime;
+        public ulong totalTime;
+        public ulong compressedSize;
+        public ulong frameBufferSize;
+        public int threadCount;
+    }
+}
@@ -24,6 +24,7 @@ namespace AvifFileType.Interop
         TileNclxProfileMismatch,
         UnsupportedBitDepth,
         UnknownYUVFormat,
-        TileFormatMismatch
+        TileFormatMismatch,
+        InvalidParameter
     }
 }
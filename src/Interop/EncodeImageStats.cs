@@ -0,0 +1,32 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+using System.Runtime.InteropServices;
+
+namespace AvifFileType.Interop
+{
+    /// <summary>
+    /// The encoder statistics of a color or alpha image, the times are in nanoseconds.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct EncodeImageStats
+    {
+        public ulong conversionTime;
+        public ulong encodeTime;
+        public ulong flushTime;
+        public ulong outputCopyTime;
+        public ulong callbackTime;
+        public ulong compressedSize;
+        public ulong frameBufferSize;
+        public int quantizer;
+        public int threadCount;
+    }
+}
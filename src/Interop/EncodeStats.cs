@@ -0,0 +1,28 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+using System.Runtime.InteropServices;
+
+namespace AvifFileType.Interop
+{
+    /// <summary>
+    /// The encoder statistics of an image or image grid tile, the times are in nanoseconds.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct EncodeStats
+    {
+        public EncodeImageStats color;
+        public EncodeImageStats alpha;
+        public ulong callbackTime;
+        public ulong totalTime;
+        public ulong frameBufferSize;
+    }
+}
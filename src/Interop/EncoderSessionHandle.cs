@@ -0,0 +1,39 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using Microsoft.Win32.SafeHandles;
+using System;
+
+namespace AvifFileType.Interop
+{
+    internal sealed class EncoderSessionHandle
+        : SafeHandleZeroOrMinusOneIsInvalid
+    {
+        private EncoderSessionHandle() : base(true)
+        {
+        }
+
+        protected override bool ReleaseHandle()
+        {
+            if (IntPtr.Size == 8)
+            {
+                AvifNative_64.DestroyEncoderSession(this.handle);
+            }
+            else
+            {
+                AvifNative_86.DestroyEncoderSession(this.handle);
+            }
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,154 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System;
+
+namespace AvifFileType.Interop
+{
+    /// <summary>
+    /// A reference to the process-wide native encoder session.
+    /// </summary>
+    /// <remarks>
+    /// The most recently used session is kept alive so that the next save with the same encoder options
+    /// can reuse its initialized AV1 encoders, the session is trimmed after each save to limit the memory
+    /// that its idle encoders retain.
+    /// The reference keeps the native session alive if it is replaced by a save with different options
+    /// while it is still in use.
+    /// </remarks>
+    internal sealed class EncoderSessionReference
+        : IDisposable
+    {
+        private static readonly object sync = new object();
+        private static EncoderSessionHandle cachedSession;
+        private static EncoderOptions cachedSessionOptions;
+
+        private EncoderSessionHandle handle;
+
+        private EncoderSessionReference(EncoderSessionHandle handle)
+        {
+            this.handle = handle;
+        }
+
+        public EncoderSessionHandle Handle
+        {
+            get
+            {
+                if (this.handle is null)
+                {
+                    ExceptionUtil.ThrowObjectDisposedException(nameof(EncoderSessionReference));
+                }
+
+                return this.handle;
+            }
+        }
+
+        public static EncoderSessionReference Acquire(EncoderOptions options)
+        {
+            if (options is null)
+            {
+                ExceptionUtil.ThrowArgumentNullException(nameof(options));
+            }
+
+            lock (sync)
+            {
+                if (cachedSession is null || !HasSameValues(cachedSessionOptions, options))
+                {
+                    EncoderSessionHandle session = CreateSession(options);
+
+                    cachedSession?.Dispose();
+                    cachedSession = session;
+                    cachedSessionOptions = new EncoderOptions
+                    {
+                        quality = options.quality,
+                        compressionSpeed = options.compressionSpeed,
+                        yuvFormat = options.yuvFormat,
+                        maxThreads = options.maxThreads
+                    };
+                }
+
+                bool success = false;
+                cachedSession.DangerousAddRef(ref success);
+
+                return new EncoderSessionReference(cachedSession);
+            }
+        }
+
+        /// <summary>
+        /// Releases most of the memory that is retained by the idle encoders of the cached session.
+        /// </summary>
+        public static void TrimCachedSession()
+        {
+            lock (sync)
+            {
+                if (cachedSession != null)
+                {
+                    if (IntPtr.Size == 8)
+                    {
+                        AvifNative_64.TrimEncoderSession(cachedSession);
+                    }
+                    else
+                    {
+                        AvifNative_86.TrimEncoderSession(cachedSession);
+                    }
+                }
+            }
+        }
+
+        public void Dispose()
+        {
+            if (this.handle != null)
+            {
+                this.handle.DangerousRelease();
+                this.handle = null;
+            }
+        }
+
+        private static EncoderSessionHandle CreateSession(EncoderOptions options)
+        {
+            EncoderSessionHandle session;
+            EncoderStatus status;
+
+            if (IntPtr.Size == 8)
+            {
+                status = AvifNative_64.CreateEncoderSession(options, out session);
+            }
+            else
+            {
+                status = AvifNative_86.CreateEncoderSession(options, out session);
+            }
+
+            if (status != EncoderStatus.Ok)
+            {
+                session?.Dispose();
+
+                if (status == EncoderStatus.OutOfMemory)
+                {
+                    throw new OutOfMemoryException();
+                }
+                else
+                {
+                    throw new FormatException("Unable to create the AV1 encoder session.");
+                }
+            }
+
+            return session;
+        }
+
+        private static bool HasSameValues(EncoderOptions first, EncoderOptions second)
+        {
+            return first.quality == second.quality
+                && first.compressionSpeed == second.compressionSpeed
+                && first.yuvFormat == second.yuvFormat
+                && first.maxThreads == second.maxThreads;
+        }
+    }
+}
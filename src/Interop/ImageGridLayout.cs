@@ -0,0 +1,25 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System.Runtime.InteropServices;
+
+namespace AvifFileType.Interop
+{
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct ImageGridLayout
+    {
+        public uint tileColumnCount;
+        public uint tileRowCount;
+        public uint tileWidth;
+        public uint tileHeight;
+    }
+}
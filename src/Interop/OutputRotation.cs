@@ -0,0 +1,23 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+namespace AvifFileType.Interop
+{
+    internal enum OutputRotation
+    {
+        None,
+        Rotate90CCW,
+        Rotate180,
+        Rotate270CCW
+    }
+}
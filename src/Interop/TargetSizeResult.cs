@@ -0,0 +1,30 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+using System.Runtime.InteropServices;
+
+namespace AvifFileType.Interop
+{
+    /// <summary>
+    /// The result of a target file size search.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct TargetSizeResult
+    {
+        public int quality;
+        public int quantizer;
+        public ulong compressedSize;
+        public uint probeEncodeCount;
+        public uint refineEncodeCount;
+        [MarshalAs(UnmanagedType.U1)]
+        public bool targetSizeMet;
+    }
+}
@@ -0,0 +1,30 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-avif, a FileType plugin for Paint.NET
+// that loads and saves AVIF images.
+//
+// Copyright (c) 2020, 2021 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using PaintDotNet;
+using System.Runtime.InteropServices;
+
+namespace AvifFileType.Interop
+{
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct TileAnalysis
+    {
+        [MarshalAs(UnmanagedType.U1)]
+        public bool grayscale;
+        [MarshalAs(UnmanagedType.U1)]
+        public bool opaque;
+        [MarshalAs(UnmanagedType.U1)]
+        public bool solidColor;
+        public ColorBgra color;
+        public uint duplicateTileIndex;
+    }
+}
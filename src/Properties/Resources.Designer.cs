@@ -176,5 +176,23 @@ namespace AvifFileType.Properties {
                 return ResourceManager.GetString("Quality_DisplayName", resourceCulture);
             }
         }
+        
+        /// <summary>
+        ///   Looks up a localized string similar to Selects the highest quality that fits, 0 uses the quality setting.
+        /// </summary>
+        internal static string TargetFileSize_Description {
+            get {
+                return ResourceManager.GetString("TargetFileSize_Description", resourceCulture);
+            }
+        }
+        
+        /// <summary>
+        ///   Looks up a localized string similar to Target File Size (KB).
+        /// </summary>
+        internal static string TargetFileSize_DisplayName {
+            get {
+                return ResourceManager.GetString("TargetFileSize_DisplayName", resourceCulture);
+            }
+        }
     }
 }